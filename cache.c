@@ -0,0 +1,1029 @@
+/**
+ * @file cache.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Cache odpovedí s ohľadom na TTL
+ */
+
+#include "cache.h"
+#include "dns_parser.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Odhad priemernej veľkosti záznamu pre dimenzovanie hash tabuľky */
+#define DNS_CACHE_AVG_ENTRY     256
+
+/* Formát snapshotu cache (-C) */
+#define DNS_CACHE_FILE_MAGIC    "DNSCACH"
+#define DNS_CACHE_FILE_VERSION  2
+#define DNS_CACHE_FILE_BYTE_ORDER 0x01020304u
+
+/**
+ * @brief Hlavička snapshotu cache
+ *
+ * Za hlavičkou nasledujú záznamy (dns_cache_file_record_t + wire
+ * odpoveď) bez zarovnania, čítajú sa cez memcpy().
+ */
+typedef struct {
+    char magic[8];                      /* DNS_CACHE_FILE_MAGIC */
+    uint32_t version;                   /* DNS_CACHE_FILE_VERSION */
+    uint32_t byte_order;                /* DNS_CACHE_FILE_BYTE_ORDER v natívnom poradí */
+    uint64_t saved_at;                  /* Čas zápisu (Unix sekundy) */
+    uint64_t entry_count;               /* Počet záznamov */
+} dns_cache_file_header_t;
+
+/**
+ * @brief Hlavička jedného záznamu snapshotu
+ */
+typedef struct {
+    uint64_t expires_at;                /* Absolútna expirácia (Unix sekundy) */
+    uint32_t response_len;              /* Dĺžka odpovede za hlavičkou */
+    uint8_t dnssec;                     /* DO a CD bity kľúča */
+    uint8_t reserved[3];                /* Zarovnanie (0) */
+} dns_cache_file_record_t;
+
+/**
+ * @brief Načíta 16-bitové číslo v network byte order
+ */
+static uint16_t read_u16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/**
+ * @brief Načíta 32-bitové číslo v network byte order
+ */
+static uint32_t read_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/**
+ * @brief Zapíše 32-bitové číslo v network byte order
+ */
+static void write_u32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+/**
+ * @brief Vráti shard pre daný hash
+ */
+static dns_cache_shard_t *shard_for(dns_cache_t *cache, uint32_t hash) {
+    return &cache->shards[hash % DNS_CACHE_SHARDS];
+}
+
+/**
+ * @brief Vyberie záznam z LRU zoznamu
+ */
+static void lru_unlink(dns_cache_entry_t *entry) {
+    entry->lru_prev->lru_next = entry->lru_next;
+    entry->lru_next->lru_prev = entry->lru_prev;
+}
+
+/**
+ * @brief Vloží záznam na začiatok jeho LRU zoznamu (najnovší)
+ */
+static void lru_push_front(dns_cache_shard_t *shard, dns_cache_entry_t *entry) {
+    dns_cache_entry_t *lru = entry->negative ? &shard->neg_lru : &shard->lru;
+
+    entry->lru_prev = lru;
+    entry->lru_next = lru->lru_next;
+    lru->lru_next->lru_prev = entry;
+    lru->lru_next = entry;
+}
+
+/**
+ * @brief Odstráni záznam zo shardu a uvoľní ho
+ */
+static void shard_remove(dns_cache_shard_t *shard, dns_cache_entry_t *entry) {
+    dns_cache_entry_t **link = &shard->buckets[entry->hash & shard->bucket_mask];
+
+    while (*link != NULL && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (*link == entry) {
+        *link = entry->hash_next;
+    }
+
+    lru_unlink(entry);
+    shard->bytes -= entry->size;
+    shard->entries--;
+    if (entry->negative) {
+        shard->neg_bytes -= entry->size;
+        shard->neg_entries--;
+    }
+    free(entry);
+}
+
+/**
+ * @brief Nájde záznam v sharde podľa kľúča
+ */
+static dns_cache_entry_t *shard_find(dns_cache_shard_t *shard, const dns_cache_key_t *key) {
+    dns_cache_entry_t *entry = shard->buckets[key->hash & shard->bucket_mask];
+
+    for (; entry != NULL; entry = entry->hash_next) {
+        if (entry->hash == key->hash &&
+            entry->qtype == key->qtype &&
+            entry->qclass == key->qclass &&
+            entry->dnssec == key->dnssec &&
+            entry->name_len == key->name_len &&
+            memcmp(entry->name, key->name, key->name_len) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Vytvorí cache
+ *
+ * Kvóta sa delí rovnomerne medzi shardy; počet bucketov sa odvodí z
+ * kvóty a odhadovanej veľkosti záznamu (mocnina 2).
+ *
+ * Edge cases:
+ * - Nulová kvóta
+ * - Memory allocation failure
+ */
+dns_cache_t *dns_cache_create(size_t budget_bytes, size_t negative_bytes, uint32_t stale_sec) {
+    if (budget_bytes == 0) {
+        return NULL;
+    }
+
+    dns_cache_t *cache = (dns_cache_t *)calloc(1, sizeof(dns_cache_t));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    cache->budget = budget_bytes;
+    cache->negative_budget = negative_bytes;
+    cache->stale_ms = (uint64_t)stale_sec * 1000u;
+
+    size_t shard_budget = budget_bytes / DNS_CACHE_SHARDS;
+    size_t buckets = 64;
+    while (buckets < shard_budget / DNS_CACHE_AVG_ENTRY) {
+        buckets <<= 1;
+    }
+
+    for (size_t i = 0; i < DNS_CACHE_SHARDS; i++) {
+        dns_cache_shard_t *shard = &cache->shards[i];
+
+        shard->buckets = (dns_cache_entry_t **)calloc(buckets, sizeof(dns_cache_entry_t *));
+        if (shard->buckets == NULL) {
+            dns_cache_destroy(cache);
+            return NULL;
+        }
+
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->bucket_mask = buckets - 1;
+        shard->budget = shard_budget;
+        shard->neg_budget = negative_bytes / DNS_CACHE_SHARDS;
+        shard->lru.lru_next = &shard->lru;
+        shard->lru.lru_prev = &shard->lru;
+        shard->neg_lru.lru_next = &shard->neg_lru;
+        shard->neg_lru.lru_prev = &shard->neg_lru;
+    }
+
+    return cache;
+}
+
+/**
+ * @brief Uvoľní cache
+ */
+void dns_cache_destroy(dns_cache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < DNS_CACHE_SHARDS; i++) {
+        dns_cache_shard_t *shard = &cache->shards[i];
+
+        if (shard->buckets == NULL) {
+            continue;
+        }
+
+        while (shard->lru.lru_next != &shard->lru) {
+            shard_remove(shard, shard->lru.lru_next);
+        }
+        while (shard->neg_lru.lru_next != &shard->neg_lru) {
+            shard_remove(shard, shard->neg_lru.lru_next);
+        }
+
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->lock);
+    }
+
+    free(cache);
+}
+
+/**
+ * @brief Zostaví z question section kľúč bez DNSSEC bitov
+ *
+ * Meno sa skopíruje bez dekódovania, iba ASCII písmená sa prevedú na
+ * malé (DNS mená sú case-insensitive, RFC 4343). Hash ešte nezahŕňa
+ * DNSSEC bity (doplní ich key_set_dnssec()).
+ *
+ * Edge cases:
+ * - QDCOUNT != 1
+ * - Kompresia v question section
+ * - Meno dlhšie ako 255 bajtov
+ */
+static int parse_question(const uint8_t *packet, size_t len, dns_cache_key_t *key) {
+
+    if (read_u16(packet + 4) != 1) {
+        return -1;
+    }
+
+    size_t pos = DNS_HEADER_SIZE;
+    size_t out = 0;
+    uint32_t hash = 2166136261u;
+
+    for (;;) {
+        if (pos >= len) {
+            return -1;
+        }
+
+        uint8_t label = packet[pos];
+        if (label > DNS_MAX_LABEL_LEN || out + label + 1 > DNS_MAX_NAME_LEN ||
+            pos + label + 1 > len) {
+            return -1;
+        }
+
+        key->name[out++] = label;
+        hash = (hash ^ label) * 16777619u;
+        pos++;
+
+        if (label == 0) {
+            break;
+        }
+
+        for (uint8_t i = 0; i < label; i++) {
+            uint8_t c = packet[pos++];
+            if (c >= 'A' && c <= 'Z') {
+                c = (uint8_t)(c + ('a' - 'A'));
+            }
+            key->name[out++] = c;
+            hash = (hash ^ c) * 16777619u;
+        }
+    }
+
+    if (pos + 4 > len) {
+        return -1;
+    }
+
+    key->name_len = out;
+    key->qtype = read_u16(packet + pos);
+    key->qclass = read_u16(packet + pos + 2);
+    key->question_end = pos + 4;
+
+    hash = (hash ^ (key->qtype & 0xFF)) * 16777619u;
+    hash = (hash ^ (key->qtype >> 8)) * 16777619u;
+    hash = (hash ^ (key->qclass & 0xFF)) * 16777619u;
+    key->hash = hash;
+    key->dnssec = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Doplní do kľúča z parse_question() DNSSEC bity
+ */
+static void key_set_dnssec(dns_cache_key_t *key, uint8_t dnssec) {
+    key->dnssec = dnssec;
+    key->hash = (key->hash ^ dnssec) * 16777619u;
+}
+
+/**
+ * @brief Zostaví kľúč cache z wire-format paketu (dotazu)
+ *
+ * Okrem otázky kľúč obsahuje CD bit z hlavičky a DO bit z OPT.
+ *
+ * Edge cases:
+ * - Neplatná question section (viď parse_question())
+ * - Poškodený alebo viacnásobný OPT
+ */
+int dns_cache_key_from_packet(const uint8_t *packet, size_t len, dns_cache_key_t *key) {
+    if (packet == NULL || key == NULL || len < DNS_HEADER_SIZE ||
+        parse_question(packet, len, key) != 0) {
+        return -1;
+    }
+
+    uint8_t dnssec = 0;
+    if (read_u16(packet + 2) & DNS_FLAG_CD) {
+        dnssec |= DNS_CACHE_KEY_CD;
+    }
+
+    /* OPT je v additional section - bez nej netreba prechádzať RR */
+    if (read_u16(packet + 10) != 0) {
+        dns_edns_t edns;
+        if (dns_parse_edns(packet, len, &edns) != 0) {
+            return -1;
+        }
+        if (edns.dnssec_ok) {
+            dnssec |= DNS_CACHE_KEY_DO;
+        }
+    }
+
+    key_set_dnssec(key, dnssec);
+    return 0;
+}
+
+/**
+ * @brief Nájde záznam, ktorý ešte smie ísť klientovi (aj po TTL v stale okne)
+ *
+ * Záznam za hranicou stale okna sa odstráni.
+ */
+static dns_cache_entry_t *shard_find_usable(const dns_cache_t *cache, dns_cache_shard_t *shard,
+                                            const dns_cache_key_t *key, uint64_t now_ms) {
+    dns_cache_entry_t *entry = shard_find(shard, key);
+
+    if (entry != NULL && now_ms >= entry->expires_ms + cache->stale_ms) {
+        shard->expirations++;
+        shard_remove(shard, entry);
+        entry = NULL;
+    }
+
+    return entry;
+}
+
+/**
+ * @brief Skopíruje uloženú odpoveď do out a upraví TTL polia
+ * @return Dĺžka odpovede, 0 ak sa nezmestí do out
+ *
+ * TTL sa znížia o čas strávený v cache, stale odpoveď (po expirácii)
+ * dostane vo všetkých RR DNS_CACHE_STALE_TTL (RFC 8767 Section 4).
+ */
+static size_t copy_entry(dns_cache_shard_t *shard, dns_cache_entry_t *entry,
+                         uint8_t *out, size_t out_size, uint64_t now_ms) {
+    if (entry->response_len > out_size) {
+        return 0;
+    }
+
+    /* LRU - záznam je najnovší */
+    lru_unlink(entry);
+    lru_push_front(shard, entry);
+
+    size_t len = entry->response_len;
+    memcpy(out, entry->response, len);
+
+    bool stale = now_ms >= entry->expires_ms;
+    uint32_t elapsed = (uint32_t)((now_ms - entry->stored_ms) / 1000u);
+    for (uint16_t i = 0; i < entry->ttl_count; i++) {
+        uint8_t *ttl = out + entry->ttl_offsets[i];
+        uint32_t value = read_u32(ttl);
+        if (stale) {
+            write_u32(ttl, DNS_CACHE_STALE_TTL);
+        } else {
+            write_u32(ttl, value > elapsed ? value - elapsed : 0);
+        }
+    }
+
+    if (stale) {
+        shard->stale_hits++;
+    }
+    return len;
+}
+
+/**
+ * @brief Prepíše ID a question section odpovede na tie z dotazu klienta
+ */
+static void copy_question(const dns_cache_key_t *key, const uint8_t *query, uint8_t *out) {
+    /* Rovnaká dĺžka ako kľúč - question section je bez kompresie */
+    out[0] = query[0];
+    out[1] = query[1];
+    memcpy(out + DNS_HEADER_SIZE, query + DNS_HEADER_SIZE,
+           key->question_end - DNS_HEADER_SIZE);
+}
+
+/**
+ * @brief Vyhľadá odpoveď v cache
+ *
+ * Odpoveď sa skopíruje do out tak ako prišla od upstream; prepíše sa iba
+ * transaction ID, question section (zachová sa veľkosť písmen z dotazu
+ * klienta) a TTL polia na uložených offsetoch.
+ *
+ * Pozitívny záznam s aspoň DNS_CACHE_PREFETCH_HITS zásahmi, ktorému
+ * ostáva posledných DNS_CACHE_PREFETCH_PERCENT % TTL, si vyžiada obnovu,
+ * aby populárne mená medzi klientmi nikdy nevypadli z cache.
+ *
+ * Expirovaný záznam v stale okne sa vráti iba vtedy, ak už raz upstream
+ * nestihol termín klienta (dns_cache_lookup_stale()) - vtedy ide stale
+ * odpoveď hneď a obnova beží na pozadí (RFC 8767 Section 5).
+ *
+ * Edge cases:
+ * - Expirovaný záznam (mimo stale okna sa odstráni)
+ * - Malý výstupný buffer
+ * - Obnova, na ktorú neprišla odpoveď (po DNS_CACHE_REFRESH_RETRY_MS sa zopakuje)
+ */
+size_t dns_cache_lookup(dns_cache_t *cache, const dns_cache_key_t *key,
+                        const uint8_t *query, uint8_t *out, size_t out_size,
+                        uint64_t now_ms, bool *prefetch) {
+    if (prefetch != NULL) {
+        *prefetch = false;
+    }
+
+    if (cache == NULL || key == NULL || query == NULL || out == NULL) {
+        return 0;
+    }
+
+    dns_cache_shard_t *shard = shard_for(cache, key->hash);
+    size_t len = 0;
+
+    pthread_mutex_lock(&shard->lock);
+
+    dns_cache_entry_t *entry = shard_find_usable(cache, shard, key, now_ms);
+    bool stale = entry != NULL && now_ms >= entry->expires_ms;
+
+    if (stale && !entry->stale_served) {
+        entry = NULL;
+    }
+
+    if (entry != NULL) {
+        if (entry->hits < UINT32_MAX) {
+            entry->hits++;
+        }
+
+        uint64_t lifetime = entry->expires_ms - entry->stored_ms;
+        bool hot = !entry->negative && entry->hits >= DNS_CACHE_PREFETCH_HITS &&
+                   !stale && (entry->expires_ms - now_ms) * 100 <=
+                             lifetime * DNS_CACHE_PREFETCH_PERCENT;
+        bool idle = !entry->prefetching ||
+                    now_ms >= entry->prefetch_ms + DNS_CACHE_REFRESH_RETRY_MS;
+
+        if (prefetch != NULL && (hot || stale) && idle) {
+            entry->prefetching = true;
+            entry->prefetch_ms = now_ms;
+            shard->prefetches++;
+            *prefetch = true;
+        }
+
+        len = copy_entry(shard, entry, out, out_size, now_ms);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    if (len > 0) {
+        copy_question(key, query, out);
+    }
+
+    return len;
+}
+
+/**
+ * @brief Vyhľadá odpoveď aj po expirácii TTL (serve-stale)
+ *
+ * Volá sa, keď upstream nestihol termín klienta. Záznam sa označí, takže
+ * ďalšie dotazy naň dostanú stale odpoveď hneď z dns_cache_lookup().
+ */
+size_t dns_cache_lookup_stale(dns_cache_t *cache, const dns_cache_key_t *key,
+                              const uint8_t *query, uint8_t *out, size_t out_size,
+                              uint64_t now_ms) {
+    if (cache == NULL || key == NULL || query == NULL || out == NULL) {
+        return 0;
+    }
+
+    dns_cache_shard_t *shard = shard_for(cache, key->hash);
+    size_t len = 0;
+
+    pthread_mutex_lock(&shard->lock);
+
+    dns_cache_entry_t *entry = shard_find_usable(cache, shard, key, now_ms);
+    if (entry != NULL) {
+        if (now_ms >= entry->expires_ms) {
+            entry->stale_served = true;
+        }
+        len = copy_entry(shard, entry, out, out_size, now_ms);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    if (len > 0) {
+        copy_question(key, query, out);
+    }
+
+    return len;
+}
+
+/**
+ * @brief Uloží odpoveď upstream do cache
+ *
+ * Prejdú sa všetky RR (answer, authority, additional), zapamätajú sa
+ * offsety ich TTL polí a ako doba platnosti sa použije najmenšie TTL.
+ * Pri negatívnej odpovedi sa započíta aj MINIMUM zo SOA a TTL SOA sa v
+ * uloženej kópii prepíše na výslednú dobu platnosti, aby klient z
+ * odpovede z cache nevyčítal dlhší negatívny TTL (RFC 2308 Section 5).
+ *
+ * Edge cases:
+ * - Odpoveď nie je NOERROR ani NXDOMAIN / má TC bit
+ * - Negatívna odpoveď bez SOA v authority section (necachuje sa)
+ * - Question section nezodpovedá kľúču
+ * - Poškodené RR (odpoveď sa neuloží)
+ * - TTL 0 (necachuje sa)
+ * - Existujúci záznam s rovnakým kľúčom (nahradí sa)
+ */
+int dns_cache_store(dns_cache_t *cache, const dns_cache_key_t *key,
+                    const uint8_t *response, size_t len, uint64_t now_ms) {
+    if (cache == NULL || key == NULL || response == NULL ||
+        len < key->question_end || len > UINT16_MAX) {
+        return -1;
+    }
+
+    uint16_t flags = read_u16(response + 2);
+    uint16_t rcode = flags & 0x000F;
+    if (!(flags & DNS_FLAG_QR) || (flags & DNS_FLAG_TC) ||
+        (rcode != DNS_RCODE_NOERROR && rcode != DNS_RCODE_NXDOMAIN)) {
+        return -1;
+    }
+
+    /* NXDOMAIN alebo NODATA (NOERROR s prázdnou answer section) */
+    bool negative = rcode == DNS_RCODE_NXDOMAIN || read_u16(response + 6) == 0;
+    if (negative && cache->negative_budget == 0) {
+        return -1;
+    }
+
+    /* Odpoveď musí patriť k tomuto kľúču (DNSSEC bity sú z dotazu) */
+    dns_cache_key_t resp_key;
+    if (parse_question(response, len, &resp_key) != 0 ||
+        resp_key.name_len != key->name_len ||
+        memcmp(resp_key.name, key->name, key->name_len) != 0 ||
+        resp_key.qtype != key->qtype || resp_key.qclass != key->qclass) {
+        return -1;
+    }
+
+    /* Prechod všetkých RR - offsety TTL a minimálne TTL */
+    uint16_t ttl_offsets[DNS_CACHE_MAX_RRS];
+    uint16_t ttl_count = 0;
+    uint32_t min_ttl = negative ? DNS_CACHE_MAX_NEGATIVE_TTL : DNS_CACHE_MAX_TTL;
+    size_t soa_ttl_offset = 0;
+
+    dns_rr_iter_t iter;
+    dns_rr_t rr;
+    int rc;
+
+    if (dns_rr_iter_init(&iter, response, len) != 0) {
+        return -1;
+    }
+
+    while ((rc = dns_rr_iter_next(&iter, &rr)) == 1) {
+        /* Pole TTL pri OPT pseudo-RR nie je TTL (RFC 6891) */
+        if (rr.section == DNS_SECTION_QUESTION || rr.type == DNS_TYPE_OPT) {
+            continue;
+        }
+
+        if (ttl_count == DNS_CACHE_MAX_RRS) {
+            return -1;
+        }
+        ttl_offsets[ttl_count++] = (uint16_t)rr.ttl_offset;
+        if (rr.ttl < min_ttl) {
+            min_ttl = rr.ttl;
+        }
+
+        /* TTL negatívnej odpovede = min(TTL SOA, MINIMUM) */
+        uint32_t minimum;
+        if (negative && soa_ttl_offset == 0 && rr.section == DNS_SECTION_AUTHORITY &&
+            rr.type == DNS_TYPE_SOA &&
+            dns_parse_soa_minimum(response, len, &rr, &minimum) == 0) {
+            soa_ttl_offset = rr.ttl_offset;
+            if (minimum < min_ttl) {
+                min_ttl = minimum;
+            }
+        }
+    }
+
+    if (rc != 0) {
+        return -1;
+    }
+
+    if (min_ttl == 0 || (negative && soa_ttl_offset == 0)) {
+        return -1;
+    }
+
+    /* Jedna alokácia: hlavička | meno | offsety | odpoveď */
+    size_t offsets_at = (key->name_len + 1) & ~(size_t)1;
+    size_t response_at = offsets_at + ttl_count * sizeof(uint16_t);
+    size_t size = sizeof(dns_cache_entry_t) + response_at + len;
+
+    dns_cache_shard_t *shard = shard_for(cache, key->hash);
+    if (size > (negative ? shard->neg_budget : shard->budget)) {
+        return -1;
+    }
+
+    dns_cache_entry_t *entry = (dns_cache_entry_t *)malloc(size);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    entry->hash = key->hash;
+    entry->qtype = key->qtype;
+    entry->qclass = key->qclass;
+    entry->dnssec = key->dnssec;
+    entry->name_len = (uint16_t)key->name_len;
+    entry->ttl_count = ttl_count;
+    entry->response_len = (uint16_t)len;
+    entry->negative = negative;
+    entry->prefetching = false;
+    entry->stale_served = false;
+    entry->hits = 0;
+    entry->prefetch_ms = 0;
+    entry->stored_ms = now_ms;
+    entry->expires_ms = now_ms + (uint64_t)min_ttl * 1000u;
+    entry->size = size;
+    uint8_t *data = (uint8_t *)(entry + 1);
+    entry->name = data;
+    entry->ttl_offsets = (uint16_t *)(void *)(data + offsets_at);
+    entry->response = data + response_at;
+
+    memcpy(entry->name, key->name, key->name_len);
+    memcpy(entry->ttl_offsets, ttl_offsets, ttl_count * sizeof(uint16_t));
+    memcpy(entry->response, response, len);
+    if (negative) {
+        write_u32(entry->response + soa_ttl_offset, min_ttl);
+    }
+
+    pthread_mutex_lock(&shard->lock);
+
+    /* Obnovený záznam zdedí polovicu zásahov - populárne meno ostáva horúce */
+    dns_cache_entry_t *old = shard_find(shard, key);
+    if (old != NULL) {
+        entry->hits = old->hits / 2;
+        shard_remove(shard, old);
+    }
+
+    /* Eviction najstarších záznamov kým sa nový nezmestí do kvóty */
+    if (negative) {
+        while (shard->neg_bytes + size > shard->neg_budget &&
+               shard->neg_lru.lru_prev != &shard->neg_lru) {
+            shard_remove(shard, shard->neg_lru.lru_prev);
+            shard->evictions++;
+        }
+    } else {
+        while (shard->bytes - shard->neg_bytes + size > shard->budget &&
+               shard->lru.lru_prev != &shard->lru) {
+            shard_remove(shard, shard->lru.lru_prev);
+            shard->evictions++;
+        }
+    }
+
+    dns_cache_entry_t **bucket = &shard->buckets[key->hash & shard->bucket_mask];
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    lru_push_front(shard, entry);
+    shard->bytes += size;
+    shard->entries++;
+    if (negative) {
+        shard->neg_bytes += size;
+        shard->neg_entries++;
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return 0;
+}
+
+/**
+ * @brief Vráti súhrnné štatistiky
+ */
+void dns_cache_get_stats(dns_cache_t *cache, dns_cache_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    if (cache == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < DNS_CACHE_SHARDS; i++) {
+        dns_cache_shard_t *shard = &cache->shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+        stats->entries += shard->entries;
+        stats->bytes += shard->bytes;
+        stats->negative_entries += shard->neg_entries;
+        stats->negative_bytes += shard->neg_bytes;
+        stats->evictions += shard->evictions;
+        stats->expirations += shard->expirations;
+        stats->prefetches += shard->prefetches;
+        stats->stale_hits += shard->stale_hits;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+/**
+ * @brief Zapíše celý buffer (opakuje write() pri čiastočnom zápise)
+ */
+static int write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Serializuje platné záznamy jedného LRU zoznamu (od najstaršieho)
+ * @return Koniec zapísaných dát v out
+ */
+static uint8_t *serialize_lru(const dns_cache_entry_t *sentinel, uint8_t *out,
+                              uint64_t now_ms, uint64_t now_sec, size_t *count) {
+    for (const dns_cache_entry_t *entry = sentinel->lru_prev; entry != sentinel;
+         entry = entry->lru_prev) {
+        if (entry->expires_ms < now_ms + 1000u) {
+            continue;
+        }
+
+        dns_cache_file_record_t record;
+        record.expires_at = now_sec + (entry->expires_ms - now_ms) / 1000u;
+        record.response_len = entry->response_len;
+        record.dnssec = entry->dnssec;
+        memset(record.reserved, 0, sizeof(record.reserved));
+        memcpy(out, &record, sizeof(record));
+        out += sizeof(record);
+
+        /* Zostávajúce TTL - rovnako ako pri odpovedi z cache */
+        memcpy(out, entry->response, entry->response_len);
+        uint32_t elapsed = (uint32_t)((now_ms - entry->stored_ms) / 1000u);
+        for (uint16_t i = 0; i < entry->ttl_count; i++) {
+            uint8_t *ttl = out + entry->ttl_offsets[i];
+            uint32_t value = read_u32(ttl);
+            write_u32(ttl, value > elapsed ? value - elapsed : 0);
+        }
+        out += entry->response_len;
+        (*count)++;
+    }
+    return out;
+}
+
+/**
+ * @brief Serializuje shard do nového bufferu
+ * @return 0 pri úspechu, -1 pri nedostatku pamäte
+ *
+ * Zámok shardu sa drží iba počas kopírovania do pamäte, zápis na disk
+ * beží bez neho - workeri čakajú najviac na memcpy() jedného shardu.
+ */
+static int shard_serialize(dns_cache_shard_t *shard, uint64_t now_ms, uint64_t now_sec,
+                           uint8_t **data, size_t *len, size_t *count) {
+    const dns_cache_entry_t *lists[2] = { &shard->lru, &shard->neg_lru };
+
+    pthread_mutex_lock(&shard->lock);
+
+    size_t size = 0;
+    for (size_t l = 0; l < 2; l++) {
+        for (const dns_cache_entry_t *entry = lists[l]->lru_prev; entry != lists[l];
+             entry = entry->lru_prev) {
+            size += sizeof(dns_cache_file_record_t) + entry->response_len;
+        }
+    }
+
+    uint8_t *buffer = (uint8_t *)malloc(size > 0 ? size : 1);
+    if (buffer == NULL) {
+        pthread_mutex_unlock(&shard->lock);
+        return -1;
+    }
+
+    uint8_t *end = buffer;
+    for (size_t l = 0; l < 2; l++) {
+        end = serialize_lru(lists[l], end, now_ms, now_sec, count);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    *data = buffer;
+    *len = (size_t)(end - buffer);
+    return 0;
+}
+
+/**
+ * @brief Zapíše snapshot cache
+ *
+ * Rovnako ako prekompilovaný filter sa zapisuje do "<path>.tmp", ktorý
+ * sa po fsync() premenuje - pád počas zápisu nechá predchádzajúci
+ * snapshot nedotknutý. Počet záznamov sa do hlavičky doplní na konci.
+ *
+ * Edge cases:
+ * - Prázdna cache (snapshot iba s hlavičkou)
+ * - Expirované záznamy a záznamy s menej ako sekundou TTL (neukladajú sa)
+ * - Chyba zápisu (dočasný súbor sa zmaže)
+ */
+int dns_cache_save(dns_cache_t *cache, const char *path, uint64_t now_ms,
+                   uint64_t now_sec, size_t *saved) {
+    if (saved != NULL) {
+        *saved = 0;
+    }
+    if (cache == NULL || path == NULL) {
+        return -1;
+    }
+
+    dns_cache_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DNS_CACHE_FILE_MAGIC, sizeof(header.magic));
+    header.version = DNS_CACHE_FILE_VERSION;
+    header.byte_order = DNS_CACHE_FILE_BYTE_ORDER;
+    header.saved_at = now_sec;
+
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        print_error("Cache snapshot path too long: %s", path);
+        return -1;
+    }
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        print_error("Cannot create %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    int rc = write_all(fd, &header, sizeof(header));
+    size_t count = 0;
+
+    for (size_t i = 0; rc == 0 && i < DNS_CACHE_SHARDS; i++) {
+        uint8_t *data;
+        size_t len;
+        if (shard_serialize(&cache->shards[i], now_ms, now_sec, &data, &len, &count) != 0) {
+            errno = ENOMEM;
+            rc = -1;
+            break;
+        }
+        rc = write_all(fd, data, len);
+        free(data);
+    }
+
+    header.entry_count = count;
+    if (rc != 0 ||
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        fsync(fd) != 0) {
+        print_error("Cannot write %s: %s", tmp_path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    close(fd);
+
+    if (rename(tmp_path, path) != 0) {
+        print_error("Cannot rename %s to %s: %s", tmp_path, path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    if (saved != NULL) {
+        *saved = count;
+    }
+    return 0;
+}
+
+/**
+ * @brief Zníži TTL všetkých RR odpovede o elapsed sekúnd
+ * @return 0 pri úspechu, -1 ak odpoveď nie je platná
+ */
+static int age_response(uint8_t *response, size_t len, uint32_t elapsed) {
+    dns_rr_iter_t iter;
+    dns_rr_t rr;
+    int rc;
+
+    if (dns_rr_iter_init(&iter, response, len) != 0) {
+        return -1;
+    }
+
+    while ((rc = dns_rr_iter_next(&iter, &rr)) == 1) {
+        if (rr.section == DNS_SECTION_QUESTION || rr.type == DNS_TYPE_OPT) {
+            continue;
+        }
+        write_u32(response + rr.ttl_offset, rr.ttl > elapsed ? rr.ttl - elapsed : 0);
+    }
+
+    return rc == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Načíta snapshot cache
+ *
+ * Súbor sa namapuje a prechádza sekvenčne (MADV_SEQUENTIAL), takže
+ * štart s miliónmi záznamov nepotrebuje ďalšiu pamäť okrem samotnej
+ * cache. Snapshot nie je dôveryhodný tak ako prekompilovaný filter -
+ * každá odpoveď sa overí v dns_cache_store().
+ *
+ * Edge cases:
+ * - Neexistujúci snapshot (prvý štart, nie je chyba)
+ * - Zlý magic / verzia / poradie bajtov
+ * - Orezaný súbor (načítané záznamy ostávajú)
+ * - Hodiny posunuté dozadu (TTL sa neznižujú)
+ */
+int dns_cache_load(dns_cache_t *cache, const char *path, uint64_t now_ms,
+                   uint64_t now_sec, size_t *loaded) {
+    if (loaded != NULL) {
+        *loaded = 0;
+    }
+    if (cache == NULL || path == NULL) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        print_error("Cannot open cache snapshot %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(dns_cache_file_header_t)) {
+        print_error("Cache snapshot too short: %s", path);
+        close(fd);
+        return -1;
+    }
+
+    size_t file_size = (size_t)st.st_size;
+    void *map = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        print_error("Cannot mmap cache snapshot %s: %s", path, strerror(errno));
+        return -1;
+    }
+    madvise(map, file_size, MADV_SEQUENTIAL);
+
+    const dns_cache_file_header_t *header = (const dns_cache_file_header_t *)map;
+    uint8_t *buffer = (uint8_t *)malloc(UINT16_MAX);
+
+    if (memcmp(header->magic, DNS_CACHE_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != DNS_CACHE_FILE_VERSION ||
+        header->byte_order != DNS_CACHE_FILE_BYTE_ORDER || buffer == NULL) {
+        print_error("Invalid cache snapshot: %s", path);
+        free(buffer);
+        munmap(map, file_size);
+        return -1;
+    }
+
+    uint64_t age = now_sec > header->saved_at ? now_sec - header->saved_at : 0;
+    uint32_t elapsed = age < UINT32_MAX ? (uint32_t)age : UINT32_MAX;
+    const uint8_t *data = (const uint8_t *)map;
+    size_t offset = sizeof(*header);
+    size_t count = 0;
+    int ret = 0;
+
+    for (uint64_t i = 0; i < header->entry_count; i++) {
+        dns_cache_file_record_t record;
+        if (file_size - offset < sizeof(record)) {
+            ret = -1;
+            break;
+        }
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        if (record.response_len > UINT16_MAX || record.response_len > file_size - offset) {
+            ret = -1;
+            break;
+        }
+        size_t len = record.response_len;
+        memcpy(buffer, data + offset, len);
+        offset += len;
+
+        if (record.expires_at <= now_sec) {
+            continue;
+        }
+
+        dns_cache_key_t key;
+        if (age_response(buffer, len, elapsed) != 0 ||
+            parse_question(buffer, len, &key) != 0) {
+            continue;
+        }
+
+        /* DNSSEC bity patria dotazu, nie odpovedi - sú v zázname */
+        key_set_dnssec(&key, record.dnssec & (DNS_CACHE_KEY_DO | DNS_CACHE_KEY_CD));
+        if (dns_cache_store(cache, &key, buffer, len, now_ms) == 0) {
+            count++;
+        }
+    }
+
+    if (ret != 0) {
+        print_error("Truncated cache snapshot: %s", path);
+    }
+
+    free(buffer);
+    munmap(map, file_size);
+
+    if (loaded != NULL) {
+        *loaded = count;
+    }
+    return ret;
+}
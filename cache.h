@@ -0,0 +1,270 @@
+/**
+ * @file cache.h
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Cache odpovedí s ohľadom na TTL
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "dns.h"
+
+#include <pthread.h>
+
+/* Počet nezávislých shardov (každý má vlastný zámok) */
+#define DNS_CACHE_SHARDS        16
+
+/* Predvolená pamäťová kvóta v MB (-c parameter, 0 = cache vypnutá) */
+#define DNS_CACHE_DEFAULT_MB    16
+
+/* Predvolená kvóta negatívnych odpovedí v MB (-n parameter, 0 = necachujú sa) */
+#define DNS_CACHE_NEGATIVE_DEFAULT_MB 4
+
+/* Horná hranica TTL uloženej odpovede (sekundy) */
+#define DNS_CACHE_MAX_TTL       86400
+
+/* Horná hranica TTL negatívnej odpovede (RFC 2308 Section 5 - 3 hodiny) */
+#define DNS_CACHE_MAX_NEGATIVE_TTL 10800
+
+/* Prefetch: záznam s aspoň toľkými zásahmi sa obnoví v poslednom
+ * DNS_CACHE_PREFETCH_PERCENT % svojho TTL */
+#define DNS_CACHE_PREFETCH_HITS 8
+#define DNS_CACHE_PREFETCH_PERCENT 10
+
+/* Obnova, na ktorú neprišla odpoveď, sa smie zopakovať až po tomto čase
+ * (celkový timeout upstream dotazu) */
+#define DNS_CACHE_REFRESH_RETRY_MS 5000
+
+/* TTL v stale odpovedi (RFC 8767 Section 4 odporúča 30 s) */
+#define DNS_CACHE_STALE_TTL     30
+
+/* Najdlhšie serve-stale okno (-S) - RFC 8767 Section 5 odporúča 1-3 dni */
+#define DNS_CACHE_MAX_STALE_SEC (3 * 86400)
+
+/* Maximálny počet RR v uloženej odpovedi (offsety TTL polí) */
+#define DNS_CACHE_MAX_RRS       64
+
+/* Interval periodického zápisu snapshotu cache (-C) v sekundách */
+#define DNS_CACHE_SNAPSHOT_SEC  300
+
+/* DNSSEC bity dotazu v kľúči cache (dns_cache_key_t.dnssec) */
+#define DNS_CACHE_KEY_DO        0x01    /* DO bit v OPT (odpoveď s RRSIG) */
+#define DNS_CACHE_KEY_CD        0x02    /* CD bit (upstream nevalidoval) */
+
+/**
+ * @brief Kľúč cache - (normalizované QNAME, QTYPE, QCLASS, DO, CD)
+ *
+ * QNAME je vo wire formáte s písmenami prevedenými na malé, takže sa
+ * kľúč dá zostaviť priamo z prijatého paketu bez dekódovania mena.
+ * Odpoveď závisí aj od DO a CD bitov dotazu - CD=1 odpoveď nesmie
+ * dostať validujúci klient a DO=1 klient odpoveď bez RRSIG.
+ */
+typedef struct {
+    uint8_t name[DNS_MAX_NAME_LEN + 1]; /* Wire-format QNAME (lowercase) */
+    size_t name_len;                    /* Dĺžka vrátane koncovej 0 */
+    uint16_t qtype;                     /* QTYPE */
+    uint16_t qclass;                    /* QCLASS */
+    uint8_t dnssec;                     /* DNS_CACHE_KEY_DO | DNS_CACHE_KEY_CD */
+    size_t question_end;                /* Offset za question section */
+    uint32_t hash;                      /* FNV-1a hash kľúča */
+} dns_cache_key_t;
+
+/**
+ * @brief Záznam cache (uložená wire odpoveď upstream)
+ *
+ * Meno, offsety TTL polí a samotná odpoveď sú v jednej alokácii hneď
+ * za hlavičkou záznamu, takže záznam = jeden malloc().
+ */
+typedef struct dns_cache_entry {
+    struct dns_cache_entry *hash_next;  /* Reťazenie v buckete */
+    struct dns_cache_entry *lru_prev;   /* LRU zoznam (novší) */
+    struct dns_cache_entry *lru_next;   /* LRU zoznam (starší) */
+    uint32_t hash;                      /* Hash kľúča */
+    uint16_t qtype;                     /* QTYPE */
+    uint16_t qclass;                    /* QCLASS */
+    uint16_t name_len;                  /* Dĺžka mena */
+    uint16_t ttl_count;                 /* Počet TTL polí */
+    uint16_t response_len;              /* Dĺžka odpovede */
+    uint8_t dnssec;                     /* DO a CD bity kľúča */
+    bool negative;                      /* NXDOMAIN / NODATA (vlastná kvóta a LRU) */
+    bool prefetching;                   /* Obnova už bola vyžiadaná */
+    bool stale_served;                  /* Upstream nestihol termín - po TTL ide stale hneď */
+    uint32_t hits;                      /* Počet zásahov (prenáša sa do obnoveného záznamu) */
+    uint64_t prefetch_ms;               /* Čas poslednej vyžiadanej obnovy */
+    uint64_t stored_ms;                 /* Čas uloženia */
+    uint64_t expires_ms;                /* Čas expirácie (najmenšie TTL) */
+    size_t size;                        /* Započítaná veľkosť v bajtoch */
+    uint8_t *name;                      /* Za hlavičkou: meno */
+    uint16_t *ttl_offsets;              /* Za menom: offsety TTL polí */
+    uint8_t *response;                  /* Za offsetmi: odpoveď */
+} dns_cache_entry_t;
+
+/**
+ * @brief Shard cache - hash tabuľka + LRU pod jedným zámkom
+ *
+ * Negatívne odpovede majú vlastný LRU zoznam a kvótu, takže záplava
+ * neexistujúcich mien vytláča iba iné negatívne odpovede.
+ */
+typedef struct {
+    pthread_mutex_t lock;               /* Zámok shardu */
+    dns_cache_entry_t **buckets;        /* Hash tabuľka */
+    size_t bucket_mask;                 /* Počet bucketov - 1 (mocnina 2) */
+    dns_cache_entry_t lru;              /* Sentinel LRU (next = najnovší) */
+    size_t bytes;                       /* Obsadená pamäť */
+    size_t budget;                      /* Kvóta shardu */
+    size_t entries;                     /* Počet záznamov */
+    dns_cache_entry_t neg_lru;          /* Sentinel LRU negatívnych odpovedí */
+    size_t neg_bytes;                   /* Pamäť negatívnych odpovedí */
+    size_t neg_budget;                  /* Kvóta negatívnych odpovedí */
+    size_t neg_entries;                 /* Počet negatívnych odpovedí */
+    unsigned long evictions;            /* Vyhodené kvôli kvóte */
+    unsigned long expirations;          /* Odstránené po expirácii TTL */
+    unsigned long prefetches;           /* Vyžiadané obnovy pred expiráciou */
+    unsigned long stale_hits;           /* Odpovede po expirácii TTL (serve-stale) */
+} dns_cache_shard_t;
+
+/**
+ * @brief Cache odpovedí zdieľaná všetkými workermi
+ */
+typedef struct {
+    dns_cache_shard_t shards[DNS_CACHE_SHARDS];
+    size_t budget;                      /* Kvóta pozitívnych odpovedí v bajtoch */
+    size_t negative_budget;             /* Kvóta negatívnych odpovedí v bajtoch */
+    uint64_t stale_ms;                  /* Ako dlho po TTL sa záznam drží (0 = serve-stale vypnuté) */
+} dns_cache_t;
+
+/**
+ * @brief Súhrnné štatistiky cache
+ */
+typedef struct {
+    size_t entries;                     /* Aktuálny počet záznamov */
+    size_t bytes;                       /* Obsadená pamäť */
+    size_t negative_entries;            /* Z toho negatívne odpovede */
+    size_t negative_bytes;              /* Pamäť negatívnych odpovedí */
+    unsigned long evictions;            /* Vyhodené kvôli kvóte */
+    unsigned long expirations;          /* Expirované záznamy */
+    unsigned long prefetches;           /* Vyžiadané obnovy pred expiráciou */
+    unsigned long stale_hits;           /* Stale odpovede */
+} dns_cache_stats_t;
+
+/**
+ * @brief Vytvorí cache s danými pamäťovými kvótami
+ * @param budget_bytes Kvóta pozitívnych odpovedí v bajtoch (> 0)
+ * @param negative_bytes Kvóta negatívnych odpovedí v bajtoch (0 = necachujú sa)
+ * @param stale_sec Ako dlho po expirácii TTL smie záznam ísť ako stale
+ *                  odpoveď (RFC 8767, 0 = vypnuté)
+ * @return Nová cache alebo NULL pri chybe
+ */
+dns_cache_t *dns_cache_create(size_t budget_bytes, size_t negative_bytes, uint32_t stale_sec);
+
+/**
+ * @brief Uvoľní cache a všetky záznamy
+ * @param cache Cache (môže byť NULL)
+ */
+void dns_cache_destroy(dns_cache_t *cache);
+
+/**
+ * @brief Zostaví kľúč cache z wire-format dotazu (otázka, CD bit, DO bit z OPT)
+ * @param packet DNS paket
+ * @param len Dĺžka paketu
+ * @param key Výstupný kľúč
+ * @return 0 pri úspechu, -1 ak paket nemá práve jednu platnú otázku alebo
+ *         má poškodený OPT
+ */
+int dns_cache_key_from_packet(const uint8_t *packet, size_t len, dns_cache_key_t *key);
+
+/**
+ * @brief Vyhľadá odpoveď v cache
+ * @param cache Cache
+ * @param key Kľúč dotazu
+ * @param query Dotaz klienta (ID a question section sa skopírujú do odpovede)
+ * @param out Výstupný buffer
+ * @param out_size Veľkosť výstupného bufferu
+ * @param now_ms Aktuálny monotónny čas
+ * @param prefetch Výstup (môže byť NULL): true ak treba záznam obnoviť z upstream
+ * @return Dĺžka odpovede v out, 0 ak záznam nie je v cache (alebo expiroval)
+ *
+ * TTL všetkých RR sa znížia o čas strávený v cache priamo vo wire dátach.
+ * Prefetch sa pre jeden záznam ohlási najviac raz za
+ * DNS_CACHE_REFRESH_RETRY_MS - až kým ho nenahradí čerstvá odpoveď
+ * (dns_cache_store()) alebo neexpiruje. Expirovaný záznam sa vráti iba
+ * po dns_cache_lookup_stale() (upstream nestíha) a vždy si vyžiada obnovu.
+ */
+size_t dns_cache_lookup(dns_cache_t *cache, const dns_cache_key_t *key,
+                        const uint8_t *query, uint8_t *out, size_t out_size,
+                        uint64_t now_ms, bool *prefetch);
+
+/**
+ * @brief Vyhľadá odpoveď aj po expirácii TTL, ak je v stale okne (RFC 8767)
+ * @param cache Cache
+ * @param key Kľúč dotazu
+ * @param query Dotaz klienta (ID a question section sa skopírujú do odpovede)
+ * @param out Výstupný buffer
+ * @param out_size Veľkosť výstupného bufferu
+ * @param now_ms Aktuálny monotónny čas
+ * @return Dĺžka odpovede v out (stale odpoveď má TTL DNS_CACHE_STALE_TTL),
+ *         0 ak záznam nie je v cache ani v stale okne
+ */
+size_t dns_cache_lookup_stale(dns_cache_t *cache, const dns_cache_key_t *key,
+                              const uint8_t *query, uint8_t *out, size_t out_size,
+                              uint64_t now_ms);
+
+/**
+ * @brief Uloží odpoveď upstream do cache
+ * @param cache Cache
+ * @param key Kľúč dotazu
+ * @param response Wire-format odpoveď
+ * @param len Dĺžka odpovede
+ * @param now_ms Aktuálny monotónny čas
+ * @return 0 ak bola odpoveď uložená, -1 ak nie je cachovateľná
+ *
+ * Cachujú sa úplné NOERROR odpovede s aspoň jedným záznamom v answer
+ * section a nenulovým TTL. NXDOMAIN a NODATA (NOERROR bez odpovede) sa
+ * cachujú iba so SOA v authority section, na min(TTL SOA, MINIMUM)
+ * (RFC 2308 Section 5), a to v kvóte negatívnych odpovedí.
+ */
+int dns_cache_store(dns_cache_t *cache, const dns_cache_key_t *key,
+                    const uint8_t *response, size_t len, uint64_t now_ms);
+
+/**
+ * @brief Vráti súhrnné štatistiky všetkých shardov
+ * @param cache Cache
+ * @param stats Výstupné štatistiky
+ */
+void dns_cache_get_stats(dns_cache_t *cache, dns_cache_stats_t *stats);
+
+/**
+ * @brief Zapíše platné záznamy cache do súboru (warm restart)
+ * @param cache Cache
+ * @param path Cesta k snapshotu (zapisuje sa cez "<path>.tmp" + rename)
+ * @param now_ms Aktuálny monotónny čas
+ * @param now_sec Aktuálny čas v Unix sekundách (absolútne expirácie)
+ * @param saved Výstup (môže byť NULL): počet zapísaných záznamov
+ * @return 0 pri úspechu, -1 pri chybe zápisu
+ *
+ * Odpovede sa ukladajú so zostávajúcimi TTL a absolútnym časom expirácie,
+ * v každom shardi od najstaršej po najnovšiu, takže načítanie obnoví aj
+ * poradie LRU.
+ */
+int dns_cache_save(dns_cache_t *cache, const char *path, uint64_t now_ms,
+                   uint64_t now_sec, size_t *saved);
+
+/**
+ * @brief Načíta snapshot z dns_cache_save() do cache
+ * @param cache Cache
+ * @param path Cesta k snapshotu
+ * @param now_ms Aktuálny monotónny čas
+ * @param now_sec Aktuálny čas v Unix sekundách
+ * @param loaded Výstup (môže byť NULL): počet načítaných záznamov
+ * @return 0 pri úspechu (aj keď snapshot neexistuje), -1 ak je neplatný
+ *         alebo orezaný (už načítané záznamy ostávajú v cache)
+ *
+ * Záznamy s expiráciou v minulosti sa preskočia, ostatným sa TTL znížia
+ * o čas od zápisu snapshotu. Každá odpoveď prejde rovnakou kontrolou
+ * ako v dns_cache_store().
+ */
+int dns_cache_load(dns_cache_t *cache, const char *path, uint64_t now_ms,
+                   uint64_t now_sec, size_t *loaded);
+
+#endif /* CACHE_H */
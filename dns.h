@@ -21,10 +21,27 @@
 #define DNS_MAX_NAME_LEN        255     /* Maximálna dĺžka celého mena */
 #define DNS_UDP_MAX_SIZE        512     /* Maximálna veľkosť UDP správy */
 #define DNS_HEADER_SIZE         12      /* Veľkosť DNS hlavičky */
+#define DNS_TCP_MAX_SIZE        65535   /* Najväčšia správa cez TCP (2-bajtová dĺžka) */
+
+/* EDNS(0) (RFC 6891) */
+#define DNS_EDNS_UDP_SIZE       1232    /* Ohlasovaný UDP payload (upstream aj klientom) */
+#define DNS_EDNS_MAX_SIZE       4096    /* Najväčšia prijatá odpoveď upstream */
+#define DNS_OPT_RR_SIZE         11      /* OPT RR bez volieb (meno, typ, trieda, TTL, RDLENGTH) */
 
 /* DNS Port */
 #define DNS_DEFAULT_PORT        53      /* Predvolený DNS port */
 
+/* Upstream servery (-s parameter, opakovateľný) */
+#define DNS_MAX_UPSTREAMS       8       /* Maximálny počet upstream serverov */
+
+/* Worker vlákna (-t parameter) */
+#define DNS_DEFAULT_THREADS     1       /* Predvolený počet workerov */
+#define DNS_MAX_THREADS         64      /* Maximálny počet workerov */
+
+/* Dávkové UDP I/O (-b parameter, recvmmsg/sendmmsg) */
+#define DNS_DEFAULT_BATCH       32      /* Predvolená veľkosť dávky */
+#define DNS_MAX_BATCH           1024    /* Maximálna veľkosť dávky */
+
 /* DNS QTYPE values (RFC 1035 Section 3.2.2) */
 #define DNS_TYPE_A              1       /* Host address */
 #define DNS_TYPE_NS             2       /* Authoritative name server */
@@ -34,6 +51,7 @@
 #define DNS_TYPE_MX             15      /* Mail exchange */
 #define DNS_TYPE_TXT            16      /* Text strings */
 #define DNS_TYPE_AAAA           28      /* IPv6 address */
+#define DNS_TYPE_OPT            41      /* EDNS(0) pseudo-RR (RFC 6891) */
 
 /* DNS QCLASS values (RFC 1035 Section 3.2.4) */
 #define DNS_CLASS_IN            1       /* Internet */
@@ -48,10 +66,12 @@
 
 /* DNS Header Flags (RFC 1035 Section 4.1.1) */
 #define DNS_FLAG_QR             0x8000  /* Query/Response bit */
+#define DNS_FLAG_OPCODE         0x7800  /* Opcode (4 bity, 0 = QUERY) */
 #define DNS_FLAG_AA             0x0400  /* Authoritative Answer */
 #define DNS_FLAG_TC             0x0200  /* Truncation */
 #define DNS_FLAG_RD             0x0100  /* Recursion Desired */
 #define DNS_FLAG_RA             0x0080  /* Recursion Available */
+#define DNS_FLAG_CD             0x0010  /* Checking Disabled (RFC 4035) */
 
 /* DNS Label compression (RFC 1035 Section 4.1.4) */
 #define DNS_COMPRESSION_MASK    0xC0    /* 11000000 - pointer prefix */
@@ -110,6 +130,85 @@ typedef struct {
     size_t raw_len;             /* Dĺžka surových dát */
 } dns_message_t;
 
+/**
+ * @brief Zero-copy pohľad na DNS správu
+ *
+ * Obsahuje iba offsety a dĺžky do bufferu volajúceho - na rozdiel od
+ * dns_message_t sa nič nekopíruje ani nealokuje. Buffer musí byť platný
+ * počas celého používania pohľadu.
+ */
+typedef struct {
+    const uint8_t *packet;      /* Buffer volajúceho */
+    size_t len;                 /* Dĺžka správy */
+    dns_header_t header;        /* Dekódovaná hlavička */
+    size_t qname_offset;        /* Začiatok QNAME prvej otázky */
+    size_t qname_len;           /* Bajty QNAME v pakete (vrátane pointera) */
+    bool qname_compressed;      /* QNAME končí compression pointerom */
+    uint16_t qtype;             /* QTYPE prvej otázky */
+    uint16_t qclass;            /* QCLASS prvej otázky */
+    size_t question_end;        /* Offset za prvou otázkou (za QCLASS) */
+    size_t questions_end;       /* Offset za poslednou otázkou */
+} dns_view_t;
+
+/**
+ * @brief EDNS(0) informácie z OPT pseudo-RR (RFC 6891 Section 6.1)
+ *
+ * Rovnaká štruktúra slúži na parsovanie (dns_parse_edns()) aj skladanie
+ * OPT záznamu (dns_append_opt()) - pri skladaní sa offsety ignorujú.
+ */
+typedef struct {
+    bool present;               /* Správa obsahuje OPT */
+    uint16_t udp_size;          /* Veľkosť UDP payloadu odosielateľa (CLASS) */
+    uint8_t ext_rcode;          /* Horných 8 bitov rozšíreného RCODE */
+    uint8_t version;            /* Verzia EDNS */
+    bool dnssec_ok;             /* DO bit */
+    size_t opt_offset;          /* Začiatok OPT RR v správe */
+    size_t opt_len;             /* Dĺžka OPT RR vrátane RDATA */
+} dns_edns_t;
+
+/**
+ * @brief Sekcie DNS správy (RFC 1035 Section 4.1)
+ */
+typedef enum {
+    DNS_SECTION_QUESTION = 0,
+    DNS_SECTION_ANSWER,
+    DNS_SECTION_AUTHORITY,
+    DNS_SECTION_ADDITIONAL,
+    DNS_SECTION_COUNT
+} dns_section_t;
+
+/**
+ * @brief Jeden záznam (RR alebo otázka) dekódovaný priamo z wire dát
+ *
+ * Meno vlastníka ani RDATA sa nekopírujú - iba offsety do paketu. Pre
+ * otázku sú ttl, ttl_offset, rdata_offset a rdlength nulové.
+ */
+typedef struct {
+    dns_section_t section;      /* Sekcia, v ktorej záznam leží */
+    size_t name_offset;         /* Začiatok mena vlastníka (môže byť komprimované) */
+    uint16_t type;              /* TYPE / QTYPE */
+    uint16_t rr_class;          /* CLASS / QCLASS (pri OPT veľkosť UDP payloadu) */
+    uint32_t ttl;               /* TTL v sekundách */
+    size_t ttl_offset;          /* Offset TTL poľa (na prepis pri odpovedi z cache) */
+    size_t rdata_offset;        /* Začiatok RDATA */
+    uint16_t rdlength;          /* Dĺžka RDATA */
+} dns_rr_t;
+
+/**
+ * @brief Lenivý iterátor cez všetky štyri sekcie správy
+ *
+ * Každé volanie dns_rr_iter_next() dekóduje iba nasledujúci záznam,
+ * nič sa neparsuje dopredu ani nealokuje.
+ */
+typedef struct {
+    const uint8_t *packet;      /* Buffer volajúceho */
+    size_t len;                 /* Dĺžka správy */
+    size_t pos;                 /* Offset nasledujúceho záznamu */
+    uint16_t counts[DNS_SECTION_COUNT]; /* QDCOUNT, ANCOUNT, NSCOUNT, ARCOUNT */
+    dns_section_t section;      /* Aktuálna sekcia */
+    uint16_t index;             /* Index záznamu v aktuálnej sekcii */
+} dns_rr_iter_t;
+
 /* ============================================================================
  * FILTER ŠTRUKTÚRA (Trie pre efektívne vyhľadávanie)
  * ============================================================================ */
@@ -120,6 +219,12 @@ typedef struct {
  * Trie je organizovaný odzadu (TLD najprv):
  * Príklad: ads.google.com -> com -> google -> ads
  * 
+ * Uzly s veľkým počtom detí (napr. "com") majú navyše open-addressing
+ * hash index, úzke uzly sa prehľadávajú lineárne.
+ * 
+ * Po načítaní sa Trie dá zbaliť do kompaktnej formy (filter_compact()),
+ * koreň potom slúži iba ako handle pre is_domain_blocked().
+ * 
  * Edge cases:
  * - Prázdne domény
  * - Veľmi dlhé domény (>255 znakov)
@@ -131,7 +236,12 @@ typedef struct filter_node {
     struct filter_node **children;  /* Pole detí */
     size_t children_count;          /* Počet detí */
     size_t children_capacity;       /* Kapacita poľa detí */
+    struct filter_node **child_index; /* Hash index detí (NULL = lineárne hľadanie) */
+    size_t index_mask;              /* Veľkosť indexu - 1 (mocnina 2) */
+    uint32_t label_hash;            /* FNV-1a hash labelu */
+    uint8_t label_len;              /* Dĺžka labelu */
     bool is_blocked;                /* True = táto doména je blokovaná */
+    struct filter_compact *compact; /* Kompaktná forma (iba koreň po filter_compact()) */
 } filter_node_t;
 
 /* ============================================================================
@@ -142,10 +252,22 @@ typedef struct filter_node {
  * @brief Konfigurácia DNS servera
  */
 typedef struct {
-    char *upstream_server;      /* IP/hostname upstream DNS servera */
+    char *upstream_servers[DNS_MAX_UPSTREAMS]; /* IP/hostname upstream DNS serverov */
+    unsigned int upstream_count; /* Počet upstream serverov (-s, aspoň 1) */
     uint16_t local_port;        /* Lokálny port (default 53) */
     char *filter_file;          /* Cesta k filter súboru */
+    bool filter_compiled;       /* filter_file je prekompilovaný (-F, mmap) */
+    bool filter_watch;          /* Reload pri zmene filter_file (-w, inotify) */
     bool verbose;               /* Verbose logging (-v parameter) */
+    unsigned int num_threads;   /* Počet worker vlákien (-t parameter) */
+    unsigned int batch_size;    /* Datagramov na recvmmsg/sendmmsg (-b, 1 = vypnuté) */
+    unsigned int upstream_refresh_sec; /* Interval obnovy upstream adresy (-r, 0 = vypnuté) */
+    unsigned int rto_max_ms;    /* Strop retransmission timeoutu upstream dotazov (-T) */
+    unsigned int hedge_percent; /* Rozpočet hedged upstream dotazov v % (-H, 0 = vypnuté) */
+    unsigned int cache_size_mb; /* Kvóta cache odpovedí v MB (-c, 0 = vypnutá) */
+    unsigned int negative_cache_mb; /* Kvóta negatívnych odpovedí v MB (-n, 0 = necachujú sa) */
+    unsigned int stale_sec;     /* Serve-stale okno po TTL v sekundách (-S, 0 = vypnuté) */
+    char *cache_file;           /* Snapshot cache pre warm restart (-C, NULL = žiadny) */
     filter_node_t *filter_root; /* Koreň Trie štruktúry filtrov */
 } server_config_t;
 
@@ -107,6 +107,190 @@ int build_error_response(const dns_message_t *query, uint8_t rcode,
     return 0;
 }
 
+/**
+ * @brief Prepíše dotaz na chybovú odpoveď v mieste
+ */
+size_t build_error_in_place(uint8_t *packet, size_t question_end, uint8_t rcode) {
+    if (!packet || question_end <= DNS_HEADER_SIZE || rcode > DNS_RCODE_REFUSED) {
+        return 0;
+    }
+
+    /* ID ostáva, flags ako v build_error_response() */
+    dns_header_t resp_header;
+    resp_header.id = (uint16_t)((packet[0] << 8) | packet[1]);
+    resp_header.flags = DNS_FLAG_QR | (((packet[2] << 8) | packet[3]) & DNS_FLAG_RD) | rcode;
+    resp_header.qdcount = 1;
+    resp_header.ancount = 0;
+    resp_header.nscount = 0;
+    resp_header.arcount = 0;
+
+    if (build_dns_header(packet, &resp_header) != 0) {
+        return 0;
+    }
+
+    return question_end;
+}
+
+/**
+ * @brief Vytvorí chybovú odpoveď zo zero-copy pohľadu
+ */
+size_t build_error_from_view(const dns_view_t *view, uint8_t rcode,
+                             uint8_t *response, size_t response_size) {
+    if (!view || !view->packet || !response || rcode > DNS_RCODE_REFUSED) {
+        return 0;
+    }
+
+    /* Otázka sa kopíruje celá vrátane prípadného compression pointera -
+     * ten ukazuje dozadu do otázky alebo hlavičky, ktoré sú v odpovedi
+     * na rovnakých offsetoch */
+    size_t question_size = view->header.qdcount > 0 ?
+                           view->question_end - DNS_HEADER_SIZE : 0;
+    size_t resp_len = DNS_HEADER_SIZE + question_size;
+
+    if (resp_len > response_size) {
+        return 0;
+    }
+
+    dns_header_t resp_header;
+    resp_header.id = view->header.id;
+    resp_header.flags = DNS_FLAG_QR | (view->header.flags & DNS_FLAG_RD) | rcode;
+    resp_header.qdcount = view->header.qdcount > 0 ? 1 : 0;
+    resp_header.ancount = 0;
+    resp_header.nscount = 0;
+    resp_header.arcount = 0;
+
+    if (build_dns_header(response, &resp_header) != 0) {
+        return 0;
+    }
+
+    memcpy(response + DNS_HEADER_SIZE, view->packet + DNS_HEADER_SIZE, question_size);
+    return resp_len;
+}
+
+/**
+ * @brief Pridá OPT pseudo-RR na koniec správy (RFC 6891 Section 6.1.2)
+ */
+size_t dns_append_opt(uint8_t *packet, size_t len, size_t size, const dns_edns_t *edns) {
+    if (!packet || !edns || len < DNS_HEADER_SIZE || len + DNS_OPT_RR_SIZE > size) {
+        return 0;
+    }
+
+    uint16_t arcount = (uint16_t)((packet[10] << 8) | packet[11]);
+    if (arcount == UINT16_MAX) {
+        return 0;
+    }
+
+    uint8_t *opt = packet + len;
+
+    opt[0] = 0;                                 /* NAME = koreň */
+    opt[1] = 0;                                 /* TYPE = OPT */
+    opt[2] = DNS_TYPE_OPT;
+    opt[3] = (edns->udp_size >> 8) & 0xFF;      /* CLASS = UDP payload */
+    opt[4] = edns->udp_size & 0xFF;
+    opt[5] = edns->ext_rcode;                   /* TTL = EXT-RCODE, VERSION, DO, Z */
+    opt[6] = edns->version;
+    opt[7] = edns->dnssec_ok ? 0x80 : 0x00;
+    opt[8] = 0;
+    opt[9] = 0;                                 /* RDLENGTH = 0 (bez volieb) */
+    opt[10] = 0;
+
+    arcount++;
+    packet[10] = (arcount >> 8) & 0xFF;
+    packet[11] = arcount & 0xFF;
+
+    return len + DNS_OPT_RR_SIZE;
+}
+
+/**
+ * @brief Odstráni OPT pseudo-RR zo správy
+ */
+size_t dns_remove_opt(uint8_t *packet, size_t len, const dns_edns_t *edns) {
+    if (!packet || !edns || len < DNS_HEADER_SIZE) {
+        return 0;
+    }
+
+    if (!edns->present) {
+        return len;
+    }
+
+    uint16_t arcount = (uint16_t)((packet[10] << 8) | packet[11]);
+    size_t opt_end = edns->opt_offset + edns->opt_len;
+
+    if (arcount == 0 || edns->opt_offset < DNS_HEADER_SIZE || opt_end > len) {
+        return 0;
+    }
+
+    /* Za OPT môžu byť ešte ďalšie additional RR (TSIG/SIG(0) sú až za ním) */
+    memmove(packet + edns->opt_offset, packet + opt_end, len - opt_end);
+
+    arcount--;
+    packet[10] = (arcount >> 8) & 0xFF;
+    packet[11] = arcount & 0xFF;
+
+    return len - edns->opt_len;
+}
+
+/**
+ * @brief Prispôsobí odpoveď klientovi
+ *
+ * Postup:
+ * 1. Odstránenie OPT z odpovede (veľkosť payloadu upstream klienta nezaujíma)
+ * 2. Ak by odpoveď (aj s naším OPT) prekročila payload, ostane iba
+ *    hlavička + question section a nastaví sa TC (RFC 2181 Section 9)
+ * 3. Klient s EDNS dostane náš OPT (DNS_EDNS_UDP_SIZE, DO podľa dotazu,
+ *    rozšírený RCODE z upstream)
+ */
+size_t dns_fit_response(uint8_t *packet, size_t len, size_t size, const dns_edns_t *client,
+                        size_t payload) {
+    if (!packet || !client) {
+        return 0;
+    }
+
+    dns_edns_t resp_edns;
+    if (dns_parse_edns(packet, len, &resp_edns) != 0) {
+        return 0;
+    }
+
+    len = dns_remove_opt(packet, len, &resp_edns);
+    if (len == 0) {
+        return 0;
+    }
+
+    size_t opt_size = client->present ? DNS_OPT_RR_SIZE : 0;
+
+    if (len + opt_size > payload) {
+        dns_rr_iter_t iter;
+        dns_rr_t rr;
+        size_t questions_end = DNS_HEADER_SIZE;
+
+        if (dns_rr_iter_init(&iter, packet, len) != 0) {
+            return 0;
+        }
+        while (dns_rr_iter_next(&iter, &rr) == 1 && rr.section == DNS_SECTION_QUESTION) {
+            questions_end = iter.pos;
+        }
+
+        uint16_t flags = (uint16_t)((packet[2] << 8) | packet[3]) | DNS_FLAG_TC;
+        packet[2] = (flags >> 8) & 0xFF;
+        packet[3] = flags & 0xFF;
+        memset(packet + 6, 0, 6);               /* ANCOUNT, NSCOUNT, ARCOUNT */
+        len = questions_end;
+    }
+
+    if (client->present) {
+        dns_edns_t opt;
+        memset(&opt, 0, sizeof(opt));
+        opt.present = true;
+        opt.udp_size = DNS_EDNS_UDP_SIZE;
+        opt.ext_rcode = resp_edns.ext_rcode;
+        opt.dnssec_ok = client->dnssec_ok;
+
+        len = dns_append_opt(packet, len, size, &opt);
+    }
+
+    return len;
+}
+
 /**
  * @brief Vytvorí DNS header do bufferu
  */
@@ -27,6 +27,69 @@
 int build_error_response(const dns_message_t *query, uint8_t rcode, 
                          uint8_t **response, size_t *resp_len);
 
+/**
+ * @brief Prepíše prijatý dotaz na chybovú odpoveď priamo v jeho bufferi
+ * @param packet Buffer s dotazom (prepíše sa hlavička)
+ * @param question_end Koniec prvej otázky (za QCLASS) - dĺžka odpovede
+ * @param rcode Response code
+ * @return Dĺžka odpovede, 0 pri chybe
+ *
+ * Výsledok je rovnaký ako pri build_error_response() pre dotaz s jednou
+ * otázkou: QR=1, RD podľa dotazu, RCODE, QDCOUNT=1, ostatné sekcie
+ * prázdne (všetko za otázkou sa odreže). Nealokuje pamäť.
+ */
+size_t build_error_in_place(uint8_t *packet, size_t question_end, uint8_t rcode);
+
+/**
+ * @brief Vytvorí chybovú odpoveď zo zero-copy pohľadu do bufferu volajúceho
+ * @param view Pohľad na dotaz (dns_view_parse())
+ * @param rcode Response code
+ * @param response Výstupný buffer
+ * @param response_size Veľkosť výstupného bufferu
+ * @return Dĺžka odpovede, 0 pri chybe
+ *
+ * Hlavička ako pri build_error_response(), za ňou prvá otázka dotazu
+ * (ak nejaká je). QDCOUNT zodpovedá počtu skopírovaných otázok (0 alebo 1).
+ */
+size_t build_error_from_view(const dns_view_t *view, uint8_t rcode,
+                             uint8_t *response, size_t response_size);
+
+/**
+ * @brief Pridá OPT pseudo-RR (EDNS(0)) na koniec správy a zvýši ARCOUNT
+ * @param packet Správa
+ * @param len Aktuálna dĺžka správy
+ * @param size Veľkosť bufferu
+ * @param edns Obsah OPT (udp_size, ext_rcode, version, dnssec_ok)
+ * @return Nová dĺžka správy, 0 pri chybe (málo miesta)
+ */
+size_t dns_append_opt(uint8_t *packet, size_t len, size_t size, const dns_edns_t *edns);
+
+/**
+ * @brief Odstráni OPT pseudo-RR zo správy a zníži ARCOUNT
+ * @param packet Správa
+ * @param len Dĺžka správy
+ * @param edns Poloha OPT (z dns_parse_edns() nad touto správou)
+ * @return Nová dĺžka správy (bez zmeny ak OPT nie je), 0 pri chybe
+ */
+size_t dns_remove_opt(uint8_t *packet, size_t len, const dns_edns_t *edns);
+
+/**
+ * @brief Prispôsobí odpoveď upstream/cache klientovi (RFC 6891 Section 7)
+ * @param packet Odpoveď (upravuje sa v mieste)
+ * @param len Dĺžka odpovede
+ * @param size Veľkosť bufferu
+ * @param client EDNS informácie z dotazu klienta
+ * @param payload Najväčšia odpoveď, ktorú klient prijme (UDP: dns_edns_payload(),
+ *                TCP: veľkosť bufferu)
+ * @return Nová dĺžka odpovede, 0 pri chybe
+ *
+ * OPT z upstream sa nahradí vlastným (iba ak ho poslal aj klient).
+ * Odpoveď väčšia ako payload sa skráti na hlavičku a otázky s TC
+ * bitom - klient zopakuje dotaz cez TCP.
+ */
+size_t dns_fit_response(uint8_t *packet, size_t len, size_t size, const dns_edns_t *client,
+                        size_t payload);
+
 /**
  * @brief Vytvorí DNS header do bufferu
  * @param buffer Buffer pre header (min 12 bajtov)
@@ -186,6 +186,53 @@
      return -1;
  }
 
+ /**
+  * @brief Zmeria nekomprimované meno vo wire formáte bez kopírovania
+  *
+  * Meno v prvej otázke dotazu takmer nikdy nie je komprimované (nie je
+  * naň kam ukazovať), takže rýchla cesta servera ho môže overiť priamo
+  * v prijatom bufferi. Komprimované meno vráti -1 - volajúci použije
+  * parse_dns_name().
+  *
+  * Edge cases:
+  * - Compression pointer (0xC0)
+  * - Label dĺžka > 63
+  * - Meno dlhšie ako DNS_MAX_NAME_LEN
+  * - Neukončené meno
+  */
+ int dns_wire_name_length(const uint8_t *buffer, size_t len, size_t offset) {
+     if (buffer == NULL) {
+         return -1;
+     }
+
+     size_t pos = offset;
+     size_t name_len = 0;   /* Dĺžka v textovom tvare (labely + bodky) */
+
+     while (pos < len) {
+         uint8_t label_len = buffer[pos];
+
+         if (label_len == 0) {
+             return (int)(pos + 1 - offset);
+         }
+
+         /* Compression pointer aj rezervované typy labelov */
+         if (label_len > DNS_MAX_LABEL_LEN) {
+             return -1;
+         }
+
+         /* Rovnaký limit ako parse_dns_name() (meno + koncová bodka) */
+         name_len += (size_t)label_len + 1;
+         if (name_len > DNS_MAX_NAME_LEN) {
+             return -1;
+         }
+
+         pos += (size_t)label_len + 1;
+     }
+
+     /* Neukončené meno */
+     return -1;
+ }
+
  /**
   * @brief Parsuje DNS question section (RFC 1035 Section 4.1.2)
   *
@@ -329,6 +376,410 @@
      return 0;
  }
 
+ /**
+  * @brief Zero-copy parsovanie DNS správy
+  *
+  * Otázky sa iba overia a preskočia - nekomprimované meno cez
+  * dns_wire_name_length() priamo v bufferi, komprimované cez
+  * parse_dns_name() do bufferu na zásobníku. Do úložiska volajúceho sa
+  * dekóduje iba QNAME prvej otázky.
+  *
+  * Edge cases:
+  * - NULL pointers
+  * - Buffer príliš krátky / neplatná hlavička
+  * - Neplatné alebo neukončené meno v ktorejkoľvek otázke
+  * - Chýbajúci QTYPE/QCLASS
+  */
+ int dns_view_parse(const uint8_t *buffer, size_t len, dns_view_t *view,
+                    char *qname, size_t qname_size) {
+     if (buffer == NULL || view == NULL || (qname != NULL && qname_size == 0)) {
+         return -1;
+     }
+
+     memset(view, 0, sizeof(*view));
+     view->packet = buffer;
+     view->len = len;
+
+     if (parse_dns_header(buffer, len, &view->header) != 0) {
+         return -1;
+     }
+
+     if (qname != NULL) {
+         qname[0] = '\0';
+     }
+
+     size_t offset = DNS_HEADER_SIZE;
+     char scratch[DNS_MAX_NAME_LEN + 1];
+
+     for (uint16_t i = 0; i < view->header.qdcount; i++) {
+         size_t name_start = offset;
+         int wire_len = dns_wire_name_length(buffer, len, offset);
+         bool compressed = wire_len < 0;
+
+         /* Prvá otázka sa dekóduje do úložiska volajúceho, ostatné sa iba
+          * overia (komprimované meno musí prejsť parse_dns_name()) */
+         if (i == 0 && qname != NULL) {
+             if (parse_dns_name(buffer, len, &offset, qname, qname_size) != 0) {
+                 return -1;
+             }
+         } else if (compressed) {
+             if (parse_dns_name(buffer, len, &offset, scratch, sizeof(scratch)) != 0) {
+                 return -1;
+             }
+         } else {
+             offset += (size_t)wire_len;
+         }
+
+         /* Edge case: Nedostatok miesta pre QTYPE a QCLASS */
+         if (offset + 4 > len) {
+             return -1;
+         }
+
+         if (i == 0) {
+             view->qname_offset = name_start;
+             view->qname_len = offset - name_start;
+             view->qname_compressed = compressed;
+             view->qtype = ntohs(*(const uint16_t *)(buffer + offset));
+             view->qclass = ntohs(*(const uint16_t *)(buffer + offset + 2));
+             view->question_end = offset + 4;
+         }
+
+         offset += 4;
+     }
+
+     view->questions_end = offset;
+     return 0;
+ }
+
+ /**
+  * @brief Prejde meno vo wire formáte (vrátane compression) bez kopírovania
+  * @param end Výstup: offset za menom v mieste výskytu (za prvým pointerom)
+  * @return 0 pri úspechu, -1 pri chybe
+  *
+  * Rovnaké pravidlá ako parse_dns_name() - pointer iba dozadu, najviac
+  * MAX_COMPRESSION_JUMPS skokov, meno najviac DNS_MAX_NAME_LEN znakov.
+  */
+ static int walk_dns_name(const uint8_t *buffer, size_t len, size_t offset, size_t *end) {
+     size_t pos = offset;
+     size_t name_len = 0;   /* Dĺžka v textovom tvare (labely + bodky) */
+     int jump_count = 0;
+     bool jumped = false;
+
+     while (pos < len) {
+         uint8_t label_len = buffer[pos];
+
+         if ((label_len & DNS_COMPRESSION_MASK) == DNS_COMPRESSION_MASK) {
+             if (pos + 1 >= len) {
+                 return -1;
+             }
+
+             size_t pointer_offset = ((size_t)(label_len & 0x3F) << 8) | buffer[pos + 1];
+             if (pointer_offset >= pos || ++jump_count > MAX_COMPRESSION_JUMPS) {
+                 return -1;
+             }
+
+             if (!jumped) {
+                 *end = pos + 2;
+                 jumped = true;
+             }
+             pos = pointer_offset;
+             continue;
+         }
+
+         if (label_len > DNS_MAX_LABEL_LEN) {
+             return -1;
+         }
+
+         if (label_len == 0) {
+             if (!jumped) {
+                 *end = pos + 1;
+             }
+             return 0;
+         }
+
+         if (pos + 1 + label_len > len) {
+             return -1;
+         }
+
+         name_len += (size_t)label_len + 1;
+         if (name_len > DNS_MAX_NAME_LEN) {
+             return -1;
+         }
+
+         pos += (size_t)label_len + 1;
+     }
+
+     return -1;
+ }
+
+ /**
+  * @brief Inicializuje lenivý iterátor záznamov
+  */
+ int dns_rr_iter_init(dns_rr_iter_t *iter, const uint8_t *buffer, size_t len) {
+     if (iter == NULL) {
+         return -1;
+     }
+
+     memset(iter, 0, sizeof(*iter));
+
+     dns_header_t header;
+     if (parse_dns_header(buffer, len, &header) != 0) {
+         return -1;
+     }
+
+     iter->packet = buffer;
+     iter->len = len;
+     iter->pos = DNS_HEADER_SIZE;
+     iter->counts[DNS_SECTION_QUESTION] = header.qdcount;
+     iter->counts[DNS_SECTION_ANSWER] = header.ancount;
+     iter->counts[DNS_SECTION_AUTHORITY] = header.nscount;
+     iter->counts[DNS_SECTION_ADDITIONAL] = header.arcount;
+     iter->section = DNS_SECTION_QUESTION;
+     iter->index = 0;
+
+     return 0;
+ }
+
+ /**
+  * @brief Dekóduje nasledujúci záznam (RFC 1035 Section 4.1.2, 4.1.3)
+  *
+  * RR format:
+  *     NAME | TYPE (2) | CLASS (2) | TTL (4) | RDLENGTH (2) | RDATA
+  *
+  * Prázdne sekcie sa preskočia. Pozícia sa posúva iba po úspešnom
+  * dekódovaní, takže po chybe ďalšie volanie zlyhá na tom istom mieste.
+  */
+ int dns_rr_iter_next(dns_rr_iter_t *iter, dns_rr_t *rr) {
+     if (iter == NULL || rr == NULL || iter->packet == NULL) {
+         return -1;
+     }
+
+     while (iter->section < DNS_SECTION_COUNT &&
+            iter->index >= iter->counts[iter->section]) {
+         iter->section++;
+         iter->index = 0;
+     }
+
+     if (iter->section == DNS_SECTION_COUNT) {
+         return 0;
+     }
+
+     const uint8_t *buffer = iter->packet;
+     size_t pos;
+
+     if (walk_dns_name(buffer, iter->len, iter->pos, &pos) != 0) {
+         return -1;
+     }
+
+     memset(rr, 0, sizeof(*rr));
+     rr->section = iter->section;
+     rr->name_offset = iter->pos;
+
+     /* Otázka: iba QTYPE a QCLASS */
+     if (iter->section == DNS_SECTION_QUESTION) {
+         if (pos + 4 > iter->len) {
+             return -1;
+         }
+         rr->type = ntohs(*(const uint16_t *)(buffer + pos));
+         rr->rr_class = ntohs(*(const uint16_t *)(buffer + pos + 2));
+         iter->pos = pos + 4;
+         iter->index++;
+         return 1;
+     }
+
+     /* Edge case: Chýbajú pevné polia RR (10 bajtov) */
+     if (pos + 10 > iter->len) {
+         return -1;
+     }
+
+     rr->type = ntohs(*(const uint16_t *)(buffer + pos));
+     rr->rr_class = ntohs(*(const uint16_t *)(buffer + pos + 2));
+     rr->ttl_offset = pos + 4;
+     rr->ttl = ntohl(*(const uint32_t *)(buffer + pos + 4));
+     rr->rdlength = ntohs(*(const uint16_t *)(buffer + pos + 8));
+     rr->rdata_offset = pos + 10;
+
+     /* Edge case: RDATA presahuje správu */
+     if (rr->rdata_offset + rr->rdlength > iter->len) {
+         return -1;
+     }
+
+     iter->pos = rr->rdata_offset + rr->rdlength;
+     iter->index++;
+     return 1;
+ }
+
+ /**
+  * @brief Overí štruktúru celej správy
+  */
+ int dns_validate_message(const uint8_t *buffer, size_t len) {
+     dns_rr_iter_t iter;
+     dns_rr_t rr;
+     int rc;
+
+     if (dns_rr_iter_init(&iter, buffer, len) != 0) {
+         return -1;
+     }
+
+     while ((rc = dns_rr_iter_next(&iter, &rr)) == 1) {
+         /* Iba prechod */
+     }
+
+     return rc;
+ }
+
+ /**
+  * @brief Nájde a dekóduje OPT pseudo-RR
+  *
+  * OPT RR format (RFC 6891 Section 6.1.2):
+  *     NAME = 0 (koreň) | TYPE = 41 | CLASS = UDP payload |
+  *     TTL = EXTENDED-RCODE (8) VERSION (8) DO (1) Z (15) | RDLEN | RDATA
+  */
+ int dns_parse_edns(const uint8_t *buffer, size_t len, dns_edns_t *edns) {
+     if (edns == NULL) {
+         return -1;
+     }
+
+     memset(edns, 0, sizeof(*edns));
+
+     dns_rr_iter_t iter;
+     dns_rr_t rr;
+     int rc;
+
+     if (dns_rr_iter_init(&iter, buffer, len) != 0) {
+         return -1;
+     }
+
+     while ((rc = dns_rr_iter_next(&iter, &rr)) == 1) {
+         if (rr.type != DNS_TYPE_OPT || rr.section == DNS_SECTION_QUESTION) {
+             continue;
+         }
+
+         /* Edge case: OPT iba raz, v additional section, s koreňovým menom */
+         if (edns->present || rr.section != DNS_SECTION_ADDITIONAL ||
+             buffer[rr.name_offset] != 0) {
+             return -1;
+         }
+
+         edns->present = true;
+         edns->udp_size = rr.rr_class;
+         edns->ext_rcode = (uint8_t)(rr.ttl >> 24);
+         edns->version = (uint8_t)(rr.ttl >> 16);
+         edns->dnssec_ok = (rr.ttl & 0x8000) != 0;
+         edns->opt_offset = rr.name_offset;
+         edns->opt_len = rr.rdata_offset + rr.rdlength - rr.name_offset;
+     }
+
+     return rc;
+ }
+
+ /**
+  * @brief Prečíta pole MINIMUM zo SOA záznamu
+  *
+  * SOA RDATA (RFC 1035 Section 3.3.13):
+  *     MNAME | RNAME | SERIAL (4) | REFRESH (4) | RETRY (4) | EXPIRE (4) | MINIMUM (4)
+  *
+  * Mená môžu byť komprimované, preto sa prejdú cez walk_dns_name() a
+  * MINIMUM sa číta až za nimi, nie od konca RDATA.
+  */
+ int dns_parse_soa_minimum(const uint8_t *buffer, size_t len, const dns_rr_t *rr,
+                           uint32_t *minimum) {
+     if (buffer == NULL || rr == NULL || minimum == NULL || rr->type != DNS_TYPE_SOA) {
+         return -1;
+     }
+
+     size_t rdata_end = rr->rdata_offset + rr->rdlength;
+     size_t pos = rr->rdata_offset;
+
+     if (rdata_end > len ||
+         walk_dns_name(buffer, rdata_end, pos, &pos) != 0 ||
+         walk_dns_name(buffer, rdata_end, pos, &pos) != 0 ||
+         pos + 20 != rdata_end) {
+         return -1;
+     }
+
+     *minimum = ntohl(*(const uint32_t *)(buffer + pos + 16));
+     return 0;
+ }
+
+ /**
+  * @brief Vráti najväčšiu odpoveď, ktorú odosielateľ prijme cez UDP
+  *
+  * Hodnoty pod 512 sa považujú za 512 (RFC 6891 Section 6.2.5), viac
+  * ako DNS_EDNS_UDP_SIZE server neposiela (fragmentácia).
+  */
+ size_t dns_edns_payload(const dns_edns_t *edns) {
+     if (edns == NULL || !edns->present || edns->udp_size <= DNS_UDP_MAX_SIZE) {
+         return DNS_UDP_MAX_SIZE;
+     }
+
+     return edns->udp_size < DNS_EDNS_UDP_SIZE ? edns->udp_size : DNS_EDNS_UDP_SIZE;
+ }
+
+ /**
+  * @brief Porovná meno vo wire formáte s textovým menom
+  *
+  * Labely sa porovnávajú priamo v pakete, compression pointery sa
+  * nasledujú rovnako ako v parse_dns_name(). Porovnanie je ASCII
+  * case-insensitive (RFC 1035 Section 2.3.3).
+  */
+ bool dns_name_equals(const uint8_t *buffer, size_t len, size_t offset, const char *name) {
+     if (buffer == NULL || name == NULL) {
+         return false;
+     }
+
+     size_t end;
+     if (walk_dns_name(buffer, len, offset, &end) != 0) {
+         return false;
+     }
+
+     /* Meno je platné - pointery už netreba kontrolovať */
+     size_t pos = offset;
+     const char *p = name;
+
+     for (;;) {
+         uint8_t label_len = buffer[pos];
+
+         if ((label_len & DNS_COMPRESSION_MASK) == DNS_COMPRESSION_MASK) {
+             pos = ((size_t)(label_len & 0x3F) << 8) | buffer[pos + 1];
+             continue;
+         }
+
+         if (label_len == 0) {
+             return *p == '\0';
+         }
+
+         /* Oddeľovač medzi labelmi */
+         if (p != name) {
+             if (*p != '.') {
+                 return false;
+             }
+             p++;
+         }
+
+         for (size_t i = 0; i < label_len; i++) {
+             uint8_t a = buffer[pos + 1 + i];
+             uint8_t b = (uint8_t)p[i];
+
+             if (b == '\0') {
+                 return false;
+             }
+             if (a >= 'A' && a <= 'Z') {
+                 a = (uint8_t)(a + ('a' - 'A'));
+             }
+             if (b >= 'A' && b <= 'Z') {
+                 b = (uint8_t)(b + ('a' - 'A'));
+             }
+             if (a != b) {
+                 return false;
+             }
+         }
+
+         p += label_len;
+         pos += (size_t)label_len + 1;
+     }
+ }
+
  /**
   * @brief Uvoľní pamäť alokovanu v DNS správe
   */
@@ -369,29 +820,19 @@ int dns_parse_query(const uint8_t *buffer, size_t len, dns_query_t *query) {
         return -1;
     }
 
-    /* Parse full message first */
-    dns_message_t message;
-    if (parse_dns_message(buffer, len, &message) != 0) {
+    /* Zero-copy parse - QNAME sa dekóduje priamo do query->qname */
+    dns_view_t view;
+    if (dns_view_parse(buffer, len, &view, query->qname, sizeof(query->qname)) != 0) {
         return -1;
     }
 
     /* Extract first question */
-    if (message.header.qdcount == 0 || message.questions == NULL) {
-        free_dns_message(&message);
+    if (view.header.qdcount == 0) {
         return -1;
     }
 
-    /* Copy to simplified structure */
-    if (message.questions[0].qname) {
-        strncpy(query->qname, message.questions[0].qname, DNS_MAX_NAME_LEN);
-        query->qname[DNS_MAX_NAME_LEN] = '\0';
-    } else {
-        query->qname[0] = '\0';
-    }
-
-    query->qtype = message.questions[0].qtype;
-    query->qclass = message.questions[0].qclass;
+    query->qtype = view.qtype;
+    query->qclass = view.qclass;
 
-    free_dns_message(&message);
     return 0;
 }
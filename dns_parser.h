@@ -50,6 +50,22 @@ int parse_dns_question(const uint8_t *buffer, size_t len, size_t *offset,
  */
 int parse_dns_message(const uint8_t *buffer, size_t len, dns_message_t *message);
 
+/**
+ * @brief Parsuje DNS správu bez kopírovania (zero-copy pohľad)
+ * @param buffer Surové DNS data (view na ne ukazuje, nekopírujú sa)
+ * @param len Dĺžka bufferu
+ * @param view Výstupný pohľad
+ * @param qname Úložisko volajúceho pre dekódované QNAME prvej otázky
+ *              (NULL = nedekódovať, iba overiť)
+ * @param qname_size Veľkosť úložiska (aspoň DNS_MAX_NAME_LEN + 1)
+ * @return 0 pri úspechu, -1 pri chybe
+ *
+ * Akceptuje presne tie isté správy ako parse_dns_message() (hlavička +
+ * všetky otázky vrátane kompresie), ale nealokuje žiadnu pamäť.
+ */
+int dns_view_parse(const uint8_t *buffer, size_t len, dns_view_t *view,
+                   char *qname, size_t qname_size);
+
 /**
  * @brief Uvoľní pamäť alokovanu v DNS správe
  * @param message DNS správa na uvoľnenie
@@ -74,6 +90,98 @@ void free_dns_message(dns_message_t *message);
 int parse_dns_name(const uint8_t *buffer, size_t len, size_t *offset,
                    char *name, size_t name_len);
 
+/**
+ * @brief Vráti dĺžku nekomprimovaného mena vo wire formáte (bez kópie)
+ * @param buffer Surové DNS data
+ * @param len Dĺžka bufferu
+ * @param offset Pozícia kde začína meno
+ * @return Počet bajtov mena vrátane nulového bajtu, -1 ak je meno
+ *         neplatné alebo komprimované
+ */
+int dns_wire_name_length(const uint8_t *buffer, size_t len, size_t offset);
+
+/**
+ * @brief Inicializuje lenivý iterátor záznamov správy
+ * @param iter Výstupný iterátor
+ * @param buffer Surové DNS data (nekopírujú sa)
+ * @param len Dĺžka bufferu
+ * @return 0 pri úspechu, -1 pri chybe (neplatná hlavička)
+ */
+int dns_rr_iter_init(dns_rr_iter_t *iter, const uint8_t *buffer, size_t len);
+
+/**
+ * @brief Dekóduje nasledujúci záznam (otázky, answer, authority, additional)
+ * @param iter Iterátor
+ * @param rr Výstupný záznam
+ * @return 1 ak bol záznam dekódovaný, 0 na konci správy, -1 pri chybe
+ *
+ * Meno vlastníka sa overí (vrátane compression pointerov) bez kópie,
+ * RDATA sa iba ohraničí. Po chybe iterátor ďalej vracia -1.
+ *
+ * Edge cases:
+ * - Neplatné meno / circular pointers
+ * - Chýbajúce pevné polia záznamu
+ * - RDLENGTH presahuje správu
+ */
+int dns_rr_iter_next(dns_rr_iter_t *iter, dns_rr_t *rr);
+
+/**
+ * @brief Overí štruktúru celej správy (všetky sekcie) bez alokácie
+ * @param buffer Surové DNS data
+ * @param len Dĺžka bufferu
+ * @return 0 ak sa dajú dekódovať všetky záznamy, -1 inak
+ */
+int dns_validate_message(const uint8_t *buffer, size_t len);
+
+/**
+ * @brief Nájde a dekóduje OPT pseudo-RR (EDNS(0), RFC 6891)
+ * @param buffer Surové DNS data
+ * @param len Dĺžka bufferu
+ * @param edns Výstup (present = false ak správa OPT nemá)
+ * @return 0 pri úspechu, -1 pri poškodenej správe alebo neplatnom OPT
+ *
+ * Edge cases:
+ * - OPT mimo additional section alebo s iným menom ako koreň
+ * - Viac OPT záznamov (RFC 6891 Section 6.1.1 - FORMERR)
+ */
+int dns_parse_edns(const uint8_t *buffer, size_t len, dns_edns_t *edns);
+
+/**
+ * @brief Prečíta pole MINIMUM zo SOA záznamu (RFC 1035 Section 3.3.13)
+ * @param buffer Surové DNS data (potrebné pre compression)
+ * @param len Dĺžka bufferu
+ * @param rr SOA záznam z dns_rr_iter_next()
+ * @param minimum Výstup: MINIMUM (TTL negatívnej odpovede, RFC 2308)
+ * @return 0 pri úspechu, -1 ak záznam nie je platný SOA
+ *
+ * Edge cases:
+ * - Iný typ záznamu
+ * - Neplatné MNAME / RNAME (vrátane compression pointerov)
+ * - RDLENGTH nezodpovedá menám + 5 32-bitovým poliam
+ */
+int dns_parse_soa_minimum(const uint8_t *buffer, size_t len, const dns_rr_t *rr,
+                          uint32_t *minimum);
+
+/**
+ * @brief Vráti najväčšiu odpoveď, ktorú odosielateľ prijme cez UDP
+ * @param edns EDNS informácie z dotazu
+ * @return 512 bez EDNS, inak ohlásená veľkosť obmedzená na
+ *         [DNS_UDP_MAX_SIZE, DNS_EDNS_UDP_SIZE]
+ */
+size_t dns_edns_payload(const dns_edns_t *edns);
+
+/**
+ * @brief Porovná meno vo wire formáte s textovým menom (bez kópie)
+ * @param buffer Surové DNS data (potrebné pre compression)
+ * @param len Dĺžka bufferu
+ * @param offset Pozícia kde začína meno
+ * @param name Textové meno bez koncovej bodky ("" = koreň)
+ * @return true ak sa mená zhodujú (bez ohľadu na veľkosť písmen)
+ *
+ * Neplatné meno v pakete sa nezhoduje s ničím.
+ */
+bool dns_name_equals(const uint8_t *buffer, size_t len, size_t offset, const char *name);
+
 /* ============================================================================
  * WRAPPER API PRE INTEGRATION TESTY
  * ============================================================================ */
@@ -5,14 +5,25 @@
  * @brief Filtering DNS Resolver
  */
 
+ /* recvmmsg()/sendmmsg() */
+ #define _GNU_SOURCE
+
  #include "dns_server.h"
  #include "dns_parser.h"
  #include "dns_builder.h"
  #include "filter.h"
  #include "resolver.h"
+ #include "forwarder.h"
+ #include "tcp_server.h"
+ #include "cache.h"
+ #include "filter_reload.h"
  #include "utils.h"
  
  #include <sys/socket.h>
+ #include <sys/epoll.h>
+ #include <sys/uio.h>
+ #include <sys/resource.h>
+ #include <fcntl.h>
  #include <netinet/in.h>
  #include <arpa/inet.h>
  #include <unistd.h>
@@ -20,10 +31,102 @@
  #include <string.h>
  #include <errno.h>
  #include <signal.h>
+ #include <pthread.h>
+ #include <time.h>
+ 
+ /* Výsledok process_dns_query() */
+ #define QUERY_ANSWERED          0   /* Odpoveď je v response_buffer */
+ #define QUERY_FORWARDED         1   /* Dotaz čaká na upstream (odpoveď príde neskôr) */
+ #define QUERY_CACHED            2   /* Odpoveď z cache je v response_buffer */
+ 
+ /* Výsledok fast_path_query() */
+ #define FAST_PATH_ANSWERED      0   /* NXDOMAIN odoslané priamo z prijatého bufferu */
+ #define FAST_PATH_ALLOWED       1   /* Filter skontrolovaný, doména nie je blokovaná */
+ #define FAST_PATH_FALLBACK      2   /* Dotaz treba spracovať cez process_dns_query() */
+ 
+ /* Maximálny počet udalostí z jedného epoll_wait() */
+ #define WORKER_MAX_EVENTS       16
+ 
+ /* Maximálny počet dotazov prečítaných naraz z klientského socketu */
+ #define WORKER_RECV_BUDGET      64
+ 
+ /* Najdlhšie čakanie v epoll_wait() - kontrola server_running */
+ #define WORKER_POLL_MS          1000
+ 
+ /* Dĺžka fronty nevybavených TCP spojení (listen backlog) */
+ #define TCP_LISTEN_BACKLOG      128
+ 
+ /* Najviac toľko obnov cache (prefetch) naraz čaká na upstream v jednom workerovi */
+ #define WORKER_MAX_PREFETCH     32
+ 
+ /* File descriptory mimo workerov (stdio, inotify, rezerva) */
+ #define SERVER_FD_RESERVE       32
+ 
+ /**
+  * @brief Štatistiky jedného workera
+  *
+  * Každý worker si vedie vlastné počítadlá (bez zámkov a zdieľaných
+  * cache line), ktoré sa zlúčia až pri ukončení servera.
+  */
+ typedef struct {
+     unsigned long query_count;
+     unsigned long blocked_count;
+     unsigned long fast_path_count;  /* Blokované dotazy zodpovedané bez parsovania */
+     unsigned long forwarded_count;
+     unsigned long error_count;
+     unsigned long pending_count;    /* Dotazy čakajúce na upstream */
+     unsigned long cache_hits;       /* Odpovede z cache */
+     unsigned long cache_misses;     /* Povolené dotazy, ktoré museli na upstream */
+     unsigned long prefetch_count;   /* Obnovy cache odoslané na upstream */
+     unsigned long prefetch_dropped; /* Obnovy zahodené nad WORKER_MAX_PREFETCH */
+     unsigned long recv_calls;       /* Počet recvfrom()/recvmmsg() volaní s dátami */
+     unsigned long send_calls;       /* Počet sendto()/sendmmsg() volaní */
+     unsigned long sent_count;       /* Počet odoslaných odpovedí */
+ } server_stats_t;
+ 
+ /**
+  * @brief Dávka datagramov pre recvmmsg()/sendmmsg()
+  *
+  * Všetky polia sú alokované raz pri štarte workera (capacity položiek),
+  * iov[i] ukazuje do buffers na i-ty slot veľkosti DNS_EDNS_UDP_SIZE
+  * (najväčší dotaz, ktorý server prijme, aj najväčšia odpoveď klientovi).
+  */
+ typedef struct {
+     struct mmsghdr *msgs;       /* Hlavičky správ [capacity] */
+     struct iovec *iov;          /* I/O vektory [capacity] */
+     struct sockaddr_in *addrs;  /* Adresy klientov [capacity] */
+     uint8_t *buffers;           /* Dáta [capacity * DNS_EDNS_UDP_SIZE] */
+     unsigned int capacity;      /* Maximálny počet datagramov v dávke */
+     unsigned int count;         /* Aktuálny počet (iba pre odosielanie) */
+ } io_batch_t;
+ 
+ /**
+  * @brief Kontext jedného worker vlákna
+  */
+ typedef struct {
+     pthread_t thread;           /* Handle vlákna */
+     unsigned int id;            /* Poradové číslo workera (0..N-1) */
+     int sockfd;                 /* Vlastný UDP socket (SO_REUSEPORT) */
+     int epfd;                   /* epoll inštancia workera */
+     server_config_t *config;    /* Zdieľaná (read-only) konfigurácia */
+     forwarder_t forwarder;      /* Asynchrónne upstream dotazy */
+     tcp_server_t tcp;           /* TCP listener a spojenia klientov */
+     uint32_t upstream_gen;      /* Generácia upstream adresy vo forwarderi */
+     dns_cache_t *cache;         /* Zdieľaná cache odpovedí (NULL = vypnutá) */
+     filter_reloader_t *reloader; /* Publikovaný filter + quiescent stav */
+     bool batching;              /* true = recvmmsg()/sendmmsg() */
+     io_batch_t rx;              /* Dávka prijatých dotazov */
+     io_batch_t tx;              /* Dávka odpovedí čakajúcich na odoslanie */
+     unsigned int prefetch_pending; /* Obnovy cache čakajúce na upstream */
+     server_stats_t stats;       /* Privátne počítadlá */
+ } dns_worker_t;
  
  /* Globálna premenná pre graceful shutdown */
  static volatile sig_atomic_t server_running = 1;
  
+ /* Požiadavka na reload filtra (SIGHUP) */
+ static volatile sig_atomic_t reload_requested = 0;
+ 
  /**
   * @brief Signal handler pre SIGINT (Ctrl+C)
   */
@@ -32,6 +135,14 @@
      server_running = 0;
  }
  
+ /**
+  * @brief Signal handler pre SIGHUP - reload filtra
+  */
+ static void reload_signal_handler(int signum) {
+     (void)signum;
+     reload_requested = 1;
+ }
+ 
  /**
   * @brief Inicializuje UDP socket na zadanom porte
   * 
@@ -39,8 +150,12 @@
   * - Privilegovaný port (<1024) bez root
   * - Port už používaný
   * - Socket creation failure
+  * - SO_REUSEPORT nepodporovaný kernelom
+  *
+  * @param port Port number
+  * @param reuse_port true = SO_REUSEPORT (viac socketov na jednom porte)
   */
- int init_udp_server(uint16_t port) {
+ int init_udp_server(uint16_t port, bool reuse_port) {
      int sockfd;
      struct sockaddr_in server_addr;
      int reuse = 1;
@@ -60,6 +175,14 @@
          return -1;
      }
 
+     /* SO_REUSEPORT - kernel rozkladá prichádzajúce dotazy medzi workerov */
+     if (reuse_port &&
+         setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+         print_error("Failed to set SO_REUSEPORT: %s", strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+
      /* Nastavenie recv timeout pre umožnenie kontroly server_running */
      timeout.tv_sec = 1;   /* 1 sekunda timeout */
      timeout.tv_usec = 0;
@@ -84,281 +207,1414 @@
 
      return sockfd;
  }
+
+ /**
+  * @brief Inicializuje neblokujúci TCP listen socket na zadanom porte
+  *
+  * Edge cases:
+  * - Privilegovaný port (<1024) bez root
+  * - Port už používaný
+  * - SO_REUSEPORT nepodporovaný kernelom
+  *
+  * @param port Port number
+  * @param reuse_port true = SO_REUSEPORT (kernel rozkladá spojenia medzi workerov)
+  */
+ int init_tcp_server(uint16_t port, bool reuse_port) {
+     struct sockaddr_in server_addr;
+     int reuse = 1;
+
+     int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+     if (sockfd < 0) {
+         print_error("Failed to create TCP socket: %s", strerror(errno));
+         return -1;
+     }
+
+     if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+         print_error("Failed to set SO_REUSEADDR: %s", strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+
+     if (reuse_port &&
+         setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+         print_error("Failed to set SO_REUSEPORT: %s", strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+
+     memset(&server_addr, 0, sizeof(server_addr));
+     server_addr.sin_family = AF_INET;
+     server_addr.sin_addr.s_addr = INADDR_ANY;
+     server_addr.sin_port = htons(port);
+
+     if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+         print_error("Failed to bind TCP port %u: %s", port, strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+
+     if (listen(sockfd, TCP_LISTEN_BACKLOG) < 0) {
+         print_error("listen() failed: %s", strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+
+     return sockfd;
+ }
+
+ /**
+  * @brief Najväčšia odpoveď, ktorú klient prijme
+  *
+  * Cez TCP odpoveď obmedzuje iba buffer (DNS_EDNS_MAX_SIZE), cez UDP
+  * payload z OPT klienta (RFC 6891 Section 6.2.5).
+  */
+ static size_t client_payload(const dns_client_t *client) {
+     return client->tcp_conn != 0 ? DNS_EDNS_MAX_SIZE : dns_edns_payload(&client->edns);
+ }
+
+ /**
+  * @brief Chybová odpoveď na dotaz - hlavička + otázka, OPT ak ho poslal klient
+  * @return Dĺžka odpovede, 0 pri chybe
+  */
+ static size_t build_error_reply(const dns_view_t *view, const dns_client_t *client,
+                                 uint8_t rcode, uint8_t *response, size_t response_size) {
+     size_t len = build_error_from_view(view, rcode, response, response_size);
+     return len > 0 ? dns_fit_response(response, len, response_size, &client->edns,
+                                       client_payload(client)) : 0;
+ }
+ 
+ /**
+  * @brief Obnoví populárny záznam cache na pozadí (prefetch)
+  * 
+  * Dotaz klienta sa odošle znova s prefetch klientom - odpoveď iba
+  * prepíše záznam v cache (relay_upstream_reply()), nikomu sa neposiela.
+  * Počet naraz rozpracovaných obnov je obmedzený, aby prefetch nemohol
+  * zahltiť upstream ani pending tabuľku.
+  */
+ static void start_prefetch(dns_worker_t *worker, const dns_view_t *view) {
+     if (worker->prefetch_pending >= WORKER_MAX_PREFETCH) {
+         worker->stats.prefetch_dropped++;
+         return;
+     }
+     
+     dns_client_t prefetch;
+     memset(&prefetch, 0, sizeof(prefetch));
+     prefetch.id = view->header.id;
+     prefetch.prefetch = true;
+     
+     if (forwarder_submit(&worker->forwarder, view->packet, view->len, &prefetch) < 0) {
+         worker->stats.prefetch_dropped++;
+         return;
+     }
+     
+     verbose_log(worker->config, "  Hot cache entry near expiry - prefetching");
+     worker->prefetch_pending++;
+     worker->stats.prefetch_count++;
+ }
  
  /**
   * @brief Spracuje jeden DNS dotaz
   * 
   * Logika:
-  * 1. Parse DNS query
+  * 1. Check QDCOUNT (žiadna otázka → FORMERR)
   * 2. Check QTYPE (len A je podporovaný)
   * 3. Check filter (blokovaná doména?)
   * 4. Ak blokovaná → NXDOMAIN
   * 5. Ak neplatný typ → NOTIMPL
-  * 6. Ak povolená → forward upstream (FÁZA 6)
+  * 6. Ak povolená a je v cache → odpoveď z cache (QUERY_CACHED)
+  * 7. Inak → odovzdá dotaz forwarderu (odpoveď príde asynchrónne)
   * 
-  * @param config Server konfigurácia
-  * @param query_buffer Buffer s DNS dotazom
-  * @param query_len Dĺžka dotazu
-  * @param response_buffer Buffer pre odpoveď (alokuje sa)
+  * Dotaz je už rozparsovaný cez dns_view_parse() - všetko sa číta priamo
+  * z prijatého bufferu a odpoveď sa píše do bufferu volajúceho.
+  * 
+  * @param worker Kontext workera
+  * @param view Zero-copy pohľad na dotaz
+  * @param qname Dekódované QNAME prvej otázky
+  * @param client Klient (adresa alebo TCP spojenie, ID a EDNS z dotazu)
+  * @param filter_checked true = fast_path_query() už zistila, že doména
+  *                       nie je blokovaná (krok 3 sa preskočí)
+  * @param response Buffer pre odpoveď (DNS_EDNS_MAX_SIZE bajtov)
   * @param response_len Dĺžka odpovede
-  * @return 0 pri úspechu, -1 pri chybe
+  * @return QUERY_ANSWERED, QUERY_CACHED, QUERY_FORWARDED alebo -1 pri chybe
   */
- static int process_dns_query(server_config_t *config,
-                              const uint8_t *query_buffer, size_t query_len,
-                              uint8_t **response_buffer, size_t *response_len) {
-     dns_message_t query;
-     
-     /* Parse DNS query */
-     if (parse_dns_message(query_buffer, query_len, &query) != 0) {
-         verbose_log(config, "Failed to parse DNS query - sending FORMERR");
-         
-         /* Ak sa nepodarí parsovať, nemôžeme ani postaviť response */
-         /* V reále by sme mali aspoň skúsiť extrahovať ID */
-         return -1;
-     }
+ static int process_dns_query(dns_worker_t *worker, const dns_view_t *view,
+                              const char *qname, const dns_client_t *client,
+                              bool filter_checked, uint8_t *response, size_t *response_len) {
+     server_config_t *config = worker->config;
      
      verbose_log(config, "Received DNS query:");
-     verbose_log(config, "  Transaction ID: 0x%04X", query.header.id);
-     verbose_log(config, "  Questions: %u", query.header.qdcount);
+     verbose_log(config, "  Transaction ID: 0x%04X", view->header.id);
+     verbose_log(config, "  Questions: %u", view->header.qdcount);
      
      /* Edge case: Žiadne otázky */
-     if (query.header.qdcount == 0) {
+     if (view->header.qdcount == 0) {
          verbose_log(config, "  No questions in query - sending FORMERR");
          
-         if (build_error_response(&query, DNS_RCODE_FORMERR, 
-                                 response_buffer, response_len) != 0) {
-             free_dns_message(&query);
-             return -1;
-         }
-         
-         free_dns_message(&query);
-         return 0;
+         *response_len = build_error_reply(view, client, DNS_RCODE_FORMERR,
+                                           response, DNS_EDNS_MAX_SIZE);
+         return *response_len > 0 ? QUERY_ANSWERED : -1;
      }
      
      /* Pre simplicity, spracujeme len prvú otázku */
-     dns_question_t *question = &query.questions[0];
-     
-     verbose_log(config, "  Domain: %s", question->qname);
+     verbose_log(config, "  Domain: %s", qname);
      verbose_log(config, "  Type: %u (%s)", 
-                 question->qtype,
-                 question->qtype == DNS_TYPE_A ? "A" :
-                 question->qtype == DNS_TYPE_AAAA ? "AAAA" :
-                 question->qtype == DNS_TYPE_MX ? "MX" :
-                 question->qtype == DNS_TYPE_CNAME ? "CNAME" : "Other");
+                 view->qtype,
+                 view->qtype == DNS_TYPE_A ? "A" :
+                 view->qtype == DNS_TYPE_AAAA ? "AAAA" :
+                 view->qtype == DNS_TYPE_MX ? "MX" :
+                 view->qtype == DNS_TYPE_CNAME ? "CNAME" : "Other");
      
      /* Check QTYPE - podporujeme len A */
-     if (question->qtype != DNS_TYPE_A) {
+     if (view->qtype != DNS_TYPE_A) {
          verbose_log(config, "  Unsupported query type - sending NOTIMPL");
          
-         if (build_error_response(&query, DNS_RCODE_NOTIMPL,
-                                 response_buffer, response_len) != 0) {
-             free_dns_message(&query);
-             return -1;
-         }
-         
-         free_dns_message(&query);
-         return 0;
+         *response_len = build_error_reply(view, client, DNS_RCODE_NOTIMPL,
+                                           response, DNS_EDNS_MAX_SIZE);
+         return *response_len > 0 ? QUERY_ANSWERED : -1;
      }
      
-     /* Check filter - je doména blokovaná? */
-     bool blocked = is_domain_blocked(config->filter_root, question->qname);
+     /* Check filter - je doména blokovaná? (koreň sa môže vymeniť reloadom,
+      * ale starý sa uvoľní až po quiescent bode tohto workera) */
+     bool blocked = !filter_checked &&
+                    is_domain_blocked(filter_reader_root(worker->reloader), qname);
      
      if (blocked) {
          verbose_log(config, "  Domain is BLOCKED - sending NXDOMAIN");
          
-         if (build_error_response(&query, DNS_RCODE_NXDOMAIN,
-                                 response_buffer, response_len) != 0) {
-             free_dns_message(&query);
-             return -1;
+         *response_len = build_error_reply(view, client, DNS_RCODE_NXDOMAIN,
+                                           response, DNS_EDNS_MAX_SIZE);
+         return *response_len > 0 ? QUERY_ANSWERED : -1;
+     }
+     
+     /* Doména nie je blokovaná - najprv cache */
+     dns_cache_key_t key;
+     if (worker->cache != NULL &&
+         dns_cache_key_from_packet(view->packet, view->len, &key) == 0) {
+         bool prefetch = false;
+         size_t cached_len = dns_cache_lookup(worker->cache, &key, view->packet,
+                                              response, DNS_EDNS_MAX_SIZE, monotonic_ms(),
+                                              &prefetch);
+         
+         if (prefetch) {
+             start_prefetch(worker, view);
          }
          
-         free_dns_message(&query);
-         return 0;
+         /* Uložená odpoveď má OPT od upstream - prispôsobí sa klientovi */
+         if (cached_len > 0) {
+             cached_len = dns_fit_response(response, cached_len, DNS_EDNS_MAX_SIZE,
+                                           &client->edns, client_payload(client));
+         }
+         
+         if (cached_len > 0) {
+             verbose_log(config, "  Cache hit - answering from cache");
+             *response_len = cached_len;
+             worker->stats.cache_hits++;
+             return QUERY_CACHED;
+         }
+         
+         worker->stats.cache_misses++;
      }
      
-     /* Doména nie je blokovaná - forward na upstream */
-     verbose_log(config, "  Domain is allowed - forwarding to upstream %s", 
-                 config->upstream_server);
-     
-     /* Forward na upstream server (implementované v FÁZE 6) */
-     if (forward_query(&query, config->upstream_server, 
-                      response_buffer, response_len) != 0) {
+     /* Cache miss - forward na upstream server - neblokujúco, odpoveď
+      * doručí relay_upstream_reply() keď príde */
+     int upstream = forwarder_submit(&worker->forwarder, view->packet, view->len, client);
+     if (upstream < 0) {
          verbose_log(config, "  Upstream forwarding failed - sending SERVFAIL");
          
          /* Ak forwarding zlyhal, vrátime SERVFAIL */
-         if (build_error_response(&query, DNS_RCODE_SERVFAIL,
-                                 response_buffer, response_len) != 0) {
-             free_dns_message(&query);
-             return -1;
+         *response_len = build_error_reply(view, client, DNS_RCODE_SERVFAIL,
+                                           response, DNS_EDNS_MAX_SIZE);
+         return *response_len > 0 ? QUERY_ANSWERED : -1;
+     }
+     
+     verbose_log(config, "  Domain is allowed - forwarded to upstream %s",
+                 config->upstream_servers[upstream]);
+     return QUERY_FORWARDED;
+ }
+ 
+ /**
+  * @brief Započíta odpoveď do štatistík podľa RCODE
+  */
+ static void account_response(server_stats_t *stats, const uint8_t *response,
+                              size_t response_len) {
+     dns_header_t resp_header;
+     
+     if (parse_dns_header(response, response_len, &resp_header) != 0) {
+         return;
+     }
+     
+     uint16_t rcode = resp_header.flags & 0x0F;
+     
+     if (rcode == DNS_RCODE_NXDOMAIN) {
+         stats->blocked_count++;
+     } else if (rcode == DNS_RCODE_NOERROR) {
+         stats->forwarded_count++;
+     }
+ }
+ 
+ /**
+  * @brief Alokuje dávku datagramov
+  * @return 0 pri úspechu, -1 pri chybe
+  */
+ static int io_batch_init(io_batch_t *batch, unsigned int capacity) {
+     memset(batch, 0, sizeof(*batch));
+     
+     batch->msgs = (struct mmsghdr *)calloc(capacity, sizeof(struct mmsghdr));
+     batch->iov = (struct iovec *)calloc(capacity, sizeof(struct iovec));
+     batch->addrs = (struct sockaddr_in *)calloc(capacity, sizeof(struct sockaddr_in));
+     batch->buffers = (uint8_t *)malloc((size_t)capacity * DNS_EDNS_UDP_SIZE);
+     
+     if (batch->msgs == NULL || batch->iov == NULL ||
+         batch->addrs == NULL || batch->buffers == NULL) {
+         free(batch->msgs);
+         free(batch->iov);
+         free(batch->addrs);
+         free(batch->buffers);
+         memset(batch, 0, sizeof(*batch));
+         return -1;
+     }
+     
+     batch->capacity = capacity;
+     return 0;
+ }
+ 
+ /**
+  * @brief Uvoľní dávku datagramov
+  */
+ static void io_batch_free(io_batch_t *batch) {
+     free(batch->msgs);
+     free(batch->iov);
+     free(batch->addrs);
+     free(batch->buffers);
+     memset(batch, 0, sizeof(*batch));
+ }
+ 
+ /**
+  * @brief Pripraví i-tu položku dávky (iov + adresa) pre recvmmsg/sendmmsg
+  */
+ static void io_batch_prepare(io_batch_t *batch, unsigned int i, size_t len) {
+     batch->iov[i].iov_base = batch->buffers + (size_t)i * DNS_EDNS_UDP_SIZE;
+     batch->iov[i].iov_len = len;
+     
+     memset(&batch->msgs[i].msg_hdr, 0, sizeof(batch->msgs[i].msg_hdr));
+     batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+     batch->msgs[i].msg_hdr.msg_iovlen = 1;
+     batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+     batch->msgs[i].msg_hdr.msg_namelen = sizeof(batch->addrs[i]);
+     batch->msgs[i].msg_len = 0;
+ }
+ 
+ /**
+  * @brief Odošle všetky odpovede nazbierané v tx dávke jedným sendmmsg()
+  * 
+  * Edge cases:
+  * - sendmmsg() odošle iba časť dávky (pokračuje sa od prvej neodoslanej)
+  * - Plný socket buffer (EAGAIN) - zvyšok dávky sa zahodí, klient zopakuje
+  */
+ static void flush_responses(dns_worker_t *worker) {
+     io_batch_t *tx = &worker->tx;
+     unsigned int done = 0;
+     
+     while (done < tx->count) {
+         int sent = sendmmsg(worker->sockfd, tx->msgs + done, tx->count - done, 0);
+         worker->stats.send_calls++;
+         
+         if (sent < 0) {
+             if (errno == EINTR) {
+                 continue;
+             }
+             print_error("sendmmsg() failed: %s", strerror(errno));
+             worker->stats.error_count += tx->count - done;
+             break;
          }
          
-         free_dns_message(&query);
-         return 0;
+         worker->stats.sent_count += (unsigned long)sent;
+         done += (unsigned int)sent;
+     }
+     
+     if (tx->count > 0) {
+         verbose_log(worker->config, "Response batch sent (%u datagrams)", done);
+     }
+     
+     tx->count = 0;
+ }
+ 
+ /**
+  * @brief Odošle odpoveď klientovi
+  * 
+  * V dávkovom režime sa odpoveď iba skopíruje do tx dávky; odošle sa
+  * spolu s ostatnými (blokované, chybové aj upstream odpovede) pri
+  * flush_responses() na konci iterácie event loopu alebo pri zaplnení.
+  * TCP odpoveď sa zaradí do tx spojenia a odíde pri tcp_server_flush().
+  * 
+  * Edge cases:
+  * - TCP spojenie zaniklo skôr, ako prišla odpoveď upstream
+  */
+ static void send_response(dns_worker_t *worker, const dns_client_t *client,
+                           const uint8_t *response, size_t response_len) {
+     const struct sockaddr_in *client_addr = &client->addr;
+     
+     if (client->tcp_conn != 0) {
+         if (tcp_server_send(&worker->tcp, client->tcp_conn, client->tcp_gen,
+                             response, response_len) != 0) {
+             verbose_log(worker->config, "TCP connection closed - response dropped");
+             return;
+         }
+         worker->stats.sent_count++;
+         verbose_log(worker->config, "Response queued on TCP connection (%zu bytes)",
+                     response_len);
+         return;
+     }
+     
+     if (worker->batching && response_len <= DNS_EDNS_UDP_SIZE) {
+         io_batch_t *tx = &worker->tx;
+         
+         if (tx->count == tx->capacity) {
+             flush_responses(worker);
+         }
+         
+         unsigned int i = tx->count++;
+         io_batch_prepare(tx, i, response_len);
+         memcpy(tx->iov[i].iov_base, response, response_len);
+         tx->addrs[i] = *client_addr;
+         return;
+     }
+     
+     ssize_t sent_len = sendto(worker->sockfd, response, response_len, 0,
+                               (const struct sockaddr *)client_addr,
+                               sizeof(*client_addr));
+     worker->stats.send_calls++;
+     
+     if (sent_len < 0) {
+         print_error("sendto() failed: %s", strerror(errno));
+         worker->stats.error_count++;
+     } else if ((size_t)sent_len != response_len) {
+         verbose_log(worker->config, "Warning: Partial send (%zd/%zu bytes)",
+                    sent_len, response_len);
+     } else {
+         worker->stats.sent_count++;
+         verbose_log(worker->config, "Response sent (%zu bytes)", response_len);
+     }
+ }
+ 
+ /**
+  * @brief Zahodí odpoveď klientovi
+  * 
+  * TCP spojenie inak čaká na odpoveď, ktorá nikdy nepríde, a drží slot.
+  */
+ static void drop_response(dns_worker_t *worker, const dns_client_t *client) {
+     if (client->tcp_conn != 0) {
+         tcp_server_drop(&worker->tcp, client->tcp_conn, client->tcp_gen);
+     }
+ }
+ 
+ /**
+  * @brief Odošle klientovi SERVFAIL na forwardovaný dotaz
+  * 
+  * Edge cases:
+  * - Dotaz sa nedá rozparsovať ani na SERVFAIL - odpoveď sa zahodí
+  */
+ static void send_servfail(dns_worker_t *worker, const dns_client_t *client,
+                           const uint8_t *query, size_t query_len) {
+     dns_view_t view;
+     uint8_t servfail[DNS_EDNS_UDP_SIZE];
+     size_t servfail_len = 0;
+     
+     if (dns_view_parse(query, query_len, &view, NULL, 0) == 0) {
+         servfail_len = build_error_reply(&view, client, DNS_RCODE_SERVFAIL,
+                                          servfail, sizeof(servfail));
+     }
+     if (servfail_len == 0) {
+         worker->stats.error_count++;
+         drop_response(worker, client);
+         return;
+     }
+     
+     send_response(worker, client, servfail, servfail_len);
+ }
+ 
+ /**
+  * @brief Callback forwardera - prepošle odpoveď upstream klientovi
+  * 
+  * Ak upstream neodpovedal ani po všetkých pokusoch (response == NULL)
+  * alebo jeho odpoveď nejde klientovi prispôsobiť, klient dostane SERVFAIL. Do cache ide odpoveď tak, ako prišla, klient
+  * ju dostane prispôsobenú svojmu EDNS payloadu (cez TCP bez skrátenia).
+  */
+ static void relay_upstream_reply(void *ctx, const dns_client_t *client,
+                                  const uint8_t *query, size_t query_len,
+                                  uint8_t *response, size_t resp_len) {
+     dns_worker_t *worker = (dns_worker_t *)ctx;
+     
+     /* Prefetch alebo klient už so stale odpoveďou - odpoveď iba obnoví
+      * cache (pri zlyhaní záznam dožije) */
+     if (client->prefetch || client->answered) {
+         if (client->prefetch) {
+             worker->prefetch_pending--;
+         }
+         
+         dns_cache_key_t key;
+         if (response != NULL && worker->cache != NULL &&
+             dns_cache_key_from_packet(query, query_len, &key) == 0) {
+             dns_cache_store(worker->cache, &key, response, resp_len, monotonic_ms());
+         }
+         return;
+     }
+     
+     worker->stats.pending_count--;
+     
+     if (response == NULL) {
+         verbose_log(worker->config, "  Upstream forwarding failed - sending SERVFAIL");
+         send_servfail(worker, client, query, query_len);
+         return;
+     }
+     
+     verbose_log(worker->config, "  Response received from upstream (%zu bytes)", resp_len);
+     
+     /* Uloženie do cache (necachovateľné odpovede sa ticho preskočia) */
+     dns_cache_key_t key;
+     if (worker->cache != NULL &&
+         dns_cache_key_from_packet(query, query_len, &key) == 0) {
+         dns_cache_store(worker->cache, &key, response, resp_len, monotonic_ms());
+     }
+     
+     resp_len = dns_fit_response(response, resp_len, DNS_EDNS_MAX_SIZE, &client->edns,
+                                 client_payload(client));
+     if (resp_len == 0) {
+         /* Edge case: Poškodená odpoveď upstream (napr. dva OPT záznamy) */
+         verbose_log(worker->config, "  Invalid upstream response - sending SERVFAIL");
+         worker->stats.error_count++;
+         send_servfail(worker, client, query, query_len);
+         return;
+     }
+     
+     account_response(&worker->stats, response, resp_len);
+     send_response(worker, client, response, resp_len);
+ }
+ 
+ /**
+  * @brief Callback forwardera - upstream nestihol termín odpovede klientovi
+  * 
+  * Ak je otázka v cache aspoň ako stale záznam (RFC 8767), klient ho
+  * dostane hneď s krátkym TTL; upstream dotaz beží ďalej a jeho odpoveď
+  * iba obnoví cache.
+  * 
+  * @return 0 ak klient dostal odpoveď, -1 ak čaká ďalej na upstream
+  */
+ static int serve_stale_reply(void *ctx, const dns_client_t *client,
+                              const uint8_t *query, size_t query_len) {
+     dns_worker_t *worker = (dns_worker_t *)ctx;
+     dns_cache_key_t key;
+     uint8_t response[DNS_EDNS_MAX_SIZE];
+     
+     if (worker->cache == NULL ||
+         dns_cache_key_from_packet(query, query_len, &key) != 0) {
+         return -1;
      }
      
-     verbose_log(config, "  Response received from upstream (%zu bytes)", *response_len);
+     size_t resp_len = dns_cache_lookup_stale(worker->cache, &key, query, response,
+                                              sizeof(response), monotonic_ms());
+     if (resp_len > 0) {
+         resp_len = dns_fit_response(response, resp_len, sizeof(response), &client->edns,
+                                     client_payload(client));
+     }
+     if (resp_len == 0) {
+         return -1;
+     }
      
-     free_dns_message(&query);
+     verbose_log(worker->config, "  Upstream too slow - answering from stale cache entry");
+     
+     worker->stats.pending_count--;
+     send_response(worker, client, response, resp_len);
      return 0;
  }
  
  /**
-  * @brief Hlavná slučka DNS servera
+  * @brief Rýchla cesta pre blokované domény - bez parsovania a alokácií
   * 
-  * Nekonečná slučka ktorá:
-  * 1. Čaká na UDP dotaz (recvfrom)
-  * 2. Spracuje dotaz
-  * 3. Pošle odpoveď (sendto)
+  * Hlavička a prvá otázka sa overia priamo v prijatom bufferi, filter sa
+  * skontroluje nad QNAME vo wire formáte a blokovaný dotaz sa v tom istom
+  * bufferi prepíše na NXDOMAIN (hlavička + otázka, zvyšok sa odreže).
+  * Odpoveď je bajtovo zhodná s tou z process_dns_query().
+  * 
+  * EDNS klient (jediný OPT hneď za otázkou) dostane namiesto svojho OPT
+  * náš - zmestí sa na jeho miesto, takže buffer netreba zväčšovať.
+  * 
+  * Edge cases (FAST_PATH_FALLBACK - rieši plný parser):
+  * - Odpoveď namiesto dotazu, iný opcode ako QUERY
+  * - QDCOUNT != 1, answer/authority záznamy, iné additional RR ako OPT
+  * - Komprimované alebo neplatné QNAME, chýbajúci QTYPE/QCLASS
+  * - Iný typ ako A (NOTIMPL má prednosť pred filtrom)
+  */
+ static int fast_path_query(dns_worker_t *worker, uint8_t *packet, size_t len,
+                            const dns_client_t *client) {
+     uint16_t flags = (uint16_t)((packet[2] << 8) | packet[3]);
+     uint16_t qdcount = (uint16_t)((packet[4] << 8) | packet[5]);
+     
+     if ((flags & (DNS_FLAG_QR | DNS_FLAG_OPCODE)) != 0 || qdcount != 1) {
+         return FAST_PATH_FALLBACK;
+     }
+     
+     int name_len = dns_wire_name_length(packet, len, DNS_HEADER_SIZE);
+     if (name_len < 0 || DNS_HEADER_SIZE + (size_t)name_len + 4 > len) {
+         return FAST_PATH_FALLBACK;
+     }
+     
+     size_t qtype_offset = DNS_HEADER_SIZE + (size_t)name_len;
+     uint16_t qtype = (uint16_t)((packet[qtype_offset] << 8) | packet[qtype_offset + 1]);
+     if (qtype != DNS_TYPE_A) {
+         return FAST_PATH_FALLBACK;
+     }
+     
+     size_t question_end = qtype_offset + 4;
+     uint16_t arcount = (uint16_t)((packet[10] << 8) | packet[11]);
+     dns_edns_t edns;
+     memset(&edns, 0, sizeof(edns));
+     
+     if ((packet[6] | packet[7] | packet[8] | packet[9]) != 0 || arcount > 1) {
+         return FAST_PATH_FALLBACK;
+     }
+     
+     if (arcount == 1) {
+         const uint8_t *opt = packet + question_end;
+         if (question_end + DNS_OPT_RR_SIZE > len || opt[0] != 0 ||
+             opt[1] != 0 || opt[2] != DNS_TYPE_OPT ||
+             question_end + DNS_OPT_RR_SIZE + (size_t)((opt[9] << 8) | opt[10]) != len) {
+             return FAST_PATH_FALLBACK;
+         }
+         edns.present = true;
+         edns.udp_size = DNS_EDNS_UDP_SIZE;
+         edns.dnssec_ok = (opt[7] & 0x80) != 0;
+     }
+     
+     if (!is_wire_name_blocked(filter_reader_root(worker->reloader),
+                               packet + DNS_HEADER_SIZE, (size_t)name_len)) {
+         return FAST_PATH_ALLOWED;
+     }
+     
+     if (worker->config->verbose) {
+         char qname[DNS_MAX_NAME_LEN + 1];
+         size_t offset = DNS_HEADER_SIZE;
+         if (parse_dns_name(packet, len, &offset, qname, sizeof(qname)) == 0) {
+             verbose_log(worker->config, "  Transaction ID: 0x%04X",
+                         (unsigned int)((packet[0] << 8) | packet[1]));
+             verbose_log(worker->config, "  Domain: %s", qname);
+         }
+         verbose_log(worker->config, "  Domain is BLOCKED (fast path) - sending NXDOMAIN");
+     }
+     
+     size_t response_len = build_error_in_place(packet, question_end, DNS_RCODE_NXDOMAIN);
+     if (response_len > 0 && edns.present) {
+         response_len = dns_append_opt(packet, response_len, len, &edns);
+     }
+     if (response_len == 0) {
+         return FAST_PATH_FALLBACK;
+     }
+     
+     worker->stats.blocked_count++;
+     worker->stats.fast_path_count++;
+     send_response(worker, client, packet, response_len);
+     return FAST_PATH_ANSWERED;
+ }
+ 
+ /**
+  * @brief Spracuje jeden prijatý dotaz (UDP datagram alebo TCP rámec)
   * 
   * Edge cases:
-  * - Socket errors
   * - Truncated packets
   * - Invalid source addresses
-  * - Timeout pri upstream
   * 
-  * @param config Server konfigurácia
-  * @return ERR_SUCCESS alebo chybový kód
+  * @param client Adresu (a TCP spojenie) vyplní volajúci, ID a EDNS sa doplnia
+  * @return 0 ak odpoveď odišla alebo príde od upstream, -1 ak sa dotaz zahodil
   */
- int run_server(server_config_t *config) {
-     if (config == NULL) {
-         return ERR_INVALID_ARGS;
+ static int handle_query_packet(dns_worker_t *worker, uint8_t *query_buffer,
+                                size_t recv_len, dns_client_t *client) {
+     server_config_t *config = worker->config;
+     server_stats_t *stats = &worker->stats;
+     const struct sockaddr_in *client_addr = &client->addr;
+     char client_ip[INET_ADDRSTRLEN];
+     
+     /* inet_ntoa() používa statický buffer - nie je thread-safe */
+     if (config->verbose) {
+         inet_ntop(AF_INET, &client_addr->sin_addr, client_ip, sizeof(client_ip));
      }
      
-     /* Inicializácia socketu */
-     int sockfd = init_udp_server(config->local_port);
-     if (sockfd < 0) {
-         return ERR_SOCKET_CREATE;
+     /* Edge case: Príliš krátky packet */
+     if (recv_len < DNS_HEADER_SIZE) {
+         verbose_log(config, "Received packet too short (%zu bytes) from %s:%u",
+                    recv_len, client_ip, ntohs(client_addr->sin_port));
+         stats->error_count++;
+         return -1;
      }
      
-     verbose_log(config, "DNS server listening on port %u", config->local_port);
-     verbose_log(config, "Press Ctrl+C to stop");
+     stats->query_count++;
      
-     /* Nastavenie signal handlera pre graceful shutdown */
-     signal(SIGINT, signal_handler);
-     signal(SIGTERM, signal_handler);
+     verbose_log(config, "\n[Worker %u, Query #%lu] from %s:%u%s (%zu bytes)",
+                worker->id,
+                stats->query_count,
+                client_ip,
+                ntohs(client_addr->sin_port),
+                client->tcp_conn != 0 ? " over TCP" : "",
+                recv_len);
+     
+     /* Blokované domény sa vybavia priamo v prijatom bufferi */
+     int fast = fast_path_query(worker, query_buffer, recv_len, client);
+     if (fast == FAST_PATH_ANSWERED) {
+         return 0;
+     }
+     
+     /* Zero-copy parse - QNAME sa dekóduje do bufferu na zásobníku */
+     dns_view_t view;
+     char qname[DNS_MAX_NAME_LEN + 1];
+     
+     if (dns_view_parse(query_buffer, recv_len, &view, qname, sizeof(qname)) != 0) {
+         verbose_log(config, "Failed to parse DNS query");
+         stats->error_count++;
+         return -1;
+     }
+     
+     /* Odpoveď z cache môže byť až DNS_EDNS_MAX_SIZE pred prispôsobením klientovi */
+     uint8_t response[DNS_EDNS_MAX_SIZE];
+     size_t response_len = 0;
+     int result;
+     
+     client->id = view.header.id;
+     
+     /* Edge case: Poškodený alebo viacnásobný OPT (RFC 6891 Section 6.1.1) */
+     if (dns_parse_edns(query_buffer, recv_len, &client->edns) != 0) {
+         verbose_log(config, "  Invalid OPT record - sending FORMERR");
+         memset(&client->edns, 0, sizeof(client->edns));
+         response_len = build_error_reply(&view, client, DNS_RCODE_FORMERR,
+                                          response, sizeof(response));
+         result = response_len > 0 ? QUERY_ANSWERED : -1;
+     } else {
+         result = process_dns_query(worker, &view, qname, client,
+                                    fast == FAST_PATH_ALLOWED, response, &response_len);
+     }
      
-     /* Buffer pre prijímanie DNS dotazov */
-     uint8_t query_buffer[DNS_UDP_MAX_SIZE];
+     if (result == QUERY_FORWARDED) {
+         /* Odpoveď odošle relay_upstream_reply() */
+         stats->pending_count++;
+         return 0;
+     }
+     
+     if (result != QUERY_ANSWERED && result != QUERY_CACHED) {
+         verbose_log(config, "Failed to process query");
+         stats->error_count++;
+         return -1;
+     }
+     
+     /* Určenie typu odpovede pre štatistiky (cache hit je už započítaný) */
+     if (result == QUERY_ANSWERED) {
+         account_response(stats, response, response_len);
+     }
+     
+     /* Odoslanie odpovede */
+     send_response(worker, client, response, response_len);
+     return 0;
+ }
+ 
+ /**
+  * @brief Spracuje jeden UDP datagram
+  */
+ static void handle_udp_packet(dns_worker_t *worker, uint8_t *query_buffer,
+                               size_t recv_len, const struct sockaddr_in *client_addr) {
+     dns_client_t client;
+     memset(&client, 0, sizeof(client));
+     client.addr = *client_addr;
+     
+     handle_query_packet(worker, query_buffer, recv_len, &client);
+ }
+ 
+ /**
+  * @brief Callback TCP listenera - jeden dotaz z TCP spojenia
+  * 
+  * Odpoveď (aj forwardovaná) nesie odkaz na spojenie, takže pipelined
+  * dotazy sa zodpovedajú v poradí, v akom sú hotové.
+  */
+ static int handle_tcp_query(void *ctx, uint32_t conn_ref, uint32_t generation,
+                             const struct sockaddr_in *addr, uint8_t *query, size_t len) {
+     dns_client_t client;
+     memset(&client, 0, sizeof(client));
+     client.addr = *addr;
+     client.tcp_conn = conn_ref;
+     client.tcp_gen = generation;
+     
+     return handle_query_packet((dns_worker_t *)ctx, query, len, &client);
+ }
+ 
+ /**
+  * @brief Prečíta a spracuje dotazy čakajúce na klientskom sockete
+  * 
+  * Socket je neblokujúci - číta sa kým recvfrom() nevráti EAGAIN, najviac
+  * však WORKER_RECV_BUDGET dotazov, aby sa medzitým stihli spracovať aj
+  * odpovede od upstream.
+  * 
+  * Edge cases:
+  * - Socket errors
+  */
+ static void handle_client_queries(dns_worker_t *worker) {
+     /* Buffer pre prijímanie DNS dotazov (EDNS klient môže poslať viac ako 512 B) */
+     uint8_t query_buffer[DNS_EDNS_UDP_SIZE];
      
      /* Client address */
      struct sockaddr_in client_addr;
      socklen_t client_addr_len;
      
-     /* Počítadlo dotazov */
-     unsigned long query_count = 0;
-     unsigned long blocked_count = 0;
-     unsigned long forwarded_count = 0;
-     unsigned long error_count = 0;
-     
-     /* Hlavná slučka servera */
-     while (server_running) {
+     for (int budget = 0; budget < WORKER_RECV_BUDGET; budget++) {
          client_addr_len = sizeof(client_addr);
          
          /* Prijatie UDP dotazu */
-         ssize_t recv_len = recvfrom(sockfd, query_buffer, sizeof(query_buffer), 0,
+         ssize_t recv_len = recvfrom(worker->sockfd, query_buffer, sizeof(query_buffer), 0,
                                      (struct sockaddr *)&client_addr, &client_addr_len);
          
          if (recv_len < 0) {
              if (errno == EINTR) {
-                 /* Interrupted by signal - continue alebo exit */
-                 if (!server_running) {
-                     break;
-                 }
                  continue;
              }
-
+             
              if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                 /* Socket timeout - check server_running flag and continue */
-                 continue;
+                 /* Socket vyprázdnený */
+                 return;
              }
-
+             
              print_error("recvfrom() failed: %s", strerror(errno));
-             error_count++;
-             continue;
+             worker->stats.error_count++;
+             return;
          }
          
-         /* Edge case: Príliš krátky packet */
-         if (recv_len < DNS_HEADER_SIZE) {
-             verbose_log(config, "Received packet too short (%zd bytes) from %s:%u",
-                        recv_len,
-                        inet_ntoa(client_addr.sin_addr),
-                        ntohs(client_addr.sin_port));
-             error_count++;
-             continue;
+         worker->stats.recv_calls++;
+         handle_udp_packet(worker, query_buffer, (size_t)recv_len, &client_addr);
+     }
+ }
+ 
+ /**
+  * @brief Prečíta a spracuje dotazy po dávkach cez recvmmsg()
+  * 
+  * Jedno volanie recvmmsg() vráti až rx.capacity datagramov; odpovede
+  * sa zbierajú v tx dávke a odošlú sa naraz cez sendmmsg(). Pri malých
+  * (30-60 B) dotazoch tak réžia syscallov neprevažuje nad spracovaním.
+  */
+ static void handle_client_batches(dns_worker_t *worker) {
+     io_batch_t *rx = &worker->rx;
+     unsigned int received_total = 0;
+     
+     while (received_total < WORKER_RECV_BUDGET) {
+         for (unsigned int i = 0; i < rx->capacity; i++) {
+             io_batch_prepare(rx, i, DNS_EDNS_UDP_SIZE);
          }
          
-         query_count++;
+         int n = recvmmsg(worker->sockfd, rx->msgs, rx->capacity, MSG_DONTWAIT, NULL);
+         
+         if (n < 0) {
+             if (errno == EINTR) {
+                 continue;
+             }
+             if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                 print_error("recvmmsg() failed: %s", strerror(errno));
+                 worker->stats.error_count++;
+             }
+             return;
+         }
          
-         verbose_log(config, "\n[Query #%lu] from %s:%u (%zd bytes)",
-                    query_count,
-                    inet_ntoa(client_addr.sin_addr),
-                    ntohs(client_addr.sin_port),
-                    recv_len);
+         worker->stats.recv_calls++;
          
-         /* Spracovanie dotazu */
-         uint8_t *response_buffer = NULL;
-         size_t response_len = 0;
+         for (int i = 0; i < n; i++) {
+             handle_udp_packet(worker, (uint8_t *)rx->iov[i].iov_base,
+                               rx->msgs[i].msg_len, &rx->addrs[i]);
+         }
          
-         int result = process_dns_query(config, query_buffer, (size_t)recv_len,
-                                        &response_buffer, &response_len);
+         received_total += (unsigned int)n;
          
-         if (result != 0 || response_buffer == NULL) {
-             verbose_log(config, "Failed to process query");
-             error_count++;
-             
-             if (response_buffer != NULL) {
-                 free(response_buffer);
+         /* Menej ako plná dávka = socket je vyprázdnený */
+         if ((unsigned int)n < rx->capacity) {
+             return;
+         }
+     }
+ }
+ 
+ /**
+  * @brief Zaregistruje file descriptor do epoll workera
+  */
+ static int worker_watch_fd(dns_worker_t *worker, int fd) {
+     struct epoll_event ev;
+     memset(&ev, 0, sizeof(ev));
+     ev.events = EPOLLIN;
+     ev.data.fd = fd;
+     
+     if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+         print_error("epoll_ctl() failed: %s", strerror(errno));
+         return -1;
+     }
+     
+     return 0;
+ }
+ 
+ /**
+  * @brief Hlavná slučka jedného workera (event loop)
+  * 
+  * epoll sleduje klientsky socket, TCP listener so spojeniami aj upstream
+  * sockety forwardera. Kým sa čaká na upstream, worker ďalej obsluhuje
+  * nové dotazy; odpovede sa párujú v pending tabuľke a timeouty rieši
+  * timer wheel forwardera (TCP spojenia majú vlastný pre nečinnosť).
+  * 
+  * @param worker Kontext workera (socket, konfigurácia, počítadlá)
+  */
+ static void worker_loop(dns_worker_t *worker) {
+     struct epoll_event events[WORKER_MAX_EVENTS];
+     
+     while (server_running) {
+         /* Upstream adresa sa zmenila (obnova na pozadí) - nezmenené
+          * servery si ponechajú sockety aj namerané RTT */
+         if (upstream_cache_generation() != worker->upstream_gen) {
+             for (unsigned int i = 0; i < worker->forwarder.upstream_count; i++) {
+                 struct sockaddr_in upstream;
+                 worker->upstream_gen = upstream_cache_get(i, &upstream);
+                 forwarder_set_upstream(&worker->forwarder, i, &upstream);
+             }
+         }
+         
+         int timeout = forwarder_timeout_ms(&worker->forwarder, monotonic_ms(),
+                                            WORKER_POLL_MS);
+         timeout = tcp_server_timeout_ms(&worker->tcp, monotonic_ms(), timeout);
+         
+         /* Quiescent bod - počas čakania worker nedrží žiadny filter */
+         filter_reader_offline(worker->reloader, worker->id);
+         int n = epoll_wait(worker->epfd, events, WORKER_MAX_EVENTS, timeout);
+         filter_reader_online(worker->reloader, worker->id);
+         
+         if (n < 0) {
+             if (errno == EINTR) {
+                 continue;
              }
-             continue;
+             print_error("epoll_wait() failed: %s", strerror(errno));
+             worker->stats.error_count++;
+             break;
          }
          
-         /* Určenie typu odpovede pre štatistiky */
-         if (response_len >= DNS_HEADER_SIZE) {
-             dns_header_t resp_header;
-             if (parse_dns_header(response_buffer, response_len, &resp_header) == 0) {
-                 uint16_t rcode = resp_header.flags & 0x0F;
-                 
-                 if (rcode == DNS_RCODE_NXDOMAIN) {
-                     blocked_count++;
-                 } else if (rcode == DNS_RCODE_NOERROR) {
-                     forwarded_count++;
+         for (int i = 0; i < n; i++) {
+             /* TCP udalosti nesú značku v data.u64 (index spojenia, nie fd) */
+             if (events[i].data.u64 & TCP_EPOLL_TAG) {
+                 tcp_server_handle_event(&worker->tcp, events[i].data.u64, events[i].events);
+             } else if (events[i].data.fd == worker->sockfd) {
+                 if (worker->batching) {
+                     handle_client_batches(worker);
+                 } else {
+                     handle_client_queries(worker);
                  }
+             } else if (forwarder_owns_fd(&worker->forwarder, events[i].data.fd)) {
+                 forwarder_handle_event(&worker->forwarder, events[i].data.fd,
+                                        events[i].events);
              }
          }
          
-         /* Odoslanie odpovede */
-         ssize_t sent_len = sendto(sockfd, response_buffer, response_len, 0,
-                                   (struct sockaddr *)&client_addr, client_addr_len);
-         
-         if (sent_len < 0) {
-             print_error("sendto() failed: %s", strerror(errno));
-             error_count++;
-         } else if ((size_t)sent_len != response_len) {
-             verbose_log(config, "Warning: Partial send (%zd/%zu bytes)",
-                        sent_len, response_len);
-         } else {
-             verbose_log(config, "Response sent (%zu bytes)", response_len);
+         forwarder_process_timeouts(&worker->forwarder, monotonic_ms());
+         tcp_server_process_timeouts(&worker->tcp, monotonic_ms());
+         
+         /* Všetky odpovede z tejto iterácie jedným sendmmsg(), TCP odpovede
+          * jedným send() na spojenie */
+         flush_responses(worker);
+         tcp_server_flush(&worker->tcp);
+     }
+     
+     filter_reader_offline(worker->reloader, worker->id);
+ }
+ 
+ /**
+  * @brief Inicializuje event loop workera (epoll + forwarder + TCP listener)
+  * @param tcp_fd TCP listen socket (pri chybe ostáva volajúcemu)
+  * @param tcp_max_conns Limit TCP spojení workera
+  * @return 0 pri úspechu, -1 pri chybe
+  */
+ static int worker_init(dns_worker_t *worker, int tcp_fd, size_t tcp_max_conns) {
+     /* Klientsky socket musí byť neblokujúci (event loop) */
+     int flags = fcntl(worker->sockfd, F_GETFL, 0);
+     if (flags < 0 || fcntl(worker->sockfd, F_SETFL, flags | O_NONBLOCK) < 0) {
+         print_error("Failed to set O_NONBLOCK: %s", strerror(errno));
+         return -1;
+     }
+     
+     /* Dávkové I/O (recvmmsg/sendmmsg) pre batch_size > 1 */
+     unsigned int batch = worker->config->batch_size;
+     worker->batching = batch > 1;
+     
+     if (worker->batching &&
+         (io_batch_init(&worker->rx, batch) != 0 || io_batch_init(&worker->tx, batch) != 0)) {
+         print_error("Failed to allocate I/O batch buffers");
+         io_batch_free(&worker->rx);
+         return -1;
+     }
+     
+     worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+     if (worker->epfd < 0) {
+         print_error("epoll_create1() failed: %s", strerror(errno));
+         io_batch_free(&worker->rx);
+         io_batch_free(&worker->tx);
+         return -1;
+     }
+     
+     /* Forwarder registruje do epoll sám iba TCP spojenia (vznikajú za behu) */
+     struct sockaddr_in upstreams[DNS_MAX_UPSTREAMS];
+     unsigned int upstream_count = upstream_cache_count();
+     for (unsigned int i = 0; i < upstream_count; i++) {
+         worker->upstream_gen = upstream_cache_get(i, &upstreams[i]);
+     }
+     
+     if (forwarder_init(&worker->forwarder, upstreams, upstream_count,
+                        worker->config->rto_max_ms, worker->config->hedge_percent,
+                        worker->epfd,
+                        relay_upstream_reply, worker) != 0) {
+         close(worker->epfd);
+         worker->epfd = -1;
+         io_batch_free(&worker->rx);
+         io_batch_free(&worker->tx);
+         return -1;
+     }
+     
+     /* Serve-stale - klient nečaká na pomalý upstream dlhšie ako termín */
+     if (worker->cache != NULL && worker->config->stale_sec > 0) {
+         forwarder_set_stale(&worker->forwarder, FORWARDER_STALE_TIMEOUT_MS, serve_stale_reply);
+     }
+     
+     bool watched = worker_watch_fd(worker, worker->sockfd) == 0;
+     for (unsigned int u = 0; watched && u < upstream_count; u++) {
+         const upstream_t *up = &worker->forwarder.upstreams[u];
+         for (unsigned int i = 0; watched && i < up->sock_count; i++) {
+             watched = worker_watch_fd(worker, up->socks[i]) == 0;
+         }
+     }
+     
+     if (!watched || tcp_server_init(&worker->tcp, tcp_fd, worker->epfd, tcp_max_conns,
+                                     handle_tcp_query, worker) != 0) {
+         close(worker->epfd);
+         worker->epfd = -1;
+         forwarder_free(&worker->forwarder);
+         io_batch_free(&worker->rx);
+         io_batch_free(&worker->tx);
+         return -1;
+     }
+     
+     return 0;
+ }
+ 
+ /**
+  * @brief Uvoľní event loop workera
+  */
+ static void worker_cleanup(dns_worker_t *worker) {
+     tcp_server_free(&worker->tcp);
+     
+     if (worker->epfd >= 0) {
+         close(worker->epfd);
+         worker->epfd = -1;
+     }
+     
+     forwarder_free(&worker->forwarder);
+     io_batch_free(&worker->rx);
+     io_batch_free(&worker->tx);
+     close(worker->sockfd);
+ }
+ 
+ /**
+  * @brief Vstupný bod worker vlákna
+  */
+ static void *worker_thread(void *arg) {
+     worker_loop((dns_worker_t *)arg);
+     return NULL;
+ }
+ 
+ /**
+  * @brief Určí limit TCP spojení na jedného workera
+  * 
+  * Mäkký limit file descriptorov sa zdvihne (najviac po tvrdý) tak, aby
+  * pokryl TCP_MAX_CONNECTIONS na workera; zo skutočného limitu sa odráta
+  * rezerva na sockety workerov a zvyšok sa rozdelí medzi workerov. Bez
+  * toho by accept() pri vyčerpaných deskriptoroch zlyhával s EMFILE
+  * a spojenie by ostávalo v backlogu (level-triggered epoll by sa točil).
+  * 
+  * @param num_workers Počet workerov
+  * @param num_upstreams Počet upstream serverov
+  * @return Limit spojení na workera (aspoň 1)
+  */
+ static size_t tcp_connection_limit(unsigned int num_workers, unsigned int num_upstreams) {
+     /* Na workera: UDP socket, TCP listen socket, epoll, pool každého upstream (UDP aj TCP) */
+     size_t reserve = SERVER_FD_RESERVE +
+                      (size_t)num_workers * ((size_t)num_upstreams *
+                                             (FORWARDER_POOL_SIZE + FORWARDER_TCP_POOL_SIZE) + 3);
+     size_t wanted = reserve + (size_t)num_workers * TCP_MAX_CONNECTIONS;
+     struct rlimit limit;
+     
+     if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+         return TCP_MAX_CONNECTIONS;
+     }
+     
+     if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted) {
+         struct rlimit raised = limit;
+         raised.rlim_cur = limit.rlim_max == RLIM_INFINITY || limit.rlim_max > wanted ?
+                           wanted : limit.rlim_max;
+         if (setrlimit(RLIMIT_NOFILE, &raised) == 0) {
+             limit = raised;
+         }
+     }
+     
+     if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= wanted) {
+         return TCP_MAX_CONNECTIONS;
+     }
+     
+     size_t available = limit.rlim_cur > reserve ? (size_t)(limit.rlim_cur - reserve) : 0;
+     size_t per_worker = available / num_workers;
+     return per_worker > 0 ? per_worker : 1;
+ }
+ 
+ /**
+  * @brief Hlavná slučka DNS servera
+  * 
+  * Spustí config->num_threads workerov. Každý worker má vlastný UDP aj TCP
+  * listen socket naviazaný na rovnaký port cez SO_REUSEPORT, takže kernel
+  * rozkladá prichádzajúce dotazy aj spojenia medzi jednotlivé sockety (a
+  * jadrá CPU), a vlastný epoll event loop s asynchrónnym forwarderom.
+  * Hlavné vlákno iba čaká na signál a po ukončení workerov zlúči ich
+  * štatistiky.
+  * 
+  * Edge cases:
+  * - Zlyhanie vytvorenia socketu / vlákna (už spustení workeri sa ukončia)
+  * - Signál doručený worker vláknu (workeri majú signály blokované)
+  * 
+  * @param config Server konfigurácia
+  * @return ERR_SUCCESS alebo chybový kód
+  */
+ int run_server(server_config_t *config) {
+     if (config == NULL) {
+         return ERR_INVALID_ARGS;
+     }
+     
+     unsigned int num_workers = config->num_threads > 0 ? config->num_threads : 1;
+     bool reuse_port = num_workers > 1;
+     
+     /* Upstream servery sa vyriešia raz pri štarte - workeri dostanú hotové adresy */
+     if (upstream_cache_init(config->upstream_servers, config->upstream_count) != 0) {
+         print_error("Failed to resolve upstream servers");
+         return ERR_UPSTREAM_FAIL;
+     }
+     
+     /* Cache odpovedí zdieľaná workermi (0 MB = vypnutá) */
+     dns_cache_t *cache = NULL;
+     if (config->cache_size_mb > 0) {
+         cache = dns_cache_create((size_t)config->cache_size_mb * 1024 * 1024,
+                                  (size_t)config->negative_cache_mb * 1024 * 1024,
+                                  config->stale_sec);
+         if (cache == NULL) {
+             print_error("Failed to allocate response cache");
+             upstream_cache_clear();
+             return ERR_MEMORY;
+         }
+     }
+     
+     /* Warm restart - snapshot z predchádzajúceho behu (chyba nie je fatálna) */
+     if (cache != NULL && config->cache_file != NULL) {
+         size_t loaded;
+         uint64_t start_ms = monotonic_ms();
+         dns_cache_load(cache, config->cache_file, start_ms, (uint64_t)time(NULL), &loaded);
+         verbose_log(config, "Cache snapshot %s: %zu entries loaded in %llu ms",
+                     config->cache_file, loaded,
+                     (unsigned long long)(monotonic_ms() - start_ms));
+     }
+     
+     /* Hot reload filtra - workeri čítajú koreň cez reloader (RCU) */
+     filter_reloader_t reloader;
+     if (filter_reloader_init(&reloader, config, num_workers, config->filter_watch) != 0) {
+         print_error("Failed to initialize filter reloader");
+         dns_cache_destroy(cache);
+         upstream_cache_clear();
+         return ERR_MEMORY;
+     }
+     
+     dns_worker_t *workers = (dns_worker_t *)calloc(num_workers, sizeof(dns_worker_t));
+     if (workers == NULL) {
+         print_error("Failed to allocate worker contexts");
+         filter_reloader_destroy(&reloader);
+         dns_cache_destroy(cache);
+         upstream_cache_clear();
+         return ERR_MEMORY;
+     }
+     
+     size_t tcp_max_conns = tcp_connection_limit(num_workers, config->upstream_count);
+     
+     /* Inicializácia socketov a event loopov - každý worker má vlastné */
+     for (unsigned int i = 0; i < num_workers; i++) {
+         workers[i].id = i;
+         workers[i].config = config;
+         workers[i].cache = cache;
+         workers[i].reloader = &reloader;
+         workers[i].epfd = -1;
+         workers[i].sockfd = init_udp_server(config->local_port, reuse_port);
+         int tcp_fd = workers[i].sockfd >= 0 ?
+                      init_tcp_server(config->local_port, reuse_port) : -1;
+         
+         int err = ERR_SUCCESS;
+         if (workers[i].sockfd < 0 || tcp_fd < 0) {
+             if (workers[i].sockfd >= 0) {
+                 close(workers[i].sockfd);
+             }
+             err = ERR_SOCKET_CREATE;
+         } else if (worker_init(&workers[i], tcp_fd, tcp_max_conns) != 0) {
+             close(workers[i].sockfd);
+             close(tcp_fd);
+             err = ERR_UPSTREAM_FAIL;
          }
          
-         free(response_buffer);
+         if (err != ERR_SUCCESS) {
+             for (unsigned int j = 0; j < i; j++) {
+                 worker_cleanup(&workers[j]);
+             }
+             free(workers);
+             filter_reloader_destroy(&reloader);
+             dns_cache_destroy(cache);
+             upstream_cache_clear();
+             return err;
+         }
      }
      
-     /* Shutdown */
-     close(sockfd);
+     verbose_log(config, "DNS server listening on port %u UDP/TCP (%u worker%s)",
+                 config->local_port, num_workers, num_workers > 1 ? "s" : "");
+     verbose_log(config, "TCP connection limit: %zu per worker, idle timeout %u ms",
+                 tcp_max_conns, (unsigned int)TCP_IDLE_TIMEOUT_MS);
+     verbose_log(config, "Press Ctrl+C to stop, send SIGHUP to reload the filter");
+     
+     /* Nastavenie signal handlera pre graceful shutdown */
+     signal(SIGINT, signal_handler);
+     signal(SIGTERM, signal_handler);
+     signal(SIGHUP, reload_signal_handler);
+     
+     /* Workeri dedia masku signálov - zablokujeme ich, aby signály
+      * obsluhovalo iba hlavné vlákno */
+     sigset_t block_set, old_set;
+     sigemptyset(&block_set);
+     sigaddset(&block_set, SIGINT);
+     sigaddset(&block_set, SIGTERM);
+     sigaddset(&block_set, SIGHUP);
+     pthread_sigmask(SIG_BLOCK, &block_set, &old_set);
+     
+     unsigned int started = 0;
+     int ret = ERR_SUCCESS;
+     
+     if (filter_reloader_start(&reloader) != 0) {
+         server_running = 0;
+         ret = ERR_MEMORY;
+     }
+     
+     for (; server_running && started < num_workers; started++) {
+         int err = pthread_create(&workers[started].thread, NULL,
+                                  worker_thread, &workers[started]);
+         if (err != 0) {
+             print_error("Failed to create worker thread: %s", strerror(err));
+             server_running = 0;
+             ret = ERR_MEMORY;
+             break;
+         }
+     }
+     
+     pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+     
+     /* Hlavné vlákno čaká na signál (sleep() preruší doručený signál)
+      * a medzitým obnovuje upstream adresu - getaddrinfo() nikdy nebeží
+      * v event loope workerov. Reload filtra iba vyžiada, samotné
+      * načítanie beží vo vlákne reloadera. */
+     uint64_t refresh_ms = (uint64_t)config->upstream_refresh_sec * 1000u;
+     uint64_t next_refresh = monotonic_ms() + refresh_ms;
+     bool snapshot = cache != NULL && config->cache_file != NULL;
+     uint64_t next_snapshot = monotonic_ms() + DNS_CACHE_SNAPSHOT_SEC * 1000u;
+     
+     while (server_running) {
+         sleep(1);
+         
+         if (reload_requested) {
+             reload_requested = 0;
+             verbose_log(config, "SIGHUP received, reloading filter %s", config->filter_file);
+             filter_reloader_request(&reloader);
+         }
+         if (filter_reloader_poll(&reloader)) {
+             verbose_log(config, "Filter file %s changed, reloading", config->filter_file);
+         }
+         
+         if (refresh_ms > 0 && server_running && monotonic_ms() >= next_refresh) {
+             if (upstream_cache_refresh() == 0) {
+                 verbose_log(config, "Upstream addresses refreshed");
+             }
+             next_refresh = monotonic_ms() + refresh_ms;
+         }
+         
+         /* Periodický snapshot - po páde ostane cache najviac DNS_CACHE_SNAPSHOT_SEC stará */
+         if (snapshot && server_running && monotonic_ms() >= next_snapshot) {
+             size_t saved;
+             if (dns_cache_save(cache, config->cache_file, monotonic_ms(),
+                                (uint64_t)time(NULL), &saved) == 0) {
+                 verbose_log(config, "Cache snapshot: %zu entries saved to %s",
+                             saved, config->cache_file);
+             }
+             next_snapshot = monotonic_ms() + DNS_CACHE_SNAPSHOT_SEC * 1000u;
+         }
+     }
+     
+     /* Shutdown - workeri zistia server_running == 0 najneskôr po WORKER_POLL_MS */
+     server_stats_t total;
+     memset(&total, 0, sizeof(total));
+     unsigned long upstream_retries = 0;
+     unsigned long upstream_timeouts = 0;
+     unsigned long upstream_tcp_fallbacks = 0;
+     unsigned long upstream_tcp_connects = 0;
+     unsigned long upstream_hedges = 0;
+     unsigned long upstream_hedge_wins = 0;
+     unsigned long upstream_coalesced = 0;
+     unsigned long upstream_stale = 0;
+     unsigned long tcp_accepted = 0;
+     unsigned long tcp_rejected = 0;
+     unsigned long tcp_idle_closed = 0;
+     unsigned long tcp_queries = 0;
+     upstream_t upstream_totals[DNS_MAX_UPSTREAMS];
+     uint64_t upstream_srtt_sum[DNS_MAX_UPSTREAMS];
+     memset(upstream_totals, 0, sizeof(upstream_totals));
+     memset(upstream_srtt_sum, 0, sizeof(upstream_srtt_sum));
+     
+     for (unsigned int i = 0; i < started; i++) {
+         pthread_join(workers[i].thread, NULL);
+         
+         total.query_count += workers[i].stats.query_count;
+         total.blocked_count += workers[i].stats.blocked_count;
+         total.fast_path_count += workers[i].stats.fast_path_count;
+         total.forwarded_count += workers[i].stats.forwarded_count;
+         total.error_count += workers[i].stats.error_count;
+         total.pending_count += workers[i].stats.pending_count;
+         total.cache_hits += workers[i].stats.cache_hits;
+         total.cache_misses += workers[i].stats.cache_misses;
+         total.prefetch_count += workers[i].stats.prefetch_count;
+         total.prefetch_dropped += workers[i].stats.prefetch_dropped;
+         total.recv_calls += workers[i].stats.recv_calls;
+         total.send_calls += workers[i].stats.send_calls;
+         total.sent_count += workers[i].stats.sent_count;
+         upstream_retries += workers[i].forwarder.retry_count;
+         upstream_timeouts += workers[i].forwarder.timeout_count;
+         upstream_tcp_fallbacks += workers[i].forwarder.tcp_fallback_count;
+         upstream_tcp_connects += workers[i].forwarder.tcp_connect_count;
+         upstream_hedges += workers[i].forwarder.hedge_count;
+         upstream_hedge_wins += workers[i].forwarder.hedge_win_count;
+         upstream_coalesced += workers[i].forwarder.coalesced_count;
+         upstream_stale += workers[i].forwarder.stale_count;
+         tcp_accepted += workers[i].tcp.accepted_count;
+         tcp_rejected += workers[i].tcp.rejected_count;
+         tcp_idle_closed += workers[i].tcp.idle_closed_count;
+         tcp_queries += workers[i].tcp.query_count;
+         
+         for (unsigned int u = 0; u < workers[i].forwarder.upstream_count; u++) {
+             const upstream_t *up = &workers[i].forwarder.upstreams[u];
+             upstream_totals[u].query_count += up->query_count;
+             upstream_totals[u].answer_count += up->answer_count;
+             upstream_totals[u].timeout_count += up->timeout_count;
+             upstream_totals[u].rtt_sum_us += up->rtt_sum_us;
+             upstream_totals[u].rtt_samples += up->rtt_samples;
+             upstream_srtt_sum[u] += up->rtt.srtt_us;
+         }
+     }
+     
+     for (unsigned int i = 0; i < num_workers; i++) {
+         worker_cleanup(&workers[i]);
+     }
+     free(workers);
+     
+     /* Až po join workerov - prebiehajúci reload sa dokončí */
+     filter_reloader_destroy(&reloader);
+     filter_reload_stats_t reload_stats = reloader.stats;
+     
+     /* Snapshot pri ukončení - v signal handleri nie je zápis do súboru
+      * bezpečný, preto až tu, keď workeri cache už nemenia */
+     size_t snapshot_saved = 0;
+     int snapshot_rc = -1;
+     if (snapshot) {
+         snapshot_rc = dns_cache_save(cache, config->cache_file, monotonic_ms(),
+                                      (uint64_t)time(NULL), &snapshot_saved);
+     }
+     
+     dns_cache_stats_t cache_stats;
+     dns_cache_get_stats(cache, &cache_stats);
+     dns_cache_destroy(cache);
+     
+     upstream_cache_stats_t refresh_stats;
+     upstream_cache_stats(&refresh_stats);
+     upstream_cache_clear();
      
      /* Finálne štatistiky */
      printf("\n==============================================\n");
      printf("DNS Server Statistics:\n");
      printf("==============================================\n");
-     printf("  Total queries:     %lu\n", query_count);
+     printf("  Worker threads:    %u\n", num_workers);
+     printf("  I/O batch size:    %u%s\n", config->batch_size,
+            config->batch_size > 1 ? " (recvmmsg/sendmmsg)" : " (recvfrom/sendto)");
+     printf("  Total queries:     %lu\n", total.query_count);
      printf("  Blocked (NXDOMAIN): %lu (%.1f%%)\n", 
-            blocked_count, 
-            query_count > 0 ? (100.0 * blocked_count / query_count) : 0.0);
+            total.blocked_count, 
+            total.query_count > 0 ? (100.0 * total.blocked_count / total.query_count) : 0.0);
+     printf("  Fast-path NXDOMAIN: %lu\n", total.fast_path_count);
      printf("  Forwarded:         %lu (%.1f%%)\n",
-            forwarded_count,
-            query_count > 0 ? (100.0 * forwarded_count / query_count) : 0.0);
-     printf("  Errors:            %lu\n", error_count);
+            total.forwarded_count,
+            total.query_count > 0 ? (100.0 * total.forwarded_count / total.query_count) : 0.0);
+     printf("  Cache hits:        %lu (%.1f%% of allowed)\n", total.cache_hits,
+            total.cache_hits + total.cache_misses > 0 ?
+            (100.0 * total.cache_hits / (total.cache_hits + total.cache_misses)) : 0.0);
+     printf("  Cache misses:      %lu\n", total.cache_misses);
+     printf("  Cache entries:     %zu (%zu bytes, %lu evicted, %lu expired)\n",
+            cache_stats.entries, cache_stats.bytes,
+            cache_stats.evictions, cache_stats.expirations);
+     printf("  Negative entries:  %zu (%zu bytes)\n",
+            cache_stats.negative_entries, cache_stats.negative_bytes);
+     printf("  Cache prefetches:  %lu (%lu over the limit of %d per worker)\n",
+            total.prefetch_count, total.prefetch_dropped, WORKER_MAX_PREFETCH);
+     printf("  Stale answers:     %lu (%lu after the %d ms upstream deadline)\n",
+            cache_stats.stale_hits, upstream_stale, FORWARDER_STALE_TIMEOUT_MS);
+     if (snapshot && snapshot_rc == 0) {
+         printf("  Cache snapshot:    %zu entries saved to %s\n",
+                snapshot_saved, config->cache_file);
+     } else if (snapshot) {
+         printf("  Cache snapshot:    write to %s failed\n", config->cache_file);
+     }
+     printf("  Upstream retries:  %lu\n", upstream_retries);
+     printf("  Upstream timeouts: %lu\n", upstream_timeouts);
+     printf("  Upstream over TCP: %lu truncated answers (%lu connections opened)\n",
+            upstream_tcp_fallbacks, upstream_tcp_connects);
+     printf("  Hedged requests:   %lu (%.1f%% of forwarded, %lu won by another upstream)\n",
+            upstream_hedges,
+            total.forwarded_count > 0 ? (100.0 * upstream_hedges / total.forwarded_count) : 0.0,
+            upstream_hedge_wins);
+     printf("  Coalesced queries: %lu (waited for an identical in-flight query)\n",
+            upstream_coalesced);
+     printf("  Upstream servers:\n");
+     for (unsigned int u = 0; u < config->upstream_count; u++) {
+         const upstream_t *up = &upstream_totals[u];
+         printf("    %-16s %lu queries, %lu answers, %lu timeouts, "
+                "avg %.1f ms (smoothed %.1f ms)\n",
+                config->upstream_servers[u], up->query_count, up->answer_count,
+                up->timeout_count,
+                up->rtt_samples > 0 ? (double)up->rtt_sum_us / up->rtt_samples / 1000.0 : 0.0,
+                started > 0 ? (double)upstream_srtt_sum[u] / started / 1000.0 : 0.0);
+     }
+     printf("  Upstream refreshes: %lu (%lu failed, %lu address changes)\n",
+            refresh_stats.refresh_count, refresh_stats.refresh_failures,
+            refresh_stats.address_changes);
+     printf("  Filter reloads:    %lu (%lu failed", reload_stats.reload_count,
+            reload_stats.reload_failures);
+     if (reload_stats.reload_count > 0) {
+         printf(", last: %zu domains in %.1f ms", reload_stats.last_domains,
+                reload_stats.last_reload_ms);
+     }
+     printf(")\n");
+     printf("  TCP connections:   %lu (%lu rejected over limit, %lu idle-closed)\n",
+            tcp_accepted, tcp_rejected, tcp_idle_closed);
+     printf("  TCP queries:       %lu\n", tcp_queries);
+     printf("  Unanswered at exit: %lu\n", total.pending_count);
+     printf("  Datagrams/recv:    %.2f\n",
+            total.recv_calls > 0 && total.query_count >= tcp_queries ?
+            (double)(total.query_count - tcp_queries) / total.recv_calls : 0.0);
+     printf("  Datagrams/send:    %.2f\n",
+            total.send_calls > 0 ? (double)total.sent_count / total.send_calls : 0.0);
+     printf("  Errors:            %lu\n", total.error_count);
      printf("==============================================\n");
      
-     return ERR_SUCCESS;
- }
\ No newline at end of file
+     return ret;
+ }
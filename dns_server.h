@@ -13,12 +13,25 @@
 /**
  * @brief Inicializuje UDP socket na zadanom porte
  * @param port Port number (default DNS_DEFAULT_PORT)
+ * @param reuse_port true = nastaví SO_REUSEPORT (jeden socket na workera)
  * @return Socket file descriptor alebo -1 pri chybe
  */
-int init_udp_server(uint16_t port);
+int init_udp_server(uint16_t port, bool reuse_port);
+
+/**
+ * @brief Inicializuje neblokujúci TCP listen socket na zadanom porte
+ * @param port Port number (rovnaký ako UDP)
+ * @param reuse_port true = nastaví SO_REUSEPORT (jeden listen socket na workera)
+ * @return Socket file descriptor alebo -1 pri chybe
+ */
+int init_tcp_server(uint16_t port, bool reuse_port);
 
 /**
  * @brief Hlavná slučka DNS servera
+ * 
+ * Spustí config->num_threads worker vlákien, každé s vlastným
+ * SO_REUSEPORT UDP aj TCP socketom. Štatistiky workerov sa zlúčia pri ukončení.
+ * 
  * @param config Server konfigurácia
  * @return ERR_SUCCESS alebo chybový kód
  */
@@ -13,10 +13,25 @@
  #include <string.h>
  #include <ctype.h>
  #include <stdbool.h>
+ #include <malloc.h>
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
  
  /* Inicializálna kapacita pre children array */
  #define INITIAL_CHILDREN_CAPACITY 4
  
+ /* Od tohto počtu detí sa pre uzol stavia hash index */
+ #define CHILD_INDEX_THRESHOLD 8
+ 
+ /* Formát prekompilovaného filtra (--compile-filter) */
+ #define FILTER_FILE_MAGIC       "DNSFLTR"
+ #define FILTER_FILE_VERSION     1
+ #define FILTER_FILE_BYTE_ORDER  0x01020304u
+ 
  /* Štatistiky pre verbose výstup */
  typedef struct {
      size_t total_domains;
@@ -26,6 +41,8 @@
  
  /* Forward deklarácie pre rekurzívne funkcie */
  static void count_stats_recursive(const filter_node_t *node, size_t depth, filter_stats_t *stats);
+ static bool compact_is_blocked(const filter_compact_t *compact, const char *normalized,
+                                size_t len);
  
  /**
   * @brief Inicializuje nový filter node
@@ -40,7 +57,12 @@
      node->children = NULL;
      node->children_count = 0;
      node->children_capacity = 0;
+     node->child_index = NULL;
+     node->index_mask = 0;
+     node->label_hash = 0;
+     node->label_len = 0;
      node->is_blocked = false;
+     node->compact = NULL;
      
      return node;
  }
@@ -65,6 +87,15 @@
      if (root->children != NULL) {
          free(root->children);
      }
+     free(root->child_index);
+     if (root->compact != NULL) {
+         if (root->compact->mapped) {
+             munmap(root->compact->mem, root->compact->mem_size);
+         } else {
+             free(root->compact->mem);
+         }
+         free(root->compact);
+     }
      free(root);
  }
  
@@ -140,122 +171,103 @@
  }
  
  /**
-  * @brief Rozdelí doménu na labels (v reverznom poradí)
+  * @brief Nájde posledný label domény pred pozíciou end
   * 
-  * Príklad: "ads.google.com" -> ["com", "google", "ads"]
+  * Doména sa prechádza sprava doľava priamo v normalizovanom bufferi,
+  * takže pri vyhľadávaní nie je potrebné labely kopírovať ani alokovať.
+  * Príklad: "ads.google.com" -> "com", "google", "ads"
   * 
-  * @param domain Normalizovaná doména
-  * @param labels Výstupné pole (alokuje sa)
-  * @param count Počet labels (výstup)
-  * @return 0 pri úspechu, -1 pri chybe
+  * @param domain Začiatok normalizovanej domény
+  * @param end Koniec aktuálneho labelu (za posledným znakom)
+  * @param label_len Dĺžka nájdeného labelu (výstup)
+  * @return Začiatok labelu
   */
- static int split_domain_labels(const char *domain, char ***labels, size_t *count) {
-     if (domain == NULL || labels == NULL || count == NULL) {
-         return -1;
+ static const char *prev_label(const char *domain, const char *end, size_t *label_len) {
+     const char *start = end;
+     while (start > domain && *(start - 1) != '.') {
+         start--;
      }
      
-     /* Spočítame počet labels (počet bodiek + 1) */
-     size_t label_count = 1;
-     for (const char *p = domain; *p; p++) {
-         if (*p == '.') {
-             label_count++;
-         }
-     }
-     
-     /* Alokácia poľa pre labels */
-     char **label_array = (char **)malloc(label_count * sizeof(char *));
-     if (label_array == NULL) {
-         return -1;
+     *label_len = (size_t)(end - start);
+     return start;
+ }
+ 
+ /**
+  * @brief FNV-1a hash labelu (pre hash index detí)
+  */
+ static uint32_t hash_label(const char *label, size_t label_len) {
+     uint32_t hash = 2166136261u;
+     for (size_t i = 0; i < label_len; i++) {
+         hash ^= (uint8_t)label[i];
+         hash *= 16777619u;
      }
-     
-     /* Inicializácia na NULL pre bezpečné uvoľnenie pri chybe */
-     for (size_t i = 0; i < label_count; i++) {
-         label_array[i] = NULL;
+     return hash;
+ }
+ 
+ /**
+  * @brief Nájde child node s daným labelom
+  * 
+  * Label nemusí byť ukončený nulou (ukazuje do normalizovanej domény).
+  * Široké uzly sa prehľadávajú cez hash index (O(1)), úzke lineárne -
+  * pri pár deťoch je porovnanie dĺžky + memcmp rýchlejšie ako hash.
+  * 
+  * @return Pointer na child alebo NULL ak neexistuje
+  */
+ static filter_node_t *find_child(const filter_node_t *node, const char *label, size_t label_len) {
+     if (node == NULL || label == NULL) {
+         return NULL;
      }
      
-     /* Rozdelenie domény na labels (v reverznom poradí) */
-     const char *end = domain + strlen(domain);
-     size_t idx = 0;
-     
-     while (end > domain) {
-         /* Nájdeme predchádzajúcu bodku alebo začiatok */
-         const char *start = end - 1;
-         while (start > domain && *(start - 1) != '.') {
-             start--;
-         }
-         if (start > domain && *(start - 1) == '.') {
-             /* Nič, start je na správnej pozícii */
-         } else if (start == domain) {
-             /* Začiatok domény */
-         }
+     if (node->child_index != NULL) {
+         uint32_t hash = hash_label(label, label_len);
          
-         /* Dĺžka labelu */
-         size_t label_len = (size_t)(end - start);
-         
-         /* Edge case: prázdny label (napr. "..") */
-         if (label_len == 0) {
-             /* Uvoľnenie už alokovaných labels */
-             for (size_t i = 0; i < idx; i++) {
-                 free(label_array[i]);
+         /* Linear probing - index je zaplnený najviac na polovicu */
+         for (size_t i = hash & node->index_mask; ; i = (i + 1) & node->index_mask) {
+             filter_node_t *child = node->child_index[i];
+             if (child == NULL) {
+                 return NULL;
              }
-             free(label_array);
-             return -1;
-         }
-         
-         /* Edge case: label dlhší ako 63 znakov (RFC 1035) */
-         if (label_len > DNS_MAX_LABEL_LEN) {
-             for (size_t i = 0; i < idx; i++) {
-                 free(label_array[i]);
+             if (child->label_hash == hash && child->label_len == label_len &&
+                 memcmp(child->label, label, label_len) == 0) {
+                 return child;
              }
-             free(label_array);
-             return -1;
          }
-         
-         /* Alokácia a kopírovanie labelu */
-         label_array[idx] = (char *)malloc(label_len + 1);
-         if (label_array[idx] == NULL) {
-             for (size_t i = 0; i < idx; i++) {
-                 free(label_array[i]);
-             }
-             free(label_array);
-             return -1;
-         }
-         
-         memcpy(label_array[idx], start, label_len);
-         label_array[idx][label_len] = '\0';
-         idx++;
-         
-         /* Posun na ďalší label */
-         if (start > domain) {
-             end = start - 1;  /* Preskočiť bodku */
-         } else {
-             break;
+     }
+     
+     for (size_t i = 0; i < node->children_count; i++) {
+         filter_node_t *child = node->children[i];
+         if (child->label_len == label_len && 
+             memcmp(child->label, label, label_len) == 0) {
+             return child;
          }
      }
      
-     *labels = label_array;
-     *count = label_count;
-     return 0;
+     return NULL;
  }
  
  /**
-  * @brief Nájde child node s daným labelom
+  * @brief Postaví hash index detí danej veľkosti
   * 
-  * @return Pointer na child alebo NULL ak neexistuje
+  * Pri nedostatku pamäte sa index zruší a uzol sa ďalej prehľadáva
+  * lineárne (pomalšie, ale stále správne).
   */
- static filter_node_t *find_child(const filter_node_t *node, const char *label) {
-     if (node == NULL || label == NULL) {
-         return NULL;
+ static void rebuild_child_index(filter_node_t *node, size_t size) {
+     free(node->child_index);
+     node->child_index = (filter_node_t **)calloc(size, sizeof(filter_node_t *));
+     if (node->child_index == NULL) {
+         node->index_mask = 0;
+         return;
      }
      
+     node->index_mask = size - 1;
      for (size_t i = 0; i < node->children_count; i++) {
-         if (node->children[i]->label != NULL && 
-             strcmp(node->children[i]->label, label) == 0) {
-             return node->children[i];
+         filter_node_t *child = node->children[i];
+         size_t slot = child->label_hash & node->index_mask;
+         while (node->child_index[slot] != NULL) {
+             slot = (slot + 1) & node->index_mask;
          }
+         node->child_index[slot] = child;
      }
-     
-     return NULL;
  }
  
  /**
@@ -289,6 +301,28 @@
      
      /* Pridanie child */
      parent->children[parent->children_count++] = child;
+     
+     /* Hash index: vytvorenie po prekročení prahu, zdvojnásobenie pri
+      * zaplnení nad 50 % (inak iba vloženie do voľného slotu) */
+     if (parent->child_index != NULL) {
+         size_t size = parent->index_mask + 1;
+         if (parent->children_count * 2 > size) {
+             rebuild_child_index(parent, size * 2);
+         } else {
+             size_t slot = child->label_hash & parent->index_mask;
+             while (parent->child_index[slot] != NULL) {
+                 slot = (slot + 1) & parent->index_mask;
+             }
+             parent->child_index[slot] = child;
+         }
+     } else if (parent->children_count >= CHILD_INDEX_THRESHOLD) {
+         size_t size = CHILD_INDEX_THRESHOLD;
+         while (size < parent->children_count * 2) {
+             size *= 2;
+         }
+         rebuild_child_index(parent, size);
+     }
+     
      return 0;
  }
  
@@ -303,9 +337,10 @@
   * - Prázdna doména
   * - Duplicitné domény (nie je chyba, iba nastaví is_blocked)
   * - Neplatné doménové meno
+  * - Zbalená Trie (iba na čítanie)
   */
  int filter_add_domain(filter_node_t *root, const char *domain) {
-     if (root == NULL || domain == NULL) {
+     if (root == NULL || domain == NULL || root->compact != NULL) {
          return -1;
      }
      
@@ -315,67 +350,101 @@
          return -1;
      }
      
-     /* Rozdelenie na labels */
-     char **labels = NULL;
-     size_t label_count = 0;
-     if (split_domain_labels(normalized, &labels, &label_count) != 0) {
-         return -1;
+     /* Edge case: label dlhší ako 63 znakov (RFC 1035) - kontrola pred
+      * vytvorením uzlov, aby neplatná doména nezanechala v Trie nič */
+     const char *end = normalized + strlen(normalized);
+     const char *pos = end;
+     while (pos > normalized) {
+         size_t label_len;
+         const char *start = prev_label(normalized, pos, &label_len);
+         if (label_len == 0 || label_len > DNS_MAX_LABEL_LEN) {
+             return -1;
+         }
+         pos = start > normalized ? start - 1 : normalized;
      }
      
-     /* Prechádzanie/vytváranie Trie */
+     /* Prechádzanie/vytváranie Trie (labely sprava doľava) */
      filter_node_t *current = root;
      
-     for (size_t i = 0; i < label_count; i++) {
+     while (end > normalized) {
+         size_t label_len;
+         const char *start = prev_label(normalized, end, &label_len);
+         
          /* Hľadáme existujúci child */
-         filter_node_t *child = find_child(current, labels[i]);
+         filter_node_t *child = find_child(current, start, label_len);
          
          if (child == NULL) {
              /* Child neexistuje, vytvoríme nový */
              child = filter_node_create();
              if (child == NULL) {
-                 /* Cleanup */
-                 for (size_t j = 0; j < label_count; j++) {
-                     free(labels[j]);
-                 }
-                 free(labels);
                  return -1;
              }
              
              /* Skopírujeme label */
-             child->label = strdup(labels[i]);
+             child->label = strndup(start, label_len);
              if (child->label == NULL) {
                  filter_node_free(child);
-                 for (size_t j = 0; j < label_count; j++) {
-                     free(labels[j]);
-                 }
-                 free(labels);
                  return -1;
              }
+             child->label_len = (uint8_t)label_len;
+             child->label_hash = hash_label(start, label_len);
              
              /* Pridáme child do parent */
              if (add_child(current, child) != 0) {
                  filter_node_free(child);
-                 for (size_t j = 0; j < label_count; j++) {
-                     free(labels[j]);
-                 }
-                 free(labels);
                  return -1;
              }
          }
          
          current = child;
+         end = start > normalized ? start - 1 : normalized;
      }
      
      /* Označíme koncový node ako blokovaný */
      current->is_blocked = true;
      
-     /* Cleanup labels */
-     for (size_t i = 0; i < label_count; i++) {
-         free(labels[i]);
+     return 0;
+ }
+ 
+ /**
+  * @brief Prechádza Trie pre normalizované meno (labely sprava doľava)
+  */
+ static bool lookup_normalized(const filter_node_t *root, const char *normalized,
+                               size_t len) {
+     if (root->compact != NULL) {
+         return compact_is_blocked(root->compact, normalized, len);
      }
-     free(labels);
      
-     return 0;
+     const filter_node_t *current = root;
+     const char *end = normalized + len;
+     
+     while (end > normalized) {
+         size_t label_len;
+         const char *start = prev_label(normalized, end, &label_len);
+         
+         /* Edge case: label dlhší ako 63 znakov (RFC 1035) */
+         if (label_len > DNS_MAX_LABEL_LEN) {
+             return false;
+         }
+         
+         /* Hľadáme child */
+         const filter_node_t *child = find_child(current, start, label_len);
+         
+         if (child == NULL) {
+             /* Label neexistuje v Trie -> doména nie je blokovaná */
+             return false;
+         }
+         
+         /* Ak je tento node blokovaný, celá doména je blokovaná */
+         if (child->is_blocked) {
+             return true;
+         }
+         
+         current = child;
+         end = start > normalized ? start - 1 : normalized;
+     }
+     
+     return false;
  }
  
  /**
@@ -384,6 +453,9 @@
   * Kontroluje aj všetky subdomény:
   * Ak je blokovaná "google.com", tak aj "ads.google.com" je blokovaná.
   * 
+  * Vyhľadávanie nealokuje žiadnu pamäť - doména sa normalizuje do
+  * bufferu na zásobníku a labely sa porovnávajú priamo v ňom.
+  * 
   * Edge cases:
   * - NULL root/domain
   * - Prázdna doména
@@ -400,44 +472,57 @@
          return false;
      }
      
-     /* Rozdelenie na labels */
-     char **labels = NULL;
-     size_t label_count = 0;
-     if (split_domain_labels(normalized, &labels, &label_count) != 0) {
+     return lookup_normalized(root, normalized, strlen(normalized));
+ }
+ 
+ /**
+  * @brief Skontroluje meno vo wire formáte (bez kompresie)
+  * 
+  * Labely sa rovno pri kopírovaní prevedú na lowercase a spoja bodkou
+  * do zásobníkového bufferu, takže odpadá parse_dns_name() aj
+  * normalize_domain(). Bodka vnútri labelu sa (rovnako ako po
+  * parse_dns_name()) správa ako oddeľovač labelov.
+  * 
+  * Edge cases:
+  * - Koreňové meno (iba nulový bajt)
+  * - Compression pointer alebo label > 63 znakov
+  * - Meno neukončené v rámci len
+  */
+ bool is_wire_name_blocked(const filter_node_t *root, const uint8_t *name, size_t len) {
+     if (root == NULL || name == NULL) {
          return false;
      }
      
-     /* Prechádzanie Trie */
-     const filter_node_t *current = root;
-     bool is_blocked = false;
+     char normalized[DNS_MAX_NAME_LEN + 1];
+     size_t out = 0;
+     size_t pos = 0;
      
-     for (size_t i = 0; i < label_count; i++) {
-         /* Hľadáme child */
-         const filter_node_t *child = find_child(current, labels[i]);
+     while (pos < len && name[pos] != 0) {
+         size_t label_len = name[pos++];
          
-         if (child == NULL) {
-             /* Label neexistuje v Trie -> doména nie je blokovaná */
-             break;
+         if (label_len > DNS_MAX_LABEL_LEN || pos + label_len > len ||
+             out + label_len + 1 > sizeof(normalized)) {
+             return false;
          }
          
-         /* Ak je tento node blokovaný, celá doména je blokovaná */
-         if (child->is_blocked) {
-             is_blocked = true;
-             break;
+         if (out > 0) {
+             normalized[out++] = '.';
          }
-         
-         current = child;
+         for (size_t i = 0; i < label_len; i++) {
+             normalized[out++] = (char)tolower(name[pos + i]);
+         }
+         pos += label_len;
      }
      
-     /* Cleanup */
-     for (size_t i = 0; i < label_count; i++) {
-         free(labels[i]);
+     /* Neukončené meno alebo koreň */
+     if (pos >= len || out == 0) {
+         return false;
      }
-     free(labels);
      
-     return is_blocked;
+     normalized[out] = '\0';
+     return lookup_normalized(root, normalized, out);
  }
- 
+
  /**
   * @brief Načíta filter súbor a vytvorí Trie štruktúru
   * 
@@ -576,6 +661,19 @@
          return;
      }
      
+     if (root->compact != NULL) {
+         const filter_compact_t *compact = root->compact;
+         printf("[VERBOSE] Filter statistics (compact):\n");
+         printf("[VERBOSE]   Total blocked domains: %u\n", compact->domain_count);
+         printf("[VERBOSE]   Total Trie nodes: %u\n", compact->node_count);
+         printf("[VERBOSE]   Label pool: %u bytes\n", compact->pool_size);
+         printf("[VERBOSE]   Memory: %zu bytes (%.1f bytes/domain)\n",
+                filter_memory_usage(root),
+                (double)filter_memory_usage(root) /
+                (compact->domain_count > 0 ? compact->domain_count : 1));
+         return;
+     }
+     
      filter_stats_t stats = {0, 0, 0};
      
      /* Počítanie štatistík zo všetkých children root node */
@@ -594,6 +692,561 @@
          printf("[VERBOSE]   Average branching factor: %.2f\n", avg_branching);
      }
  }
+/* ============================================================================
+ * KOMPAKTNÁ REPREZENTÁCIA
+ * ============================================================================ */
+
+/**
+ * @brief Veľkosť hash indexu pre uzol s daným počtom detí
+ *
+ * Veľkosť sa odvodzuje iba z počtu detí, takže sa nemusí ukladať do uzla.
+ */
+static uint32_t compact_index_size(uint32_t child_count) {
+    uint32_t size = CHILD_INDEX_THRESHOLD;
+    while (size < child_count * 2) {
+        size *= 2;
+    }
+    return size;
+}
+
+/**
+ * @brief Porovná label uzla kompaktnej Trie
+ * @return true ak sa labely zhodujú (label mimo string poolu sa nezhoduje)
+ */
+static bool compact_label_equals(const filter_compact_t *compact, const filter_cnode_t *node,
+                                 const char *label, size_t label_len) {
+    return node->label_len == label_len &&
+           (uint64_t)node->label_off + label_len <= compact->pool_size &&
+           memcmp(compact->pool + node->label_off, label, label_len) == 0;
+}
+
+/**
+ * @brief Nájde dieťa kompaktného uzla s daným labelom
+ * @return Index dieťaťa alebo 0 ak neexistuje (koreň nie je dieťa)
+ *
+ * Namapovaný súbor sa pri štarte overuje iba podľa hlavičky a veľkosti,
+ * takže indexy a offsety uzla sa kontrolujú tu (O(1) na krok) - poškodený
+ * súbor vráti "neblokované" namiesto čítania mimo mapovania.
+ */
+static uint32_t compact_find_child(const filter_compact_t *compact,
+                                   const filter_cnode_t *node,
+                                   const char *label, size_t label_len) {
+    if (node->child_count == 0 || node->first_child == 0 ||
+        (uint64_t)node->first_child + node->child_count > compact->node_count) {
+        return 0;
+    }
+
+    if (node->child_count >= CHILD_INDEX_THRESHOLD) {
+        uint32_t hash = hash_label(label, label_len);
+        uint32_t size = compact_index_size(node->child_count);
+        if ((uint64_t)node->index_off + size > compact->index_count) {
+            return 0;
+        }
+
+        uint32_t mask = size - 1;
+        const uint32_t *slots = compact->index + node->index_off;
+
+        /* Najviac size pokusov - plný index nesmie zacykliť lookup */
+        for (uint32_t n = 0, i = hash & mask; n < size; n++, i = (i + 1) & mask) {
+            uint32_t idx = slots[i];
+            if (idx == 0) {
+                return 0;
+            }
+            if (idx >= compact->node_count) {
+                continue;
+            }
+            const filter_cnode_t *child = &compact->nodes[idx];
+            if (child->label_hash == hash &&
+                compact_label_equals(compact, child, label, label_len)) {
+                return idx;
+            }
+        }
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        uint32_t idx = node->first_child + i;
+        if (compact_label_equals(compact, &compact->nodes[idx], label, label_len)) {
+            return idx;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Vyhľadanie v kompaktnej Trie (labely sprava doľava)
+ */
+static bool compact_is_blocked(const filter_compact_t *compact, const char *normalized,
+                               size_t len) {
+    const filter_cnode_t *current = &compact->nodes[0];
+    const char *end = normalized + len;
+
+    while (end > normalized) {
+        size_t label_len;
+        const char *start = prev_label(normalized, end, &label_len);
+
+        if (label_len > DNS_MAX_LABEL_LEN) {
+            return false;
+        }
+
+        uint32_t idx = compact_find_child(compact, current, start, label_len);
+        if (idx == 0) {
+            return false;
+        }
+
+        current = &compact->nodes[idx];
+        if (current->is_blocked) {
+            return true;
+        }
+
+        end = start > normalized ? start - 1 : normalized;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Spočíta uzly, sloty hash indexov a bajty labelov pointer Trie
+ */
+static void compact_count_recursive(const filter_node_t *node, size_t *nodes,
+                                    size_t *slots, size_t *label_bytes) {
+    (*nodes)++;
+    *label_bytes += node->label_len;
+    if (node->children_count >= CHILD_INDEX_THRESHOLD) {
+        *slots += compact_index_size((uint32_t)node->children_count);
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        compact_count_recursive(node->children[i], nodes, slots, label_bytes);
+    }
+}
+
+/**
+ * @brief Vloží label uzla do string poolu (rovnaký label iba raz)
+ * @return Offset labelu v poole
+ */
+static uint32_t compact_intern_label(filter_cnode_t *nodes, char *pool, size_t *pool_used,
+                                     uint32_t *intern, size_t intern_mask,
+                                     uint32_t idx, const char *label) {
+    const filter_cnode_t *node = &nodes[idx];
+    size_t slot = node->label_hash & intern_mask;
+
+    while (intern[slot] != 0) {
+        const filter_cnode_t *other = &nodes[intern[slot]];
+        if (other->label_hash == node->label_hash && other->label_len == node->label_len &&
+            memcmp(pool + other->label_off, label, node->label_len) == 0) {
+            return other->label_off;
+        }
+        slot = (slot + 1) & intern_mask;
+    }
+
+    intern[slot] = idx;
+    uint32_t offset = (uint32_t)*pool_used;
+    memcpy(pool + offset, label, node->label_len);
+    *pool_used += node->label_len;
+    return offset;
+}
+
+/**
+ * @brief Zbalí Trie do kompaktnej formy
+ *
+ * Postup:
+ * 1. Spočítanie uzlov a veľkostí (blok sa alokuje naraz)
+ * 2. BFS - deti každého uzla dostanú súvislý rozsah indexov
+ * 3. Interning labelov do string poolu, hash indexy pre široké uzly
+ * 4. Zmenšenie bloku na skutočnú veľkosť poolu, uvoľnenie pôvodných uzlov
+ *
+ * Edge cases:
+ * - Už zbalená Trie
+ * - Viac ako 2^32 uzlov / bajtov
+ * - Nedostatok pamäte (pôvodná Trie ostáva nezmenená)
+ */
+int filter_compact(filter_node_t *root) {
+    if (root == NULL || root->compact != NULL) {
+        return -1;
+    }
+
+    size_t node_count = 0, index_count = 0, label_bytes = 0;
+    compact_count_recursive(root, &node_count, &index_count, &label_bytes);
+    if (node_count > UINT32_MAX || index_count > UINT32_MAX || label_bytes > UINT32_MAX) {
+        return -1;
+    }
+
+    size_t nodes_size = node_count * sizeof(filter_cnode_t);
+    size_t index_size = index_count * sizeof(uint32_t);
+
+    size_t intern_size = 1;
+    while (intern_size < node_count * 2) {
+        intern_size *= 2;
+    }
+
+    filter_compact_t *compact = (filter_compact_t *)malloc(sizeof(filter_compact_t));
+    uint8_t *mem = (uint8_t *)malloc(nodes_size + index_size + label_bytes);
+    const filter_node_t **order = (const filter_node_t **)malloc(node_count * sizeof(filter_node_t *));
+    uint32_t *intern = (uint32_t *)calloc(intern_size, sizeof(uint32_t));
+    if (compact == NULL || mem == NULL || order == NULL || intern == NULL) {
+        free(compact);
+        free(mem);
+        free(order);
+        free(intern);
+        return -1;
+    }
+
+    filter_cnode_t *nodes = (filter_cnode_t *)mem;
+    uint32_t *index = (uint32_t *)(mem + nodes_size);
+    char *pool = (char *)(mem + nodes_size + index_size);
+    memset(index, 0, index_size);
+
+    size_t tail = 1, index_used = 0, pool_used = 0, domains = 0;
+    order[0] = root;
+
+    for (size_t head = 0; head < node_count; head++) {
+        const filter_node_t *src = order[head];
+        filter_cnode_t *dst = &nodes[head];
+
+        dst->label_hash = src->label_hash;
+        dst->label_len = src->label_len;
+        dst->is_blocked = src->is_blocked ? 1 : 0;
+        dst->label_off = head == 0 ? 0 :
+            compact_intern_label(nodes, pool, &pool_used, intern, intern_size - 1,
+                                 (uint32_t)head, src->label);
+        dst->first_child = (uint32_t)tail;
+        dst->child_count = (uint32_t)src->children_count;
+        dst->index_off = 0;
+
+        for (size_t i = 0; i < src->children_count; i++) {
+            order[tail++] = src->children[i];
+        }
+
+        if (src->is_blocked) {
+            domains++;
+        }
+
+        /* Hash index pre široký uzol - hodnoty sú indexy detí */
+        if (dst->child_count >= CHILD_INDEX_THRESHOLD) {
+            uint32_t size = compact_index_size(dst->child_count);
+            uint32_t *slots = index + index_used;
+            dst->index_off = (uint32_t)index_used;
+
+            for (uint32_t i = 0; i < dst->child_count; i++) {
+                uint32_t slot = src->children[i]->label_hash & (size - 1);
+                while (slots[slot] != 0) {
+                    slot = (slot + 1) & (size - 1);
+                }
+                slots[slot] = dst->first_child + i;
+            }
+            index_used += size;
+        }
+    }
+
+    free(order);
+    free(intern);
+
+    /* Pool je na konci bloku - zmenšenie o duplicitné labely */
+    size_t mem_size = nodes_size + index_size + pool_used;
+    uint8_t *shrunk = (uint8_t *)realloc(mem, mem_size);
+    if (shrunk != NULL) {
+        mem = shrunk;
+    }
+
+    compact->nodes = (const filter_cnode_t *)mem;
+    compact->index = (const uint32_t *)(mem + nodes_size);
+    compact->pool = (const char *)(mem + nodes_size + index_size);
+    compact->node_count = (uint32_t)node_count;
+    compact->index_count = (uint32_t)index_count;
+    compact->pool_size = (uint32_t)pool_used;
+    compact->domain_count = (uint32_t)domains;
+    compact->mem = mem;
+    compact->mem_size = mem_size;
+    compact->mapped = false;
+
+    /* Pôvodné uzly už nie sú potrebné, root ostáva ako handle */
+    for (size_t i = 0; i < root->children_count; i++) {
+        filter_node_free(root->children[i]);
+    }
+    free(root->children);
+    free(root->child_index);
+    root->children = NULL;
+    root->children_count = 0;
+    root->children_capacity = 0;
+    root->child_index = NULL;
+    root->index_mask = 0;
+    root->compact = compact;
+
+    return 0;
+}
+
+/**
+ * @brief Rekurzívny súčet alokácií pointer Trie
+ */
+static size_t memory_usage_recursive(const filter_node_t *node) {
+    size_t bytes = malloc_usable_size((void *)node);
+    if (node->label != NULL) {
+        bytes += malloc_usable_size(node->label);
+    }
+    if (node->children != NULL) {
+        bytes += malloc_usable_size(node->children);
+    }
+    if (node->child_index != NULL) {
+        bytes += malloc_usable_size(node->child_index);
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        bytes += memory_usage_recursive(node->children[i]);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Vráti pamäť obsadenú Trie (bajty)
+ */
+size_t filter_memory_usage(const filter_node_t *root) {
+    if (root == NULL) {
+        return 0;
+    }
+
+    if (root->compact != NULL) {
+        return sizeof(filter_node_t) + sizeof(filter_compact_t) + root->compact->mem_size;
+    }
+
+    return memory_usage_recursive(root);
+}
+
+/**
+ * @brief Vráti počet blokovaných domén v Trie
+ */
+size_t filter_domain_count(const filter_node_t *root) {
+    if (root == NULL) {
+        return 0;
+    }
+
+    if (root->compact != NULL) {
+        return root->compact->domain_count;
+    }
+
+    filter_stats_t stats = {0, 0, 0};
+    for (size_t i = 0; i < root->children_count; i++) {
+        count_stats_recursive(root->children[i], 1, &stats);
+    }
+    return stats.total_domains;
+}
+
+/* ============================================================================
+ * PREKOMPILOVANÝ FILTER (--compile-filter / -F)
+ * ============================================================================ */
+
+/**
+ * @brief Hlavička prekompilovaného súboru
+ *
+ * Za hlavičkou nasleduje priamo blok kompaktnej Trie (nodes | index |
+ * pool) v natívnom poradí bajtov. Veľkosť hlavičky je násobok 4, takže
+ * uzly v namapovanom súbore sú zarovnané.
+ */
+typedef struct {
+    char magic[8];              /* FILTER_FILE_MAGIC */
+    uint32_t version;           /* FILTER_FILE_VERSION */
+    uint32_t byte_order;        /* FILTER_FILE_BYTE_ORDER v natívnom poradí */
+    uint32_t node_size;         /* sizeof(filter_cnode_t) */
+    uint32_t node_count;        /* Počet uzlov */
+    uint32_t index_count;       /* Počet slotov hash indexov */
+    uint32_t pool_size;         /* Veľkosť string poolu */
+    uint32_t domain_count;      /* Počet blokovaných domén */
+    uint32_t reserved;          /* Zarovnanie (0) */
+} filter_file_header_t;
+
+/**
+ * @brief Zapíše celý buffer (opakuje write() pri čiastočnom zápise)
+ */
+static int write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Uloží kompaktnú Trie do súboru
+ *
+ * Zapisuje sa do dočasného súboru "<path>.tmp", ktorý sa po fsync()
+ * premenuje - bežiaci server s namapovanou starou verziou tak nikdy
+ * neuvidí napoly zapísaný súbor.
+ *
+ * Edge cases:
+ * - Trie nie je zbalená
+ * - Chyba zápisu (dočasný súbor sa zmaže)
+ */
+int filter_save_compiled(const filter_node_t *root, const char *path) {
+    if (root == NULL || root->compact == NULL || path == NULL) {
+        return -1;
+    }
+
+    const filter_compact_t *compact = root->compact;
+
+    filter_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILTER_FILE_MAGIC, sizeof(header.magic));
+    header.version = FILTER_FILE_VERSION;
+    header.byte_order = FILTER_FILE_BYTE_ORDER;
+    header.node_size = (uint32_t)sizeof(filter_cnode_t);
+    header.node_count = compact->node_count;
+    header.index_count = compact->index_count;
+    header.pool_size = compact->pool_size;
+    header.domain_count = compact->domain_count;
+
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        print_error("Compiled filter path too long: %s", path);
+        return -1;
+    }
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        print_error("Cannot create %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    if (write_all(fd, &header, sizeof(header)) != 0 ||
+        write_all(fd, compact->nodes, compact->node_count * sizeof(filter_cnode_t)) != 0 ||
+        write_all(fd, compact->index, compact->index_count * sizeof(uint32_t)) != 0 ||
+        write_all(fd, compact->pool, compact->pool_size) != 0 ||
+        fsync(fd) != 0) {
+        print_error("Cannot write %s: %s", tmp_path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    close(fd);
+
+    if (rename(tmp_path, path) != 0) {
+        print_error("Cannot rename %s to %s: %s", tmp_path, path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Namapuje prekompilovaný filter (read-only)
+ *
+ * Kontroluje sa iba hlavička a veľkosť súboru (O(1)), obsah sa nečíta -
+ * stránky sa načítajú až pri lookupoch a sú zdieľané medzi procesmi.
+ * Súbor je dôveryhodný výstup --compile-filter.
+ *
+ * Edge cases:
+ * - Neexistujúci súbor
+ * - Zlý magic / verzia / poradie bajtov / veľkosť uzla
+ * - Veľkosť súboru nezodpovedá hlavičke
+ */
+filter_node_t *filter_map_compiled(const char *path) {
+    if (path == NULL) {
+        print_error("Compiled filter path is NULL");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        print_error("Cannot open compiled filter: %s", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(filter_file_header_t)) {
+        print_error("Compiled filter too short: %s", path);
+        close(fd);
+        return NULL;
+    }
+
+    size_t file_size = (size_t)st.st_size;
+    void *map = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        print_error("Cannot mmap compiled filter %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    const filter_file_header_t *header = (const filter_file_header_t *)map;
+    uint64_t expected = (uint64_t)sizeof(*header) +
+                        (uint64_t)header->node_count * sizeof(filter_cnode_t) +
+                        (uint64_t)header->index_count * sizeof(uint32_t) +
+                        header->pool_size;
+
+    if (memcmp(header->magic, FILTER_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != FILTER_FILE_VERSION ||
+        header->byte_order != FILTER_FILE_BYTE_ORDER ||
+        header->node_size != sizeof(filter_cnode_t) ||
+        header->node_count == 0 || expected != file_size) {
+        print_error("Invalid compiled filter: %s", path);
+        munmap(map, file_size);
+        return NULL;
+    }
+
+    filter_node_t *root = filter_node_create();
+    filter_compact_t *compact = (filter_compact_t *)malloc(sizeof(filter_compact_t));
+    if (root == NULL || compact == NULL) {
+        print_error("Failed to create filter root node");
+        free(root);
+        free(compact);
+        munmap(map, file_size);
+        return NULL;
+    }
+
+    const uint8_t *data = (const uint8_t *)map + sizeof(*header);
+    compact->nodes = (const filter_cnode_t *)data;
+    compact->index = (const uint32_t *)(data + header->node_count * sizeof(filter_cnode_t));
+    compact->pool = (const char *)(compact->index + header->index_count);
+    compact->node_count = header->node_count;
+    compact->index_count = header->index_count;
+    compact->pool_size = header->pool_size;
+    compact->domain_count = header->domain_count;
+    compact->mem = map;
+    compact->mem_size = file_size;
+    compact->mapped = true;
+
+    root->compact = compact;
+    return root;
+}
+
+/**
+ * @brief Načíta filter pre server (textový + zbalenie, alebo mmap)
+ *
+ * Ak zbalenie zlyhá (nedostatok pamäte), vráti sa pointer Trie - je
+ * pomalšia a väčšia, ale funkčne rovnaká.
+ */
+filter_node_t *filter_load(const char *path, bool compiled, bool verbose) {
+    if (compiled) {
+        return filter_map_compiled(path);
+    }
+
+    filter_node_t *root = load_filter_file(path, verbose);
+    if (root == NULL) {
+        return NULL;
+    }
+
+    size_t tree_bytes = filter_memory_usage(root);
+    if (filter_compact(root) == 0) {
+        if (verbose) {
+            printf("[VERBOSE] Filter compacted: %zu -> %zu bytes\n",
+                   tree_bytes, filter_memory_usage(root));
+        }
+    } else if (verbose) {
+        printf("[VERBOSE] Filter compaction failed - using pointer Trie\n");
+    }
+
+    return root;
+}
+
 /* ============================================================================
  * WRAPPER API PRE TESTY
  * ============================================================================ */
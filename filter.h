@@ -71,6 +71,18 @@ int filter_add_domain(filter_node_t *root, const char *domain);
  */
 bool is_domain_blocked(const filter_node_t *root, const char *domain);
 
+/**
+ * @brief Kontroluje meno priamo vo wire formáte (napr. QNAME v prijatom pakete)
+ * @param root Koreň Trie
+ * @param name Začiatok mena (sekvencia labelov ukončená nulovým bajtom)
+ * @param len Počet bajtov dostupných od name
+ * @return true ak je blokované, false inak (aj pri neplatnom alebo
+ *         komprimovanom mene)
+ *
+ * Nealokuje pamäť, rovnaká sémantika ako is_domain_blocked().
+ */
+bool is_wire_name_blocked(const filter_node_t *root, const uint8_t *name, size_t len);
+
 /**
  * @brief Normalizuje doménové meno
  * @param domain Pôvodné meno
@@ -92,6 +104,102 @@ int normalize_domain(const char *domain, char *normalized, size_t len);
  */
 void filter_print_stats(const filter_node_t *root, bool verbose);
 
+/* ============================================================================
+ * KOMPAKTNÁ REPREZENTÁCIA
+ * ============================================================================ */
+
+/**
+ * @brief Uzol kompaktnej Trie (adresovaný 32-bit indexom)
+ *
+ * Deti uzla ležia v poli uzlov za sebou (first_child .. first_child +
+ * child_count - 1), labely sú v spoločnom string poole (bez '\0').
+ */
+typedef struct {
+    uint32_t label_off;         /* Offset labelu v string poole */
+    uint32_t label_hash;        /* FNV-1a hash labelu */
+    uint32_t first_child;       /* Index prvého dieťaťa */
+    uint32_t child_count;       /* Počet detí */
+    uint32_t index_off;         /* Začiatok hash indexu detí (ak je uzol široký) */
+    uint8_t label_len;          /* Dĺžka labelu */
+    uint8_t is_blocked;         /* 1 = doména je blokovaná */
+} filter_cnode_t;
+
+/**
+ * @brief Kompaktná Trie - uzly, hash indexy a string pool v jednom bloku
+ *
+ * Blok neobsahuje žiadne pointre (iba indexy a offsety), takže ho možno
+ * uložiť do súboru alebo namapovať bez úprav.
+ */
+typedef struct filter_compact {
+    const filter_cnode_t *nodes; /* Pole uzlov, nodes[0] = koreň */
+    const uint32_t *index;      /* Sloty hash indexov (0 = prázdny) */
+    const char *pool;           /* String pool labelov */
+    uint32_t node_count;        /* Počet uzlov */
+    uint32_t index_count;       /* Počet slotov vo všetkých indexoch */
+    uint32_t pool_size;         /* Veľkosť string poolu v bajtoch */
+    uint32_t domain_count;      /* Počet blokovaných domén */
+    void *mem;                  /* Alokovaný blok (nodes | index | pool) alebo mmap */
+    size_t mem_size;            /* Veľkosť bloku */
+    bool mapped;                /* true = mem je namapovaný súbor (munmap) */
+} filter_compact_t;
+
+/**
+ * @brief Zbalí Trie do kompaktnej formy
+ * @param root Koreň Trie (po load_filter_file())
+ * @return 0 pri úspechu, -1 pri chybe (Trie ostáva nezmenená)
+ *
+ * Uzly sa uložia do jedného poľa (BFS poradie), rovnaké labely sa v string
+ * poole uložia iba raz. Pôvodné uzly sa uvoľnia a root ďalej slúži ako
+ * handle pre is_domain_blocked() / filter_lookup(). Do zbalenej Trie už
+ * nemožno pridávať domény.
+ */
+int filter_compact(filter_node_t *root);
+
+/**
+ * @brief Uloží zbalenú Trie do prekompilovaného súboru
+ * @param root Koreň zbalenej Trie
+ * @param path Cieľový súbor (prepíše sa atomicky cez rename())
+ * @return 0 pri úspechu, -1 pri chybe
+ */
+int filter_save_compiled(const filter_node_t *root, const char *path);
+
+/**
+ * @brief Namapuje prekompilovaný filter read-only cez mmap()
+ * @param path Súbor vytvorený filter_save_compiled()
+ * @return Koreň (handle) pre is_domain_blocked() alebo NULL pri chybe
+ *
+ * Lookupy čítajú priamo z mapovania, štart je O(1) a stránky sú
+ * zdieľané medzi procesmi. Uvoľňuje sa cez filter_node_free().
+ * Súbor sa pri štarte overuje iba podľa hlavičky a veľkosti - indexy
+ * uzlov kontroluje až lookup. Kým je namapovaný, smie sa nahradiť iba
+ * cez rename(); skrátenie na mieste (cp) znamená SIGBUS pri lookupe.
+ */
+filter_node_t *filter_map_compiled(const char *path);
+
+/**
+ * @brief Načíta filter pre server
+ * @param path Textový alebo prekompilovaný súbor
+ * @param compiled true = filter_map_compiled(), false = load_filter_file()
+ *                 + filter_compact()
+ * @param verbose Verbose logging
+ * @return Koreň (handle) alebo NULL pri chybe
+ */
+filter_node_t *filter_load(const char *path, bool compiled, bool verbose);
+
+/**
+ * @brief Vráti pamäť obsadenú Trie (bajty)
+ * @param root Koreň Trie
+ * @return Súčet veľkostí alokácií uzlov, labelov a polí detí
+ *         (pre kompaktnú Trie veľkosť bloku)
+ */
+size_t filter_memory_usage(const filter_node_t *root);
+
+/**
+ * @brief Vráti počet blokovaných domén v Trie
+ * @param root Koreň Trie
+ */
+size_t filter_domain_count(const filter_node_t *root);
+
 /* ============================================================================
  * WRAPPER API PRE TESTY
  * ============================================================================ */
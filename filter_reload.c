@@ -0,0 +1,307 @@
+/**
+ * @file filter_reload.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Hot reload filtra (SIGHUP / inotify)
+ */
+
+#include "filter_reload.h"
+#include "filter.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+/**
+ * @brief Monotónny čas v ms s desatinnou časťou (meranie reloadu)
+ */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Počká, kým každý worker prešiel quiescent bodom po epoche target
+ *
+ * Worker je bezpečný, ak je offline (epoch == 0) alebo už videl novú
+ * epochu - v oboch prípadoch číta iba nový koreň.
+ */
+static void wait_for_readers(filter_reloader_t *reloader, uint64_t target) {
+    struct timespec pause = { 0, FILTER_RELOAD_POLL_MS * 1000000L };
+
+    for (unsigned int i = 0; i < reloader->reader_count; i++) {
+        for (;;) {
+            uint64_t seen = __atomic_load_n(&reloader->readers[i].epoch, __ATOMIC_SEQ_CST);
+            if (seen == 0 || seen >= target) {
+                break;
+            }
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+/**
+ * @brief Jeden reload: načítanie, publikovanie, grace period, uvoľnenie
+ */
+static void do_reload(filter_reloader_t *reloader) {
+    server_config_t *config = reloader->config;
+    double start = now_ms();
+
+    filter_node_t *fresh = filter_load(config->filter_file, config->filter_compiled,
+                                       config->verbose);
+    if (fresh == NULL) {
+        print_error("Filter reload failed - keeping current filter");
+        pthread_mutex_lock(&reloader->lock);
+        reloader->stats.reload_failures++;
+        pthread_mutex_unlock(&reloader->lock);
+        return;
+    }
+
+    /* Publikovanie - od tejto chvíle noví čitatelia vidia iba nový koreň */
+    filter_node_t *old = __atomic_exchange_n(&config->filter_root, fresh, __ATOMIC_SEQ_CST);
+    uint64_t target = __atomic_add_fetch(&reloader->epoch, 1, __ATOMIC_SEQ_CST);
+
+    wait_for_readers(reloader, target);
+
+    size_t old_domains = filter_domain_count(old);
+    size_t new_domains = filter_domain_count(fresh);
+    filter_node_free(old);
+
+    double elapsed = now_ms() - start;
+
+    pthread_mutex_lock(&reloader->lock);
+    reloader->stats.reload_count++;
+    reloader->stats.last_domains = new_domains;
+    reloader->stats.last_old_domains = old_domains;
+    reloader->stats.last_reload_ms = elapsed;
+    pthread_mutex_unlock(&reloader->lock);
+
+    printf("Filter reloaded: %zu domains (previously %zu) in %.1f ms\n",
+           new_domains, old_domains, elapsed);
+    fflush(stdout);
+}
+
+/**
+ * @brief Vlákno reloadera - čaká na požiadavky
+ */
+static void *reloader_thread(void *arg) {
+    filter_reloader_t *reloader = (filter_reloader_t *)arg;
+
+    pthread_mutex_lock(&reloader->lock);
+    while (!reloader->stopping) {
+        if (!reloader->requested) {
+            pthread_cond_wait(&reloader->cond, &reloader->lock);
+            continue;
+        }
+
+        /* Požiadavky počas reloadu sa zlúčia do jedného ďalšieho */
+        reloader->requested = false;
+        pthread_mutex_unlock(&reloader->lock);
+        do_reload(reloader);
+        pthread_mutex_lock(&reloader->lock);
+    }
+    pthread_mutex_unlock(&reloader->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Nastaví inotify sledovanie adresára filter súboru
+ *
+ * Sleduje sa adresár (IN_CLOSE_WRITE, IN_MOVED_TO), nie samotný súbor -
+ * editory aj --compile-filter súbor nahrádzajú cez rename(), čím by
+ * sledovanie inode zaniklo.
+ */
+static int watch_filter_file(filter_reloader_t *reloader, const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *name = slash != NULL ? slash + 1 : path;
+    char dir[PATH_MAX];
+
+    if (slash == NULL) {
+        snprintf(dir, sizeof(dir), ".");
+    } else if (slash == path) {
+        snprintf(dir, sizeof(dir), "/");
+    } else {
+        size_t dir_len = (size_t)(slash - path);
+        if (dir_len >= sizeof(dir)) {
+            return -1;
+        }
+        memcpy(dir, path, dir_len);
+        dir[dir_len] = '\0';
+    }
+
+    reloader->watch_name = strdup(name);
+    if (reloader->watch_name == NULL) {
+        return -1;
+    }
+
+    reloader->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reloader->inotify_fd < 0) {
+        return -1;
+    }
+
+    if (inotify_add_watch(reloader->inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(reloader->inotify_fd);
+        reloader->inotify_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Inicializuje reloader
+ *
+ * Edge cases:
+ * - NULL argumenty / nulový počet workerov
+ * - inotify nedostupné (iba varovanie, SIGHUP funguje ďalej)
+ */
+int filter_reloader_init(filter_reloader_t *reloader, server_config_t *config,
+                         unsigned int reader_count, bool watch) {
+    if (reloader == NULL || config == NULL || reader_count == 0) {
+        return -1;
+    }
+
+    memset(reloader, 0, sizeof(*reloader));
+    reloader->config = config;
+    reloader->reader_count = reader_count;
+    reloader->epoch = 1;
+    reloader->inotify_fd = -1;
+
+    reloader->readers = (filter_reader_t *)calloc(reader_count, sizeof(filter_reader_t));
+    if (reloader->readers == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_init(&reloader->lock, NULL);
+    pthread_cond_init(&reloader->cond, NULL);
+
+    if (watch && config->filter_file != NULL &&
+        watch_filter_file(reloader, config->filter_file) != 0) {
+        print_error("Cannot watch filter file %s: %s (SIGHUP reload still works)",
+                    config->filter_file, strerror(errno));
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Spustí vlákno reloadera
+ */
+int filter_reloader_start(filter_reloader_t *reloader) {
+    if (reloader == NULL || reloader->running) {
+        return -1;
+    }
+
+    int err = pthread_create(&reloader->thread, NULL, reloader_thread, reloader);
+    if (err != 0) {
+        print_error("Failed to create filter reload thread: %s", strerror(err));
+        return -1;
+    }
+
+    reloader->running = true;
+    return 0;
+}
+
+/**
+ * @brief Požiada o reload
+ */
+void filter_reloader_request(filter_reloader_t *reloader) {
+    if (reloader == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&reloader->lock);
+    reloader->requested = true;
+    pthread_cond_signal(&reloader->cond);
+    pthread_mutex_unlock(&reloader->lock);
+}
+
+/**
+ * @brief Skontroluje inotify udalosti
+ */
+bool filter_reloader_poll(filter_reloader_t *reloader) {
+    if (reloader == NULL || reloader->inotify_fd < 0) {
+        return false;
+    }
+
+    /* Zarovnanie podľa inotify(7) */
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+
+    for (;;) {
+        ssize_t len = read(reloader->inotify_fd, buf, sizeof(buf));
+        if (len <= 0) {
+            break;
+        }
+
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->len > 0 && strcmp(event->name, reloader->watch_name) == 0) {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (changed) {
+        filter_reloader_request(reloader);
+    }
+    return changed;
+}
+
+/**
+ * @brief Ukončí vlákno a uvoľní zdroje
+ */
+void filter_reloader_destroy(filter_reloader_t *reloader) {
+    if (reloader == NULL) {
+        return;
+    }
+
+    if (reloader->running) {
+        pthread_mutex_lock(&reloader->lock);
+        reloader->stopping = true;
+        pthread_cond_signal(&reloader->cond);
+        pthread_mutex_unlock(&reloader->lock);
+        pthread_join(reloader->thread, NULL);
+        reloader->running = false;
+    }
+
+    if (reloader->inotify_fd >= 0) {
+        close(reloader->inotify_fd);
+        reloader->inotify_fd = -1;
+    }
+
+    free(reloader->watch_name);
+    reloader->watch_name = NULL;
+    free(reloader->readers);
+    reloader->readers = NULL;
+
+    pthread_cond_destroy(&reloader->cond);
+    pthread_mutex_destroy(&reloader->lock);
+}
+
+/**
+ * @brief Vráti štatistiky reloadov
+ */
+void filter_reloader_stats(filter_reloader_t *reloader, filter_reload_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    if (reloader == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&reloader->lock);
+    *stats = reloader->stats;
+    pthread_mutex_unlock(&reloader->lock);
+}
@@ -0,0 +1,126 @@
+/**
+ * @file filter_reload.h
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Hot reload filtra (SIGHUP / inotify)
+ */
+
+#ifndef FILTER_RELOAD_H
+#define FILTER_RELOAD_H
+
+#include "dns.h"
+
+#include <pthread.h>
+
+/* Interval kontroly, či už všetci workeri prešli quiescent bodom (ms) */
+#define FILTER_RELOAD_POLL_MS   1
+
+/**
+ * @brief Stav jedného čitateľa (workera)
+ *
+ * epoch = 0 znamená, že worker práve nedrží žiadnu referenciu na filter
+ * (čaká v epoll_wait()). Zarovnanie na cache line - každý worker zapisuje
+ * svoju položku pri každej iterácii event loopu.
+ */
+typedef struct {
+    uint64_t epoch;                     /* Videná epocha, 0 = offline */
+    uint8_t pad[56];                    /* Výplň do 64 B (false sharing) */
+} filter_reader_t;
+
+/**
+ * @brief Štatistiky reloadov
+ */
+typedef struct {
+    unsigned long reload_count;         /* Úspešné reloady */
+    unsigned long reload_failures;      /* Neúspešné (ostal starý filter) */
+    size_t last_domains;                /* Počet domén po poslednom reloade */
+    size_t last_old_domains;            /* Počet domén pred posledným reloadom */
+    double last_reload_ms;              /* Trvanie posledného reloadu */
+} filter_reload_stats_t;
+
+/**
+ * @brief Reloader - vlákno na pozadí, ktoré prestavia a publikuje filter
+ *
+ * Publikovanie je RCU: nový koreň sa atomicky vymení v config->filter_root,
+ * starý sa uvoľní až keď každý worker prešiel quiescent bodom (alebo je
+ * offline). Čitatelia nikdy nečakajú na zámok.
+ */
+typedef struct {
+    server_config_t *config;            /* Konfigurácia (filter_root, filter_file) */
+    filter_reader_t *readers;           /* Stav čitateľov [reader_count] */
+    unsigned int reader_count;          /* Počet workerov */
+    uint64_t epoch;                     /* Globálna epocha (začína na 1) */
+    pthread_t thread;                   /* Vlákno reloadera */
+    pthread_mutex_t lock;               /* Chráni requested/stopping/stats */
+    pthread_cond_t cond;                /* Signalizácia požiadavky */
+    bool requested;                     /* Čaká požiadavka na reload */
+    bool stopping;                      /* Ukončenie vlákna */
+    bool running;                       /* Vlákno beží */
+    int inotify_fd;                     /* inotify (-1 = bez sledovania) */
+    char *watch_name;                   /* Meno súboru v sledovanom adresári */
+    filter_reload_stats_t stats;        /* Štatistiky */
+} filter_reloader_t;
+
+/**
+ * @brief Inicializuje reloader (vlákno sa spúšťa zvlášť)
+ * @param reloader Reloader
+ * @param config Konfigurácia servera
+ * @param reader_count Počet workerov
+ * @param watch true = sledovať filter_file cez inotify
+ * @return 0 pri úspechu, -1 pri chybe
+ *
+ * Ak inotify nie je dostupné, reloader funguje ďalej iba so SIGHUP.
+ */
+int filter_reloader_init(filter_reloader_t *reloader, server_config_t *config,
+                         unsigned int reader_count, bool watch);
+
+/**
+ * @brief Spustí vlákno reloadera
+ * @return 0 pri úspechu, -1 pri chybe
+ */
+int filter_reloader_start(filter_reloader_t *reloader);
+
+/**
+ * @brief Požiada o reload (neblokuje, viac požiadaviek sa zlúči)
+ */
+void filter_reloader_request(filter_reloader_t *reloader);
+
+/**
+ * @brief Skontroluje inotify udalosti (volá hlavné vlákno)
+ * @return true ak sa filter súbor zmenil (reload bol vyžiadaný)
+ */
+bool filter_reloader_poll(filter_reloader_t *reloader);
+
+/**
+ * @brief Ukončí vlákno (dokončí prebiehajúci reload) a uvoľní zdroje
+ */
+void filter_reloader_destroy(filter_reloader_t *reloader);
+
+/**
+ * @brief Vráti štatistiky reloadov
+ */
+void filter_reloader_stats(filter_reloader_t *reloader, filter_reload_stats_t *stats);
+
+/**
+ * @brief Worker drží referencie na filter (po návrate z epoll_wait())
+ */
+static inline void filter_reader_online(filter_reloader_t *reloader, unsigned int id) {
+    __atomic_store_n(&reloader->readers[id].epoch,
+                     __atomic_load_n(&reloader->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Quiescent bod - worker nedrží žiadnu referenciu na filter
+ */
+static inline void filter_reader_offline(filter_reloader_t *reloader, unsigned int id) {
+    __atomic_store_n(&reloader->readers[id].epoch, 0, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Aktuálne publikovaný filter (platný do najbližšieho quiescent bodu)
+ */
+static inline const filter_node_t *filter_reader_root(const filter_reloader_t *reloader) {
+    return __atomic_load_n(&reloader->config->filter_root, __ATOMIC_SEQ_CST);
+}
+
+#endif /* FILTER_RELOAD_H */
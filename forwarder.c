@@ -0,0 +1,1585 @@
+/**
+ * @file forwarder.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Asynchrónne preposielanie na upstream
+ */
+
+#include "forwarder.h"
+#include "resolver.h"
+#include "dns_parser.h"
+#include "dns_builder.h"
+#include "utils.h"
+
+#include <sys/socket.h>
+#include <sys/random.h>
+#include <sys/epoll.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+/**
+ * @brief xorshift32 generátor pre transaction ID
+ *
+ * Nie je kryptograficky silný, ale seed je z getrandom() a každý worker
+ * má vlastný stav, takže ID nie sú predvídateľné zvonku.
+ */
+static uint32_t next_random(forwarder_t *fw) {
+    uint32_t x = fw->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fw->rng_state = x;
+    return x;
+}
+
+/**
+ * @brief Nájde koniec question section (bez compression)
+ * @return Offset za QCLASS prvej otázky alebo 0 pri chybe
+ */
+static size_t find_question_end(const uint8_t *buffer, size_t len) {
+    size_t pos = DNS_HEADER_SIZE;
+
+    while (pos < len && buffer[pos] != 0) {
+        /* Kompresia nie je povolená v question section dotazu */
+        if (buffer[pos] > DNS_MAX_LABEL_LEN) {
+            return 0;
+        }
+        pos += (size_t)buffer[pos] + 1;
+    }
+
+    /* +1 pre nulový bajt, +4 pre QTYPE a QCLASS */
+    pos += 5;
+    return pos <= len ? pos : 0;
+}
+
+/**
+ * @brief Zapíše transaction ID do hlavičky (network byte order)
+ */
+static void write_id(uint8_t *buffer, uint16_t id) {
+    buffer[0] = (uint8_t)(id >> 8);
+    buffer[1] = (uint8_t)(id & 0xFF);
+}
+
+/* Výsledok kontroly odpovede upstream */
+typedef enum {
+    RESPONSE_VALID,         /* Doručí sa klientovi */
+    RESPONSE_TRUNCATED,     /* TC bit - dotaz sa zopakuje cez TCP */
+    RESPONSE_INVALID        /* Zahodí sa */
+} response_check_t;
+
+/**
+ * @brief Zistí, či ide o rovnakú otázku (QNAME bez ohľadu na veľkosť písmen)
+ *
+ * Odpoveď závisí aj od DO (RRSIG záznamy) a CD (validácia upstreamom),
+ * takže sa porovnávajú aj DNSSEC bity kľúča.
+ */
+static bool same_key(const dns_cache_key_t *a, const dns_cache_key_t *b) {
+    return a->hash == b->hash && a->name_len == b->name_len &&
+           a->qtype == b->qtype && a->qclass == b->qclass &&
+           a->dnssec == b->dnssec &&
+           memcmp(a->name, b->name, a->name_len) == 0;
+}
+
+/**
+ * @brief Nájde rozpracovaný dotaz na rovnakú otázku alebo NULL
+ */
+static pending_query_t *find_keyed(const forwarder_t *fw, const dns_cache_key_t *key) {
+    pending_query_t *pending = fw->by_key[key->hash & (FORWARDER_KEY_BUCKETS - 1)];
+
+    while (pending != NULL && !same_key(&pending->key, key)) {
+        pending = pending->next_key;
+    }
+    return pending;
+}
+
+/**
+ * @brief Vyradí dotaz z tabuľky by_key (ďalšie rovnaké otázky sa už nepripoja)
+ */
+static void unlink_key(forwarder_t *fw, pending_query_t *pending) {
+    if (!pending->keyed) {
+        return;
+    }
+
+    pending_query_t **link = &fw->by_key[pending->key.hash & (FORWARDER_KEY_BUCKETS - 1)];
+    while (*link != NULL && *link != pending) {
+        link = &(*link)->next_key;
+    }
+    if (*link != NULL) {
+        *link = pending->next_key;
+    }
+    pending->keyed = false;
+}
+
+/**
+ * @brief Prepíše v bufferi ID a question section na tie od čakajúceho klienta
+ */
+static void patch_for_waiter(const pending_query_t *pending, const forwarder_waiter_t *waiter,
+                             uint8_t *buffer) {
+    write_id(buffer, waiter->client.id);
+    memcpy(buffer + DNS_HEADER_SIZE, waiter->question, pending->question_end - DNS_HEADER_SIZE);
+}
+
+/**
+ * @brief Zaradí dotaz do zoznamu dotazov TCP spojenia
+ */
+static void tcp_link(upstream_tcp_t *conn, pending_query_t *pending) {
+    pending->tcp_prev = NULL;
+    pending->tcp_next = conn->queries;
+    if (conn->queries != NULL) {
+        conn->queries->tcp_prev = pending;
+    }
+    conn->queries = pending;
+    conn->outstanding++;
+}
+
+/**
+ * @brief Vyradí dotaz zo zoznamu dotazov TCP spojenia
+ */
+static void tcp_unlink(upstream_tcp_t *conn, pending_query_t *pending) {
+    if (pending->tcp_prev != NULL) {
+        pending->tcp_prev->tcp_next = pending->tcp_next;
+    } else {
+        conn->queries = pending->tcp_next;
+    }
+    if (pending->tcp_next != NULL) {
+        pending->tcp_next->tcp_prev = pending->tcp_prev;
+    }
+    pending->tcp_prev = NULL;
+    pending->tcp_next = NULL;
+    conn->outstanding--;
+}
+
+/**
+ * @brief Vyberie záznam z pending tabuľky a vráti ho do free-listu
+ */
+static void release_pending(forwarder_t *fw, pending_query_t *pending) {
+    timer_wheel_cancel(&fw->timers, &pending->timer);
+    timer_wheel_cancel(&fw->stale_timers, &pending->stale_timer);
+    unlink_key(fw, pending);
+    fw->by_id[pending->upstream_id] = NULL;
+    fw->in_flight -= 1 + pending->waiter_count;
+
+    while (pending->waiters != NULL) {
+        forwarder_waiter_t *waiter = pending->waiters;
+        pending->waiters = waiter->next;
+        waiter->next = fw->free_waiters;
+        fw->free_waiters = waiter;
+    }
+    pending->waiter_count = 0;
+
+    if (pending->over_tcp) {
+        tcp_unlink(&fw->upstreams[pending->upstream].tcp[pending->sock_index], pending);
+    }
+
+    pending->next_free = fw->free_list;
+    fw->free_list = pending;
+}
+
+/**
+ * @brief Započíta odpoveď upstream servera (meranie RTT, obnova zdravia)
+ */
+static void upstream_answered(upstream_t *up, const pending_query_t *pending, uint64_t now_us) {
+    up->answer_count++;
+
+    /* Karnov algoritmus - RTT iba z odpovede na jediné odoslanie cez UDP */
+    if (pending->attempts == 1 && !pending->over_tcp && now_us > pending->sent_us) {
+        uint64_t elapsed = now_us - pending->sent_us;
+        uint32_t sample = elapsed < UINT32_MAX ? (uint32_t)elapsed : UINT32_MAX;
+
+        up->rtt_sum_us += sample;
+        up->rtt_samples++;
+        upstream_rtt_sample(&up->rtt, sample);
+    }
+
+    up->fail_score = 0;
+    up->down_until_ms = 0;
+}
+
+/**
+ * @brief Započíta vypršané RTO upstream servera (penalizácia, prípadne vyradenie)
+ */
+static void upstream_timed_out(upstream_t *up, uint64_t now_ms) {
+    up->timeout_count++;
+    up->fail_score++;
+
+    if (up->fail_score >= FORWARDER_FAIL_LIMIT) {
+        unsigned int doublings = up->fail_score - FORWARDER_FAIL_LIMIT;
+        uint64_t down_ms = (uint64_t)FORWARDER_DOWN_MS << (doublings < 5 ? doublings : 5);
+        if (down_ms > FORWARDER_DOWN_MAX_MS) {
+            down_ms = FORWARDER_DOWN_MAX_MS;
+        }
+        up->down_until_ms = now_ms + down_ms;
+
+        /* Iba prechod do vyradenia - predĺženia by pri výpadku zahltili log */
+        if (up->fail_score == FORWARDER_FAIL_LIMIT) {
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &up->addr.sin_addr, ip, sizeof(ip));
+            verbose_log_raw("  Upstream %s marked down (%u timeouts in a row)",
+                            ip, up->fail_score);
+        }
+    }
+}
+
+/**
+ * @brief Vráti poradové skóre servera - SRTT zdvojnásobené za každé RTO
+ *        vypršané od poslednej odpovede (0 = zatiaľ bez merania)
+ */
+static uint64_t upstream_score(const upstream_t *up) {
+    uint64_t srtt = up->rtt.srtt_us;
+
+    if (srtt == 0 && up->fail_score > 0) {
+        srtt = (uint64_t)UPSTREAM_RTO_INITIAL_MS * 1000u;
+    }
+    return srtt << (up->fail_score < 16 ? up->fail_score : 16);
+}
+
+/**
+ * @brief Vyberie upstream server pre ďalší pokus
+ *
+ * Spomedzi nevyradených vyhráva najnižšie skóre (server bez merania má
+ * prednosť, aby sa zmeral). Server po skončení vyradenia alebo dlho bez
+ * dotazu dostane jeden dotaz ako sondu - inak by penalizované RTT nikdy
+ * neobnovil. Ak sú vyradené všetky, vyberie sa ten, ktorého vyradenie
+ * skončí najskôr.
+ */
+static unsigned int select_upstream(forwarder_t *fw, uint64_t now_ms) {
+    unsigned int best = fw->upstream_count;
+
+    for (unsigned int i = 0; i < fw->upstream_count; i++) {
+        upstream_t *up = &fw->upstreams[i];
+
+        if (up->down_until_ms > now_ms) {
+            continue;
+        }
+
+        if (up->fail_score >= FORWARDER_FAIL_LIMIT) {
+            /* Jedna sonda naraz - ďalšie dotazy počkajú na jej výsledok */
+            up->down_until_ms = now_ms + fw->rto_max_ms;
+            return i;
+        }
+        if (now_ms - up->last_used_ms >= FORWARDER_PROBE_MS) {
+            return i;
+        }
+
+        if (best == fw->upstream_count ||
+            upstream_score(up) < upstream_score(&fw->upstreams[best])) {
+            best = i;
+        }
+    }
+
+    if (best < fw->upstream_count) {
+        return best;
+    }
+
+    best = 0;
+    for (unsigned int i = 1; i < fw->upstream_count; i++) {
+        if (fw->upstreams[i].down_until_ms < fw->upstreams[best].down_until_ms) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Vráti bucket histogramu latencie (4 buckety na mocninu dvoch)
+ */
+static unsigned int latency_bucket(uint32_t us) {
+    if (us < 4) {
+        return us;
+    }
+
+    unsigned int msb = 2;
+    while (msb < 31 && (us >> (msb + 1)) != 0) {
+        msb++;
+    }
+    return msb * 4 + ((us >> (msb - 2)) & 3);
+}
+
+/**
+ * @brief Vráti hornú hranicu bucketu histogramu (µs, exkluzívne)
+ */
+static uint64_t latency_bucket_limit(unsigned int bucket) {
+    if (bucket < 8) {
+        return bucket + 1;
+    }
+    return (uint64_t)(5 + bucket % 4) << (bucket / 4 - 2);
+}
+
+/**
+ * @brief Prepočíta p95 latencie z histogramu (oneskorenie hedged kópie)
+ */
+static void update_hedge_delay(forwarder_t *fw) {
+    uint64_t target = ((uint64_t)fw->latency_samples * 95 + 99) / 100;
+    uint64_t seen = 0;
+
+    for (unsigned int i = 0; i < FORWARDER_LATENCY_BUCKETS; i++) {
+        seen += fw->latency_hist[i];
+        if (seen >= target) {
+            uint64_t limit = latency_bucket_limit(i);
+            fw->hedge_delay_us = limit < UINT32_MAX ? (uint32_t)limit : UINT32_MAX;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Započíta latenciu dotazu (od prvého odoslania po odpoveď)
+ *
+ * Každých FORWARDER_LATENCY_WINDOW meraní sa histogram prepolí, takže
+ * staršie merania postupne strácajú váhu.
+ */
+static void record_latency(forwarder_t *fw, uint64_t latency_us) {
+    uint32_t us = latency_us < UINT32_MAX ? (uint32_t)latency_us : UINT32_MAX;
+
+    fw->latency_hist[latency_bucket(us)]++;
+    fw->latency_samples++;
+
+    if (fw->latency_samples >= FORWARDER_LATENCY_WINDOW) {
+        fw->latency_samples = 0;
+        for (unsigned int i = 0; i < FORWARDER_LATENCY_BUCKETS; i++) {
+            fw->latency_hist[i] /= 2;
+            fw->latency_samples += fw->latency_hist[i];
+        }
+        update_hedge_delay(fw);
+    } else if (fw->latency_samples % 32 == 0) {
+        update_hedge_delay(fw);
+    }
+}
+
+/**
+ * @brief Obnoví ID klienta, doručí odpoveď a uvoľní pending záznam
+ *
+ * Callback smie odpoveď upraviť (EDNS klienta), preto každý čakajúci
+ * dostane čerstvú kópiu s vlastným ID a question section.
+ */
+static void deliver_response(forwarder_t *fw, pending_query_t *pending,
+                             uint8_t *response, size_t resp_len) {
+    uint64_t now_us = monotonic_us();
+
+    upstream_answered(&fw->upstreams[pending->upstream], pending, now_us);
+    if (!pending->over_tcp && now_us > pending->first_sent_us) {
+        record_latency(fw, now_us - pending->first_sent_us);
+    }
+
+    unlink_key(fw, pending);
+    if (pending->waiters != NULL) {
+        memcpy(fw->reply_copy, response, resp_len);
+    }
+
+    dns_client_t client = pending->client;
+    write_id(response, client.id);
+    write_id(pending->query, client.id);
+
+    fw->on_reply(fw->cb_ctx, &client, pending->query, pending->query_len,
+                 response, resp_len);
+
+    for (forwarder_waiter_t *waiter = pending->waiters; waiter != NULL; waiter = waiter->next) {
+        memcpy(response, fw->reply_copy, resp_len);
+        patch_for_waiter(pending, waiter, response);
+        patch_for_waiter(pending, waiter, pending->query);
+
+        fw->on_reply(fw->cb_ctx, &waiter->client, pending->query, pending->query_len,
+                     response, resp_len);
+    }
+
+    release_pending(fw, pending);
+}
+
+/**
+ * @brief Ohlási zlyhanie dotazu (klienti dostanú SERVFAIL) a uvoľní záznam
+ */
+static void fail_pending(forwarder_t *fw, pending_query_t *pending) {
+    unlink_key(fw, pending);
+
+    dns_client_t client = pending->client;
+    write_id(pending->query, client.id);
+
+    fw->on_reply(fw->cb_ctx, &client, pending->query, pending->query_len, NULL, 0);
+
+    for (forwarder_waiter_t *waiter = pending->waiters; waiter != NULL; waiter = waiter->next) {
+        patch_for_waiter(pending, waiter, pending->query);
+        fw->on_reply(fw->cb_ctx, &waiter->client, pending->query, pending->query_len, NULL, 0);
+    }
+
+    release_pending(fw, pending);
+}
+
+/**
+ * @brief Pripojí klienta k rozpracovanému dotazu na rovnakú otázku
+ * @return 0 pri úspechu, -1 ak sa klient nedá pripojiť (dotaz ide samostatne)
+ */
+static int attach_waiter(forwarder_t *fw, pending_query_t *pending, const uint8_t *query,
+                         const dns_client_t *client) {
+    if (pending->waiter_count >= FORWARDER_MAX_WAITERS) {
+        return -1;
+    }
+
+    forwarder_waiter_t *waiter = fw->free_waiters;
+    if (waiter != NULL) {
+        fw->free_waiters = waiter->next;
+    } else {
+        waiter = (forwarder_waiter_t *)malloc(sizeof(forwarder_waiter_t));
+        if (waiter == NULL) {
+            return -1;
+        }
+    }
+
+    waiter->client = *client;
+    memcpy(waiter->question, query + DNS_HEADER_SIZE, pending->question_end - DNS_HEADER_SIZE);
+    waiter->next = pending->waiters;
+    pending->waiters = waiter;
+    pending->waiter_count++;
+
+    fw->in_flight++;
+    fw->coalesced_count++;
+    return 0;
+}
+
+/**
+ * @brief Overí odpoveď spárovanú s pending dotazom
+ *
+ * Edge cases:
+ * - QR=0 (nie je to odpoveď)
+ * - Question section nezodpovedá dotazu
+ * - Poškodené RR (odpoveď s TC bitom sa neoveruje - môže byť neúplná)
+ */
+static response_check_t check_response(forwarder_t *fw, const pending_query_t *pending,
+                                       const dns_header_t *header,
+                                       const uint8_t *response, size_t resp_len) {
+    if (!(header->flags & DNS_FLAG_QR)) {
+        fw->dropped_count++;
+        return RESPONSE_INVALID;
+    }
+
+    if (resp_len < pending->question_end ||
+        memcmp(response + DNS_HEADER_SIZE, pending->query + DNS_HEADER_SIZE,
+               pending->question_end - DNS_HEADER_SIZE) != 0) {
+        verbose_log_raw("  Upstream response question mismatch (ID 0x%04X)", header->id);
+        fw->dropped_count++;
+        return RESPONSE_INVALID;
+    }
+
+    if (header->flags & DNS_FLAG_TC) {
+        return RESPONSE_TRUNCATED;
+    }
+
+    if (dns_validate_message(response, resp_len) != 0) {
+        verbose_log_raw("  Malformed upstream response (ID 0x%04X)", header->id);
+        fw->dropped_count++;
+        return RESPONSE_INVALID;
+    }
+
+    return RESPONSE_VALID;
+}
+
+/**
+ * @brief Pošle dotaz cez UDP na daný upstream
+ *
+ * Na server, ktorý dotaz už dostal, ide cez ten istý socket (odpoveď na
+ * skorší pokus tak ostáva platná). Zlyhanie send() sa nepovažuje za
+ * fatálne - RTO spustí retransmisiu.
+ */
+static void send_to_upstream(forwarder_t *fw, pending_query_t *pending,
+                             unsigned int upstream, uint64_t now_ms) {
+    upstream_t *up = &fw->upstreams[upstream];
+
+    if (pending->sent_sock[upstream] == 0) {
+        pending->sent_sock[upstream] = (uint8_t)((next_random(fw) >> 8) % up->sock_count + 1);
+    }
+
+    ssize_t sent_len = send(up->socks[pending->sent_sock[upstream] - 1], pending->query,
+                            pending->query_len, 0);
+
+    if (sent_len < 0) {
+        print_error("Failed to send to upstream: %s", strerror(errno));
+    } else if ((size_t)sent_len != pending->query_len) {
+        print_error("Partial send to upstream (%zd/%zu bytes)",
+                    sent_len, pending->query_len);
+    }
+
+    pending->attempts++;
+    up->query_count++;
+    up->last_used_ms = now_ms;
+    fw->sent_count++;
+}
+
+/**
+ * @brief Odošle (alebo znovu odošle) pending dotaz a naplánuje RTO
+ *
+ * Každý pokus si upstream vyberá znova (viď select_upstream()). RTO je
+ * podľa RTT servera, zdvojené za každý predchádzajúci pokus a nikdy
+ * nepresiahne deadline dotazu. Pri prvom pokuse s hedgingom sa časovač
+ * nastaví na skorší p95 a RTO sa odloží do rto_expires_ms.
+ */
+static void send_pending(forwarder_t *fw, pending_query_t *pending, uint64_t now_ms) {
+    pending->upstream = select_upstream(fw, now_ms);
+
+    upstream_t *up = &fw->upstreams[pending->upstream];
+    uint64_t expires = now_ms + upstream_rtt_rto_ms(&up->rtt, (unsigned int)pending->attempts,
+                                                    fw->rto_max_ms);
+    if (expires > pending->deadline_ms) {
+        expires = pending->deadline_ms;
+    }
+
+    bool first = pending->attempts == 0;
+    send_to_upstream(fw, pending, pending->upstream, now_ms);
+    pending->sock_index = pending->sent_sock[pending->upstream] - 1u;
+    pending->sent_us = monotonic_us();
+
+    if (!first) {
+        timer_wheel_add(&fw->timers, &pending->timer, expires);
+        return;
+    }
+
+    pending->first_sent_us = pending->sent_us;
+
+    uint64_t hedge_at = now_ms + (fw->hedge_delay_us + 999) / 1000;
+    if (fw->hedge_percent > 0 && fw->hedge_tokens >= 100 &&
+        fw->latency_samples >= FORWARDER_HEDGE_MIN_SAMPLES && hedge_at < expires) {
+        pending->hedge_armed = true;
+        pending->rto_expires_ms = expires;
+        expires = hedge_at;
+    }
+
+    timer_wheel_add(&fw->timers, &pending->timer, expires);
+}
+
+/**
+ * @brief Vyberie server pre hedged kópiu - najlepší nevyradený okrem
+ *        aktuálneho, inak ten istý
+ */
+static unsigned int hedge_target(const forwarder_t *fw, unsigned int current, uint64_t now_ms) {
+    unsigned int best = current;
+
+    for (unsigned int i = 0; i < fw->upstream_count; i++) {
+        const upstream_t *up = &fw->upstreams[i];
+
+        if (i == current || up->down_until_ms > now_ms) {
+            continue;
+        }
+        if (best == current || upstream_score(up) < upstream_score(&fw->upstreams[best])) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Pošle hedged kópiu dotazu (ak to rozpočet dovolí) a obnoví RTO
+ *
+ * Kópia má rovnaké upstream ID, takže platí prvá odpoveď; pokus sa
+ * započíta, takže odpoveď sa pre RTT nepoužije (Karnov algoritmus).
+ */
+static void send_hedge(forwarder_t *fw, pending_query_t *pending, uint64_t now_ms) {
+    pending->hedge_armed = false;
+
+    if (fw->hedge_tokens >= 100) {
+        fw->hedge_tokens -= 100;
+        pending->hedge_upstream = hedge_target(fw, pending->upstream, now_ms);
+        send_to_upstream(fw, pending, pending->hedge_upstream, now_ms);
+        fw->hedge_count++;
+    }
+
+    timer_wheel_add(&fw->timers, &pending->timer, pending->rto_expires_ms);
+}
+
+/**
+ * @brief Nastaví epoll udalosti TCP spojenia (EPOLLOUT iba pri connect/tx)
+ */
+static void tcp_update_events(forwarder_t *fw, upstream_tcp_t *conn) {
+    uint32_t events = EPOLLIN;
+    if (!conn->connected || conn->tx_sent < conn->tx_len) {
+        events |= EPOLLOUT;
+    }
+
+    if (conn->events == events) {
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = conn->fd;
+
+    if (epoll_ctl(fw->epfd, EPOLL_CTL_MOD, conn->fd, &ev) == 0) {
+        conn->events = events;
+    }
+}
+
+/**
+ * @brief Zatvorí TCP spojenie (rozpracované dotazy rieši volajúci)
+ */
+static void tcp_close(upstream_tcp_t *conn) {
+    if (conn->fd >= 0) {
+        close(conn->fd);
+    }
+    free(conn->rx);
+    free(conn->tx);
+
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = -1;
+}
+
+/**
+ * @brief Otvorí neblokujúce TCP spojenie na upstream a zaregistruje ho do epoll
+ * @return 0 pri úspechu (connect() môže ešte prebiehať), -1 pri chybe
+ */
+static int tcp_open(forwarder_t *fw, const upstream_t *up, upstream_tcp_t *conn) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        print_error("Failed to create upstream TCP socket: %s", strerror(errno));
+        return -1;
+    }
+
+    /* Dotazy sú malé a každý čaká na odpoveď - Nagle by iba zdržiaval */
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    bool connected = connect(fd, (const struct sockaddr *)&up->addr, sizeof(up->addr)) == 0;
+    if (!connected && errno != EINPROGRESS) {
+        print_error("Failed to connect to upstream over TCP: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(fw->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        print_error("epoll_ctl() failed: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    conn->fd = fd;
+    conn->connected = connected;
+    conn->events = ev.events;
+    fw->tcp_connect_count++;
+
+    verbose_log_raw("  Opened TCP connection to upstream");
+    return 0;
+}
+
+/**
+ * @brief Pridá dotaz (s 2-bajtovou dĺžkou) do tx spojenia
+ * @return 0 pri úspechu, -1 pri chybe alokácie
+ */
+static int tcp_queue(upstream_tcp_t *conn, const uint8_t *msg, size_t len) {
+    /* Odoslaná časť sa zahodí až keď treba miesto */
+    if (conn->tx_sent > 0) {
+        memmove(conn->tx, conn->tx + conn->tx_sent, conn->tx_len - conn->tx_sent);
+        conn->tx_len -= conn->tx_sent;
+        conn->tx_sent = 0;
+    }
+
+    size_t need = conn->tx_len + 2 + len;
+    if (need > conn->tx_cap) {
+        size_t new_cap = conn->tx_cap > 0 ? conn->tx_cap : DNS_EDNS_UDP_SIZE;
+        while (new_cap < need) {
+            new_cap *= 2;
+        }
+
+        uint8_t *tx = (uint8_t *)realloc(conn->tx, new_cap);
+        if (tx == NULL) {
+            print_error("Failed to allocate upstream TCP buffer");
+            return -1;
+        }
+        conn->tx = tx;
+        conn->tx_cap = new_cap;
+    }
+
+    conn->tx[conn->tx_len] = (uint8_t)(len >> 8);
+    conn->tx[conn->tx_len + 1] = (uint8_t)(len & 0xFF);
+    memcpy(conn->tx + conn->tx_len + 2, msg, len);
+    conn->tx_len += 2 + len;
+    return 0;
+}
+
+/**
+ * @brief Odošle čo najviac z tx (zvyšok pri EPOLLOUT)
+ * @return 0 pri úspechu (aj čiastočnom), -1 pri chybe spojenia
+ */
+static int tcp_flush(forwarder_t *fw, upstream_tcp_t *conn) {
+    while (conn->tx_sent < conn->tx_len) {
+        ssize_t n = send(conn->fd, conn->tx + conn->tx_sent,
+                         conn->tx_len - conn->tx_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            print_error("Failed to send to upstream over TCP: %s", strerror(errno));
+            return -1;
+        }
+        conn->tx_sent += (size_t)n;
+    }
+
+    if (conn->tx_sent == conn->tx_len) {
+        conn->tx_len = 0;
+        conn->tx_sent = 0;
+    }
+
+    tcp_update_events(fw, conn);
+    return 0;
+}
+
+/**
+ * @brief Vyberie TCP spojenie pre ďalší dotaz
+ *
+ * Najmenej vyťažené spojenie, pri zhode už otvorené - nové spojenie sa
+ * otvorí, iba keď sú všetky otvorené spojenia zaťažené viac.
+ */
+static unsigned int tcp_pick(const upstream_t *up) {
+    unsigned int best = 0;
+
+    for (unsigned int i = 1; i < FORWARDER_TCP_POOL_SIZE; i++) {
+        const upstream_tcp_t *conn = &up->tcp[i];
+        const upstream_tcp_t *current = &up->tcp[best];
+
+        if (conn->outstanding < current->outstanding ||
+            (conn->outstanding == current->outstanding && conn->fd >= 0 && current->fd < 0)) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Zaradí pending dotaz do tx TCP spojenia na jeho upstream a naplánuje timeout
+ * @return 0 ak je dotaz zaradený, -1 ak TCP nie je k dispozícii (pending
+ *         ostáva nezmenený)
+ *
+ * Dotaz si ponechá upstream ID - na spojení môže byť naraz viac dotazov
+ * a odpovede sa párujú rovnako ako pri UDP. Odoslanie rieši volajúci
+ * (tcp_flush() alebo EPOLLOUT).
+ */
+static int tcp_enqueue(forwarder_t *fw, pending_query_t *pending, uint64_t now_ms) {
+    if (fw->epfd < 0) {
+        return -1;
+    }
+
+    upstream_t *up = &fw->upstreams[pending->upstream];
+    unsigned int index = tcp_pick(up);
+
+    /* Časovač odteraz patrí TCP pokusu */
+    pending->hedge_armed = false;
+    upstream_tcp_t *conn = &up->tcp[index];
+
+    if (conn->fd < 0 && tcp_open(fw, up, conn) != 0) {
+        return -1;
+    }
+    if (tcp_queue(conn, pending->query, pending->query_len) != 0) {
+        return -1;
+    }
+
+    pending->over_tcp = true;
+    pending->sock_index = index;
+    pending->attempts++;
+    pending->sent_us = monotonic_us();
+    tcp_link(conn, pending);
+    up->query_count++;
+    up->last_used_ms = now_ms;
+    fw->sent_count++;
+
+    timer_wheel_add(&fw->timers, &pending->timer,
+                    now_ms + (uint64_t)UPSTREAM_TIMEOUT_SEC * 1000u);
+    return 0;
+}
+
+/**
+ * @brief Zatvorí TCP spojenie a jeho dotazy pridá do zoznamu orphans
+ *
+ * Dotazy sa odpoja od spojenia (over_tcp = false), zoznam je cez tcp_next.
+ */
+static void tcp_detach(forwarder_t *fw, unsigned int upstream, unsigned int index,
+                       pending_query_t **orphans) {
+    upstream_tcp_t *conn = &fw->upstreams[upstream].tcp[index];
+    pending_query_t *pending = conn->queries;
+
+    tcp_close(conn);
+
+    while (pending != NULL) {
+        pending_query_t *next = pending->tcp_next;
+        pending->over_tcp = false;
+        pending->tcp_prev = NULL;
+        pending->tcp_next = *orphans;
+        *orphans = pending;
+        pending = next;
+    }
+}
+
+/**
+ * @brief Zatvorí zlyhané TCP spojenie a presunie jeho dotazy
+ *
+ * Dotazy, ktoré ešte majú pokusy, sa pošlú cez iné (alebo nové) spojenie -
+ * upstream mohol nečinné spojenie zavrieť práve počas odosielania
+ * (RFC 7766 Section 6.2.3). Ostatné skončia SERVFAIL. Cena je úmerná
+ * počtu dotazov na spojení; ak zlyhá aj odoslanie presunutých dotazov,
+ * ich spojenie sa spracuje v ďalšom kole cyklu (bez rekurzie).
+ */
+static void tcp_fail(forwarder_t *fw, unsigned int upstream, unsigned int index) {
+    upstream_t *up = &fw->upstreams[upstream];
+    pending_query_t *orphans = NULL;
+
+    tcp_detach(fw, upstream, index, &orphans);
+
+    while (orphans != NULL) {
+        uint64_t now = monotonic_ms();
+
+        while (orphans != NULL) {
+            pending_query_t *pending = orphans;
+            orphans = pending->tcp_next;
+            pending->tcp_next = NULL;
+
+            if (pending->attempts < UPSTREAM_RETRY_COUNT && tcp_enqueue(fw, pending, now) == 0) {
+                fw->retry_count++;
+                continue;
+            }
+
+            print_error("Failed to get response from upstream over TCP");
+            fw->timeout_count++;
+            fail_pending(fw, pending);
+        }
+
+        /* Kým connect() prebieha, dotazy čakajú v tx na EPOLLOUT */
+        for (unsigned int i = 0; i < FORWARDER_TCP_POOL_SIZE; i++) {
+            upstream_tcp_t *conn = &up->tcp[i];
+            if (conn->fd >= 0 && conn->connected && conn->tx_sent < conn->tx_len &&
+                tcp_flush(fw, conn) != 0) {
+                tcp_detach(fw, upstream, i, &orphans);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Pošle pending dotaz cez TCP spojenie na jeho upstream
+ * @return 0 ak je dotaz zaradený (výsledok príde cez on_reply), -1 ak TCP
+ *         nie je k dispozícii (pending ostáva nezmenený)
+ */
+static int send_over_tcp(forwarder_t *fw, pending_query_t *pending, uint64_t now_ms) {
+    if (tcp_enqueue(fw, pending, now_ms) != 0) {
+        return -1;
+    }
+
+    upstream_tcp_t *conn = &fw->upstreams[pending->upstream].tcp[pending->sock_index];
+    if (conn->connected && tcp_flush(fw, conn) != 0) {
+        tcp_fail(fw, pending->upstream, pending->sock_index);
+    }
+    return 0;
+}
+
+/**
+ * @brief Spracuje jednu odpoveď prijatú cez TCP spojenie
+ *
+ * Odpoveď väčšia ako DNS_EDNS_MAX_SIZE (buffer volajúcich aj cache) sa
+ * skráti na hlavičku a otázku s TC bitom.
+ */
+static void tcp_handle_response(forwarder_t *fw, unsigned int upstream, unsigned int index,
+                                const uint8_t *msg, size_t len) {
+    dns_header_t header;
+    if (parse_dns_header(msg, len, &header) != 0) {
+        fw->dropped_count++;
+        return;
+    }
+
+    pending_query_t *pending = fw->by_id[header.id];
+    if (pending == NULL || !pending->over_tcp || pending->upstream != upstream ||
+        pending->sock_index != index) {
+        verbose_log_raw("  Unexpected upstream TCP response (ID 0x%04X)", header.id);
+        fw->dropped_count++;
+        return;
+    }
+
+    if (check_response(fw, pending, &header, msg, len) == RESPONSE_INVALID) {
+        return;
+    }
+
+    uint8_t resp_buffer[DNS_EDNS_MAX_SIZE];
+    size_t resp_len = len;
+
+    if (len <= sizeof(resp_buffer)) {
+        memcpy(resp_buffer, msg, len);
+    } else {
+        verbose_log_raw("  Upstream TCP response too large (%zu bytes) - truncating", len);
+        resp_len = pending->question_end;
+        memcpy(resp_buffer, msg, resp_len);
+        resp_buffer[2] |= (uint8_t)(DNS_FLAG_TC >> 8);
+        memset(resp_buffer + 6, 0, 6);      /* ANCOUNT, NSCOUNT, ARCOUNT */
+    }
+
+    deliver_response(fw, pending, resp_buffer, resp_len);
+}
+
+/**
+ * @brief Jedno recv() do rx a spracovanie všetkých celých rámcov
+ */
+static void tcp_read(forwarder_t *fw, unsigned int upstream, unsigned int index) {
+    upstream_tcp_t *conn = &fw->upstreams[upstream].tcp[index];
+
+    /* Plný buffer = nekompletný rámec väčší ako rx (najviac 2 + 65535 B) */
+    if (conn->rx_len == conn->rx_cap) {
+        size_t new_cap = conn->rx_cap > 0 ? conn->rx_cap * 2 : FORWARDER_TCP_RX_INITIAL;
+        if (new_cap > DNS_TCP_MAX_SIZE + 2) {
+            new_cap = DNS_TCP_MAX_SIZE + 2;
+        }
+
+        uint8_t *rx = new_cap > conn->rx_cap ? (uint8_t *)realloc(conn->rx, new_cap) : NULL;
+        if (rx == NULL) {
+            tcp_fail(fw, upstream, index);
+            return;
+        }
+        conn->rx = rx;
+        conn->rx_cap = new_cap;
+    }
+
+    ssize_t n = recv(conn->fd, conn->rx + conn->rx_len, conn->rx_cap - conn->rx_len, 0);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+    if (n <= 0) {
+        /* Upstream zavrel spojenie (aj nečinné) - dotazy pôjdu inde */
+        verbose_log_raw("  Upstream closed TCP connection (%u queries outstanding)",
+                        conn->outstanding);
+        tcp_fail(fw, upstream, index);
+        return;
+    }
+
+    conn->rx_len += (size_t)n;
+
+    size_t pos = 0;
+    while (conn->rx_len - pos >= 2) {
+        size_t msg_len = ((size_t)conn->rx[pos] << 8) | conn->rx[pos + 1];
+        if (conn->rx_len - pos - 2 < msg_len) {
+            break;
+        }
+
+        tcp_handle_response(fw, upstream, index, conn->rx + pos + 2, msg_len);
+        pos += 2 + msg_len;
+    }
+
+    if (pos > 0) {
+        memmove(conn->rx, conn->rx + pos, conn->rx_len - pos);
+        conn->rx_len -= pos;
+    }
+}
+
+/**
+ * @brief Spracuje epoll udalosť TCP spojenia
+ */
+static void tcp_handle_event(forwarder_t *fw, unsigned int upstream, unsigned int index,
+                             uint32_t events) {
+    upstream_tcp_t *conn = &fw->upstreams[upstream].tcp[index];
+    int fd = conn->fd;
+
+    /* Dokončenie neblokujúceho connect() */
+    if (!conn->connected) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err != 0) {
+            print_error("Failed to connect to upstream over TCP: %s",
+                        strerror(err != 0 ? err : errno));
+            tcp_fail(fw, upstream, index);
+            return;
+        }
+
+        conn->connected = true;
+        events |= EPOLLOUT;
+    }
+
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        tcp_read(fw, upstream, index);
+
+        /* Spojenie zlyhalo (slot môže mať už nové, ešte nepripojené) */
+        if (conn->fd != fd) {
+            return;
+        }
+    }
+
+    if ((events & EPOLLOUT) && tcp_flush(fw, conn) != 0) {
+        tcp_fail(fw, upstream, index);
+    }
+}
+
+/**
+ * @brief Inicializuje forwarder
+ *
+ * Edge cases:
+ * - Socket creation failure
+ * - Memory allocation failure
+ */
+int forwarder_init(forwarder_t *fw, const struct sockaddr_in *upstreams, unsigned int count,
+                   uint32_t rto_max_ms, unsigned int hedge_percent, int epfd,
+                   forwarder_reply_cb_t on_reply, void *ctx) {
+    if (fw == NULL || upstreams == NULL || on_reply == NULL ||
+        count == 0 || count > DNS_MAX_UPSTREAMS) {
+        return -1;
+    }
+
+    memset(fw, 0, sizeof(*fw));
+    fw->on_reply = on_reply;
+    fw->cb_ctx = ctx;
+    fw->epfd = epfd;
+    fw->rto_max_ms = rto_max_ms;
+    fw->hedge_percent = hedge_percent;
+
+    for (unsigned int u = 0; u < count; u++) {
+        upstream_t *up = &fw->upstreams[u];
+
+        /* TCP spojenia sa otvárajú až pri prvej odpovedi s TC bitom */
+        for (unsigned int i = 0; i < FORWARDER_TCP_POOL_SIZE; i++) {
+            up->tcp[i].fd = -1;
+        }
+
+        /* Adresa je vyriešená vopred (upstream cache) - žiadny getaddrinfo() tu */
+        up->addr = upstreams[u];
+    }
+    fw->upstream_count = count;
+
+    /* Pool dlhodobých pripojených socketov s náhodnými zdrojovými portami */
+    for (unsigned int u = 0; u < count; u++) {
+        upstream_t *up = &fw->upstreams[u];
+
+        for (unsigned int i = 0; i < FORWARDER_POOL_SIZE; i++) {
+            int sockfd = open_upstream_socket(&up->addr, true);
+            if (sockfd < 0) {
+                forwarder_free(fw);
+                return -1;
+            }
+            up->socks[up->sock_count++] = sockfd;
+        }
+    }
+
+    fw->by_id = (pending_query_t **)calloc(FORWARDER_ID_SPACE, sizeof(pending_query_t *));
+    if (fw->by_id == NULL) {
+        print_error("Failed to allocate pending table");
+        forwarder_free(fw);
+        return -1;
+    }
+
+    fw->by_key = (pending_query_t **)calloc(FORWARDER_KEY_BUCKETS, sizeof(pending_query_t *));
+    if (fw->by_key == NULL) {
+        print_error("Failed to allocate pending question table");
+        forwarder_free(fw);
+        return -1;
+    }
+
+    if (timer_wheel_init(&fw->timers, TIMER_WHEEL_SLOTS, TIMER_WHEEL_TICK_MS,
+                         monotonic_ms()) != 0 ||
+        timer_wheel_init(&fw->stale_timers, TIMER_WHEEL_SLOTS, TIMER_WHEEL_TICK_MS,
+                         monotonic_ms()) != 0) {
+        print_error("Failed to initialize timer wheel");
+        forwarder_free(fw);
+        return -1;
+    }
+
+    /* Seed pre náhodné transaction ID */
+    if (getrandom(&fw->rng_state, sizeof(fw->rng_state), 0) != sizeof(fw->rng_state)) {
+        fw->rng_state = (uint32_t)monotonic_ms() ^ (uint32_t)getpid();
+    }
+    if (fw->rng_state == 0) {
+        fw->rng_state = 0x9E3779B9u;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Zapne serve-stale
+ */
+void forwarder_set_stale(forwarder_t *fw, uint32_t timeout_ms, forwarder_stale_cb_t on_stale) {
+    if (fw == NULL) {
+        return;
+    }
+
+    fw->stale_timeout_ms = timeout_ms;
+    fw->on_stale = on_stale;
+}
+
+/**
+ * @brief Presmeruje socket pool jedného upstream servera na novú adresu
+ *
+ * connect() na UDP sockete iba zmení peer adresu, takže sa zachová
+ * zdrojový port aj registrácia v epoll. TCP spojenia sa zavrú a ich
+ * dotazy sa zopakujú na spojení k novej adrese. Meranie RTT sa zahodí -
+ * nová adresa je v podstate nový server.
+ */
+int forwarder_set_upstream(forwarder_t *fw, unsigned int index,
+                           const struct sockaddr_in *upstream) {
+    if (fw == NULL || upstream == NULL || index >= fw->upstream_count) {
+        return -1;
+    }
+
+    upstream_t *up = &fw->upstreams[index];
+    if (up->addr.sin_addr.s_addr == upstream->sin_addr.s_addr &&
+        up->addr.sin_port == upstream->sin_port) {
+        return 0;
+    }
+
+    int ret = 0;
+    up->addr = *upstream;
+    memset(&up->rtt, 0, sizeof(up->rtt));
+    up->fail_score = 0;
+    up->down_until_ms = 0;
+
+    for (unsigned int i = 0; i < up->sock_count; i++) {
+        if (connect(up->socks[i], (const struct sockaddr *)upstream, sizeof(*upstream)) < 0) {
+            print_error("Failed to reconnect upstream socket: %s", strerror(errno));
+            ret = -1;
+        }
+    }
+
+    for (unsigned int i = 0; i < FORWARDER_TCP_POOL_SIZE; i++) {
+        if (up->tcp[i].fd >= 0) {
+            tcp_fail(fw, index, i);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Uvoľní forwarder
+ */
+void forwarder_free(forwarder_t *fw) {
+    if (fw == NULL) {
+        return;
+    }
+
+    for (unsigned int u = 0; u < fw->upstream_count; u++) {
+        for (unsigned int i = 0; i < FORWARDER_TCP_POOL_SIZE; i++) {
+            tcp_close(&fw->upstreams[u].tcp[i]);
+        }
+    }
+
+    if (fw->by_id != NULL) {
+        for (size_t i = 0; i < FORWARDER_ID_SPACE; i++) {
+            pending_query_t *pending = fw->by_id[i];
+            if (pending == NULL) {
+                continue;
+            }
+
+            while (pending->waiters != NULL) {
+                forwarder_waiter_t *next = pending->waiters->next;
+                free(pending->waiters);
+                pending->waiters = next;
+            }
+            free(pending);
+        }
+        free(fw->by_id);
+        fw->by_id = NULL;
+    }
+
+    free(fw->by_key);
+    fw->by_key = NULL;
+
+    while (fw->free_waiters != NULL) {
+        forwarder_waiter_t *next = fw->free_waiters->next;
+        free(fw->free_waiters);
+        fw->free_waiters = next;
+    }
+
+    while (fw->free_list != NULL) {
+        pending_query_t *next = fw->free_list->next_free;
+        free(fw->free_list);
+        fw->free_list = next;
+    }
+
+    timer_wheel_free(&fw->timers);
+    timer_wheel_free(&fw->stale_timers);
+
+    for (unsigned int u = 0; u < fw->upstream_count; u++) {
+        upstream_t *up = &fw->upstreams[u];
+
+        for (unsigned int i = 0; i < up->sock_count; i++) {
+            close(up->socks[i]);
+        }
+        up->sock_count = 0;
+    }
+
+    fw->in_flight = 0;
+}
+
+/**
+ * @brief Odošle dotaz na upstream a zaradí ho do pending tabuľky
+ *
+ * Dotaz dostane nové náhodné transaction ID (pôvodné ID klienta sa
+ * uloží), takže dotazy rôznych klientov s rovnakým ID sa nepomiešajú.
+ * Upstream sa vyberie podľa select_upstream().
+ *
+ * Edge cases:
+ * - Plná pending tabuľka
+ * - Dotaz (aj s pridaným OPT) väčší ako DNS_EDNS_UDP_SIZE
+ * - Poškodená question section alebo OPT
+ */
+int forwarder_submit(forwarder_t *fw, const uint8_t *query, size_t query_len,
+                     const dns_client_t *client) {
+    if (fw == NULL || query == NULL || client == NULL) {
+        return -1;
+    }
+
+    if (query_len < DNS_HEADER_SIZE || query_len > DNS_EDNS_UDP_SIZE) {
+        return -1;
+    }
+
+    if (fw->in_flight >= FORWARDER_MAX_PENDING) {
+        verbose_log_raw("  Pending table full (%zu queries) - rejecting", fw->in_flight);
+        return -1;
+    }
+
+    size_t question_end = find_question_end(query, query_len);
+    if (question_end == 0) {
+        return -1;
+    }
+
+    dns_edns_t edns;
+    if (dns_parse_edns(query, query_len, &edns) != 0 ||
+        (!edns.present && query_len + DNS_OPT_RR_SIZE > DNS_EDNS_UDP_SIZE)) {
+        return -1;
+    }
+
+    /* Rovnaká otázka už čaká na upstream - klient dostane tú istú odpoveď */
+    dns_cache_key_t key;
+    bool keyed = dns_cache_key_from_packet(query, query_len, &key) == 0 &&
+                 key.question_end == question_end;
+    if (keyed) {
+        pending_query_t *existing = find_keyed(fw, &key);
+        if (existing != NULL && attach_waiter(fw, existing, query, client) == 0) {
+            return (int)existing->upstream;
+        }
+    }
+
+    pending_query_t *pending = fw->free_list;
+    if (pending != NULL) {
+        fw->free_list = pending->next_free;
+    } else {
+        pending = (pending_query_t *)malloc(sizeof(pending_query_t));
+        if (pending == NULL) {
+            print_error("Failed to allocate pending query");
+            return -1;
+        }
+    }
+
+    memset(&pending->timer, 0, sizeof(pending->timer));
+    memset(&pending->stale_timer, 0, sizeof(pending->stale_timer));
+    pending->client = *client;
+    pending->over_tcp = false;
+    pending->attempts = 0;
+    pending->hedge_armed = false;
+    pending->hedge_upstream = DNS_MAX_UPSTREAMS;
+    memset(pending->sent_sock, 0, sizeof(pending->sent_sock));
+    pending->next_free = NULL;
+    pending->question_end = question_end;
+    pending->waiters = NULL;
+    pending->waiter_count = 0;
+    pending->keyed = false;
+
+    /* Náhodné voľné upstream ID (tabuľka je vždy max. z 1/16 plná) */
+    uint16_t id;
+    do {
+        id = (uint16_t)(next_random(fw) >> 16);
+    } while (fw->by_id[id] != NULL);
+
+    pending->upstream_id = id;
+    memcpy(pending->query, query, query_len);
+    pending->query_len = query_len;
+    write_id(pending->query, id);
+
+    /* Upstream smie odpovedať až DNS_EDNS_UDP_SIZE bajtov v jednom datagrame -
+     * OPT klienta dostane náš payload, inak sa pridá nový (miesto je overené) */
+    if (edns.present) {
+        pending->query[edns.opt_offset + 3] = (DNS_EDNS_UDP_SIZE >> 8) & 0xFF;
+        pending->query[edns.opt_offset + 4] = DNS_EDNS_UDP_SIZE & 0xFF;
+    } else {
+        dns_edns_t opt;
+        memset(&opt, 0, sizeof(opt));
+        opt.present = true;
+        opt.udp_size = DNS_EDNS_UDP_SIZE;
+        pending->query_len = dns_append_opt(pending->query, query_len,
+                                            sizeof(pending->query), &opt);
+    }
+
+    fw->by_id[id] = pending;
+    fw->in_flight++;
+
+    if (keyed) {
+        size_t bucket = key.hash & (FORWARDER_KEY_BUCKETS - 1);
+        pending->key = key;
+        pending->keyed = true;
+        pending->next_key = fw->by_key[bucket];
+        fw->by_key[bucket] = pending;
+    }
+
+    uint64_t now_ms = monotonic_ms();
+    pending->deadline_ms = now_ms + (uint64_t)UPSTREAM_TIMEOUT_SEC * 1000u;
+
+    if (fw->on_stale != NULL) {
+        timer_wheel_add(&fw->stale_timers, &pending->stale_timer,
+                        now_ms + fw->stale_timeout_ms);
+    }
+
+    /* Rozpočet hedgingu - hedge_percent stotín kópie za každý dotaz */
+    fw->hedge_tokens += fw->hedge_percent;
+    if (fw->hedge_tokens > FORWARDER_HEDGE_BURST * 100) {
+        fw->hedge_tokens = FORWARDER_HEDGE_BURST * 100;
+    }
+
+    send_pending(fw, pending, now_ms);
+    return (int)pending->upstream;
+}
+
+/**
+ * @brief Nájde UDP socket z poolu niektorého upstream servera
+ * @return 0 ak sa našiel (upstream a index socketu v jeho poole), inak -1
+ */
+static int find_udp(const forwarder_t *fw, int fd, unsigned int *upstream,
+                    unsigned int *index) {
+    for (unsigned int u = 0; u < fw->upstream_count; u++) {
+        for (unsigned int i = 0; i < fw->upstreams[u].sock_count; i++) {
+            if (fw->upstreams[u].socks[i] == fd) {
+                *upstream = u;
+                *index = i;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Nájde TCP spojenie niektorého upstream servera
+ * @return 0 ak sa našlo (upstream a index spojenia), inak -1
+ */
+static int find_tcp(const forwarder_t *fw, int fd, unsigned int *upstream,
+                    unsigned int *index) {
+    for (unsigned int u = 0; u < fw->upstream_count; u++) {
+        for (unsigned int i = 0; i < FORWARDER_TCP_POOL_SIZE; i++) {
+            if (fw->upstreams[u].tcp[i].fd >= 0 && fw->upstreams[u].tcp[i].fd == fd) {
+                *upstream = u;
+                *index = i;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Zistí, či file descriptor patrí forwarderu
+ */
+bool forwarder_owns_fd(const forwarder_t *fw, int fd) {
+    unsigned int upstream, index;
+
+    return fw != NULL && (find_udp(fw, fd, &upstream, &index) == 0 ||
+                          find_tcp(fw, fd, &upstream, &index) == 0);
+}
+
+/**
+ * @brief Spracuje odpovede čakajúce na UDP sockete z poolu
+ *
+ * Sockety sú connect()-nuté, takže datagramy z inej adresy ako upstream
+ * zahodí už kernel. Odpoveď sa prijme iba ak ID patrí dotazu, ktorého
+ * niektorý pokus odišiel cez ten istý socket (upstream aj zdrojový port).
+ *
+ * Edge cases:
+ * - ICMP port unreachable (ECONNREFUSED) - dotaz dobehne cez timeout
+ * - Neznáme/už vybavené transaction ID (oneskorená odpoveď po timeoute)
+ * - Odpoveď na ID z iného socketu poolu (spoofing)
+ * - Oneskorený datagram dotazu, ktorý sa už opakuje cez TCP
+ * - QR=0, príliš krátka odpoveď, nezhodná question section, poškodené RR
+ * - TC flag (dotaz sa zopakuje cez TCP, bez TCP sa odovzdá klientovi)
+ */
+static void handle_udp_readable(forwarder_t *fw, int fd, unsigned int upstream,
+                                unsigned int index) {
+    /* Väčší ako ohlásený payload - upstream, ktorý ho ignoruje, nestratí
+     * koniec odpovede (klientovi ju aj tak prispôsobí callback) */
+    uint8_t resp_buffer[DNS_EDNS_MAX_SIZE];
+
+    for (int budget = 0; budget < FORWARDER_RECV_BUDGET; budget++) {
+        ssize_t recv_len = recv(fd, resp_buffer, sizeof(resp_buffer), 0);
+
+        if (recv_len < 0) {
+            if (errno == EINTR || errno == ECONNREFUSED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                print_error("Failed to receive from upstream: %s", strerror(errno));
+            }
+            return;
+        }
+
+        dns_header_t resp_header;
+        if (parse_dns_header(resp_buffer, (size_t)recv_len, &resp_header) != 0) {
+            verbose_log_raw("  Upstream response too short (%zd bytes)", recv_len);
+            fw->dropped_count++;
+            continue;
+        }
+
+        /* Párovanie podľa transaction ID */
+        pending_query_t *pending = fw->by_id[resp_header.id];
+        if (pending == NULL || pending->over_tcp ||
+            pending->sent_sock[upstream] != index + 1) {
+            verbose_log_raw("  Unexpected upstream response (ID 0x%04X)", resp_header.id);
+            fw->dropped_count++;
+            continue;
+        }
+
+        response_check_t check = check_response(fw, pending, &resp_header,
+                                                resp_buffer, (size_t)recv_len);
+        if (check == RESPONSE_INVALID) {
+            continue;
+        }
+
+        /* Odpoveď mohla prísť na skorší pokus alebo hedged kópiu od iného servera */
+        if (upstream != pending->upstream && upstream == pending->hedge_upstream) {
+            fw->hedge_win_count++;
+        }
+        pending->upstream = upstream;
+
+        if (check == RESPONSE_TRUNCATED) {
+            /* Pokusy cez TCP sa počítajú odznova */
+            int udp_attempts = pending->attempts;
+            pending->attempts = 0;
+
+            if (send_over_tcp(fw, pending, monotonic_ms()) == 0) {
+                verbose_log_raw("  Upstream response truncated (ID 0x%04X) - retrying over TCP",
+                                resp_header.id);
+                fw->tcp_fallback_count++;
+                continue;
+            }
+
+            pending->attempts = udp_attempts;
+            verbose_log_raw("  Warning: Upstream response truncated (TC flag set)");
+        }
+
+        deliver_response(fw, pending, resp_buffer, (size_t)recv_len);
+    }
+}
+
+/**
+ * @brief Spracuje epoll udalosť upstream socketu
+ */
+void forwarder_handle_event(forwarder_t *fw, int fd, uint32_t events) {
+    if (fw == NULL) {
+        return;
+    }
+
+    unsigned int upstream, index;
+
+    if (find_udp(fw, fd, &upstream, &index) == 0) {
+        handle_udp_readable(fw, fd, upstream, index);
+        return;
+    }
+
+    if (find_tcp(fw, fd, &upstream, &index) == 0) {
+        tcp_handle_event(fw, upstream, index, events);
+    }
+}
+
+/**
+ * @brief Callback timer wheel - retransmisia po RTO alebo zlyhanie dotazu
+ */
+static void on_pending_timeout(timer_node_t *node, void *ctx) {
+    forwarder_t *fw = (forwarder_t *)ctx;
+    pending_query_t *pending = TIMER_ENTRY(node, pending_query_t, timer);
+    uint64_t now_ms = monotonic_ms();
+
+    /* p95 uplynul skôr ako RTO - nie je to timeout */
+    if (pending->hedge_armed) {
+        send_hedge(fw, pending, now_ms);
+        return;
+    }
+
+    upstream_timed_out(&fw->upstreams[pending->upstream], now_ms);
+
+    /* Cez TCP sa dotaz neopakuje - retransmisie rieši jadro */
+    if (!pending->over_tcp && now_ms < pending->deadline_ms) {
+        fw->retry_count++;
+        send_pending(fw, pending, now_ms);
+        return;
+    }
+
+    print_error("Failed to get response from upstream%s after %d attempts",
+                pending->over_tcp ? " over TCP" : "", pending->attempts);
+    fw->timeout_count++;
+
+    fail_pending(fw, pending);
+}
+
+/**
+ * @brief Ponúkne klientovi stale odpoveď, ak ešte žiadnu nedostal
+ * @return true ak klient odpoveď dostal
+ */
+static bool offer_stale(forwarder_t *fw, const dns_client_t *client,
+                        const uint8_t *query, size_t query_len) {
+    if (client->prefetch || client->answered ||
+        fw->on_stale(fw->cb_ctx, client, query, query_len) != 0) {
+        return false;
+    }
+
+    fw->stale_count++;
+    return true;
+}
+
+/**
+ * @brief Callback stale wheel - upstream nestihol termín odpovede klientom
+ *
+ * Každý čakajúci klient dostane dotaz so svojím ID a question section
+ * (kópia - pending->query ďalej slúži na retransmisie). Upstream dotaz
+ * beží ďalej a jeho odpoveď už iba obnoví cache.
+ */
+static void on_stale_timeout(timer_node_t *node, void *ctx) {
+    forwarder_t *fw = (forwarder_t *)ctx;
+    pending_query_t *pending = TIMER_ENTRY(node, pending_query_t, stale_timer);
+    uint8_t query[DNS_EDNS_UDP_SIZE];
+
+    memcpy(query, pending->query, pending->query_len);
+    write_id(query, pending->client.id);
+    if (offer_stale(fw, &pending->client, query, pending->query_len)) {
+        pending->client.answered = true;
+    }
+
+    for (forwarder_waiter_t *waiter = pending->waiters; waiter != NULL; waiter = waiter->next) {
+        patch_for_waiter(pending, waiter, query);
+        if (offer_stale(fw, &waiter->client, query, pending->query_len)) {
+            waiter->client.answered = true;
+        }
+    }
+}
+
+/**
+ * @brief Spracuje expirované timeouty
+ */
+void forwarder_process_timeouts(forwarder_t *fw, uint64_t now_ms) {
+    if (fw == NULL) {
+        return;
+    }
+
+    timer_wheel_advance(&fw->timers, now_ms, on_pending_timeout, fw);
+    timer_wheel_advance(&fw->stale_timers, now_ms, on_stale_timeout, fw);
+}
+
+/**
+ * @brief Vráti timeout pre epoll_wait
+ */
+int forwarder_timeout_ms(const forwarder_t *fw, uint64_t now_ms, int max_ms) {
+    if (fw == NULL) {
+        return max_ms;
+    }
+
+    int timeout = timer_wheel_timeout_ms(&fw->timers, now_ms, max_ms);
+    return timer_wheel_timeout_ms(&fw->stale_timers, now_ms, timeout);
+}
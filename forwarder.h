@@ -0,0 +1,365 @@
+/**
+ * @file forwarder.h
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Asynchrónne preposielanie na upstream
+ */
+
+#ifndef FORWARDER_H
+#define FORWARDER_H
+
+#include "dns.h"
+#include "cache.h"
+#include "resolver.h"
+#include "timer_wheel.h"
+
+#include <netinet/in.h>
+
+/* Maximálny počet rozpracovaných upstream dotazov na jedného workera */
+#define FORWARDER_MAX_PENDING   4096
+
+/* Veľkosť priestoru transaction ID (16 bitov) */
+#define FORWARDER_ID_SPACE      65536
+
+/* Počet pripojených upstream socketov na jedného workera */
+#define FORWARDER_POOL_SIZE     4
+
+/* Maximálny počet odpovedí spracovaných v jednom volaní (fairness) */
+#define FORWARDER_RECV_BUDGET   64
+
+/* Počet perzistentných TCP spojení na upstream (dotazy s TC odpoveďou) */
+#define FORWARDER_TCP_POOL_SIZE 2
+
+/* Počiatočná veľkosť prijímacieho bufferu TCP spojenia */
+#define FORWARDER_TCP_RX_INITIAL 4096
+
+/* Po toľkých vypršaných RTO za sebou sa upstream dočasne vyradí z výberu */
+#define FORWARDER_FAIL_LIMIT    3
+
+/* Prvé vyradenie (ms), každý ďalší timeout ho zdvojnásobí až po maximum */
+#define FORWARDER_DOWN_MS       2000
+#define FORWARDER_DOWN_MAX_MS   60000
+
+/* Upstream bez dotazu tak dlho dostane ďalší dotaz (obnova merania RTT) */
+#define FORWARDER_PROBE_MS      15000
+
+/* Histogram latencie dotazov: 4 buckety na každú mocninu dvoch (µs) */
+#define FORWARDER_LATENCY_BUCKETS 128
+
+/* Po toľkých meraniach sa histogram prepolí (p95 sleduje aktuálny stav) */
+#define FORWARDER_LATENCY_WINDOW 1024
+
+/* Hedging začne až s toľkými meraniami v histograme */
+#define FORWARDER_HEDGE_MIN_SAMPLES 64
+
+/* Najviac toľko hedged dotazov naraz z ušetreného rozpočtu (burst) */
+#define FORWARDER_HEDGE_BURST   10
+
+/* Termín odpovede klientovi pri serve-stale (RFC 8767 client response timer) */
+#define FORWARDER_STALE_TIMEOUT_MS 400
+
+/* Počet bucketov tabuľky rozpracovaných otázok (mocnina dvoch) */
+#define FORWARDER_KEY_BUCKETS   4096
+
+/* Najviac toľko klientov čaká na jeden upstream dotaz, ďalší dostanú nový */
+#define FORWARDER_MAX_WAITERS   256
+
+/**
+ * @brief Identifikácia klienta, ktorému patrí odpoveď
+ */
+typedef struct {
+    struct sockaddr_in addr;    /* Adresa klienta */
+    uint16_t id;                /* Pôvodné transaction ID klienta */
+    dns_edns_t edns;            /* EDNS z dotazu (payload, DO bit) */
+    uint32_t tcp_conn;          /* TCP spojenie (index + 1), 0 = UDP klient */
+    uint32_t tcp_gen;           /* Generácia TCP spojenia (zaniklo medzičasom?) */
+    bool prefetch;              /* Obnova cache na pozadí - odpoveď sa iba uloží */
+    bool answered;              /* Klient už dostal stale odpoveď - odpoveď sa iba uloží */
+} dns_client_t;
+
+/**
+ * @brief Klient pripojený k rozpracovanému dotazu na rovnakú otázku
+ */
+typedef struct forwarder_waiter {
+    dns_client_t client;            /* Komu patrí odpoveď */
+    uint8_t question[DNS_MAX_NAME_LEN + 5]; /* Question section klienta (veľkosť písmen) */
+    struct forwarder_waiter *next;  /* Ďalší čakajúci (alebo free-list) */
+} forwarder_waiter_t;
+
+/**
+ * @brief Rozpracovaný upstream dotaz (záznam v pending tabuľke)
+ */
+typedef struct pending_query {
+    timer_node_t timer;             /* Timeout aktuálneho pokusu */
+    timer_node_t stale_timer;       /* Termín odpovede klientom (serve-stale) */
+    dns_client_t client;            /* Komu patrí odpoveď */
+    uint16_t upstream_id;           /* Transaction ID smerom k upstream */
+    unsigned int upstream;          /* Upstream server aktuálneho pokusu */
+    unsigned int sock_index;        /* Socket z poolu (alebo TCP spojenie), cez ktorý šiel dotaz */
+    uint8_t sent_sock[DNS_MAX_UPSTREAMS]; /* Socket (index + 1) každého servera, na ktorý
+                                     * dotaz odišiel (odpoveď na skorší pokus platí) */
+    bool over_tcp;                  /* Dotaz sa opakuje cez TCP (odpoveď mala TC bit) */
+    bool hedge_armed;               /* Časovač beží do hedged odoslania, nie do RTO */
+    unsigned int hedge_upstream;    /* Server hedged kópie (DNS_MAX_UPSTREAMS = žiadna) */
+    uint8_t query[DNS_EDNS_UDP_SIZE]; /* Kópia dotazu (s upstream_id a OPT) */
+    size_t query_len;               /* Dĺžka dotazu */
+    size_t question_end;            /* Offset konca question section */
+    int attempts;                   /* Počet odoslaní */
+    uint64_t sent_us;               /* Čas posledného odoslania (meranie RTT) */
+    uint64_t first_sent_us;         /* Čas prvého odoslania (latencia dotazu) */
+    uint64_t rto_expires_ms;        /* RTO prvého pokusu (po hedged odoslaní) */
+    uint64_t deadline_ms;           /* Koniec retransmisií (UPSTREAM_TIMEOUT_SEC) */
+    dns_cache_key_t key;            /* (QNAME, QTYPE, QCLASS, DO, CD) pre coalescing */
+    bool keyed;                     /* Záznam je v tabuľke by_key */
+    forwarder_waiter_t *waiters;    /* Klienti s rovnakou otázkou (dostanú kópiu odpovede) */
+    unsigned int waiter_count;      /* Počet čakajúcich */
+    struct pending_query *next_key; /* Ďalší záznam v buckete by_key */
+    struct pending_query *tcp_prev; /* Dotazy na rovnakom TCP spojení (over_tcp) */
+    struct pending_query *tcp_next;
+    struct pending_query *next_free; /* Free-list (iba keď je voľný) */
+} pending_query_t;
+
+/**
+ * @brief Perzistentné TCP spojenie na upstream (RFC 7766)
+ *
+ * Dotazy sa na spojení pipelinujú s rovnakým upstream ID ako cez UDP,
+ * odpovede môžu prísť v ľubovoľnom poradí a párujú sa cez pending tabuľku.
+ */
+typedef struct {
+    int fd;                         /* Socket, -1 = zatvorené */
+    bool connected;                 /* Neblokujúci connect() dokončený */
+    uint32_t events;                /* Aktuálne epoll udalosti */
+    uint8_t *rx;                    /* Prijaté, ešte nespracované bajty */
+    size_t rx_len;                  /* Počet bajtov v rx */
+    size_t rx_cap;                  /* Veľkosť rx */
+    uint8_t *tx;                    /* Rámce čakajúce na odoslanie */
+    size_t tx_len;                  /* Počet bajtov v tx */
+    size_t tx_sent;                 /* Už odoslaná časť tx */
+    size_t tx_cap;                  /* Veľkosť tx */
+    unsigned int outstanding;       /* Dotazy čakajúce na odpoveď */
+    pending_query_t *queries;       /* Tie isté dotazy (zoznam cez tcp_next) */
+} upstream_tcp_t;
+
+/**
+ * @brief Jeden upstream server - sockety, zdravie a štatistiky
+ *
+ * rtt je SRTT/RTTVAR (RFC 6298) z odpovedí na prvý pokus - pri retransmisii
+ * nie je jasné, ktorému odoslaniu odpoveď patrí (Karnov algoritmus). Z neho
+ * sa počíta RTO pokusov aj poradie pri výbere servera. Každé vypršané RTO
+ * zdvojnásobí skóre servera (srtt << fail_score), takže upstream, ktorý
+ * prestane odpovedať, stratí prednosť hneď; po FORWARDER_FAIL_LIMIT RTO za
+ * sebou sa vyradí úplne (s exponenciálne rastúcim intervalom).
+ */
+typedef struct {
+    struct sockaddr_in addr;        /* Adresa servera */
+    int socks[FORWARDER_POOL_SIZE]; /* Pool pripojených UDP socketov */
+    unsigned int sock_count;        /* Počet otvorených socketov v poole */
+    upstream_tcp_t tcp[FORWARDER_TCP_POOL_SIZE]; /* TCP spojenia (TC fallback) */
+    upstream_rtt_t rtt;             /* SRTT a RTTVAR (srtt_us 0 = bez merania) */
+    unsigned int fail_score;        /* Vypršané RTO za sebou (odpoveď nuluje) */
+    uint64_t down_until_ms;         /* Vyradený z výberu do tohto času */
+    uint64_t last_used_ms;          /* Posledný dotaz (sonda po FORWARDER_PROBE_MS) */
+
+    /* Štatistiky */
+    unsigned long query_count;      /* Odoslané pokusy (UDP aj TCP) */
+    unsigned long answer_count;     /* Doručené odpovede */
+    unsigned long timeout_count;    /* Vypršané RTO (pokusy bez odpovede) */
+    uint64_t rtt_sum_us;            /* Súčet meraní RTT (priemerná latencia) */
+    unsigned long rtt_samples;      /* Počet meraní RTT */
+} upstream_t;
+
+/**
+ * @brief Callback pre doručenie výsledku klientovi
+ * @param ctx Kontext z forwarder_init()
+ * @param client Klient (adresa alebo TCP spojenie + pôvodné ID)
+ * @param query Pôvodný dotaz (ID už obnovené na ID klienta)
+ * @param query_len Dĺžka dotazu
+ * @param response Odpoveď upstream (ID už prepísané, buffer veľkosti
+ *                 DNS_EDNS_MAX_SIZE - callback ju smie upraviť), NULL pri zlyhaní
+ * @param resp_len Dĺžka odpovede
+ */
+typedef void (*forwarder_reply_cb_t)(void *ctx, const dns_client_t *client,
+                                     const uint8_t *query, size_t query_len,
+                                     uint8_t *response, size_t resp_len);
+
+/**
+ * @brief Callback po termíne odpovede klientovi (serve-stale)
+ * @param ctx Kontext z forwarder_init()
+ * @param client Klient, ktorý ešte nedostal odpoveď
+ * @param query Dotaz klienta (ID a question section klienta)
+ * @param query_len Dĺžka dotazu
+ * @return 0 ak klient dostal stale odpoveď, -1 ak čaká ďalej na upstream
+ *
+ * Ak klient odpoveď dostal, upstream dotaz beží ďalej a jeho výsledok
+ * príde cez on_reply s client->answered = true (iba obnova cache).
+ */
+typedef int (*forwarder_stale_cb_t)(void *ctx, const dns_client_t *client,
+                                    const uint8_t *query, size_t query_len);
+
+/**
+ * @brief Stav asynchrónneho forwardera (jeden na workera)
+ *
+ * Každý pokus ide na najrýchlejší nevyradený upstream (viď upstream_t) a
+ * rozkladá sa na jeho pool dlhodobých neblokujúcich UDP socketov
+ * (connect()-nutých, každý s náhodným zdrojovým portom). Dotazy sú v
+ * pending tabuľke indexovanej upstream transaction ID, odpovede sa párujú
+ * podľa ID, servera a socketu, timeouty rieši timer wheel - žiadne
+ * blokovanie event loopu ani socket() pre každý dotaz. Pokus, na ktorý
+ * nepríde odpoveď do RTO (SRTT + 4*RTTVAR servera, pri každom ďalšom pokuse
+ * dvojnásobné až po rto_max_ms), sa zopakuje - stratený paket tak stojí
+ * milisekundy, nie celý UPSTREAM_TIMEOUT_SEC. Retransmisia si upstream
+ * vyberá znova, takže obíde server, ktorý prestal odpovedať.
+ *
+ * Dotaz na otázku (QNAME, QTYPE, QCLASS), na ktorú už upstream dotaz beží,
+ * sa neodošle znova - klient sa pripojí k rozpracovanému dotazu ako
+ * waiter a odpoveď dostane každý klient s vlastným ID a question section
+ * (coalescing, ochrana pred thundering herd po expirácii populárneho záznamu).
+ *
+ * Hedging (hedge_percent > 0): ak na prvý pokus nepríde odpoveď do p95
+ * latencie dotazov (histogram latency_hist), odíde kópia dotazu na iný
+ * server (alebo na ten istý, ak iný nie je) a platí prvá odpoveď. Počet
+ * kópií obmedzuje token bucket - každý dotaz pridá hedge_percent tokenov,
+ * kópia stojí 100.
+ *
+ * Serve-stale (forwarder_set_stale()): ak upstream neodpovie do
+ * stale_timeout_ms, každý čakajúci klient dostane šancu na stale odpoveď
+ * z cache (on_stale) a upstream dotaz potom iba obnoví cache.
+ *
+ * Odpoveď s TC bitom sa klientovi neodovzdá - dotaz sa zopakuje cez jedno
+ * z perzistentných TCP spojení (otvárajú sa až pri prvej potrebe), takže
+ * veľká odpoveď stojí jeden RTT navyše, nie TCP handshake na každý dotaz.
+ */
+typedef struct {
+    upstream_t upstreams[DNS_MAX_UPSTREAMS]; /* Upstream servery (poradie -s) */
+    unsigned int upstream_count;    /* Počet upstream serverov */
+    int epfd;                       /* epoll workera (registrácia TCP spojení) */
+    uint32_t rto_max_ms;            /* Strop RTO po backoffe */
+    unsigned int hedge_percent;     /* Rozpočet hedged kópií v % dotazov, 0 = vypnuté */
+    unsigned int hedge_tokens;      /* Token bucket (100 = jedna kópia) */
+    uint32_t latency_hist[FORWARDER_LATENCY_BUCKETS]; /* Latencie dotazov (µs) */
+    uint32_t latency_samples;       /* Počet meraní v histograme */
+    uint32_t hedge_delay_us;        /* Aktuálny p95 z histogramu */
+    pending_query_t **by_id;        /* Pending tabuľka [FORWARDER_ID_SPACE] */
+    pending_query_t **by_key;       /* Rozpracované otázky [FORWARDER_KEY_BUCKETS] */
+    pending_query_t *free_list;     /* Recyklované záznamy */
+    forwarder_waiter_t *free_waiters; /* Recyklovaní čakajúci */
+    uint8_t reply_copy[DNS_EDNS_MAX_SIZE]; /* Nezmenená odpoveď pre ďalších čakajúcich */
+    size_t in_flight;               /* Počet rozpracovaných dotazov */
+    timer_wheel_t timers;           /* Timeouty pokusov */
+    timer_wheel_t stale_timers;     /* Termíny odpovede klientom (serve-stale) */
+    uint32_t stale_timeout_ms;      /* Termín odpovede klientovi, 0 = serve-stale vypnuté */
+    uint32_t rng_state;             /* xorshift32 pre náhodné ID */
+    forwarder_reply_cb_t on_reply;  /* Doručenie výsledku */
+    forwarder_stale_cb_t on_stale;  /* Stale odpoveď po termíne (NULL = vypnuté) */
+    void *cb_ctx;                   /* Kontext pre on_reply a on_stale */
+
+    /* Štatistiky */
+    unsigned long sent_count;       /* Odoslané pakety (vrátane retry) */
+    unsigned long retry_count;      /* Retransmisie po vypršanom RTO */
+    unsigned long timeout_count;    /* Dotazy bez odpovede (SERVFAIL) */
+    unsigned long dropped_count;    /* Zahodené neplatné/neočakávané odpovede */
+    unsigned long tcp_fallback_count; /* Dotazy zopakované cez TCP (TC bit) */
+    unsigned long tcp_connect_count; /* Otvorené TCP spojenia na upstream */
+    unsigned long hedge_count;      /* Odoslané hedged kópie */
+    unsigned long hedge_win_count;  /* Odpovede, v ktorých vyhral iný server z hedgingu */
+    unsigned long coalesced_count;  /* Dotazy pripojené k rozpracovanému dotazu */
+    unsigned long stale_count;      /* Klienti zodpovedaní stale odpoveďou po termíne */
+} forwarder_t;
+
+/**
+ * @brief Inicializuje forwarder
+ * @param fw Forwarder
+ * @param upstreams Adresy upstream serverov (už vyriešené, viď upstream_cache_get())
+ * @param count Počet serverov (1..DNS_MAX_UPSTREAMS)
+ * @param rto_max_ms Strop RTO retransmisií (ms, viď upstream_rtt_rto_ms())
+ * @param hedge_percent Rozpočet hedged kópií v % dotazov (0 = bez hedgingu)
+ * @param epfd epoll workera - TCP spojenia sa doň registrujú samé (UDP pool
+ *             registruje volajúci)
+ * @param on_reply Callback pre doručenie odpovedí
+ * @param ctx Kontext pre callback
+ * @return 0 pri úspechu, -1 pri chybe
+ */
+int forwarder_init(forwarder_t *fw, const struct sockaddr_in *upstreams, unsigned int count,
+                   uint32_t rto_max_ms, unsigned int hedge_percent, int epfd,
+                   forwarder_reply_cb_t on_reply, void *ctx);
+
+/**
+ * @brief Zapne serve-stale - termín odpovede klientovi (RFC 8767)
+ * @param fw Forwarder
+ * @param timeout_ms Po toľkých ms bez odpovede upstream sa zavolá on_stale
+ * @param on_stale Callback, ktorý klientovi pošle stale odpoveď (kontext ako on_reply)
+ */
+void forwarder_set_stale(forwarder_t *fw, uint32_t timeout_ms, forwarder_stale_cb_t on_stale);
+
+/**
+ * @brief Presmeruje sockety upstream servera na novú adresu
+ * @param fw Forwarder
+ * @param index Poradie servera
+ * @param upstream Nová adresa servera (rovnaká adresa = no-op)
+ * @return 0 pri úspechu, -1 ak sa niektorý socket nepodarilo pripojiť
+ *
+ * UDP sockety sa iba znovu connect()-nú (file descriptory v epoll ostávajú).
+ * Rozpracované dotazy na starú adresu dobehnú cez retry na novú, TCP
+ * spojenia sa zatvoria a ich dotazy sa zopakujú na novom spojení.
+ */
+int forwarder_set_upstream(forwarder_t *fw, unsigned int index,
+                           const struct sockaddr_in *upstream);
+
+/**
+ * @brief Uvoľní forwarder (rozpracované dotazy sa zahodia)
+ * @param fw Forwarder
+ */
+void forwarder_free(forwarder_t *fw);
+
+/**
+ * @brief Odošle dotaz na upstream a zaradí ho do pending tabuľky
+ * @param fw Forwarder
+ * @param query Surový DNS dotaz od klienta
+ * @param query_len Dĺžka dotazu
+ * @param client Klient, ktorému patrí odpoveď
+ * @return Poradie vybraného upstream servera (>= 0), -1 ak je tabuľka plná
+ *         alebo dotaz neplatný
+ *
+ * Ak na rovnakú otázku už beží upstream dotaz, klient sa k nemu iba
+ * pripojí (vráti sa server rozpracovaného dotazu).
+ *
+ * Dotaz smerom k upstream vždy ohlasuje EDNS payload DNS_EDNS_UDP_SIZE
+ * (OPT sa pridá alebo prepíše). Výsledok (odpoveď alebo zlyhanie) sa
+ * doručí cez on_reply callback.
+ */
+int forwarder_submit(forwarder_t *fw, const uint8_t *query, size_t query_len,
+                     const dns_client_t *client);
+
+/**
+ * @brief Zistí, či file descriptor patrí forwarderu (UDP pool alebo TCP spojenie)
+ * @param fw Forwarder
+ * @param fd File descriptor z epoll
+ * @return true ak ide o upstream socket
+ */
+bool forwarder_owns_fd(const forwarder_t *fw, int fd);
+
+/**
+ * @brief Spracuje epoll udalosť upstream socketu
+ * @param fw Forwarder
+ * @param fd Socket forwardera (viď forwarder_owns_fd())
+ * @param events Udalosti (EPOLLIN, EPOLLOUT, ...)
+ */
+void forwarder_handle_event(forwarder_t *fw, int fd, uint32_t events);
+
+/**
+ * @brief Spracuje expirované timeouty (retry alebo zlyhanie)
+ * @param fw Forwarder
+ * @param now_ms Aktuálny monotónny čas
+ */
+void forwarder_process_timeouts(forwarder_t *fw, uint64_t now_ms);
+
+/**
+ * @brief Vráti timeout pre epoll_wait
+ * @param fw Forwarder
+ * @param now_ms Aktuálny monotónny čas
+ * @param max_ms Horná hranica
+ * @return Timeout v ms
+ */
+int forwarder_timeout_ms(const forwarder_t *fw, uint64_t now_ms, int max_ms);
+
+#endif /* FORWARDER_H */
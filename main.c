@@ -11,6 +11,7 @@
 #include "dns_builder.h"
 #include "filter.h"
 #include "resolver.h"
+#include "cache.h"
 #include "utils.h"
 
 #include <stdio.h>
@@ -23,6 +24,17 @@
 /* Globálna konfigurácia pre signal handling */
 static server_config_t *g_config = NULL;
 
+/**
+ * @brief Uvoľní zoznam upstream serverov z konfigurácie
+ */
+static void free_upstreams(server_config_t *config) {
+    for (unsigned int i = 0; i < config->upstream_count; i++) {
+        free(config->upstream_servers[i]);
+        config->upstream_servers[i] = NULL;
+    }
+    config->upstream_count = 0;
+}
+
 /**
  * @brief Signal handler pre SIGINT (Ctrl+C) a SIGTERM
  */
@@ -36,12 +48,11 @@ void signal_handler(int signum) {
         if (g_config->filter_root != NULL) {
             filter_node_free(g_config->filter_root);
         }
-        if (g_config->upstream_server != NULL) {
-            free(g_config->upstream_server);
-        }
+        free_upstreams(g_config);
         if (g_config->filter_file != NULL) {
             free(g_config->filter_file);
         }
+        free(g_config->cache_file);
         free(g_config);
     }
     
@@ -59,22 +70,63 @@ server_config_t *init_config(void) {
     }
     
     /* Defaultné hodnoty */
-    config->upstream_server = NULL;
+    memset(config->upstream_servers, 0, sizeof(config->upstream_servers));
+    config->upstream_count = 0;
     config->local_port = DNS_DEFAULT_PORT;
     config->filter_file = NULL;
+    config->filter_compiled = false;
+    config->filter_watch = false;
     config->verbose = false;
+    config->num_threads = DNS_DEFAULT_THREADS;
+    config->batch_size = DNS_DEFAULT_BATCH;
+    config->upstream_refresh_sec = UPSTREAM_REFRESH_SEC;
+    config->rto_max_ms = UPSTREAM_RTO_MAX_MS;
+    config->hedge_percent = 0;
+    config->cache_size_mb = DNS_CACHE_DEFAULT_MB;
+    config->negative_cache_mb = DNS_CACHE_NEGATIVE_DEFAULT_MB;
+    config->stale_sec = 0;
+    config->cache_file = NULL;
     config->filter_root = NULL;
     
     return config;
 }
 
+/**
+ * @brief Režim --compile-filter: textový filter -> prekompilovaný súbor
+ * @return Návratový kód programu
+ */
+static int compile_filter(const char *in_path, const char *out_path) {
+    filter_node_t *root = load_filter_file(in_path, false);
+    if (root == NULL) {
+        print_error("Failed to load filter file: %s", in_path);
+        return ERR_FILTER_FILE;
+    }
+
+    if (filter_compact(root) != 0) {
+        print_error("Failed to compact filter: %s", in_path);
+        filter_node_free(root);
+        return ERR_MEMORY;
+    }
+
+    if (filter_save_compiled(root, out_path) != 0) {
+        filter_node_free(root);
+        return ERR_FILTER_FILE;
+    }
+
+    printf("Compiled %zu domains into %s (%zu bytes)\n",
+           filter_domain_count(root), out_path, filter_memory_usage(root));
+    filter_node_free(root);
+    return ERR_SUCCESS;
+}
+
 /**
  * @brief Parsuje command-line argumenty
  * 
  * Edge cases:
- * - Chýbajúce povinné parametre (-s, -f)
+ * - Chýbajúce povinné parametre (-s, -f alebo -F)
  * - Duplicitné parametre
  * - Neplatné číslo portu (0, > 65535, neplatný formát)
+ * - Neplatný počet vlákien (0, > DNS_MAX_THREADS, neplatný formát)
  * - Neexistujúci filter súbor (kontrola až pri načítaní)
  * - Neznáme parametre
  * - Prázdne hodnoty parametrov
@@ -85,23 +137,30 @@ int parse_arguments(int argc, char *argv[], server_config_t *config) {
     bool has_filter = false;
     
     /* getopt pre parsing argumentov */
-    while ((opt = getopt(argc, argv, "s:p:f:vh")) != -1) {
+    while ((opt = getopt(argc, argv, "s:p:f:F:t:b:r:T:H:c:n:S:C:wvh")) != -1) {
         switch (opt) {
             case 's':
-                /* Upstream server */
-                if (has_server) {
-                    print_error("Duplicate -s parameter");
-                    return -1;
-                }
+                /* Upstream server (opakovateľný - zoznam v poradí zadania) */
                 if (optarg == NULL || strlen(optarg) == 0) {
                     print_error("Empty server address");
                     return -1;
                 }
-                config->upstream_server = strdup(optarg);
-                if (config->upstream_server == NULL) {
+                if (config->upstream_count >= DNS_MAX_UPSTREAMS) {
+                    print_error("Too many upstream servers (max %d)", DNS_MAX_UPSTREAMS);
+                    return -1;
+                }
+                for (unsigned int i = 0; i < config->upstream_count; i++) {
+                    if (strcmp(config->upstream_servers[i], optarg) == 0) {
+                        print_error("Duplicate upstream server: %s", optarg);
+                        return -1;
+                    }
+                }
+                config->upstream_servers[config->upstream_count] = strdup(optarg);
+                if (config->upstream_servers[config->upstream_count] == NULL) {
                     print_error("Memory allocation failed for server address");
                     return -1;
                 }
+                config->upstream_count++;
                 has_server = true;
                 break;
                 
@@ -134,10 +193,215 @@ int parse_arguments(int argc, char *argv[], server_config_t *config) {
                 }
                 break;
                 
+            case 't': {
+                /* Počet worker vlákien */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty thread count");
+                    return -1;
+                }
+                
+                char *endptr;
+                long threads = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid thread count: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (threads <= 0 || threads > DNS_MAX_THREADS) {
+                    print_error("Thread count out of range: %ld (must be 1-%d)",
+                                threads, DNS_MAX_THREADS);
+                    return -1;
+                }
+                
+                config->num_threads = (unsigned int)threads;
+                break;
+            }
+                
+            case 'b': {
+                /* Veľkosť dávky pre recvmmsg/sendmmsg */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty batch size");
+                    return -1;
+                }
+                
+                char *endptr;
+                long batch = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid batch size: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (batch <= 0 || batch > DNS_MAX_BATCH) {
+                    print_error("Batch size out of range: %ld (must be 1-%d)",
+                                batch, DNS_MAX_BATCH);
+                    return -1;
+                }
+                
+                config->batch_size = (unsigned int)batch;
+                break;
+            }
+                
+            case 'r': {
+                /* Interval obnovy upstream adresy (0 = iba pri štarte) */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty refresh interval");
+                    return -1;
+                }
+                
+                char *endptr;
+                long interval = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid refresh interval: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (interval < 0 || interval > 86400) {
+                    print_error("Refresh interval out of range: %ld (must be 0-86400)",
+                                interval);
+                    return -1;
+                }
+                
+                config->upstream_refresh_sec = (unsigned int)interval;
+                break;
+            }
+                
+            case 'T': {
+                /* Strop RTO po exponenciálnom backoffe (celkový limit ostáva
+                 * UPSTREAM_TIMEOUT_SEC) */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty RTO cap");
+                    return -1;
+                }
+                
+                char *endptr;
+                long rto_max = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid RTO cap: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (rto_max < UPSTREAM_RTO_MIN_MS || rto_max > UPSTREAM_TIMEOUT_SEC * 1000) {
+                    print_error("RTO cap out of range: %ld (must be %d-%d ms)", rto_max,
+                                UPSTREAM_RTO_MIN_MS, UPSTREAM_TIMEOUT_SEC * 1000);
+                    return -1;
+                }
+                
+                config->rto_max_ms = (unsigned int)rto_max;
+                break;
+            }
+                
+            case 'H': {
+                /* Rozpočet hedged kópií dotazov (% z preposlaných dotazov) */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty hedge budget");
+                    return -1;
+                }
+                
+                char *endptr;
+                long percent = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid hedge budget: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (percent < 0 || percent > 100) {
+                    print_error("Hedge budget out of range: %ld (must be 0-100)", percent);
+                    return -1;
+                }
+                
+                config->hedge_percent = (unsigned int)percent;
+                break;
+            }
+                
+            case 'c': {
+                /* Kvóta cache odpovedí v MB (0 = vypnutá) */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty cache size");
+                    return -1;
+                }
+                
+                char *endptr;
+                long size_mb = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid cache size: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (size_mb < 0 || size_mb > 4096) {
+                    print_error("Cache size out of range: %ld MB (must be 0-4096)", size_mb);
+                    return -1;
+                }
+                
+                config->cache_size_mb = (unsigned int)size_mb;
+                break;
+            }
+                
+            case 'n': {
+                /* Kvóta negatívnych odpovedí (NXDOMAIN / NODATA) v MB */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty negative cache size");
+                    return -1;
+                }
+                
+                char *endptr;
+                long size_mb = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid negative cache size: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (size_mb < 0 || size_mb > 4096) {
+                    print_error("Negative cache size out of range: %ld MB (must be 0-4096)", size_mb);
+                    return -1;
+                }
+                
+                config->negative_cache_mb = (unsigned int)size_mb;
+                break;
+            }
+                
+            case 'S': {
+                /* Ako dlho po TTL sa smie odpovedať z cache, ak upstream nestíha */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty serve-stale window");
+                    return -1;
+                }
+                
+                char *endptr;
+                long stale = strtol(optarg, &endptr, 10);
+                
+                if (*endptr != '\0') {
+                    print_error("Invalid serve-stale window: '%s' (non-numeric characters)", optarg);
+                    return -1;
+                }
+                if (stale < 0 || stale > DNS_CACHE_MAX_STALE_SEC) {
+                    print_error("Serve-stale window out of range: %ld s (must be 0-%d)",
+                                stale, DNS_CACHE_MAX_STALE_SEC);
+                    return -1;
+                }
+                
+                config->stale_sec = (unsigned int)stale;
+                break;
+            }
+                
+            case 'C':
+                /* Snapshot cache - načíta sa pri štarte, zapíše periodicky a pri ukončení */
+                if (optarg == NULL || strlen(optarg) == 0) {
+                    print_error("Empty cache snapshot path");
+                    return -1;
+                }
+                free(config->cache_file);
+                config->cache_file = strdup(optarg);
+                if (config->cache_file == NULL) {
+                    print_error("Memory allocation failed for cache snapshot path");
+                    return -1;
+                }
+                break;
+                
             case 'f':
-                /* Filter file */
+            case 'F':
+                /* Filter file (-F = prekompilovaný, mmap) */
                 if (has_filter) {
-                    print_error("Duplicate -f parameter");
+                    print_error("Duplicate -f/-F parameter");
                     return -1;
                 }
                 if (optarg == NULL || strlen(optarg) == 0) {
@@ -149,9 +413,15 @@ int parse_arguments(int argc, char *argv[], server_config_t *config) {
                     print_error("Memory allocation failed for filter file path");
                     return -1;
                 }
+                config->filter_compiled = (opt == 'F');
                 has_filter = true;
                 break;
                 
+            case 'w':
+                /* Sledovanie filter súboru (reload bez SIGHUP) */
+                config->filter_watch = true;
+                break;
+                
             case 'v':
                 /* Verbose mode */
                 config->verbose = true;
@@ -189,7 +459,7 @@ int parse_arguments(int argc, char *argv[], server_config_t *config) {
     }
     
     if (!has_filter) {
-        print_error("Missing required parameter: -f (filter file)");
+        print_error("Missing required parameter: -f or -F (filter file)");
         print_usage(argv[0]);
         return -1;
     }
@@ -203,6 +473,15 @@ int parse_arguments(int argc, char *argv[], server_config_t *config) {
 int main(int argc, char *argv[]) {
     int ret = ERR_SUCCESS;
     
+    /* Samostatný režim: dns --compile-filter in.txt out.bin */
+    if (argc >= 2 && strcmp(argv[1], "--compile-filter") == 0) {
+        if (argc != 4) {
+            print_error("Usage: %s --compile-filter in.txt out.bin", argv[0]);
+            return ERR_INVALID_ARGS;
+        }
+        return compile_filter(argv[2], argv[3]);
+    }
+    
     /* Inicializácia konfigurácie */
     g_config = init_config();
     if (g_config == NULL) {
@@ -218,25 +497,44 @@ int main(int argc, char *argv[]) {
             return ERR_SUCCESS;
         }
         /* Chyba pri parsovaní */
-        if (g_config->upstream_server != NULL) free(g_config->upstream_server);
+        free_upstreams(g_config);
         if (g_config->filter_file != NULL) free(g_config->filter_file);
+        free(g_config->cache_file);
         free(g_config);
         return ERR_INVALID_ARGS;
     }
     
     /* Verbose output */
     verbose_log(g_config, "DNS Resolver starting...");
-    verbose_log(g_config, "Upstream server: %s", g_config->upstream_server);
+    for (unsigned int i = 0; i < g_config->upstream_count; i++) {
+        verbose_log(g_config, "Upstream server: %s", g_config->upstream_servers[i]);
+    }
     verbose_log(g_config, "Local port: %u", g_config->local_port);
-    verbose_log(g_config, "Filter file: %s", g_config->filter_file);
+    verbose_log(g_config, "Worker threads: %u", g_config->num_threads);
+    verbose_log(g_config, "I/O batch size: %u", g_config->batch_size);
+    verbose_log(g_config, "Upstream refresh interval: %u s", g_config->upstream_refresh_sec);
+    verbose_log(g_config, "Upstream RTO cap: %u ms", g_config->rto_max_ms);
+    verbose_log(g_config, "Hedged requests: %u%% budget", g_config->hedge_percent);
+    verbose_log(g_config, "Response cache: %u MB (+%u MB negative)",
+                g_config->cache_size_mb, g_config->negative_cache_mb);
+    verbose_log(g_config, "Serve-stale window: %u s", g_config->stale_sec);
+    if (g_config->cache_file != NULL) {
+        verbose_log(g_config, "Cache snapshot: %s (every %d s)", g_config->cache_file,
+                    DNS_CACHE_SNAPSHOT_SEC);
+    }
+    verbose_log(g_config, "Filter file: %s%s", g_config->filter_file,
+                g_config->filter_compiled ? " (compiled)" : "");
+    verbose_log(g_config, "Filter reload: SIGHUP%s", g_config->filter_watch ? " + inotify" : "");
     
     /* Načítanie filter súboru */
     verbose_log(g_config, "Loading filter file...");
-    g_config->filter_root = load_filter_file(g_config->filter_file, g_config->verbose);
+    g_config->filter_root = filter_load(g_config->filter_file, g_config->filter_compiled,
+                                        g_config->verbose);
     if (g_config->filter_root == NULL) {
         print_error("Failed to load filter file: %s", g_config->filter_file);
-        free(g_config->upstream_server);
+        free_upstreams(g_config);
         free(g_config->filter_file);
+        free(g_config->cache_file);
         free(g_config);
         return ERR_FILTER_FILE;
     }
@@ -256,12 +554,11 @@ int main(int argc, char *argv[]) {
     if (g_config->filter_root != NULL) {
         filter_node_free(g_config->filter_root);
     }
-    if (g_config->upstream_server != NULL) {
-        free(g_config->upstream_server);
-    }
+    free_upstreams(g_config);
     if (g_config->filter_file != NULL) {
         free(g_config->filter_file);
     }
+    free(g_config->cache_file);
     free(g_config);
     
     return ret;
@@ -11,6 +11,9 @@
  
  #include <sys/socket.h>
  #include <sys/time.h>
+ #include <sys/random.h>
+ #include <fcntl.h>
+ #include <pthread.h>
  #include <netinet/in.h>
  #include <arpa/inet.h>
  #include <netdb.h>
@@ -20,9 +23,37 @@
  #include <stdlib.h>
  
  /* Konštanty pre upstream komunikáciu */
- #define UPSTREAM_PORT 53
- #define UPSTREAM_TIMEOUT_SEC 5
- #define UPSTREAM_RETRIES 3
+ #define UPSTREAM_RETRIES UPSTREAM_RETRY_COUNT
+ 
+ /* Perzistentný socket pre forward_query() (jeden na vlákno) */
+ static __thread int cached_sockfd = -1;
+ static __thread struct sockaddr_in cached_upstream;
+ static __thread upstream_rtt_t cached_rtt;
+ 
+ /* Perzistentné TCP spojenie pre odpovede s TC bitom (jedno na vlákno) */
+ static __thread int cached_tcp_sockfd = -1;
+ static __thread struct sockaddr_in cached_tcp_upstream;
+ 
+ /* Cache upstream adries zdieľaná všetkými workermi */
+ static pthread_mutex_t upstream_lock = PTHREAD_MUTEX_INITIALIZER;
+ static char upstream_hosts[DNS_MAX_UPSTREAMS][DNS_MAX_NAME_LEN + 1];
+ static struct sockaddr_in upstream_current[DNS_MAX_UPSTREAMS];
+ static unsigned int upstream_count;
+ static uint32_t upstream_generation;       /* 0 = neinicializovaná */
+ static upstream_cache_stats_t upstream_stats;
+ 
+ /**
+  * @brief Vráti náhodný zdrojový port z rozsahu UPSTREAM_PORT_MIN-65535
+  */
+ static uint16_t random_source_port(void) {
+     uint16_t r;
+     
+     if (getrandom(&r, sizeof(r), GRND_NONBLOCK) != sizeof(r)) {
+         r = (uint16_t)rand();
+     }
+     
+     return (uint16_t)(UPSTREAM_PORT_MIN + r % (65536 - UPSTREAM_PORT_MIN));
+ }
  
  /**
   * @brief Zistí IP adresu z hostname alebo validuje IP adresu
@@ -89,21 +120,157 @@
      return -1;
  }
  
+ /**
+  * @brief Prečíta presne len bajtov z TCP spojenia
+  * @return 0 pri úspechu, -1 pri chybe, timeoute alebo EOF
+  */
+ static int recv_exact(int sockfd, uint8_t *buffer, size_t len) {
+     size_t got = 0;
+     
+     while (got < len) {
+         ssize_t n = recv(sockfd, buffer + got, len - got, 0);
+         if (n < 0 && errno == EINTR) {
+             continue;
+         }
+         if (n <= 0) {
+             return -1;
+         }
+         got += (size_t)n;
+     }
+     
+     return 0;
+ }
+ 
+ /**
+  * @brief Otvorí blokujúce TCP spojenie na upstream (s timeoutmi)
+  * @return Socket descriptor, -1 pri chybe
+  */
+ static int open_upstream_tcp(const struct sockaddr_in *upstream) {
+     int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+     if (sockfd < 0) {
+         print_error("Failed to create upstream TCP socket: %s", strerror(errno));
+         return -1;
+     }
+     
+     /* SO_SNDTIMEO obmedzuje aj connect() */
+     struct timeval timeout;
+     timeout.tv_sec = UPSTREAM_TIMEOUT_SEC;
+     timeout.tv_usec = 0;
+     setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+     setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+     
+     if (connect(sockfd, (const struct sockaddr *)upstream, sizeof(*upstream)) < 0) {
+         print_error("Failed to connect to upstream over TCP: %s", strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+     
+     return sockfd;
+ }
+ 
+ /**
+  * @brief Zopakuje dotaz cez perzistentné TCP spojenie na upstream
+  * 
+  * Spojenie sa otvorí pri prvej odpovedi s TC bitom a ostáva otvorené pre
+  * ďalšie. Ak ho upstream medzitým zavrel (RFC 7766 Section 6.2.3), dotaz
+  * sa raz zopakuje na novom spojení. Odpovede s iným ID (oneskorené po
+  * predchádzajúcom timeoute) sa preskočia.
+  * 
+  * @param upstream Adresa upstream servera
+  * @param query Dotaz
+  * @param query_len Dĺžka dotazu
+  * @param response Výstup - odpoveď (alokuje sa)
+  * @param resp_len Výstup - dĺžka odpovede
+  * @return 0 pri úspechu, -1 pri chybe
+  */
+ static int query_over_tcp(const struct sockaddr_in *upstream, const uint8_t *query,
+                           size_t query_len, uint8_t **response, size_t *resp_len) {
+     if (query_len < DNS_HEADER_SIZE || query_len > DNS_TCP_MAX_SIZE) {
+         return -1;
+     }
+     
+     if (cached_tcp_sockfd >= 0 &&
+         (cached_tcp_upstream.sin_addr.s_addr != upstream->sin_addr.s_addr ||
+          cached_tcp_upstream.sin_port != upstream->sin_port)) {
+         close(cached_tcp_sockfd);
+         cached_tcp_sockfd = -1;
+     }
+     
+     uint8_t *frame = (uint8_t *)malloc(query_len + 2);
+     if (frame == NULL) {
+         print_error("Failed to allocate TCP query buffer");
+         return -1;
+     }
+     frame[0] = (uint8_t)(query_len >> 8);
+     frame[1] = (uint8_t)(query_len & 0xFF);
+     memcpy(frame + 2, query, query_len);
+     
+     for (int attempt = 0; attempt < 2; attempt++) {
+         bool reused = cached_tcp_sockfd >= 0;
+         
+         if (!reused) {
+             cached_tcp_sockfd = open_upstream_tcp(upstream);
+             if (cached_tcp_sockfd < 0) {
+                 break;
+             }
+             cached_tcp_upstream = *upstream;
+         }
+         
+         if (send(cached_tcp_sockfd, frame, query_len + 2, MSG_NOSIGNAL) ==
+             (ssize_t)(query_len + 2)) {
+             uint8_t len_buf[2];
+             
+             while (recv_exact(cached_tcp_sockfd, len_buf, sizeof(len_buf)) == 0) {
+                 size_t msg_len = ((size_t)len_buf[0] << 8) | len_buf[1];
+                 uint8_t *msg = msg_len >= DNS_HEADER_SIZE ? (uint8_t *)malloc(msg_len) : NULL;
+                 
+                 if (msg == NULL || recv_exact(cached_tcp_sockfd, msg, msg_len) != 0) {
+                     free(msg);
+                     break;
+                 }
+                 
+                 if (msg[0] == query[0] && msg[1] == query[1]) {
+                     free(frame);
+                     *response = msg;
+                     *resp_len = msg_len;
+                     return 0;
+                 }
+                 free(msg);
+             }
+         }
+         
+         close(cached_tcp_sockfd);
+         cached_tcp_sockfd = -1;
+         
+         /* Nové spojenie zlyhalo - ďalší pokus by dopadol rovnako */
+         if (!reused) {
+             break;
+         }
+         verbose_log_raw("  Upstream closed TCP connection - reconnecting");
+     }
+     
+     free(frame);
+     return -1;
+ }
+ 
  /**
   * @brief Prepošle DNS dotaz na upstream server
   * 
   * Proces:
-  * 1. Resolve upstream adresy (hostname → IP)
-  * 2. Vytvorenie UDP socketu
-  * 3. Nastavenie timeoutu
+  * 1. Upstream adresa z cache (resolve hostname → IP iba ak nie je v cache)
+  * 2. Získanie perzistentného pripojeného UDP socketu (vytvorí sa iba
+  *    pri prvom volaní vo vlákne alebo pri zmene upstream)
+  * 3. Timeout pokusu = RTO z nameraného RTT vlákna (SRTT + 4*RTTVAR),
+  *    pri každej retransmisii dvojnásobný až po UPSTREAM_RTO_MAX_MS
   * 4. Odoslanie dotazu na upstream
-  * 5. Prijatie odpovede (s retry)
-  * 6. Validácia odpovede
+  * 5. Prijatie odpovede (retransmisie do UPSTREAM_TIMEOUT_SEC)
+  * 6. Odpoveď s TC bitom - dotaz sa zopakuje cez perzistentné TCP spojenie
+  * 7. Validácia odpovede
   * 
   * Edge cases:
   * - Upstream nedostupný
   * - Timeout
-  * - Truncated response (TC flag)
+  * - Truncated response (TC flag) - bez TCP sa vráti skrátená odpoveď
   * - Invalid response
   * - Transaction ID mismatch
   * - Socket errors
@@ -126,88 +293,127 @@
          return -1;
      }
      
-     /* Resolve upstream adresy */
-     char upstream_ip[16];
-     if (resolve_upstream_address(upstream, upstream_ip) != 0) {
-         return -1;
-     }
+     /* Upstream adresa - z cache, resolve iba pre iný ako nakonfigurovaný upstream */
+     struct sockaddr_in upstream_addr;
      
-     /* Vytvorenie UDP socketu */
-     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-     if (sockfd < 0) {
-         print_error("Failed to create upstream socket: %s", strerror(errno));
-         return -1;
+     if (!upstream_cache_lookup(upstream, &upstream_addr)) {
+         char upstream_ip[16];
+         if (resolve_upstream_address(upstream, upstream_ip) != 0) {
+             return -1;
+         }
+         
+         memset(&upstream_addr, 0, sizeof(upstream_addr));
+         upstream_addr.sin_family = AF_INET;
+         upstream_addr.sin_port = htons(UPSTREAM_PORT);
+         
+         if (inet_pton(AF_INET, upstream_ip, &upstream_addr.sin_addr) != 1) {
+             print_error("Invalid upstream IP address: %s", upstream_ip);
+             return -1;
+         }
      }
      
-     /* Nastavenie timeoutu pre recv */
-     struct timeval timeout;
-     timeout.tv_sec = UPSTREAM_TIMEOUT_SEC;
-     timeout.tv_usec = 0;
+     /* Perzistentný pripojený socket - nový iba pri zmene upstream */
+     if (cached_sockfd >= 0 &&
+         (cached_upstream.sin_addr.s_addr != upstream_addr.sin_addr.s_addr ||
+          cached_upstream.sin_port != upstream_addr.sin_port)) {
+         close(cached_sockfd);
+         cached_sockfd = -1;
+     }
      
-     if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
-         print_error("Failed to set socket timeout: %s", strerror(errno));
-         close(sockfd);
-         return -1;
+     if (cached_sockfd < 0) {
+         cached_sockfd = open_upstream_socket(&upstream_addr, false);
+         if (cached_sockfd < 0) {
+             return -1;
+         }
+         cached_upstream = upstream_addr;
+         memset(&cached_rtt, 0, sizeof(cached_rtt));
      }
      
-     /* Nastavenie upstream adresy */
-     struct sockaddr_in upstream_addr;
-     memset(&upstream_addr, 0, sizeof(upstream_addr));
-     upstream_addr.sin_family = AF_INET;
-     upstream_addr.sin_port = htons(UPSTREAM_PORT);
+     int sockfd = cached_sockfd;
      
-     if (inet_pton(AF_INET, upstream_ip, &upstream_addr.sin_addr) != 1) {
-         print_error("Invalid upstream IP address: %s", upstream_ip);
-         close(sockfd);
+     /* Transaction ID dotazu pre párovanie odpovedí na zdieľanom sockete */
+     dns_header_t query_header, resp_header;
+     
+     if (parse_dns_header(query->raw_data, query->raw_len, &query_header) != 0) {
+         print_error("Failed to parse query header for validation");
          return -1;
      }
      
-     /* Alokácia bufferu pre odpoveď */
-     uint8_t *resp_buffer = (uint8_t *)malloc(DNS_UDP_MAX_SIZE);
+     /* Alokácia bufferu pre odpoveď (EDNS upstream môže poslať viac ako 512 B) */
+     uint8_t *resp_buffer = (uint8_t *)malloc(DNS_EDNS_MAX_SIZE);
      if (resp_buffer == NULL) {
          print_error("Failed to allocate response buffer");
-         close(sockfd);
          return -1;
      }
      
-     /* Retry loop */
+     /* Retransmisie po RTO (SRTT + 4*RTTVAR, backoff) až do celkového limitu;
+      * odpoveď na skorší pokus má rovnaké ID, takže sa prijme aj neskôr */
      int attempt;
+     int errors = 0;
      ssize_t recv_len = -1;
+     uint64_t deadline_ms = monotonic_ms() + (uint64_t)UPSTREAM_TIMEOUT_SEC * 1000u;
      
-     for (attempt = 0; attempt < UPSTREAM_RETRIES; attempt++) {
+     for (attempt = 0; errors < UPSTREAM_RETRIES; attempt++) {
+         uint64_t now_ms = monotonic_ms();
+         if (now_ms >= deadline_ms) {
+             break;
+         }
+         
+         uint64_t rto_ms = upstream_rtt_rto_ms(&cached_rtt, (unsigned int)attempt,
+                                               UPSTREAM_RTO_MAX_MS);
+         if (rto_ms > deadline_ms - now_ms) {
+             rto_ms = deadline_ms - now_ms;
+         }
+         
          if (attempt > 0) {
-             verbose_log_raw("  Retry attempt %d/%d...", attempt + 1, UPSTREAM_RETRIES);
+             verbose_log_raw("  Retransmit %d (timeout %llu ms)...", attempt + 1,
+                             (unsigned long long)rto_ms);
          }
          
-         /* Odoslanie dotazu na upstream */
-         ssize_t sent_len = sendto(sockfd, query->raw_data, query->raw_len, 0,
-                                   (struct sockaddr *)&upstream_addr, 
-                                   sizeof(upstream_addr));
+         struct timeval timeout;
+         timeout.tv_sec = (time_t)(rto_ms / 1000);
+         timeout.tv_usec = (suseconds_t)((rto_ms % 1000) * 1000);
+         setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+         
+         /* Odoslanie dotazu na upstream (socket je connect()-nutý) */
+         ssize_t sent_len = send(sockfd, query->raw_data, query->raw_len, 0);
+         uint64_t sent_us = monotonic_us();
          
          if (sent_len < 0) {
              print_error("Failed to send to upstream: %s", strerror(errno));
+             errors++;
              continue;  /* Retry */
          }
          
          if ((size_t)sent_len != query->raw_len) {
              print_error("Partial send to upstream (%zd/%zu bytes)", 
                         sent_len, query->raw_len);
+             errors++;
              continue;  /* Retry */
          }
          
-         /* Prijatie odpovede od upstream */
-         socklen_t addr_len = sizeof(upstream_addr);
-         recv_len = recvfrom(sockfd, resp_buffer, DNS_UDP_MAX_SIZE, 0,
-                            (struct sockaddr *)&upstream_addr, &addr_len);
+         /* Prijatie odpovede - oneskorené odpovede na staršie dotazy
+          * (iné transaction ID) sa na zdieľanom sockete preskočia */
+         do {
+             recv_len = recv(sockfd, resp_buffer, DNS_EDNS_MAX_SIZE, 0);
+         } while (recv_len >= DNS_HEADER_SIZE &&
+                  ((uint16_t)((resp_buffer[0] << 8) | resp_buffer[1])) != query_header.id);
          
          if (recv_len < 0) {
              if (errno == EAGAIN || errno == EWOULDBLOCK) {
                  verbose_log_raw("  Upstream timeout");
-                 continue;  /* Timeout - retry */
+                 continue;  /* RTO vypršal - retransmisia */
              }
              
              print_error("Failed to receive from upstream: %s", strerror(errno));
-             continue;  /* Retry */
+             errors++;
+             continue;  /* Retry (napr. ECONNREFUSED z ICMP) */
+         }
+         
+         /* Karnov algoritmus - RTT iba ak bolo odoslanie jediné */
+         if (attempt == 0) {
+             uint64_t elapsed = monotonic_us() - sent_us;
+             upstream_rtt_sample(&cached_rtt, elapsed < UINT32_MAX ? (uint32_t)elapsed : UINT32_MAX);
          }
          
          /* Úspešne sme prijali odpoveď */
@@ -216,10 +422,8 @@
      
      /* Check či sa podarilo prijať odpoveď */
      if (recv_len < 0) {
-         print_error("Failed to get response from upstream after %d attempts", 
-                    UPSTREAM_RETRIES);
+         print_error("Failed to get response from upstream after %d attempts", attempt);
          free(resp_buffer);
-         close(sockfd);
          return -1;
      }
      
@@ -227,24 +431,13 @@
      if (recv_len < DNS_HEADER_SIZE) {
          print_error("Upstream response too short (%zd bytes)", recv_len);
          free(resp_buffer);
-         close(sockfd);
-         return -1;
-     }
-     
-     /* Validácia odpovede - check Transaction ID */
-     dns_header_t query_header, resp_header;
-     
-     if (parse_dns_header(query->raw_data, query->raw_len, &query_header) != 0) {
-         print_error("Failed to parse query header for validation");
-         free(resp_buffer);
-         close(sockfd);
          return -1;
      }
      
+     /* Validácia odpovede */
      if (parse_dns_header(resp_buffer, (size_t)recv_len, &resp_header) != 0) {
          print_error("Failed to parse upstream response header");
          free(resp_buffer);
-         close(sockfd);
          return -1;
      }
      
@@ -253,21 +446,40 @@
          print_error("Transaction ID mismatch (query: 0x%04X, response: 0x%04X)",
                     query_header.id, resp_header.id);
          free(resp_buffer);
-         close(sockfd);
          return -1;
      }
      
-     /* Edge case: TC flag set (truncated response) */
+     /* Edge case: TC flag set (truncated response) - celá odpoveď cez TCP */
      if (resp_header.flags & DNS_FLAG_TC) {
-         verbose_log_raw("  Warning: Upstream response truncated (TC flag set)");
-         /* Pokračujeme aj tak - UDP limit */
+         uint8_t *tcp_response;
+         size_t tcp_len;
+         
+         verbose_log_raw("  Upstream response truncated (TC flag set) - retrying over TCP");
+         
+         /* query_over_tcp() vracia iba odpovede s celou hlavičkou a rovnakým ID */
+         if (query_over_tcp(&upstream_addr, query->raw_data, query->raw_len,
+                            &tcp_response, &tcp_len) == 0) {
+             free(resp_buffer);
+             resp_buffer = tcp_response;
+             recv_len = (ssize_t)tcp_len;
+             parse_dns_header(resp_buffer, tcp_len, &resp_header);
+         } else {
+             verbose_log_raw("  Warning: TCP retry failed - using truncated response");
+         }
      }
      
      /* Edge case: Check QR flag (musí byť response) */
      if (!(resp_header.flags & DNS_FLAG_QR)) {
          print_error("Upstream response has QR=0 (not a response)");
          free(resp_buffer);
-         close(sockfd);
+         return -1;
+     }
+     
+     /* Edge case: Poškodené RR (odpoveď s TC bitom môže byť neúplná) */
+     if (!(resp_header.flags & DNS_FLAG_TC) &&
+         dns_validate_message(resp_buffer, (size_t)recv_len) != 0) {
+         print_error("Upstream response is malformed");
+         free(resp_buffer);
          return -1;
      }
      
@@ -275,8 +487,6 @@
      *response = resp_buffer;
      *resp_len = (size_t)recv_len;
      
-     close(sockfd);
-     
      verbose_log_raw("  Upstream response: %zu bytes, RCODE=%u, ANCOUNT=%u",
                     *resp_len, 
                     resp_header.flags & 0x0F,
@@ -309,4 +519,315 @@
      }
      
      return sockfd;
- }
\ No newline at end of file
+ }
+ 
+ /**
+  * @brief Otvorí UDP socket pripojený na upstream server
+  * 
+  * Zdrojový port sa volí náhodne (nie sekvenčný efemérny port jadra),
+  * takže útočník musí pri spoofingu odpovede uhádnuť port aj transaction
+  * ID. Ak je náhodný port obsadený, skúsi sa iný; po UPSTREAM_BIND_ATTEMPTS
+  * neúspechoch sa použije efemérny port pridelený pri connect().
+  * 
+  * Edge cases:
+  * - NULL upstream
+  * - Obsadený zdrojový port (EADDRINUSE)
+  * - connect() failure
+  */
+ int open_upstream_socket(const struct sockaddr_in *upstream, bool nonblocking) {
+     if (upstream == NULL) {
+         return -1;
+     }
+     
+     int sockfd = create_upstream_socket();
+     if (sockfd < 0) {
+         print_error("Failed to create upstream socket: %s", strerror(errno));
+         return -1;
+     }
+     
+     int flags = fcntl(sockfd, F_GETFL, 0);
+     if (nonblocking && (flags < 0 || fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+         print_error("Failed to set O_NONBLOCK: %s", strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+     fcntl(sockfd, F_SETFD, FD_CLOEXEC);
+     
+     /* Náhodný zdrojový port */
+     struct sockaddr_in local;
+     memset(&local, 0, sizeof(local));
+     local.sin_family = AF_INET;
+     local.sin_addr.s_addr = htonl(INADDR_ANY);
+     
+     for (int attempt = 0; attempt < UPSTREAM_BIND_ATTEMPTS; attempt++) {
+         local.sin_port = htons(random_source_port());
+         
+         if (bind(sockfd, (struct sockaddr *)&local, sizeof(local)) == 0) {
+             break;
+         }
+         
+         if (errno != EADDRINUSE && errno != EACCES) {
+             print_error("Failed to bind upstream socket: %s", strerror(errno));
+             close(sockfd);
+             return -1;
+         }
+     }
+     
+     /* connect() - kernel filtruje datagramy z iných adries */
+     if (connect(sockfd, (const struct sockaddr *)upstream, sizeof(*upstream)) < 0) {
+         print_error("Failed to connect upstream socket: %s", strerror(errno));
+         close(sockfd);
+         return -1;
+     }
+     
+     return sockfd;
+ }
+ 
+ /**
+  * @brief Započíta meranie RTT do SRTT a RTTVAR (RFC 6298 Section 2)
+  * 
+  * Prvé meranie: SRTT = R, RTTVAR = R/2. Ďalšie: RTTVAR sa posunie o 1/4
+  * k |SRTT - R| (so starým SRTT), SRTT o 1/8 k R.
+  */
+ void upstream_rtt_sample(upstream_rtt_t *rtt, uint32_t sample_us) {
+     if (rtt == NULL) {
+         return;
+     }
+     
+     /* 0 je vyhradená pre "bez merania" */
+     if (sample_us == 0) {
+         sample_us = 1;
+     }
+     
+     if (rtt->srtt_us == 0) {
+         rtt->srtt_us = sample_us;
+         rtt->rttvar_us = sample_us / 2;
+         return;
+     }
+     
+     int64_t delta = (int64_t)sample_us - (int64_t)rtt->srtt_us;
+     int64_t deviation = delta < 0 ? -delta : delta;
+     
+     rtt->rttvar_us = (uint32_t)((int64_t)rtt->rttvar_us + (deviation - (int64_t)rtt->rttvar_us) / 4);
+     rtt->srtt_us = (uint32_t)((int64_t)rtt->srtt_us + delta / 8);
+     if (rtt->srtt_us == 0) {
+         rtt->srtt_us = 1;
+     }
+ }
+ 
+ /**
+  * @brief Vypočíta timeout pokusu s exponenciálnym backoffom
+  */
+ uint32_t upstream_rtt_rto_ms(const upstream_rtt_t *rtt, unsigned int backoff, uint32_t max_ms) {
+     uint64_t rto_ms = UPSTREAM_RTO_INITIAL_MS;
+     
+     if (rtt != NULL && rtt->srtt_us != 0) {
+         /* Zaokrúhlenie nahor - RTO nesmie byť kratšie ako SRTT */
+         rto_ms = ((uint64_t)rtt->srtt_us + 4 * (uint64_t)rtt->rttvar_us + 999) / 1000;
+     }
+     if (rto_ms < UPSTREAM_RTO_MIN_MS) {
+         rto_ms = UPSTREAM_RTO_MIN_MS;
+     }
+     
+     while (backoff-- > 0 && rto_ms < max_ms) {
+         rto_ms *= 2;
+     }
+     
+     if (max_ms < UPSTREAM_RTO_MIN_MS) {
+         max_ms = UPSTREAM_RTO_MIN_MS;
+     }
+     return rto_ms < max_ms ? (uint32_t)rto_ms : max_ms;
+ }
+ 
+ /* ============================================================================
+  * CACHE UPSTREAM ADRESY
+  * ============================================================================ */
+ 
+ /**
+  * @brief Vyrieši hostname na sockaddr_in s portom UPSTREAM_PORT
+  * @return 0 pri úspechu, -1 pri chybe
+  */
+ static int resolve_upstream_sockaddr(const char *hostname, struct sockaddr_in *addr) {
+     char ip[INET_ADDRSTRLEN];
+     
+     if (resolve_upstream_address(hostname, ip) != 0) {
+         return -1;
+     }
+     
+     memset(addr, 0, sizeof(*addr));
+     addr->sin_family = AF_INET;
+     addr->sin_port = htons(UPSTREAM_PORT);
+     
+     if (inet_pton(AF_INET, ip, &addr->sin_addr) != 1) {
+         print_error("Invalid upstream IP address: %s", ip);
+         return -1;
+     }
+     
+     return 0;
+ }
+ 
+ /**
+  * @brief Vyrieši upstream servery raz pri štarte
+  * 
+  * Edge cases:
+  * - NULL, prázdny alebo príliš dlhý zoznam, príliš dlhý hostname
+  * - Nevyriešiteľný hostname (server sa nespustí, cache ostáva nezmenená)
+  */
+ int upstream_cache_init(char *const *hostnames, unsigned int count) {
+     if (hostnames == NULL || count == 0 || count > DNS_MAX_UPSTREAMS) {
+         return -1;
+     }
+     
+     struct sockaddr_in addrs[DNS_MAX_UPSTREAMS];
+     for (unsigned int i = 0; i < count; i++) {
+         if (hostnames[i] == NULL || strlen(hostnames[i]) > DNS_MAX_NAME_LEN ||
+             resolve_upstream_sockaddr(hostnames[i], &addrs[i]) != 0) {
+             return -1;
+         }
+     }
+     
+     pthread_mutex_lock(&upstream_lock);
+     for (unsigned int i = 0; i < count; i++) {
+         strcpy(upstream_hosts[i], hostnames[i]);
+         upstream_current[i] = addrs[i];
+     }
+     upstream_count = count;
+     memset(&upstream_stats, 0, sizeof(upstream_stats));
+     __atomic_add_fetch(&upstream_generation, 1, __ATOMIC_RELEASE);
+     pthread_mutex_unlock(&upstream_lock);
+     
+     return 0;
+ }
+ 
+ /**
+  * @brief Znovu vyrieši hostnames upstream serverov
+  * 
+  * getaddrinfo() beží mimo zámku, takže workeri čítajúci adresy nečakajú
+  * na DNS. Pri zlyhaní sa ponechá posledná platná adresa daného servera;
+  * generácia sa zvýši raz, ak sa zmenila ktorákoľvek adresa.
+  */
+ int upstream_cache_refresh(void) {
+     char hosts[DNS_MAX_UPSTREAMS][DNS_MAX_NAME_LEN + 1];
+     
+     pthread_mutex_lock(&upstream_lock);
+     bool initialized = __atomic_load_n(&upstream_generation, __ATOMIC_ACQUIRE) != 0;
+     unsigned int count = upstream_count;
+     memcpy(hosts, upstream_hosts, sizeof(hosts));
+     pthread_mutex_unlock(&upstream_lock);
+     
+     if (!initialized) {
+         return -1;
+     }
+     
+     int ret = 0;
+     
+     for (unsigned int i = 0; i < count; i++) {
+         struct in_addr literal;
+         
+         /* IP adresa sa nemení - nie je čo obnovovať */
+         if (inet_pton(AF_INET, hosts[i], &literal) == 1) {
+             continue;
+         }
+         
+         struct sockaddr_in addr;
+         int resolved = resolve_upstream_sockaddr(hosts[i], &addr);
+         
+         pthread_mutex_lock(&upstream_lock);
+         upstream_stats.refresh_count++;
+         
+         if (resolved != 0) {
+             upstream_stats.refresh_failures++;
+         } else if (addr.sin_addr.s_addr != upstream_current[i].sin_addr.s_addr) {
+             upstream_current[i] = addr;
+             upstream_stats.address_changes++;
+             __atomic_add_fetch(&upstream_generation, 1, __ATOMIC_RELEASE);
+         }
+         pthread_mutex_unlock(&upstream_lock);
+         
+         if (resolved != 0) {
+             print_error("Upstream refresh of %s failed - keeping last known address", hosts[i]);
+             ret = -1;
+         }
+     }
+     
+     return ret;
+ }
+ 
+ /**
+  * @brief Vráti počet nakonfigurovaných upstream serverov
+  */
+ unsigned int upstream_cache_count(void) {
+     pthread_mutex_lock(&upstream_lock);
+     unsigned int count = upstream_count;
+     pthread_mutex_unlock(&upstream_lock);
+     
+     return count;
+ }
+ 
+ /**
+  * @brief Vráti aktuálnu adresu upstream servera a generáciu adries
+  */
+ uint32_t upstream_cache_get(unsigned int index, struct sockaddr_in *addr) {
+     pthread_mutex_lock(&upstream_lock);
+     uint32_t generation = index < upstream_count ? upstream_generation : 0;
+     if (addr != NULL && index < upstream_count) {
+         *addr = upstream_current[index];
+     }
+     pthread_mutex_unlock(&upstream_lock);
+     
+     return generation;
+ }
+ 
+ /**
+  * @brief Vráti generáciu adries (atomic load, bez zámku)
+  */
+ uint32_t upstream_cache_generation(void) {
+     return __atomic_load_n(&upstream_generation, __ATOMIC_ACQUIRE);
+ }
+ 
+ /**
+  * @brief Vráti cachovanú adresu, ak hostname patrí nakonfigurovanému upstream
+  */
+ bool upstream_cache_lookup(const char *hostname, struct sockaddr_in *addr) {
+     if (hostname == NULL || addr == NULL || upstream_cache_generation() == 0) {
+         return false;
+     }
+     
+     bool hit = false;
+     
+     pthread_mutex_lock(&upstream_lock);
+     for (unsigned int i = 0; i < upstream_count && !hit; i++) {
+         hit = strcmp(hostname, upstream_hosts[i]) == 0;
+         if (hit) {
+             *addr = upstream_current[i];
+         }
+     }
+     pthread_mutex_unlock(&upstream_lock);
+     
+     return hit;
+ }
+ 
+ /**
+  * @brief Vráti štatistiky obnovy
+  */
+ void upstream_cache_stats(upstream_cache_stats_t *stats) {
+     if (stats == NULL) {
+         return;
+     }
+     
+     pthread_mutex_lock(&upstream_lock);
+     *stats = upstream_stats;
+     pthread_mutex_unlock(&upstream_lock);
+ }
+ 
+ /**
+  * @brief Vyprázdni cache
+  */
+ void upstream_cache_clear(void) {
+     pthread_mutex_lock(&upstream_lock);
+     memset(upstream_hosts, 0, sizeof(upstream_hosts));
+     memset(upstream_current, 0, sizeof(upstream_current));
+     upstream_count = 0;
+     __atomic_store_n(&upstream_generation, 0, __ATOMIC_RELEASE);
+     pthread_mutex_unlock(&upstream_lock);
+ }
@@ -10,12 +10,52 @@
  
  #include "dns.h"
  
- /* Timeout pre upstream dotazy (sekundy) */
+ #include <netinet/in.h>
+ 
+ /* Port upstream DNS servera */
+ #define UPSTREAM_PORT           53
+ 
+ /* Celkový limit na upstream dotaz vrátane retransmisií (sekundy) */
  #define UPSTREAM_TIMEOUT_SEC    5
  
- /* Počet pokusov pri timeoutoch */
+ /* Počet pokusov pri chybách socketu / TCP spojenia */
  #define UPSTREAM_RETRY_COUNT    3
  
+ /* Retransmission timeout (RFC 6298): SRTT + 4*RTTVAR, zdola ohraničený */
+ #define UPSTREAM_RTO_MIN_MS     20
+ 
+ /* RTO pred prvým meraním RTT */
+ #define UPSTREAM_RTO_INITIAL_MS 500
+ 
+ /* Predvolený strop RTO po exponenciálnom backoffe (-T parameter) */
+ #define UPSTREAM_RTO_MAX_MS     1000
+ 
+ /* Najnižší náhodný zdrojový port upstream socketov (RFC 5452) */
+ #define UPSTREAM_PORT_MIN       1024
+ 
+ /* Počet pokusov o bind() na náhodný port pred použitím efemérneho */
+ #define UPSTREAM_BIND_ATTEMPTS  16
+ 
+ /* Predvolený interval obnovy upstream adresy (sekundy, -r parameter) */
+ #define UPSTREAM_REFRESH_SEC    300
+ 
+ /**
+  * @brief Štatistiky obnovy upstream adresy
+  */
+ typedef struct {
+     unsigned long refresh_count;    /* Počet pokusov o obnovu */
+     unsigned long refresh_failures; /* Neúspešné obnovy (ostala stará adresa) */
+     unsigned long address_changes;  /* Počet zmien adresy */
+ } upstream_cache_stats_t;
+ 
+ /**
+  * @brief Odhad RTT upstream servera pre retransmission timeout (RFC 6298)
+  */
+ typedef struct {
+     uint32_t srtt_us;               /* Vyhladené RTT (váha 1/8), 0 = bez merania */
+     uint32_t rttvar_us;             /* Vyhladená odchýlka RTT (váha 1/4) */
+ } upstream_rtt_t;
+ 
  /**
   * @brief Prepošle DNS dotaz na upstream server
   * @param query DNS dotaz na preposlanie
@@ -27,7 +67,7 @@
   * Edge cases:
   * - Neplatná upstream adresa
   * - Timeout pri čakaní na odpoveď
-  * - Neúplná odpoveď (truncated)
+  * - Neúplná odpoveď (truncated) - zopakuje sa cez perzistentné TCP spojenie
   * - Upstream server nedostupný
   * - Hostname upstream - potreba DNS resolution (getaddrinfo)
   */
@@ -51,4 +91,93 @@
   */
  int create_upstream_socket(void);
  
+ /**
+  * @brief Otvorí dlhodobý UDP socket pripojený na upstream server
+  * @param upstream Adresa upstream servera
+  * @param nonblocking true = O_NONBLOCK (pre event loop)
+  * @return Socket descriptor, -1 pri chybe
+  * 
+  * Socket je naviazaný na náhodný zdrojový port (ochrana proti spoofingu
+  * odpovedí) a connect()-nutý na upstream, takže kernel doručí iba
+  * datagramy z upstream adresy a portu.
+  */
+ int open_upstream_socket(const struct sockaddr_in *upstream, bool nonblocking);
+ 
+ 
+ /**
+  * @brief Započíta meranie RTT do SRTT a RTTVAR
+  * @param rtt Odhad RTT
+  * @param sample_us Nameraný čas odpovede (iba odpoveď na jediné odoslanie -
+  *                  Karnov algoritmus)
+  */
+ void upstream_rtt_sample(upstream_rtt_t *rtt, uint32_t sample_us);
+ 
+ /**
+  * @brief Vypočíta timeout pokusu: SRTT + 4*RTTVAR, zdvojnásobený backoff-krát
+  * @param rtt Odhad RTT
+  * @param backoff Počet predchádzajúcich pokusov bez odpovede
+  * @param max_ms Strop timeoutu
+  * @return Timeout v ms (UPSTREAM_RTO_MIN_MS..max_ms)
+  */
+ uint32_t upstream_rtt_rto_ms(const upstream_rtt_t *rtt, unsigned int backoff, uint32_t max_ms);
+ 
+ 
+ /* ============================================================================
+  * CACHE UPSTREAM ADRESY
+  * ============================================================================ */
+ 
+ /**
+  * @brief Vyrieši upstream servery raz pri štarte a uloží hotové sockaddr_in
+  * @param hostnames IP adresy alebo hostnames upstream serverov
+  * @param count Počet serverov (1..DNS_MAX_UPSTREAMS)
+  * @return 0 pri úspechu, -1 ak sa niektorú adresu nepodarilo zistiť
+  */
+ int upstream_cache_init(char *const *hostnames, unsigned int count);
+ 
+ /**
+  * @brief Znovu vyrieši hostnames upstream serverov (volá sa mimo hot path)
+  * @return 0 pri úspechu, -1 ak niektorá obnova zlyhala (posledná platná
+  *         adresa ostáva)
+  * 
+  * Pre IP adresy zadané priamo je to no-op.
+  */
+ int upstream_cache_refresh(void);
+ 
+ /**
+  * @brief Vráti počet nakonfigurovaných upstream serverov
+  */
+ unsigned int upstream_cache_count(void);
+ 
+ /**
+  * @brief Vráti aktuálnu adresu upstream servera
+  * @param index Poradie servera (poradie -s parametrov)
+  * @param addr Výstupná adresa (môže byť NULL)
+  * @return Generácia adries (mení sa pri každej zmene ktorejkoľvek), 0 ak
+  *         cache nie je inicializovaná alebo index neexistuje
+  */
+ uint32_t upstream_cache_get(unsigned int index, struct sockaddr_in *addr);
+ 
+ /**
+  * @brief Vráti generáciu adries bez zamykania (lacná kontrola zmeny)
+  */
+ uint32_t upstream_cache_generation(void);
+ 
+ /**
+  * @brief Vráti cachovanú adresu, ak hostname zodpovedá niektorému upstream
+  * @param hostname Hostname alebo IP adresa
+  * @param addr Výstupná adresa
+  * @return true ak bola adresa v cache
+  */
+ bool upstream_cache_lookup(const char *hostname, struct sockaddr_in *addr);
+ 
+ /**
+  * @brief Vráti štatistiky obnovy
+  */
+ void upstream_cache_stats(upstream_cache_stats_t *stats);
+ 
+ /**
+  * @brief Vyprázdni cache (pri ukončení servera)
+  */
+ void upstream_cache_clear(void);
+ 
  #endif /* RESOLVER_H */
\ No newline at end of file
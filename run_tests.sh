@@ -16,7 +16,7 @@ echo ""
 
 # Kompilácia testov
 echo -e "${YELLOW}[1/2] Compiling tests...${NC}"
-if make -s test_filter test_dns_parser test_dns_builder test_dns_server test_resolver test_integration 2>&1; then
+if make -s test_filter test_dns_parser test_dns_builder test_dns_server test_resolver test_timer_wheel test_cache test_forwarder test_tcp_server test_integration 2>&1; then
     echo -e "${GREEN} Compilation successful${NC}"
 else
     echo -e "${RED} Compilation failed!${NC}"
@@ -35,46 +35,46 @@ FAILED_TESTS=0
 FAILED_SUITES=0
 
 # Test 1: Filter
-echo -e "${BLUE}[1/6] Filter Module Tests${NC}"
+echo -e "${BLUE}[1/10] Filter Module Tests${NC}"
 if ./test_filter 2>&1; then
-    PASSED_TESTS=$((PASSED_TESTS + 47))
-    echo -e "${GREEN} Filter: 47/47 passed${NC}"
+    PASSED_TESTS=$((PASSED_TESTS + 57))
+    echo -e "${GREEN} Filter: 57/57 passed${NC}"
 else
-    FAILED_TESTS=$((FAILED_TESTS + 47))
+    FAILED_TESTS=$((FAILED_TESTS + 57))
     FAILED_SUITES=$((FAILED_SUITES + 1))
     echo -e "${RED} Filter: FAILED${NC}"
 fi
-TOTAL_TESTS=$((TOTAL_TESTS + 47))
+TOTAL_TESTS=$((TOTAL_TESTS + 57))
 echo ""
 
 # Test 2: DNS Parser
-echo -e "${BLUE}[2/6] DNS Parser Tests${NC}"
+echo -e "${BLUE}[2/10] DNS Parser Tests${NC}"
 if ./test_dns_parser 2>&1; then
-    PASSED_TESTS=$((PASSED_TESTS + 17))
-    echo -e "${GREEN} DNS Parser: 17/17 passed${NC}"
+    PASSED_TESTS=$((PASSED_TESTS + 30))
+    echo -e "${GREEN} DNS Parser: 30/30 passed${NC}"
 else
-    FAILED_TESTS=$((FAILED_TESTS + 17))
+    FAILED_TESTS=$((FAILED_TESTS + 30))
     FAILED_SUITES=$((FAILED_SUITES + 1))
     echo -e "${RED} DNS Parser: FAILED${NC}"
 fi
-TOTAL_TESTS=$((TOTAL_TESTS + 17))
+TOTAL_TESTS=$((TOTAL_TESTS + 30))
 echo ""
 
 # Test 3: DNS Builder
-echo -e "${BLUE}[3/6] DNS Builder Tests${NC}"
+echo -e "${BLUE}[3/10] DNS Builder Tests${NC}"
 if ./test_dns_builder 2>&1; then
-    PASSED_TESTS=$((PASSED_TESTS + 20))
-    echo -e "${GREEN} DNS Builder: 20/20 passed${NC}"
+    PASSED_TESTS=$((PASSED_TESTS + 28))
+    echo -e "${GREEN} DNS Builder: 28/28 passed${NC}"
 else
-    FAILED_TESTS=$((FAILED_TESTS + 20))
+    FAILED_TESTS=$((FAILED_TESTS + 28))
     FAILED_SUITES=$((FAILED_SUITES + 1))
     echo -e "${RED} DNS Builder: FAILED${NC}"
 fi
-TOTAL_TESTS=$((TOTAL_TESTS + 20))
+TOTAL_TESTS=$((TOTAL_TESTS + 28))
 echo ""
 
 # Test 4: DNS Server
-echo -e "${BLUE}[4/6] DNS Server Tests${NC}"
+echo -e "${BLUE}[4/10] DNS Server Tests${NC}"
 if ./test_dns_server 2>&1; then
     PASSED_TESTS=$((PASSED_TESTS + 5))
     echo -e "${GREEN} DNS Server: 5/5 passed${NC}"
@@ -87,20 +87,72 @@ TOTAL_TESTS=$((TOTAL_TESTS + 5))
 echo ""
 
 # Test 5: Resolver
-echo -e "${BLUE}[5/6] Resolver Tests${NC}"
+echo -e "${BLUE}[5/10] Resolver Tests${NC}"
 if ./test_resolver 2>&1; then
-    PASSED_TESTS=$((PASSED_TESTS + 5))
-    echo -e "${GREEN} Resolver: 5/5 passed${NC}"
+    PASSED_TESTS=$((PASSED_TESTS + 21))
+    echo -e "${GREEN} Resolver: 21/21 passed${NC}"
 else
-    FAILED_TESTS=$((FAILED_TESTS + 5))
+    FAILED_TESTS=$((FAILED_TESTS + 21))
     FAILED_SUITES=$((FAILED_SUITES + 1))
     echo -e "${RED} Resolver: FAILED${NC}"
 fi
-TOTAL_TESTS=$((TOTAL_TESTS + 5))
+TOTAL_TESTS=$((TOTAL_TESTS + 21))
+echo ""
+
+# Test 6: Timer Wheel
+echo -e "${BLUE}[6/10] Timer Wheel Tests${NC}"
+if ./test_timer_wheel 2>&1; then
+    PASSED_TESTS=$((PASSED_TESTS + 13))
+    echo -e "${GREEN} Timer Wheel: 13/13 passed${NC}"
+else
+    FAILED_TESTS=$((FAILED_TESTS + 13))
+    FAILED_SUITES=$((FAILED_SUITES + 1))
+    echo -e "${RED} Timer Wheel: FAILED${NC}"
+fi
+TOTAL_TESTS=$((TOTAL_TESTS + 13))
+echo ""
+
+# Test 7: Response Cache
+echo -e "${BLUE}[7/10] Response Cache Tests${NC}"
+if ./test_cache 2>&1; then
+    PASSED_TESTS=$((PASSED_TESTS + 31))
+    echo -e "${GREEN} Response Cache: 31/31 passed${NC}"
+else
+    FAILED_TESTS=$((FAILED_TESTS + 31))
+    FAILED_SUITES=$((FAILED_SUITES + 1))
+    echo -e "${RED} Response Cache: FAILED${NC}"
+fi
+TOTAL_TESTS=$((TOTAL_TESTS + 31))
+echo ""
+
+# Test 8: Forwarder
+echo -e "${BLUE}[8/10] Forwarder Tests${NC}"
+if ./test_forwarder 2>&1; then
+    PASSED_TESTS=$((PASSED_TESTS + 50))
+    echo -e "${GREEN} Forwarder: 50/50 passed${NC}"
+else
+    FAILED_TESTS=$((FAILED_TESTS + 50))
+    FAILED_SUITES=$((FAILED_SUITES + 1))
+    echo -e "${RED} Forwarder: FAILED${NC}"
+fi
+TOTAL_TESTS=$((TOTAL_TESTS + 50))
+echo ""
+
+# Test 9: TCP Listener
+echo -e "${BLUE}[9/10] TCP Listener Tests${NC}"
+if ./test_tcp_server 2>&1; then
+    PASSED_TESTS=$((PASSED_TESTS + 24))
+    echo -e "${GREEN} TCP Listener: 24/24 passed${NC}"
+else
+    FAILED_TESTS=$((FAILED_TESTS + 24))
+    FAILED_SUITES=$((FAILED_SUITES + 1))
+    echo -e "${RED} TCP Listener: FAILED${NC}"
+fi
+TOTAL_TESTS=$((TOTAL_TESTS + 24))
 echo ""
 
-# Test 6: Integration
-echo -e "${BLUE}[6/6] Integration Tests${NC}"
+# Test 10: Integration
+echo -e "${BLUE}[10/10] Integration Tests${NC}"
 if ./test_integration 2>&1; then
     PASSED_TESTS=$((PASSED_TESTS + 3))
     echo -e "${GREEN} Integration: 3/3 passed${NC}"
@@ -118,11 +170,15 @@ echo -e "${BLUE}                    TEST SUMMARY${NC}"
 echo -e "${BLUE}═══════════════════════════════════════════════════════════${NC}"
 echo ""
 echo -e "Test Suites:"
-echo -e "  Filter Module:      47 tests"
-echo -e "  DNS Parser:         17 tests"
-echo -e "  DNS Builder:        20 tests"
+echo -e "  Filter Module:      57 tests"
+echo -e "  DNS Parser:         30 tests"
+echo -e "  DNS Builder:        28 tests"
 echo -e "  DNS Server:          5 tests"
-echo -e "  Resolver:            5 tests"
+echo -e "  Resolver:           21 tests"
+echo -e "  Timer Wheel:        13 tests"
+echo -e "  Response Cache:     31 tests"
+echo -e "  Forwarder:          50 tests"
+echo -e "  TCP Listener:       24 tests"
 echo -e "  Integration:         3 tests"
 echo -e "${BLUE}───────────────────────────────────────────────────────────${NC}"
 echo -e "  Total:              ${TOTAL_TESTS} tests"
@@ -130,7 +186,7 @@ echo ""
 echo -e "Results:"
 echo -e "  Passed:             ${GREEN}${PASSED_TESTS}${NC} tests"
 echo -e "  Failed:             ${RED}${FAILED_TESTS}${NC} tests"
-echo -e "  Failed Suites:      ${RED}${FAILED_SUITES}${NC} / 6"
+echo -e "  Failed Suites:      ${RED}${FAILED_SUITES}${NC} / 10"
 
 # Výpočet úspešnosti
 if [ $TOTAL_TESTS -gt 0 ]; then
@@ -157,6 +213,10 @@ else
         echo "  ./test_dns_builder"
         echo "  ./test_dns_server"
         echo "  ./test_resolver"
+        echo "  ./test_timer_wheel"
+        echo "  ./test_cache"
+        echo "  ./test_forwarder"
+        echo "  ./test_tcp_server"
         echo "  ./test_integration"
     fi
     echo ""
@@ -0,0 +1,568 @@
+/**
+ * @file tcp_server.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - DNS cez TCP (RFC 7766)
+ */
+
+/* accept4() */
+#define _GNU_SOURCE
+
+#include "tcp_server.h"
+#include "utils.h"
+
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+/**
+ * @brief Vráti odkaz na spojenie (index + 1, 0 je rezervovaná pre UDP)
+ */
+static uint32_t conn_ref(const tcp_server_t *tcp, const tcp_conn_t *conn) {
+    return (uint32_t)(conn - tcp->conns) + 1;
+}
+
+/**
+ * @brief Nastaví epoll udalosti spojenia (epoll_ctl iba pri zmene)
+ */
+static int set_events(tcp_server_t *tcp, tcp_conn_t *conn, uint32_t events) {
+    if (conn->events == events) {
+        return 0;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u64 = TCP_EPOLL_TAG | (uint64_t)(conn - tcp->conns);
+
+    if (epoll_ctl(tcp->epfd, EPOLL_CTL_MOD, conn->fd, &ev) < 0) {
+        return -1;
+    }
+
+    conn->events = events;
+    return 0;
+}
+
+/**
+ * @brief Zaradí spojenie do zoznamu na flush (najviac raz)
+ */
+static void mark_dirty(tcp_server_t *tcp, tcp_conn_t *conn) {
+    if (!conn->dirty) {
+        conn->dirty = true;
+        conn->next_dirty = tcp->dirty_list;
+        tcp->dirty_list = conn;
+    }
+}
+
+/**
+ * @brief Zatvorí spojenie a vráti slot do free-listu
+ *
+ * Slot môže ostať v dirty zozname - flush zatvorené sloty preskočí
+ * a vďaka príznaku dirty sa do zoznamu nedostane dvakrát ani po
+ * opätovnom použití.
+ */
+static void close_conn(tcp_server_t *tcp, tcp_conn_t *conn) {
+    epoll_ctl(tcp->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    timer_wheel_cancel(&tcp->timers, &conn->idle_timer);
+
+    free(conn->rx);
+    free(conn->tx);
+    conn->rx = NULL;
+    conn->tx = NULL;
+    conn->rx_len = conn->rx_cap = 0;
+    conn->tx_len = conn->tx_sent = conn->tx_cap = 0;
+
+    /* Odkazy v pending dotazoch forwardera odteraz neplatia */
+    conn->fd = -1;
+    conn->generation++;
+
+    conn->next_free = tcp->free_list;
+    tcp->free_list = conn;
+    tcp->open_count--;
+}
+
+/**
+ * @brief Klient skončil a všetky odpovede sú odoslané
+ */
+static bool conn_finished(const tcp_conn_t *conn) {
+    return conn->read_closed && conn->outstanding == 0 && conn->tx_sent == conn->tx_len;
+}
+
+/**
+ * @brief Zatvorí spojenie, ak skončilo, inak prepočíta epoll udalosti
+ *
+ * Nad TCP_TX_HIGH_WATER neodoslaných bajtov sa z klienta nečíta, kým
+ * neodoberie odpovede (backpressure namiesto neobmedzeného tx).
+ */
+static void finish_conn(tcp_server_t *tcp, tcp_conn_t *conn) {
+    if (conn->closing || conn_finished(conn)) {
+        close_conn(tcp, conn);
+        return;
+    }
+
+    size_t unsent = conn->tx_len - conn->tx_sent;
+    uint32_t events = 0;
+
+    if (!conn->read_closed && unsent < TCP_TX_HIGH_WATER) {
+        events |= EPOLLIN;
+    }
+    if (unsent > 0) {
+        events |= EPOLLOUT;
+    }
+
+    if (set_events(tcp, conn, events) != 0) {
+        tcp->error_count++;
+        close_conn(tcp, conn);
+    }
+}
+
+/**
+ * @brief Prijme čakajúce spojenia
+ *
+ * Edge cases:
+ * - Limit spojení dosiahnutý (spojenie sa hneď zavrie, aby nevisel
+ *   v backlogu a level-triggered epoll sa netočil naprázdno)
+ * - Klient zrušil spojenie pred accept() (ECONNABORTED)
+ */
+static void accept_connections(tcp_server_t *tcp) {
+    for (int budget = 0; budget < TCP_ACCEPT_BUDGET; budget++) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+
+        int fd = accept4(tcp->listen_fd, (struct sockaddr *)&addr, &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                print_error("accept() failed: %s", strerror(errno));
+                tcp->error_count++;
+            }
+            return;
+        }
+
+        tcp_conn_t *conn = tcp->free_list;
+        if (conn == NULL) {
+            close(fd);
+            tcp->rejected_count++;
+            continue;
+        }
+
+        /* Odpoveď je jeden rámec - Nagle by ju iba zdržal */
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        uint8_t *rx = (uint8_t *)malloc(TCP_RX_INITIAL);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = TCP_EPOLL_TAG | (uint64_t)(conn - tcp->conns);
+
+        if (rx == NULL || epoll_ctl(tcp->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            print_error("Failed to register TCP connection");
+            free(rx);
+            close(fd);
+            tcp->error_count++;
+            continue;
+        }
+
+        tcp->free_list = conn->next_free;
+        conn->next_free = NULL;
+        conn->fd = fd;
+        conn->addr = addr;
+        conn->rx = rx;
+        conn->rx_cap = TCP_RX_INITIAL;
+        conn->outstanding = 0;
+        conn->events = EPOLLIN;
+        conn->read_closed = false;
+        conn->closing = false;
+
+        timer_wheel_add(&tcp->timers, &conn->idle_timer, monotonic_ms() + TCP_IDLE_TIMEOUT_MS);
+        tcp->open_count++;
+        tcp->accepted_count++;
+    }
+}
+
+/**
+ * @brief Spracuje všetky celé rámce v rx
+ *
+ * Každý dotaz sa odovzdá hneď - odpoveď z filtra alebo cache sa zaradí
+ * okamžite, forwardovaná príde neskôr (aj po odpovediach na neskoršie
+ * dotazy). Nekompletný rámec ostane na začiatku rx.
+ */
+static void dispatch_frames(tcp_server_t *tcp, tcp_conn_t *conn) {
+    uint32_t ref = conn_ref(tcp, conn);
+    size_t pos = 0;
+
+    while (conn->rx_len - pos >= 2) {
+        size_t msg_len = (size_t)((conn->rx[pos] << 8) | conn->rx[pos + 1]);
+
+        /* Edge case: prázdny rámec nie je DNS správa */
+        if (msg_len == 0) {
+            tcp->error_count++;
+            conn->closing = true;
+            break;
+        }
+        if (conn->rx_len - pos - 2 < msg_len) {
+            break;
+        }
+
+        conn->outstanding++;
+        tcp->query_count++;
+
+        if (tcp->on_query(tcp->cb_ctx, ref, conn->generation, &conn->addr,
+                          conn->rx + pos + 2, msg_len) != 0) {
+            conn->outstanding--;
+            conn->closing = true;
+            break;
+        }
+
+        pos += 2 + msg_len;
+    }
+
+    if (pos > 0) {
+        memmove(conn->rx, conn->rx + pos, conn->rx_len - pos);
+        conn->rx_len -= pos;
+    }
+}
+
+/**
+ * @brief Jedno recv() do rx a spracovanie prijatých rámcov
+ *
+ * Na udalosť sa číta iba raz - ďalšie dáta ohlási level-triggered epoll
+ * v nasledujúcej iterácii, takže jeden klient nezablokuje ostatných.
+ */
+static void read_conn(tcp_server_t *tcp, tcp_conn_t *conn) {
+    /* Plný buffer = nekompletný rámec väčší ako rx (najviac 2 + 65535 B) */
+    if (conn->rx_len == conn->rx_cap) {
+        size_t new_cap = conn->rx_cap * 2;
+        if (new_cap > TCP_MAX_MESSAGE + 2) {
+            new_cap = TCP_MAX_MESSAGE + 2;
+        }
+
+        uint8_t *rx = new_cap > conn->rx_cap ? (uint8_t *)realloc(conn->rx, new_cap) : NULL;
+        if (rx == NULL) {
+            tcp->error_count++;
+            conn->closing = true;
+            return;
+        }
+        conn->rx = rx;
+        conn->rx_cap = new_cap;
+    }
+
+    ssize_t n = recv(conn->fd, conn->rx + conn->rx_len, conn->rx_cap - conn->rx_len, 0);
+
+    if (n == 0) {
+        /* Klient skončil - rozpracované odpovede sa ešte doručia */
+        conn->read_closed = true;
+        return;
+    }
+    if (n < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            conn->closing = true;
+        }
+        return;
+    }
+
+    conn->rx_len += (size_t)n;
+    timer_wheel_add(&tcp->timers, &conn->idle_timer, monotonic_ms() + TCP_IDLE_TIMEOUT_MS);
+
+    dispatch_frames(tcp, conn);
+}
+
+/**
+ * @brief Odošle čo najviac z tx
+ * @return 0 pri úspechu (aj čiastočnom), -1 pri chybe spojenia
+ */
+static int write_conn(tcp_conn_t *conn) {
+    while (conn->tx_sent < conn->tx_len) {
+        ssize_t n = send(conn->fd, conn->tx + conn->tx_sent,
+                         conn->tx_len - conn->tx_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        conn->tx_sent += (size_t)n;
+    }
+
+    if (conn->tx_sent == conn->tx_len) {
+        conn->tx_len = 0;
+        conn->tx_sent = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Expirácia nečinnosti - spojenie s rozpracovanými dotazmi počká
+ */
+static void on_idle_timeout(timer_node_t *node, void *ctx) {
+    tcp_server_t *tcp = (tcp_server_t *)ctx;
+    tcp_conn_t *conn = TIMER_ENTRY(node, tcp_conn_t, idle_timer);
+
+    if (conn->outstanding > 0 || conn->tx_sent < conn->tx_len) {
+        timer_wheel_add(&tcp->timers, &conn->idle_timer, monotonic_ms() + TCP_IDLE_TIMEOUT_MS);
+        return;
+    }
+
+    tcp->idle_closed_count++;
+    close_conn(tcp, conn);
+}
+
+/**
+ * @brief Inicializuje TCP listener
+ *
+ * Edge cases:
+ * - Nulový limit spojení
+ * - Memory allocation failure
+ */
+int tcp_server_init(tcp_server_t *tcp, int listen_fd, int epfd, size_t max_conns,
+                    tcp_query_cb_t on_query, void *ctx) {
+    if (tcp == NULL || listen_fd < 0 || epfd < 0 || max_conns == 0 || on_query == NULL) {
+        return -1;
+    }
+
+    memset(tcp, 0, sizeof(*tcp));
+    tcp->listen_fd = -1;
+    tcp->epfd = epfd;
+    tcp->max_conns = max_conns;
+    tcp->on_query = on_query;
+    tcp->cb_ctx = ctx;
+
+    tcp->conns = (tcp_conn_t *)calloc(max_conns, sizeof(tcp_conn_t));
+    if (tcp->conns == NULL) {
+        print_error("Failed to allocate TCP connection table");
+        return -1;
+    }
+
+    /* Free-list v poradí indexov */
+    for (size_t i = max_conns; i > 0; i--) {
+        tcp->conns[i - 1].fd = -1;
+        tcp->conns[i - 1].next_free = tcp->free_list;
+        tcp->free_list = &tcp->conns[i - 1];
+    }
+
+    if (timer_wheel_init(&tcp->timers, TIMER_WHEEL_SLOTS, TCP_TIMER_TICK_MS,
+                         monotonic_ms()) != 0) {
+        print_error("Failed to initialize timer wheel");
+        free(tcp->conns);
+        tcp->conns = NULL;
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = TCP_EPOLL_TAG | TCP_EPOLL_LISTEN;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        print_error("epoll_ctl() failed: %s", strerror(errno));
+        timer_wheel_free(&tcp->timers);
+        free(tcp->conns);
+        tcp->conns = NULL;
+        return -1;
+    }
+
+    tcp->listen_fd = listen_fd;
+    return 0;
+}
+
+/**
+ * @brief Zatvorí všetky spojenia aj listen socket
+ */
+void tcp_server_free(tcp_server_t *tcp) {
+    if (tcp == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; tcp->conns != NULL && i < tcp->max_conns; i++) {
+        if (tcp->conns[i].fd >= 0) {
+            close_conn(tcp, &tcp->conns[i]);
+        }
+    }
+
+    if (tcp->listen_fd >= 0) {
+        close(tcp->listen_fd);
+        tcp->listen_fd = -1;
+    }
+
+    timer_wheel_free(&tcp->timers);
+    free(tcp->conns);
+    tcp->conns = NULL;
+    tcp->free_list = NULL;
+    tcp->dirty_list = NULL;
+}
+
+/**
+ * @brief Spracuje epoll udalosť listen socketu alebo spojenia
+ *
+ * Edge cases:
+ * - Udalosť pre slot zatvorený skôr v tej istej dávke epoll_wait()
+ * - EPOLLHUP/EPOLLERR (recv() vráti 0 alebo chybu)
+ */
+void tcp_server_handle_event(tcp_server_t *tcp, uint64_t token, uint32_t events) {
+    uint32_t index = (uint32_t)(token & 0xFFFFFFFFu);
+
+    if (index == TCP_EPOLL_LISTEN) {
+        accept_connections(tcp);
+        return;
+    }
+    if (index >= tcp->max_conns || tcp->conns[index].fd < 0) {
+        return;
+    }
+
+    tcp_conn_t *conn = &tcp->conns[index];
+
+    if (events & EPOLLERR) {
+        close_conn(tcp, conn);
+        return;
+    }
+
+    if ((events & EPOLLOUT) && write_conn(conn) != 0) {
+        close_conn(tcp, conn);
+        return;
+    }
+
+    if ((events & (EPOLLIN | EPOLLHUP)) && !conn->read_closed && !conn->closing) {
+        read_conn(tcp, conn);
+    }
+
+    finish_conn(tcp, conn);
+}
+
+/**
+ * @brief Zaradí odpoveď do tx spojenia
+ *
+ * Edge cases:
+ * - Spojenie zaniklo (iná generácia slotu) - odpoveď sa zahodí
+ * - Klient neodoberá odpovede (tx nad TCP_TX_MAX) - spojenie sa zavrie
+ */
+int tcp_server_send(tcp_server_t *tcp, uint32_t conn_ref, uint32_t generation,
+                    const uint8_t *msg, size_t len) {
+    if (tcp == NULL || msg == NULL || conn_ref == 0 || conn_ref > tcp->max_conns ||
+        len == 0 || len > TCP_MAX_MESSAGE) {
+        return -1;
+    }
+
+    tcp_conn_t *conn = &tcp->conns[conn_ref - 1];
+    if (conn->fd < 0 || conn->generation != generation || conn->closing) {
+        return -1;
+    }
+
+    if (conn->outstanding > 0) {
+        conn->outstanding--;
+    }
+
+    size_t unsent = conn->tx_len - conn->tx_sent;
+    if (unsent + 2 + len > TCP_TX_MAX) {
+        tcp->error_count++;
+        conn->closing = true;
+        mark_dirty(tcp, conn);
+        return -1;
+    }
+
+    /* Odoslaná časť sa zahodí až keď treba miesto */
+    if (conn->tx_sent > 0) {
+        memmove(conn->tx, conn->tx + conn->tx_sent, unsent);
+        conn->tx_len = unsent;
+        conn->tx_sent = 0;
+    }
+
+    size_t need = conn->tx_len + 2 + len;
+    if (need > conn->tx_cap) {
+        size_t new_cap = conn->tx_cap > 0 ? conn->tx_cap : TCP_RX_INITIAL;
+        while (new_cap < need) {
+            new_cap *= 2;
+        }
+
+        uint8_t *tx = (uint8_t *)realloc(conn->tx, new_cap);
+        if (tx == NULL) {
+            tcp->error_count++;
+            conn->closing = true;
+            mark_dirty(tcp, conn);
+            return -1;
+        }
+        conn->tx = tx;
+        conn->tx_cap = new_cap;
+    }
+
+    conn->tx[conn->tx_len] = (uint8_t)(len >> 8);
+    conn->tx[conn->tx_len + 1] = (uint8_t)(len & 0xFF);
+    memcpy(conn->tx + conn->tx_len + 2, msg, len);
+    conn->tx_len += 2 + len;
+
+    mark_dirty(tcp, conn);
+    return 0;
+}
+
+/**
+ * @brief Uvoľní dotaz bez odpovede
+ *
+ * Spojenie sa pri flushi prepočíta - ak klient už skončil a toto bol
+ * posledný dotaz, zavrie sa.
+ */
+int tcp_server_drop(tcp_server_t *tcp, uint32_t conn_ref, uint32_t generation) {
+    if (tcp == NULL || conn_ref == 0 || conn_ref > tcp->max_conns) {
+        return -1;
+    }
+
+    tcp_conn_t *conn = &tcp->conns[conn_ref - 1];
+    if (conn->fd < 0 || conn->generation != generation) {
+        return -1;
+    }
+
+    if (conn->outstanding > 0) {
+        conn->outstanding--;
+    }
+
+    mark_dirty(tcp, conn);
+    return 0;
+}
+
+/**
+ * @brief Odošle odpovede všetkých spojení v dirty zozname
+ *
+ * Čo sa nezmestí do socket bufferu, odošle sa pri EPOLLOUT.
+ */
+void tcp_server_flush(tcp_server_t *tcp) {
+    while (tcp->dirty_list != NULL) {
+        tcp_conn_t *conn = tcp->dirty_list;
+        tcp->dirty_list = conn->next_dirty;
+        conn->next_dirty = NULL;
+        conn->dirty = false;
+
+        if (conn->fd < 0) {
+            continue;
+        }
+
+        if (!conn->closing && write_conn(conn) != 0) {
+            conn->closing = true;
+        }
+
+        finish_conn(tcp, conn);
+    }
+}
+
+/**
+ * @brief Spracuje expirované timeouty nečinnosti
+ */
+void tcp_server_process_timeouts(tcp_server_t *tcp, uint64_t now_ms) {
+    timer_wheel_advance(&tcp->timers, now_ms, on_idle_timeout, tcp);
+}
+
+/**
+ * @brief Vráti timeout pre epoll_wait
+ */
+int tcp_server_timeout_ms(const tcp_server_t *tcp, uint64_t now_ms, int max_ms) {
+    return timer_wheel_timeout_ms(&tcp->timers, now_ms, max_ms);
+}
@@ -0,0 +1,190 @@
+/**
+ * @file tcp_server.h
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - DNS cez TCP (RFC 7766)
+ */
+
+#ifndef TCP_SERVER_H
+#define TCP_SERVER_H
+
+#include "dns.h"
+#include "timer_wheel.h"
+
+#include <netinet/in.h>
+
+/* Maximálny počet súčasných TCP spojení na jedného workera (ďalej
+ * obmedzené limitom file descriptorov, viď run_server()) */
+#define TCP_MAX_CONNECTIONS     1024
+
+/* Spojenie bez dotazov a rozpracovaných odpovedí sa zavrie (RFC 7766 Section 6.2.3) */
+#define TCP_IDLE_TIMEOUT_MS     10000
+
+/* Najväčšia DNS správa v TCP rámci (2-bajtová dĺžka) */
+#define TCP_MAX_MESSAGE         DNS_TCP_MAX_SIZE
+
+/* Počiatočná veľkosť prijímacieho bufferu spojenia */
+#define TCP_RX_INITIAL          2048
+
+/* Nad toľko neodoslaných bajtov sa z klienta prestane čítať */
+#define TCP_TX_HIGH_WATER       (64 * 1024)
+
+/* Klient, ktorý neodoberá odpovede, sa nad týmto limitom odpojí */
+#define TCP_TX_MAX              (256 * 1024)
+
+/* Granularita časovačov nečinnosti */
+#define TCP_TIMER_TICK_MS       100
+
+/* Maximálny počet accept() v jednom volaní (fairness) */
+#define TCP_ACCEPT_BUDGET       16
+
+/* Značka epoll udalostí TCP (data.u64 = TCP_EPOLL_TAG | index spojenia) */
+#define TCP_EPOLL_TAG           (1ULL << 63)
+#define TCP_EPOLL_LISTEN        0xFFFFFFFFu
+
+/**
+ * @brief Jedno TCP spojenie (slot v tabuľke spojení)
+ *
+ * Dotazy sa spracúvajú hneď, ako je v rx celý rámec, takže pipelined
+ * dotazy bežia súbežne a odpovede sa do tx pridávajú v poradí, v akom
+ * sú hotové (RFC 7766 Section 6.2.1.1).
+ */
+typedef struct tcp_conn {
+    int fd;                         /* Socket spojenia, -1 = voľný slot */
+    uint32_t generation;            /* Zvyšuje sa pri zatvorení (neplatné odkazy) */
+    struct sockaddr_in addr;        /* Adresa klienta */
+    timer_node_t idle_timer;        /* Timeout nečinnosti */
+    uint8_t *rx;                    /* Prijaté, ešte nespracované bajty */
+    size_t rx_len;                  /* Počet bajtov v rx */
+    size_t rx_cap;                  /* Veľkosť rx */
+    uint8_t *tx;                    /* Rámce čakajúce na odoslanie */
+    size_t tx_len;                  /* Počet bajtov v tx */
+    size_t tx_sent;                 /* Už odoslaná časť tx */
+    size_t tx_cap;                  /* Veľkosť tx */
+    unsigned int outstanding;       /* Dotazy, na ktoré ešte neodišla odpoveď */
+    uint32_t events;                /* Aktuálne epoll udalosti */
+    bool read_closed;               /* Klient ukončil odosielanie (EOF) */
+    bool closing;                   /* Spojenie sa zavrie pri najbližšom flushi */
+    bool dirty;                     /* Spojenie je v zozname na flush */
+    struct tcp_conn *next_dirty;    /* Zoznam spojení s novými odpoveďami */
+    struct tcp_conn *next_free;     /* Free-list (iba keď je slot voľný) */
+} tcp_conn_t;
+
+/**
+ * @brief Callback pre jeden prijatý dotaz
+ * @param ctx Kontext z tcp_server_init()
+ * @param conn_ref Odkaz na spojenie (index + 1) pre tcp_server_send()
+ * @param generation Generácia spojenia pre tcp_server_send()
+ * @param addr Adresa klienta
+ * @param query Dotaz (bez 2-bajtovej dĺžky, callback ho smie upraviť)
+ * @param len Dĺžka dotazu
+ * @return 0 ak odpoveď bola alebo bude odoslaná, -1 ak sa dotaz zahodil
+ *         (spojenie sa zavrie)
+ */
+typedef int (*tcp_query_cb_t)(void *ctx, uint32_t conn_ref, uint32_t generation,
+                              const struct sockaddr_in *addr, uint8_t *query, size_t len);
+
+/**
+ * @brief TCP listener jedného workera
+ *
+ * Listen socket aj spojenia sú v epoll workera (level-triggered), odpovede
+ * sa zbierajú v tx bufferoch a odošlú sa naraz pri tcp_server_flush() na
+ * konci iterácie event loopu - pipelined dotazy z jedného čítania tak
+ * odídu jedným send().
+ */
+typedef struct {
+    int listen_fd;                  /* Listen socket (SO_REUSEPORT) */
+    int epfd;                       /* epoll workera */
+    tcp_conn_t *conns;              /* Tabuľka spojení [max_conns] */
+    size_t max_conns;               /* Limit súčasných spojení */
+    size_t open_count;              /* Počet otvorených spojení */
+    tcp_conn_t *free_list;          /* Voľné sloty */
+    tcp_conn_t *dirty_list;         /* Spojenia s neodoslanými odpoveďami */
+    timer_wheel_t timers;           /* Timeouty nečinnosti */
+    tcp_query_cb_t on_query;        /* Spracovanie dotazu */
+    void *cb_ctx;                   /* Kontext pre on_query */
+
+    /* Štatistiky */
+    unsigned long accepted_count;   /* Prijaté spojenia */
+    unsigned long rejected_count;   /* Odmietnuté nad limitom spojení */
+    unsigned long idle_closed_count; /* Zatvorené pre nečinnosť */
+    unsigned long query_count;      /* Prijaté dotazy */
+    unsigned long error_count;      /* Chyby protokolu / socketu */
+} tcp_server_t;
+
+/**
+ * @brief Inicializuje TCP listener a zaregistruje listen socket do epoll
+ * @param tcp Listener
+ * @param listen_fd Neblokujúci listen socket (viď init_tcp_server())
+ * @param epfd epoll workera
+ * @param max_conns Limit súčasných spojení
+ * @param on_query Callback pre prijaté dotazy
+ * @param ctx Kontext pre callback
+ * @return 0 pri úspechu, -1 pri chybe (listen_fd ostáva volajúcemu)
+ */
+int tcp_server_init(tcp_server_t *tcp, int listen_fd, int epfd, size_t max_conns,
+                    tcp_query_cb_t on_query, void *ctx);
+
+/**
+ * @brief Zatvorí všetky spojenia aj listen socket a uvoľní zdroje
+ * @param tcp Listener
+ */
+void tcp_server_free(tcp_server_t *tcp);
+
+/**
+ * @brief Spracuje epoll udalosť označenú TCP_EPOLL_TAG
+ * @param tcp Listener
+ * @param token data.u64 z epoll udalosti
+ * @param events Udalosti (EPOLLIN, EPOLLOUT, ...)
+ */
+void tcp_server_handle_event(tcp_server_t *tcp, uint64_t token, uint32_t events);
+
+/**
+ * @brief Zaradí odpoveď na odoslanie (s 2-bajtovou dĺžkou)
+ * @param tcp Listener
+ * @param conn_ref Odkaz na spojenie z on_query callbacku
+ * @param generation Generácia spojenia z on_query callbacku
+ * @param msg Odpoveď
+ * @param len Dĺžka odpovede (najviac TCP_MAX_MESSAGE)
+ * @return 0 pri úspechu, -1 ak spojenie medzitým zaniklo
+ *
+ * Odpoveď sa odošle pri najbližšom tcp_server_flush().
+ */
+int tcp_server_send(tcp_server_t *tcp, uint32_t conn_ref, uint32_t generation,
+                    const uint8_t *msg, size_t len);
+
+/**
+ * @brief Uvoľní dotaz, na ktorý odpoveď nepríde
+ * @param tcp Listener
+ * @param conn_ref Odkaz na spojenie z on_query callbacku
+ * @param generation Generácia spojenia z on_query callbacku
+ * @return 0 pri úspechu, -1 ak spojenie medzitým zaniklo
+ *
+ * Bez toho by spojenie čakalo na odpoveď navždy (timeout nečinnosti ho
+ * so zostávajúcimi dotazmi nezavrie) a blokovalo slot.
+ */
+int tcp_server_drop(tcp_server_t *tcp, uint32_t conn_ref, uint32_t generation);
+
+/**
+ * @brief Odošle odpovede nazbierané od posledného volania
+ * @param tcp Listener
+ */
+void tcp_server_flush(tcp_server_t *tcp);
+
+/**
+ * @brief Zatvorí spojenia, ktorým vypršal timeout nečinnosti
+ * @param tcp Listener
+ * @param now_ms Aktuálny monotónny čas
+ */
+void tcp_server_process_timeouts(tcp_server_t *tcp, uint64_t now_ms);
+
+/**
+ * @brief Vráti timeout pre epoll_wait
+ * @param tcp Listener
+ * @param now_ms Aktuálny monotónny čas
+ * @param max_ms Horná hranica
+ * @return Timeout v ms
+ */
+int tcp_server_timeout_ms(const tcp_server_t *tcp, uint64_t now_ms, int max_ms);
+
+#endif /* TCP_SERVER_H */
@@ -0,0 +1,246 @@
+/**
+ * @file bench_dns_parse.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Benchmark parsovania DNS správ
+ *
+ * Porovná parse_dns_message() + free_dns_message() (kópia paketu do
+ * raw_data, calloc otázok, strdup každého QNAME) so zero-copy
+ * dns_view_parse(), ktoré QNAME dekóduje do bufferu volajúceho. Alokácie
+ * sa počítajú nahradením malloc() a spol. (volajú __libc_malloc()), takže
+ * benchmark overí aj to, že view API nealokuje nič.
+ *
+ * Navyše zmeria prechod všetkých RR typickej odpovede (CNAME reťaz,
+ * komprimované mená, OPT) cez dns_rr_iter_next() - tiež bez alokácie.
+ *
+ * Použitie: ./bench_dns_parse [počet_paketov]
+ */
+
+ #include "dns.h"
+ #include "dns_parser.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+
+ #define BENCH_PACKETS   4       /* Rôzne tvary dotazov */
+ #define BENCH_MAX_LEN   128
+
+ /* Počítadlo alokácií (benchmark je jednovláknový) */
+ static unsigned long alloc_count = 0;
+
+ extern void *__libc_malloc(size_t size);
+ extern void *__libc_calloc(size_t nmemb, size_t size);
+ extern void *__libc_realloc(void *ptr, size_t size);
+
+ void *malloc(size_t size) {
+     alloc_count++;
+     return __libc_malloc(size);
+ }
+
+ void *calloc(size_t nmemb, size_t size) {
+     alloc_count++;
+     return __libc_calloc(nmemb, size);
+ }
+
+ void *realloc(void *ptr, size_t size) {
+     alloc_count++;
+     return __libc_realloc(ptr, size);
+ }
+
+ /**
+  * @brief Vráti monotónny čas v nanosekundách
+  */
+ static double now_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+ }
+
+ /* Typické dotazy: krátke meno, dlhé CDN meno, EDNS OPT v additional,
+  * dve otázky s komprimovaným menom v druhej */
+ static const uint8_t bench_packets[BENCH_PACKETS][BENCH_MAX_LEN] = {
+     {
+         0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+         0x00, 0x01, 0x00, 0x01
+     },
+     {
+         0x12, 0x35, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         6, 's', 't', 'a', 't', 'i', 'c', 3, 'c', 'd', 'n', 6, 'a', 's', 's', 'e', 't', 's',
+         9, 'r', 'e', 'g', 'i', 'o', 'n', '-', 'e', 'u', 4, 'e', 'd', 'g', 'e',
+         7, 'n', 'o', 'd', 'e', '-', '1', '7', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e',
+         3, 'c', 'o', 'm', 0,
+         0x00, 0x01, 0x00, 0x01
+     },
+     {
+         0x12, 0x36, 0x01, 0x20, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+         3, 'a', 'p', 'i', 6, 'g', 'i', 't', 'h', 'u', 'b', 3, 'c', 'o', 'm', 0,
+         0x00, 0x01, 0x00, 0x01,
+         0x00, 0x00, 0x29, 0x04, 0xD0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+     },
+     {
+         0x12, 0x37, 0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         4, 'm', 'a', 'i', 'l', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'o', 'r', 'g', 0,
+         0x00, 0x01, 0x00, 0x01,
+         3, 'w', 'w', 'w', 0xC0, 0x11,
+         0x00, 0x1C, 0x00, 0x01
+     }
+ };
+
+ static const size_t bench_lengths[BENCH_PACKETS] = { 33, 71, 43, 48 };
+
+ /* Odpoveď: CNAME -> 2x A, NS v authority, OPT v additional */
+ static const uint8_t bench_response[] = {
+     0x12, 0x38, 0x81, 0x80, 0x00, 0x01, 0x00, 0x03, 0x00, 0x01, 0x00, 0x01,
+     3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+     0x00, 0x01, 0x00, 0x01,
+     0xC0, 0x0C, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2C, 0x00, 0x06,
+     3, 'c', 'd', 'n', 0xC0, 0x10,
+     0xC0, 0x2D, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04,
+     93, 184, 216, 34,
+     0xC0, 0x2D, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04,
+     93, 184, 216, 35,
+     0xC0, 0x10, 0x00, 0x02, 0x00, 0x01, 0x00, 0x01, 0x51, 0x80, 0x00, 0x06,
+     3, 'n', 's', '1', 0xC0, 0x10,
+     0x00, 0x00, 0x29, 0x04, 0xD0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+ };
+
+ /**
+  * @brief Pôvodná cesta - parse_dns_message() + free_dns_message()
+  * @return Súčet QTYPE a dĺžok QNAME (kontrola zhody výsledkov)
+  */
+ static unsigned long run_message(unsigned long packets, double *ns_out, double *allocs_out) {
+     unsigned long checksum = 0;
+     unsigned long allocs_before = alloc_count;
+     double start = now_ns();
+
+     for (unsigned long i = 0; i < packets; i++) {
+         size_t p = i % BENCH_PACKETS;
+         dns_message_t message;
+
+         if (parse_dns_message(bench_packets[p], bench_lengths[p], &message) == 0) {
+             checksum += message.questions[0].qtype + strlen(message.questions[0].qname);
+             free_dns_message(&message);
+         }
+     }
+
+     *ns_out = (now_ns() - start) / (double)packets;
+     *allocs_out = (double)(alloc_count - allocs_before) / (double)packets;
+     return checksum;
+ }
+
+ /**
+  * @brief Zero-copy cesta - dns_view_parse()
+  */
+ static unsigned long run_view(unsigned long packets, double *ns_out, double *allocs_out) {
+     unsigned long checksum = 0;
+     unsigned long allocs_before = alloc_count;
+     double start = now_ns();
+
+     for (unsigned long i = 0; i < packets; i++) {
+         size_t p = i % BENCH_PACKETS;
+         dns_view_t view;
+         char qname[DNS_MAX_NAME_LEN + 1];
+
+         if (dns_view_parse(bench_packets[p], bench_lengths[p], &view,
+                            qname, sizeof(qname)) == 0) {
+             checksum += view.qtype + strlen(qname);
+         }
+     }
+
+     *ns_out = (now_ns() - start) / (double)packets;
+     *allocs_out = (double)(alloc_count - allocs_before) / (double)packets;
+     return checksum;
+ }
+
+ /**
+  * @brief Prechod všetkých RR odpovede - dns_rr_iter_next()
+  * @return Počet prejdených záznamov
+  */
+ static unsigned long run_rr_iter(unsigned long packets, double *ns_out, double *allocs_out) {
+     unsigned long records = 0;
+     unsigned long allocs_before = alloc_count;
+     double start = now_ns();
+
+     for (unsigned long i = 0; i < packets; i++) {
+         dns_rr_iter_t iter;
+         dns_rr_t rr;
+
+         if (dns_rr_iter_init(&iter, bench_response, sizeof(bench_response)) == 0) {
+             while (dns_rr_iter_next(&iter, &rr) == 1) {
+                 records++;
+             }
+         }
+     }
+
+     *ns_out = (now_ns() - start) / (double)packets;
+     *allocs_out = (double)(alloc_count - allocs_before) / (double)packets;
+     return records;
+ }
+
+ /**
+  * @brief Main benchmark runner
+  */
+ int main(int argc, char *argv[]) {
+     unsigned long packets = argc > 1 ? strtoul(argv[1], NULL, 10) : 4000000;
+
+     if (packets == 0) {
+         fprintf(stderr, "Usage: %s [packets]\n", argv[0]);
+         return 1;
+     }
+
+     /* Všetky vzorové pakety musia byť platné */
+     for (size_t p = 0; p < BENCH_PACKETS; p++) {
+         dns_view_t view;
+         if (dns_view_parse(bench_packets[p], bench_lengths[p], &view, NULL, 0) != 0 ||
+             view.questions_end > bench_lengths[p]) {
+             fprintf(stderr, "Invalid benchmark packet %zu\n", p);
+             return 1;
+         }
+     }
+
+     printf("==============================================\n");
+     printf("DNS Parse Benchmark (%lu packets)\n", packets);
+     printf("==============================================\n");
+
+     double message_ns, message_allocs, view_ns, view_allocs;
+     unsigned long message_sum = run_message(packets, &message_ns, &message_allocs);
+     unsigned long view_sum = run_view(packets, &view_ns, &view_allocs);
+
+     printf("  %-28s %7.1f ns/packet  %5.2f allocs/packet\n",
+            "parse_dns_message (old)", message_ns, message_allocs);
+     printf("  %-28s %7.1f ns/packet  %5.2f allocs/packet\n",
+            "dns_view_parse (zero-copy)", view_ns, view_allocs);
+     printf("----------------------------------------------\n");
+     printf("  Speedup: %.2fx\n", message_ns / view_ns);
+
+     double rr_ns, rr_allocs;
+     unsigned long records = run_rr_iter(packets, &rr_ns, &rr_allocs);
+
+     printf("  %-28s %7.1f ns/response %5.2f allocs/response\n",
+            "dns_rr_iter (6 records)", rr_ns, rr_allocs);
+
+     if (message_sum != view_sum) {
+         fprintf(stderr, "Results differ between implementations\n");
+         return 1;
+     }
+     if (message_allocs == 0.0) {
+         fprintf(stderr, "Allocation counter is not active\n");
+         return 1;
+     }
+     if (view_allocs != 0.0) {
+         fprintf(stderr, "dns_view_parse() allocated memory\n");
+         return 1;
+     }
+     if (records != packets * 6) {
+         fprintf(stderr, "dns_rr_iter_next() failed on benchmark response\n");
+         return 1;
+     }
+     if (rr_allocs != 0.0) {
+         fprintf(stderr, "dns_rr_iter_next() allocated memory\n");
+         return 1;
+     }
+     return 0;
+ }
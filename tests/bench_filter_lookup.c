@@ -0,0 +1,253 @@
+/**
+ * @file bench_filter_lookup.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Benchmark vyhľadávania vo filtri
+ *
+ * Porovná is_domain_blocked() s pôvodnou implementáciou, ktorá doménu
+ * rozdelila na labely (malloc poľa + malloc každého labelu), na dlhých
+ * viac-labelových menách. Alokácie sa počítajú nahradením malloc()
+ * a spol. (volajú __libc_malloc()), takže benchmark overí aj to, že
+ * nová cesta nealokuje nič.
+ *
+ * Použitie: ./bench_filter_lookup [počet_domén] [počet_lookupov]
+ */
+
+ #include "dns.h"
+ #include "filter.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+
+ #define BENCH_NAMES     8       /* Rôzne dotazované mená */
+
+ /* Počítadlo alokácií (benchmark je jednovláknový) */
+ static unsigned long alloc_count = 0;
+
+ extern void *__libc_malloc(size_t size);
+ extern void *__libc_calloc(size_t nmemb, size_t size);
+ extern void *__libc_realloc(void *ptr, size_t size);
+
+ void *malloc(size_t size) {
+     alloc_count++;
+     return __libc_malloc(size);
+ }
+
+ void *calloc(size_t nmemb, size_t size) {
+     alloc_count++;
+     return __libc_calloc(nmemb, size);
+ }
+
+ void *realloc(void *ptr, size_t size) {
+     alloc_count++;
+     return __libc_realloc(ptr, size);
+ }
+
+ /**
+  * @brief Vráti monotónny čas v nanosekundách
+  */
+ static double now_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+ }
+
+ /* ============================================================================
+  * PÔVODNÁ IMPLEMENTÁCIA (referencia)
+  * ============================================================================ */
+
+ /**
+  * @brief Rozdelí doménu na alokované labely (v reverznom poradí)
+  */
+ static int legacy_split(const char *domain, char ***labels, size_t *count) {
+     size_t label_count = 1;
+     for (const char *p = domain; *p; p++) {
+         if (*p == '.') {
+             label_count++;
+         }
+     }
+
+     char **label_array = (char **)malloc(label_count * sizeof(char *));
+     if (label_array == NULL) {
+         return -1;
+     }
+
+     const char *end = domain + strlen(domain);
+     size_t idx = 0;
+     while (end > domain) {
+         const char *start = end - 1;
+         while (start > domain && *(start - 1) != '.') {
+             start--;
+         }
+
+         size_t label_len = (size_t)(end - start);
+         label_array[idx] = (char *)malloc(label_len + 1);
+         if (label_array[idx] == NULL) {
+             for (size_t i = 0; i < idx; i++) {
+                 free(label_array[i]);
+             }
+             free(label_array);
+             return -1;
+         }
+         memcpy(label_array[idx], start, label_len);
+         label_array[idx][label_len] = '\0';
+         idx++;
+
+         if (start > domain) {
+             end = start - 1;
+         } else {
+             break;
+         }
+     }
+
+     *labels = label_array;
+     *count = idx;
+     return 0;
+ }
+
+ /**
+  * @brief Pôvodné is_domain_blocked() - split + strcmp
+  */
+ static bool legacy_is_domain_blocked(const filter_node_t *root, const char *domain) {
+     char normalized[DNS_MAX_NAME_LEN + 1];
+     if (normalize_domain(domain, normalized, sizeof(normalized)) != 0) {
+         return false;
+     }
+
+     char **labels = NULL;
+     size_t label_count = 0;
+     if (legacy_split(normalized, &labels, &label_count) != 0) {
+         return false;
+     }
+
+     const filter_node_t *current = root;
+     bool blocked = false;
+     for (size_t i = 0; i < label_count; i++) {
+         const filter_node_t *child = NULL;
+         for (size_t j = 0; j < current->children_count; j++) {
+             if (strcmp(current->children[j]->label, labels[i]) == 0) {
+                 child = current->children[j];
+                 break;
+             }
+         }
+         if (child == NULL) {
+             break;
+         }
+         if (child->is_blocked) {
+             blocked = true;
+             break;
+         }
+         current = child;
+     }
+
+     for (size_t i = 0; i < label_count; i++) {
+         free(labels[i]);
+     }
+     free(labels);
+     return blocked;
+ }
+
+ /* ============================================================================
+  * MERANIE
+  * ============================================================================ */
+
+ /* Dlhé viac-labelové mená (blokované aj povolené) */
+ static const char *bench_names[BENCH_NAMES] = {
+     "a1.b2.c3.d4.e5.f6.g7.h8.i9.j10.k11.l12.pixel.tracker42.example.com",
+     "Static.CDN.Assets.Region-EU.Edge.Node-17.Cluster.Zone7.Example.COM",
+     "x.y.z.metrics.collector.telemetry.service.zone3.example.com",
+     "very.long.subdomain.name.with.many.labels.allowed.example.org",
+     "img.s3.amazonaws.com.cdn.edge.cache.layer.one.two.example.net",
+     "api.v2.internal.services.backend.prod.eu-west-1.zone5.example.com",
+     "deep.deep.deep.deep.deep.deep.deep.deep.deep.ads.zone9.example.com",
+     "a.b.c.d.e.f.g.h.i.j.k.l.m.n.o.p.q.r.s.t.u.v.w.x.y.z.example.com"
+ };
+
+ typedef bool (*lookup_fn_t)(const filter_node_t *root, const char *domain);
+
+ /**
+  * @brief Zmeria jednu implementáciu
+  * @param blocked_out Počet blokovaných mien (kontrola zhody výsledkov)
+  */
+ static void run_lookup(const char *label, lookup_fn_t fn, const filter_node_t *root,
+                        unsigned long lookups, unsigned long *blocked_out,
+                        double *ns_out, double *allocs_out) {
+     unsigned long blocked = 0;
+     unsigned long allocs_before = alloc_count;
+     double start = now_ns();
+
+     for (unsigned long i = 0; i < lookups; i++) {
+         if (fn(root, bench_names[i % BENCH_NAMES])) {
+             blocked++;
+         }
+     }
+
+     double elapsed = now_ns() - start;
+     *blocked_out = blocked;
+     *ns_out = elapsed / (double)lookups;
+     *allocs_out = (double)(alloc_count - allocs_before) / (double)lookups;
+
+     printf("  %-22s %8.1f ns/lookup  %6.2f allocs/lookup  blocked=%lu\n",
+            label, *ns_out, *allocs_out, blocked);
+ }
+
+ /**
+  * @brief Main benchmark runner
+  */
+ int main(int argc, char *argv[]) {
+     unsigned long domains = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+     unsigned long lookups = argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000;
+
+     if (domains == 0 || lookups == 0) {
+         fprintf(stderr, "Usage: %s [domains] [lookups]\n", argv[0]);
+         return 1;
+     }
+
+     filter_node_t *root = filter_node_create();
+     if (root == NULL) {
+         return 1;
+     }
+
+     /* Blocklist: výplň mimo dotazovaných zón + tracker/ads zóny */
+     char domain[DNS_MAX_NAME_LEN + 1];
+     for (unsigned long i = 0; i < domains; i++) {
+         snprintf(domain, sizeof(domain), "host%lu.list%lu.test", i, i % 10);
+         filter_add_domain(root, domain);
+     }
+     filter_add_domain(root, "tracker42.example.com");
+     filter_add_domain(root, "telemetry.service.zone3.example.com");
+     filter_add_domain(root, "ads.zone9.example.com");
+
+     printf("==============================================\n");
+     printf("Filter Lookup Benchmark (%lu domains, %lu lookups)\n", domains, lookups);
+     printf("==============================================\n");
+
+     unsigned long legacy_blocked, blocked;
+     double legacy_ns, ns, legacy_allocs, allocs;
+
+     run_lookup("split + strcmp (old)", legacy_is_domain_blocked, root, lookups,
+                &legacy_blocked, &legacy_ns, &legacy_allocs);
+     run_lookup("in-place (new)", is_domain_blocked, root, lookups,
+                &blocked, &ns, &allocs);
+
+     filter_node_free(root);
+
+     printf("----------------------------------------------\n");
+     printf("  Speedup: %.2fx\n", legacy_ns / ns);
+
+     if (blocked != legacy_blocked) {
+         fprintf(stderr, "Results differ between implementations\n");
+         return 1;
+     }
+     if (legacy_allocs == 0.0) {
+         fprintf(stderr, "Allocation counter is not active\n");
+         return 1;
+     }
+     if (allocs != 0.0) {
+         fprintf(stderr, "is_domain_blocked() allocated memory\n");
+         return 1;
+     }
+     return 0;
+ }
@@ -0,0 +1,184 @@
+/**
+ * @file bench_filter_scale.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Benchmark filtra pri veľkých blocklistoch
+ *
+ * Pre 10k, 100k a 1M domén zmeria čas načítania (filter_add_domain())
+ * a čas vyhľadávania (is_domain_blocked()). Domény sú náhodné mená pod
+ * niekoľkými TLD, takže uzly "com", "net", ... majú obrovský počet detí
+ * - presne prípad, kde lineárne prehľadávanie detí degraduje.
+ *
+ * Polovica lookupov sú subdomény blokovaných domén, polovica náhodné
+ * (neblokované) mená pod rovnakými TLD. Lookup sa meria na pointer Trie
+ * aj po filter_compact(), spolu s pamäťou na doménu.
+ *
+ * Použitie: ./bench_filter_scale [max_domén] [počet_lookupov]
+ */
+
+ #include "dns.h"
+ #include "filter.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+
+ #define BENCH_NAME_LEN      48      /* Miesto pre jedno generované meno */
+ #define BENCH_TLD_COUNT     6
+
+ static const char *bench_tlds[BENCH_TLD_COUNT] = {
+     "com", "com", "com", "net", "org", "io"
+ };
+
+ /* Deterministický generátor (xorshift32) - rovnaké mená v každom behu */
+ static uint32_t rng_state = 2463534242u;
+
+ static uint32_t rng_next(void) {
+     rng_state ^= rng_state << 13;
+     rng_state ^= rng_state >> 17;
+     rng_state ^= rng_state << 5;
+     return rng_state;
+ }
+
+ /**
+  * @brief Vráti monotónny čas v nanosekundách
+  */
+ static double now_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+ }
+
+ /**
+  * @brief Vygeneruje náhodný label dĺžky 6-13 znakov
+  * @return Počet zapísaných znakov
+  */
+ static size_t random_label(char *out) {
+     size_t len = 6 + rng_next() % 8;
+     for (size_t i = 0; i < len; i++) {
+         out[i] = (char)('a' + rng_next() % 26);
+     }
+     return len;
+ }
+
+ /**
+  * @brief Vygeneruje doménu "label.tld" alebo "label.label.tld"
+  */
+ static void random_domain(char *out) {
+     size_t pos = random_label(out);
+     if (rng_next() % 4 == 0) {
+         out[pos++] = '.';
+         pos += random_label(out + pos);
+     }
+     snprintf(out + pos, BENCH_NAME_LEN - pos, ".%s",
+              bench_tlds[rng_next() % BENCH_TLD_COUNT]);
+ }
+
+ /**
+  * @brief Vykoná všetky lookupy
+  * @return Priemerný čas na lookup v ns
+  */
+ static double run_lookups(const filter_node_t *root, const char *queries,
+                           size_t lookups, size_t *blocked) {
+     double start = now_ns();
+     for (size_t i = 0; i < lookups; i++) {
+         if (is_domain_blocked(root, queries + i * BENCH_NAME_LEN)) {
+             (*blocked)++;
+         }
+     }
+     return (now_ns() - start) / (double)lookups;
+ }
+
+ /**
+  * @brief Jedno meranie pre daný počet domén
+  * @return 0 pri úspechu, -1 pri chybe
+  */
+ static int run_scale(size_t domains, size_t lookups) {
+     char *names = (char *)malloc(domains * BENCH_NAME_LEN);
+     char *queries = (char *)malloc(lookups * BENCH_NAME_LEN);
+     filter_node_t *root = filter_node_create();
+     if (names == NULL || queries == NULL || root == NULL) {
+         free(names);
+         free(queries);
+         filter_node_free(root);
+         return -1;
+     }
+
+     for (size_t i = 0; i < domains; i++) {
+         random_domain(names + i * BENCH_NAME_LEN);
+     }
+
+     /* Párne dotazy: www.<blokovaná>, nepárne: náhodné meno */
+     for (size_t i = 0; i < lookups; i++) {
+         char *query = queries + i * BENCH_NAME_LEN;
+         if (i % 2 == 0) {
+             snprintf(query, BENCH_NAME_LEN, "www.%s",
+                      names + (rng_next() % domains) * BENCH_NAME_LEN);
+         } else {
+             random_domain(query);
+         }
+     }
+
+     /* Načítanie */
+     double start = now_ns();
+     for (size_t i = 0; i < domains; i++) {
+         filter_add_domain(root, names + i * BENCH_NAME_LEN);
+     }
+     double load_ns = now_ns() - start;
+
+     size_t loaded = filter_domain_count(root);
+     size_t tree_bytes = filter_memory_usage(root);
+     size_t blocked = 0;
+     double lookup_ns = run_lookups(root, queries, lookups, &blocked);
+
+     printf("  %8zu domains  load %8.1f ms (%5.0f ns/domain)\n",
+            domains, load_ns / 1e6, load_ns / (double)domains);
+     printf("            pointer  %7.1f ns/lookup  %6.1f B/domain  blocked %zu/%zu\n",
+            lookup_ns, (double)tree_bytes / (double)loaded, blocked, lookups);
+
+     /* Kompaktná forma */
+     start = now_ns();
+     int rc = filter_compact(root);
+     double compact_ns = now_ns() - start;
+
+     size_t compact_blocked = 0;
+     if (rc == 0) {
+         lookup_ns = run_lookups(root, queries, lookups, &compact_blocked);
+         printf("            compact  %7.1f ns/lookup  %6.1f B/domain  (built in %.1f ms)\n",
+                lookup_ns, (double)filter_memory_usage(root) / (double)loaded,
+                compact_ns / 1e6);
+     }
+
+     filter_node_free(root);
+     free(names);
+     free(queries);
+
+     /* Všetky párne dotazy musia byť blokované, obe formy sa musia zhodovať */
+     return rc == 0 && blocked >= (lookups + 1) / 2 && compact_blocked == blocked ? 0 : -1;
+ }
+
+ /**
+  * @brief Main benchmark runner
+  */
+ int main(int argc, char *argv[]) {
+     size_t max_domains = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+     size_t lookups = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+
+     if (max_domains == 0 || lookups == 0) {
+         fprintf(stderr, "Usage: %s [max_domains] [lookups]\n", argv[0]);
+         return 1;
+     }
+
+     printf("==============================================\n");
+     printf("Filter Scale Benchmark (%zu lookups per size)\n", lookups);
+     printf("==============================================\n");
+
+     for (size_t domains = 10000; domains <= max_domains; domains *= 10) {
+         if (run_scale(domains, lookups) != 0) {
+             fprintf(stderr, "Benchmark failed at %zu domains\n", domains);
+             return 1;
+         }
+     }
+     return 0;
+ }
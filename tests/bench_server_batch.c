@@ -0,0 +1,265 @@
+/**
+ * @file bench_server_batch.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Benchmark dávkového UDP I/O
+ *
+ * Spustí server (run_server) v child procese raz s recvfrom()/sendto()
+ * (-b 1) a raz s recvmmsg()/sendmmsg() (-b 32) a zmeria počet
+ * zodpovedaných paketov za sekundu. Všetky dotazy sú na blokovanú
+ * doménu, takže upstream sa nikdy nekontaktuje a meria sa iba cesta
+ * prijatie -> filter -> odpoveď.
+ *
+ * Použitie: ./bench_server_batch [sekundy] [klientske_vlákna]
+ */
+
+ /* recvmmsg()/sendmmsg() */
+ #define _GNU_SOURCE
+
+ #include "dns.h"
+ #include "dns_server.h"
+ #include "filter.h"
+ #include "dns_builder.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+ #include <signal.h>
+ #include <pthread.h>
+ #include <errno.h>
+ #include <time.h>
+ #include <sys/wait.h>
+ #include <sys/socket.h>
+ #include <netinet/in.h>
+ #include <arpa/inet.h>
+
+ #define BENCH_PORT          15353
+ #define BENCH_WINDOW        64      /* Dotazov v lete na jedno vlákno */
+ #define BENCH_MAX_CLIENTS   16
+
+ /**
+  * @brief Stav jedného klientskeho vlákna
+  */
+ typedef struct {
+     pthread_t thread;
+     unsigned int id;
+     double seconds;
+     unsigned long sent;
+     unsigned long received;
+ } bench_client_t;
+
+ /**
+  * @brief Vráti monotónny čas v sekundách
+  */
+ static double now_sec(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+ }
+
+ /**
+  * @brief Zostaví A dotaz na qN.bench.test
+  * @return Dĺžka dotazu
+  */
+ static size_t build_query(uint8_t *buffer, uint16_t id, unsigned int n) {
+     char domain[64];
+     snprintf(domain, sizeof(domain), "q%u.bench.test", n);
+
+     memset(buffer, 0, DNS_HEADER_SIZE);
+     buffer[0] = (uint8_t)(id >> 8);
+     buffer[1] = (uint8_t)(id & 0xFF);
+     buffer[2] = 0x01;                   /* RD */
+     buffer[5] = 1;                      /* QDCOUNT = 1 */
+
+     int name_len = encode_dns_name(domain, buffer + DNS_HEADER_SIZE,
+                                    DNS_UDP_MAX_SIZE - DNS_HEADER_SIZE);
+     if (name_len < 0) {
+         return 0;
+     }
+
+     size_t pos = DNS_HEADER_SIZE + (size_t)name_len;
+     buffer[pos++] = 0;
+     buffer[pos++] = DNS_TYPE_A;
+     buffer[pos++] = 0;
+     buffer[pos++] = DNS_CLASS_IN;
+     return pos;
+ }
+
+ /**
+  * @brief Klient - posiela okná dotazov a čaká na odpovede
+  *
+  * Klient sám používa sendmmsg()/recvmmsg(), aby jeho réžia bola v oboch
+  * behoch rovnaká a nízka.
+  */
+ static void *client_thread(void *arg) {
+     bench_client_t *client = (bench_client_t *)arg;
+
+     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+     if (sockfd < 0) {
+         return NULL;
+     }
+
+     struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+     setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+     struct sockaddr_in server;
+     memset(&server, 0, sizeof(server));
+     server.sin_family = AF_INET;
+     server.sin_port = htons(BENCH_PORT);
+     server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+     static __thread uint8_t out[BENCH_WINDOW][DNS_UDP_MAX_SIZE];
+     static __thread uint8_t in[BENCH_WINDOW][DNS_UDP_MAX_SIZE];
+     struct mmsghdr out_msgs[BENCH_WINDOW], in_msgs[BENCH_WINDOW];
+     struct iovec out_iov[BENCH_WINDOW], in_iov[BENCH_WINDOW];
+
+     unsigned int n = client->id * 1000000u;
+     double deadline = now_sec() + client->seconds;
+
+     while (now_sec() < deadline) {
+         memset(out_msgs, 0, sizeof(out_msgs));
+         for (int i = 0; i < BENCH_WINDOW; i++) {
+             out_iov[i].iov_base = out[i];
+             out_iov[i].iov_len = build_query(out[i], (uint16_t)n, n);
+             n++;
+             out_msgs[i].msg_hdr.msg_iov = &out_iov[i];
+             out_msgs[i].msg_hdr.msg_iovlen = 1;
+             out_msgs[i].msg_hdr.msg_name = &server;
+             out_msgs[i].msg_hdr.msg_namelen = sizeof(server);
+         }
+
+         int sent = sendmmsg(sockfd, out_msgs, BENCH_WINDOW, 0);
+         if (sent <= 0) {
+             continue;
+         }
+         client->sent += (unsigned long)sent;
+
+         /* Čakanie na odpovede celého okna (alebo timeout) */
+         int pending = sent;
+         while (pending > 0) {
+             memset(in_msgs, 0, sizeof(in_msgs));
+             for (int i = 0; i < pending; i++) {
+                 in_iov[i].iov_base = in[i];
+                 in_iov[i].iov_len = DNS_UDP_MAX_SIZE;
+                 in_msgs[i].msg_hdr.msg_iov = &in_iov[i];
+                 in_msgs[i].msg_hdr.msg_iovlen = 1;
+             }
+
+             int got = recvmmsg(sockfd, in_msgs, (unsigned int)pending, MSG_WAITFORONE, NULL);
+             if (got <= 0) {
+                 break;
+             }
+             client->received += (unsigned long)got;
+             pending -= got;
+         }
+     }
+
+     close(sockfd);
+     return NULL;
+ }
+
+ /**
+  * @brief Spustí server v child procese
+  * @return PID servera, -1 pri chybe
+  */
+ static pid_t start_server(unsigned int batch_size) {
+     fflush(stdout);
+     pid_t pid = fork();
+     if (pid != 0) {
+         return pid;
+     }
+
+     /* Child: filter s jedinou blokovanou doménou (štatistiky ide na stdout) */
+     filter_node_t *root = filter_node_create();
+     if (root == NULL || filter_add_domain(root, "bench.test") != 0) {
+         _exit(1);
+     }
+
+     char upstream[] = "127.0.0.1";        /* Nikdy sa nekontaktuje */
+     server_config_t config;
+     memset(&config, 0, sizeof(config));
+     config.upstream_servers[0] = upstream;
+     config.upstream_count = 1;
+     config.local_port = BENCH_PORT;
+     config.filter_root = root;
+     config.verbose = false;
+     config.num_threads = 1;
+     config.batch_size = batch_size;
+
+     int rc = run_server(&config);
+     filter_node_free(root);
+     fflush(stdout);
+     _exit(rc == 0 ? 0 : 1);
+ }
+
+ /**
+  * @brief Jedno meranie pre danú veľkosť dávky
+  * @return Paketov za sekundu, záporné pri chybe
+  */
+ static double run_bench(unsigned int batch_size, double seconds, unsigned int clients) {
+     pid_t pid = start_server(batch_size);
+     if (pid < 0) {
+         return -1.0;
+     }
+
+     /* Server potrebuje chvíľu na bind() */
+     usleep(200000);
+
+     bench_client_t workers[BENCH_MAX_CLIENTS];
+     memset(workers, 0, sizeof(workers));
+
+     double start = now_sec();
+     for (unsigned int i = 0; i < clients; i++) {
+         workers[i].id = i;
+         workers[i].seconds = seconds;
+         pthread_create(&workers[i].thread, NULL, client_thread, &workers[i]);
+     }
+
+     unsigned long sent = 0, received = 0;
+     for (unsigned int i = 0; i < clients; i++) {
+         pthread_join(workers[i].thread, NULL);
+         sent += workers[i].sent;
+         received += workers[i].received;
+     }
+     double elapsed = now_sec() - start;
+
+     fflush(stdout);
+     kill(pid, SIGINT);
+     waitpid(pid, NULL, 0);
+
+     printf("  batch=%-4u sent=%-9lu answered=%-9lu lost=%-7lu %10.0f pkt/s\n",
+            batch_size, sent, received, sent - received, received / elapsed);
+     return received / elapsed;
+ }
+
+ /**
+  * @brief Main benchmark runner
+  */
+ int main(int argc, char *argv[]) {
+     double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+     unsigned int clients = argc > 2 ? (unsigned int)atoi(argv[2]) : 2;
+
+     if (seconds <= 0.0 || clients == 0 || clients > BENCH_MAX_CLIENTS) {
+         fprintf(stderr, "Usage: %s [seconds] [client_threads 1-%d]\n",
+                 argv[0], BENCH_MAX_CLIENTS);
+         return 1;
+     }
+
+     printf("==============================================\n");
+     printf("UDP Batch I/O Benchmark (%.1fs, %u clients, port %d)\n",
+            seconds, clients, BENCH_PORT);
+     printf("==============================================\n");
+
+     double plain = run_bench(1, seconds, clients);
+     double batched = run_bench(DNS_DEFAULT_BATCH, seconds, clients);
+
+     if (plain <= 0.0 || batched <= 0.0) {
+         fprintf(stderr, "Benchmark failed\n");
+         return 1;
+     }
+
+     printf("----------------------------------------------\n");
+     printf("  Speedup (recvmmsg/sendmmsg vs recvfrom/sendto): %.2fx\n", batched / plain);
+     return 0;
+ }
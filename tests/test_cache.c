@@ -0,0 +1,682 @@
+/**
+ * @file test_cache.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver
+ */
+
+ #include "cache.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #define COLOR_GREEN "\033[32m"
+ #define COLOR_RED "\033[31m"
+ #define COLOR_RESET "\033[0m"
+
+ int tests_passed = 0;
+ int tests_failed = 0;
+
+ #define TEST_PASS(msg) do { \
+     printf("  " COLOR_GREEN "Y" COLOR_RESET " %s\n", msg); \
+     tests_passed++; \
+ } while(0)
+
+ #define TEST_FAIL(msg) do { \
+     printf("  " COLOR_RED "N" COLOR_RESET " %s\n", msg); \
+     tests_failed++; \
+ } while(0)
+
+ /**
+  * @brief Zostaví dotaz (typ A, IN) na dané meno
+  * @return Dĺžka dotazu
+  */
+ static size_t build_query(uint8_t *buf, uint16_t id, const char *name) {
+     memset(buf, 0, DNS_HEADER_SIZE);
+     buf[0] = (uint8_t)(id >> 8);
+     buf[1] = (uint8_t)id;
+     buf[2] = 0x01;
+     buf[5] = 1;
+
+     size_t pos = DNS_HEADER_SIZE;
+     const char *label = name;
+     while (*label != '\0') {
+         const char *dot = strchr(label, '.');
+         size_t len = dot != NULL ? (size_t)(dot - label) : strlen(label);
+         buf[pos++] = (uint8_t)len;
+         memcpy(buf + pos, label, len);
+         pos += len;
+         label += len + (dot != NULL ? 1 : 0);
+     }
+     buf[pos++] = 0;
+     buf[pos++] = 0; buf[pos++] = DNS_TYPE_A;
+     buf[pos++] = 0; buf[pos++] = DNS_CLASS_IN;
+     return pos;
+ }
+
+ /**
+  * @brief Zostaví odpoveď s jedným A záznamom (pointer na QNAME)
+  * @return Dĺžka odpovede
+  */
+ static size_t build_response(uint8_t *buf, const uint8_t *query, size_t query_len,
+                              uint8_t rcode, uint32_t ttl) {
+     memcpy(buf, query, query_len);
+     buf[2] = 0x81;
+     buf[3] = (uint8_t)(0x80 | rcode);
+     buf[7] = 1;                                 /* ANCOUNT */
+
+     size_t pos = query_len;
+     buf[pos++] = 0xC0; buf[pos++] = DNS_HEADER_SIZE;
+     buf[pos++] = 0; buf[pos++] = DNS_TYPE_A;
+     buf[pos++] = 0; buf[pos++] = DNS_CLASS_IN;
+     buf[pos++] = (uint8_t)(ttl >> 24); buf[pos++] = (uint8_t)(ttl >> 16);
+     buf[pos++] = (uint8_t)(ttl >> 8); buf[pos++] = (uint8_t)ttl;
+     buf[pos++] = 0; buf[pos++] = 4;
+     buf[pos++] = 1; buf[pos++] = 2; buf[pos++] = 3; buf[pos++] = 4;
+     return pos;
+ }
+
+ /**
+  * @brief Zostaví negatívnu odpoveď (prázdna answer, SOA v authority)
+  * @return Dĺžka odpovede
+  *
+  * MNAME a RNAME sú komprimované (pointer na QNAME), takže MINIMUM sa
+  * nedá čítať z pevného offsetu.
+  */
+ static size_t build_negative(uint8_t *buf, const uint8_t *query, size_t query_len,
+                              uint8_t rcode, uint32_t soa_ttl, uint32_t minimum) {
+     memcpy(buf, query, query_len);
+     buf[2] = 0x81;
+     buf[3] = (uint8_t)(0x80 | rcode);
+     buf[9] = 1;                                 /* NSCOUNT */
+
+     size_t pos = query_len;
+     buf[pos++] = 0xC0; buf[pos++] = DNS_HEADER_SIZE;
+     buf[pos++] = 0; buf[pos++] = DNS_TYPE_SOA;
+     buf[pos++] = 0; buf[pos++] = DNS_CLASS_IN;
+     buf[pos++] = (uint8_t)(soa_ttl >> 24); buf[pos++] = (uint8_t)(soa_ttl >> 16);
+     buf[pos++] = (uint8_t)(soa_ttl >> 8); buf[pos++] = (uint8_t)soa_ttl;
+     buf[pos++] = 0; buf[pos++] = 2 + 5 + 20;
+     buf[pos++] = 0xC0; buf[pos++] = DNS_HEADER_SIZE;          /* MNAME */
+     buf[pos++] = 2; buf[pos++] = 'n'; buf[pos++] = 's';       /* RNAME */
+     buf[pos++] = 0xC0; buf[pos++] = DNS_HEADER_SIZE;
+     memset(buf + pos, 0, 16);                                 /* SERIAL..EXPIRE */
+     pos += 16;
+     buf[pos++] = (uint8_t)(minimum >> 24); buf[pos++] = (uint8_t)(minimum >> 16);
+     buf[pos++] = (uint8_t)(minimum >> 8); buf[pos++] = (uint8_t)minimum;
+     return pos;
+ }
+
+ /**
+  * @brief Prečíta TTL prvého answer RR z odpovede
+  */
+ static uint32_t answer_ttl(const uint8_t *resp, size_t query_len) {
+     const uint8_t *p = resp + query_len + 6;
+     return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+ }
+
+ /**
+  * @brief Test kľúča cache
+  */
+ void test_cache_key() {
+     printf("\n[TEST] dns_cache_key_from_packet()\n");
+
+     uint8_t a[DNS_UDP_MAX_SIZE], b[DNS_UDP_MAX_SIZE];
+     size_t a_len = build_query(a, 1, "www.Example.COM");
+     size_t b_len = build_query(b, 2, "www.example.com");
+     dns_cache_key_t ka, kb;
+
+     /* Test 1: Veľkosť písmen nemení kľúč */
+     if (dns_cache_key_from_packet(a, a_len, &ka) == 0 &&
+         dns_cache_key_from_packet(b, b_len, &kb) == 0 &&
+         ka.hash == kb.hash && ka.name_len == kb.name_len &&
+         memcmp(ka.name, kb.name, ka.name_len) == 0) {
+         TEST_PASS("Key is case-insensitive");
+     } else {
+         TEST_FAIL("Key depends on letter case");
+     }
+
+     /* Test 2: Poškodený dotaz */
+     if (dns_cache_key_from_packet(a, a_len - 3, &ka) == -1 &&
+         dns_cache_key_from_packet(a, 8, &ka) == -1) {
+         TEST_PASS("Truncated packet rejected");
+     } else {
+         TEST_FAIL("Truncated packet accepted");
+     }
+ }
+
+ /**
+  * @brief Test uloženia a zásahu
+  */
+ void test_cache_hit() {
+     printf("\n[TEST] dns_cache_store() / dns_cache_lookup()\n");
+
+     dns_cache_t *cache = dns_cache_create(1024 * 1024, 1024 * 1024, 0);
+     uint8_t query[DNS_UDP_MAX_SIZE], resp[DNS_UDP_MAX_SIZE], out[DNS_UDP_MAX_SIZE];
+     size_t query_len = build_query(query, 0x1111, "example.com");
+     size_t resp_len = build_response(resp, query, query_len, DNS_RCODE_NOERROR, 300);
+     dns_cache_key_t key;
+     dns_cache_key_from_packet(query, query_len, &key);
+
+     /* Test 1: Miss pred uložením */
+     if (dns_cache_lookup(cache, &key, query, out, sizeof(out), 1000, NULL) == 0) {
+         TEST_PASS("Miss on empty cache");
+     } else {
+         TEST_FAIL("Hit on empty cache");
+     }
+
+     /* Test 2: Hit prepíše ID a zachová veľkosť písmen z dotazu */
+     dns_cache_store(cache, &key, resp, resp_len, 1000);
+     uint8_t query2[DNS_UDP_MAX_SIZE];
+     size_t query2_len = build_query(query2, 0xBEEF, "EXAMPLE.com");
+     dns_cache_key_t key2;
+     dns_cache_key_from_packet(query2, query2_len, &key2);
+
+     size_t out_len = dns_cache_lookup(cache, &key2, query2, out, sizeof(out), 1000, NULL);
+     if (out_len == resp_len && out[0] == 0xBE && out[1] == 0xEF &&
+         memcmp(out + DNS_HEADER_SIZE, query2 + DNS_HEADER_SIZE,
+                query2_len - DNS_HEADER_SIZE) == 0) {
+         TEST_PASS("Hit rewrites ID and question");
+     } else {
+         TEST_FAIL("Hit response malformed");
+     }
+
+     /* Test 3: TTL sa znižuje o čas strávený v cache */
+     out_len = dns_cache_lookup(cache, &key, query, out, sizeof(out), 1000 + 120500, NULL);
+     if (out_len > 0 && answer_ttl(out, query_len) == 180) {
+         TEST_PASS("TTL decremented in place");
+     } else {
+         TEST_FAIL("TTL not decremented");
+     }
+
+     /* Test 4: Po uplynutí TTL záznam expiruje */
+     dns_cache_stats_t stats;
+     out_len = dns_cache_lookup(cache, &key, query, out, sizeof(out), 1000 + 300000, NULL);
+     dns_cache_get_stats(cache, &stats);
+     if (out_len == 0 && stats.entries == 0 && stats.expirations == 1) {
+         TEST_PASS("Entry expires after TTL");
+     } else {
+         TEST_FAIL("Expired entry served");
+     }
+
+     dns_cache_destroy(cache);
+ }
+
+ /**
+  * @brief Test necachovateľných odpovedí
+  */
+ void test_cache_uncacheable() {
+     printf("\n[TEST] Uncacheable responses\n");
+
+     dns_cache_t *cache = dns_cache_create(1024 * 1024, 1024 * 1024, 0);
+     uint8_t query[DNS_UDP_MAX_SIZE], resp[DNS_UDP_MAX_SIZE];
+     size_t query_len = build_query(query, 1, "example.com");
+     dns_cache_key_t key;
+     dns_cache_key_from_packet(query, query_len, &key);
+
+     size_t resp_len = build_response(resp, query, query_len, DNS_RCODE_NXDOMAIN, 300);
+     if (dns_cache_store(cache, &key, resp, resp_len, 0) == -1) {
+         TEST_PASS("NXDOMAIN without SOA not cached");
+     } else {
+         TEST_FAIL("NXDOMAIN without SOA cached");
+     }
+
+     resp_len = build_response(resp, query, query_len, DNS_RCODE_NOERROR, 0);
+     if (dns_cache_store(cache, &key, resp, resp_len, 0) == -1) {
+         TEST_PASS("TTL 0 not cached");
+     } else {
+         TEST_FAIL("TTL 0 cached");
+     }
+
+     resp_len = build_response(resp, query, query_len, DNS_RCODE_NOERROR, 300);
+     resp[2] |= 0x02;                            /* TC */
+     if (dns_cache_store(cache, &key, resp, resp_len, 0) == -1) {
+         TEST_PASS("Truncated response not cached");
+     } else {
+         TEST_FAIL("Truncated response cached");
+     }
+
+     resp[2] &= (uint8_t)~0x02;
+     if (dns_cache_store(cache, &key, resp, resp_len - 2, 0) == -1) {
+         TEST_PASS("Malformed RR not cached");
+     } else {
+         TEST_FAIL("Malformed RR cached");
+     }
+
+     dns_cache_destroy(cache);
+ }
+
+ /**
+  * @brief Test pamäťovej kvóty a LRU eviction
+  */
+ void test_cache_eviction() {
+     printf("\n[TEST] Memory budget / LRU eviction\n");
+
+     /* Malá kvóta - do shardu sa zmestí iba pár záznamov */
+     dns_cache_t *cache = dns_cache_create(DNS_CACHE_SHARDS * 1024, 0, 0);
+     uint8_t query[DNS_UDP_MAX_SIZE], resp[DNS_UDP_MAX_SIZE];
+     char name[64];
+
+     for (int i = 0; i < 2000; i++) {
+         snprintf(name, sizeof(name), "host%d.example.com", i);
+         size_t query_len = build_query(query, 1, name);
+         size_t resp_len = build_response(resp, query, query_len, DNS_RCODE_NOERROR, 300);
+         dns_cache_key_t key;
+         dns_cache_key_from_packet(query, query_len, &key);
+         dns_cache_store(cache, &key, resp, resp_len, 0);
+     }
+
+     dns_cache_stats_t stats;
+     dns_cache_get_stats(cache, &stats);
+     if (stats.bytes <= DNS_CACHE_SHARDS * 1024 && stats.evictions > 0 && stats.entries > 0) {
+         TEST_PASS("Memory stays within budget");
+     } else {
+         TEST_FAIL("Budget exceeded");
+     }
+
+     /* Najnovší záznam musí prežiť */
+     uint8_t out[DNS_UDP_MAX_SIZE];
+     size_t query_len = build_query(query, 1, "host1999.example.com");
+     dns_cache_key_t key;
+     dns_cache_key_from_packet(query, query_len, &key);
+     if (dns_cache_lookup(cache, &key, query, out, sizeof(out), 1000, NULL) > 0) {
+         TEST_PASS("Most recent entry kept");
+     } else {
+         TEST_FAIL("Most recent entry evicted");
+     }
+
+     dns_cache_destroy(cache);
+
+     if (dns_cache_create(0, 1024, 0) == NULL) {
+         TEST_PASS("Zero budget rejected");
+     } else {
+         TEST_FAIL("Zero budget accepted");
+     }
+ }
+
+ /**
+  * @brief Test negatívnej cache (RFC 2308)
+  */
+ void test_cache_negative() {
+     printf("\n[TEST] Negative caching (NXDOMAIN / NODATA)\n");
+
+     dns_cache_t *cache = dns_cache_create(1024 * 1024, 1024 * 1024, 0);
+     uint8_t query[DNS_UDP_MAX_SIZE], resp[DNS_UDP_MAX_SIZE], out[DNS_UDP_MAX_SIZE];
+     size_t query_len = build_query(query, 7, "nx.example.com");
+     dns_cache_key_t key;
+     dns_cache_key_from_packet(query, query_len, &key);
+
+     /* Test 1: TTL = min(TTL SOA, MINIMUM), TTL SOA v odpovedi zodpovedá */
+     size_t resp_len = build_negative(resp, query, query_len, DNS_RCODE_NXDOMAIN, 3600, 60);
+     size_t out_len = 0;
+     if (dns_cache_store(cache, &key, resp, resp_len, 0) == 0) {
+         out_len = dns_cache_lookup(cache, &key, query, out, sizeof(out), 10000, NULL);
+     }
+     if (out_len == resp_len && (out[3] & 0x0F) == DNS_RCODE_NXDOMAIN &&
+         answer_ttl(out, query_len) == 50) {
+         TEST_PASS("NXDOMAIN cached for SOA MINIMUM");
+     } else {
+         TEST_FAIL("NXDOMAIN not cached with SOA MINIMUM");
+     }
+
+     /* Test 2: Expirácia po MINIMUM, nie po TTL SOA */
+     if (dns_cache_lookup(cache, &key, query, out, sizeof(out), 61000, NULL) == 0) {
+         TEST_PASS("Negative entry expires after MINIMUM");
+     } else {
+         TEST_FAIL("Negative entry outlived MINIMUM");
+     }
+
+     /* Test 3: NODATA (NOERROR bez odpovede) */
+     resp_len = build_negative(resp, query, query_len, DNS_RCODE_NOERROR, 30, 300);
+     if (dns_cache_store(cache, &key, resp, resp_len, 0) == 0 &&
+         dns_cache_lookup(cache, &key, query, out, sizeof(out), 29000, NULL) == resp_len &&
+         dns_cache_lookup(cache, &key, query, out, sizeof(out), 31000, NULL) == 0) {
+         TEST_PASS("NODATA cached for SOA TTL");
+     } else {
+         TEST_FAIL("NODATA not cached correctly");
+     }
+
+     dns_cache_destroy(cache);
+
+     /* Test 4: Záplava NXDOMAIN nevytlačí pozitívne odpovede */
+     cache = dns_cache_create(DNS_CACHE_SHARDS * 1024, DNS_CACHE_SHARDS * 1024, 0);
+     query_len = build_query(query, 1, "www.example.com");
+     dns_cache_key_from_packet(query, query_len, &key);
+     resp_len = build_response(resp, query, query_len, DNS_RCODE_NOERROR, 300);
+     dns_cache_store(cache, &key, resp, resp_len, 0);
+
+     char name[64];
+     for (int i = 0; i < 2000; i++) {
+         dns_cache_key_t junk_key;
+         snprintf(name, sizeof(name), "junk%d.example.com", i);
+         size_t junk_len = build_query(out, 1, name);
+         dns_cache_key_from_packet(out, junk_len, &junk_key);
+         junk_len = build_negative(resp, out, junk_len, DNS_RCODE_NXDOMAIN, 300, 300);
+         dns_cache_store(cache, &junk_key, resp, junk_len, 0);
+     }
+
+     dns_cache_stats_t stats;
+     dns_cache_get_stats(cache, &stats);
+     if (dns_cache_lookup(cache, &key, query, out, sizeof(out), 1000, NULL) > 0 &&
+         stats.negative_entries > 0 && stats.negative_bytes <= DNS_CACHE_SHARDS * 1024) {
+         TEST_PASS("Negative flood stays in its own budget");
+     } else {
+         TEST_FAIL("Negative flood evicted positive answers");
+     }
+
+     dns_cache_destroy(cache);
+
+     /* Test 5: Nulová kvóta vypne negatívnu cache */
+     cache = dns_cache_create(1024 * 1024, 0, 0);
+     query_len = build_query(query, 7, "nx.example.com");
+     dns_cache_key_from_packet(query, query_len, &key);
+     resp_len = build_negative(resp, query, query_len, DNS_RCODE_NXDOMAIN, 300, 300);
+     if (dns_cache_store(cache, &key, resp, resp_len, 0) == -1) {
+         TEST_PASS("Zero negative budget disables negative caching");
+     } else {
+         TEST_FAIL("Negative answer cached without budget");
+     }
+
+     dns_cache_destroy(cache);
+ }
+
+ /**
+  * @brief Test prefetchu populárnych záznamov pred expiráciou
+  */
+ void test_cache_prefetch() {
+     printf("\n[TEST] Prefetch of hot entries\n");
+
+     dns_cache_t *cache = dns_cache_create(1024 * 1024, 0, 0);
+     uint8_t query[DNS_UDP_MAX_SIZE], resp[DNS_UDP_MAX_SIZE], out[DNS_UDP_MAX_SIZE];
+     size_t query_len = build_query(query, 1, "hot.example.com");
+     size_t resp_len = build_response(resp, query, query_len, DNS_RCODE_NOERROR, 100);
+     dns_cache_key_t key;
+     dns_cache_key_from_packet(query, query_len, &key);
+     dns_cache_store(cache, &key, resp, resp_len, 0);
+
+     /* Test 1: Zásahy na začiatku TTL ani málo zásahov na konci nestačia */
+     bool prefetch = false;
+     bool early = false;
+     for (int i = 0; i < DNS_CACHE_PREFETCH_HITS - 1; i++) {
+         dns_cache_lookup(cache, &key, query, out, sizeof(out), 1000, &prefetch);
+         early = early || prefetch;
+     }
+     dns_cache_lookup(cache, &key, query, out, sizeof(out), 50000, &prefetch);
+     early = early || prefetch;
+     if (!early) {
+         TEST_PASS("No prefetch before the last 10% of TTL");
+     } else {
+         TEST_FAIL("Prefetch requested too early");
+     }
+
+     /* Test 2: Populárny záznam v posledných 10 % TTL - obnova práve raz */
+     bool first = false;
+     bool second = false;
+     dns_cache_lookup(cache, &key, query, out, sizeof(out), 91000, &first);
+     dns_cache_lookup(cache, &key, query, out, sizeof(out), 92000, &second);
+     if (first && !second) {
+         TEST_PASS("Hot entry requests one prefetch near expiry");
+     } else {
+         TEST_FAIL("Prefetch not requested exactly once");
+     }
+
+     /* Test 3: Obnovený záznam zdedí zásahy a obnoví sa znova */
+     dns_cache_store(cache, &key, resp, resp_len, 93000);
+     for (int i = 0; i < DNS_CACHE_PREFETCH_HITS / 2; i++) {
+         dns_cache_lookup(cache, &key, query, out, sizeof(out), 94000, NULL);
+     }
+     dns_cache_lookup(cache, &key, query, out, sizeof(out), 184000, &prefetch);
+
+     dns_cache_stats_t stats;
+     dns_cache_get_stats(cache, &stats);
+     if (prefetch && stats.prefetches == 2) {
+         TEST_PASS("Refreshed entry keeps its popularity");
+     } else {
+         TEST_FAIL("Refreshed entry lost its popularity");
+     }
+
+     dns_cache_destroy(cache);
+ }
+
+ /**
+  * @brief Test serve-stale (RFC 8767)
+  */
+ void test_cache_stale() {
+     printf("\n[TEST] Serve-stale (RFC 8767)\n");
+
+     dns_cache_t *cache = dns_cache_create(1024 * 1024, 0, 3600);
+     uint8_t query[DNS_UDP_MAX_SIZE], resp[DNS_UDP_MAX_SIZE], out[DNS_UDP_MAX_SIZE];
+     size_t query_len = build_query(query, 1, "stale.example.com");
+     size_t resp_len = build_response(resp, query, query_len, DNS_RCODE_NOERROR, 60);
+     dns_cache_key_t key;
+     dns_cache_key_from_packet(query, query_len, &key);
+     dns_cache_store(cache, &key, resp, resp_len, 0);
+
+     /* Test 1: Po TTL ide dotaz na upstream, po termíne stale odpoveď s TTL 30 */
+     bool prefetch = false;
+     size_t fresh_len = dns_cache_lookup(cache, &key, query, out, sizeof(out), 61000, &prefetch);
+     size_t stale_len = dns_cache_lookup_stale(cache, &key, query, out, sizeof(out), 61400);
+     if (fresh_len == 0 && !prefetch && stale_len == resp_len &&
+         answer_ttl(out, query_len) == DNS_CACHE_STALE_TTL) {
+         TEST_PASS("Expired entry served stale only after the deadline");
+     } else {
+         TEST_FAIL("Stale entry handling wrong");
+     }
+
+     /* Test 2: Ďalšie dotazy dostanú stale hneď, obnova najviac raz za 5 s */
+     bool first = false;
+     bool second = false;
+     bool third = false;
+     dns_cache_lookup(cache, &key, query, out, sizeof(out), 62000, &first);
+     dns_cache_lookup(cache, &key, query, out, sizeof(out), 63000, &second);
+     size_t later_len = dns_cache_lookup(cache, &key, query, out, sizeof(out),
+                                         62000 + DNS_CACHE_REFRESH_RETRY_MS, &third);
+     if (first && !second && third && later_len == resp_len) {
+         TEST_PASS("Stale answers are immediate and refreshed in background");
+     } else {
+         TEST_FAIL("Stale answers not refreshed correctly");
+     }
+
+     /* Test 3: Za stale oknom sa záznam odstráni */
+     if (dns_cache_lookup_stale(cache, &key, query, out, sizeof(out), 61000 + 3600000) == 0 &&
+         dns_cache_lookup(cache, &key, query, out, sizeof(out), 61000 + 3600000, NULL) == 0) {
+         TEST_PASS("Entry dropped after the stale window");
+     } else {
+         TEST_FAIL("Entry served past the stale window");
+     }
+
+     dns_cache_destroy(cache);
+ }
+
+ /**
+  * @brief Test snapshotu cache (warm restart)
+  */
+ void test_cache_snapshot() {
+     printf("\n[TEST] Cache snapshot\n");
+
+     const char *path = "/tmp/test_cache_snapshot.bin";
+     const char *names[3] = { "long.example.com", "short.example.com", "nx.example.com" };
+     uint8_t query[3][DNS_UDP_MAX_SIZE];
+     size_t query_len[3];
+     dns_cache_key_t key[3];
+     uint8_t resp[DNS_UDP_MAX_SIZE], out[DNS_UDP_MAX_SIZE];
+
+     dns_cache_t *cache = dns_cache_create(1024 * 1024, 1024 * 1024, 0);
+     for (size_t i = 0; i < 3; i++) {
+         query_len[i] = build_query(query[i], 1, names[i]);
+         dns_cache_key_from_packet(query[i], query_len[i], &key[i]);
+     }
+     size_t resp_len = build_response(resp, query[0], query_len[0], DNS_RCODE_NOERROR, 300);
+     dns_cache_store(cache, &key[0], resp, resp_len, 0);
+     resp_len = build_response(resp, query[1], query_len[1], DNS_RCODE_NOERROR, 120);
+     dns_cache_store(cache, &key[1], resp, resp_len, 0);
+     resp_len = build_negative(resp, query[2], query_len[2], DNS_RCODE_NXDOMAIN, 3600, 600);
+     dns_cache_store(cache, &key[2], resp, resp_len, 0);
+
+     /* Test 1: Zápis po 100 s - všetky záznamy sú ešte platné */
+     size_t saved = 0;
+     unlink(path);
+     if (dns_cache_save(cache, path, 100000, 1000000, &saved) == 0 && saved == 3) {
+         TEST_PASS("Snapshot saves all live entries");
+     } else {
+         TEST_FAIL("Snapshot not saved");
+     }
+     dns_cache_destroy(cache);
+
+     /* Test 2: Reštart o 60 s neskôr (iný monotónny čas) - short.example.com
+      * mal 20 s TTL, preskočí sa */
+     cache = dns_cache_create(1024 * 1024, 1024 * 1024, 0);
+     size_t loaded = 0;
+     int rc = dns_cache_load(cache, path, 5000, 1000060, &loaded);
+     if (rc == 0 && loaded == 2 &&
+         dns_cache_lookup(cache, &key[1], query[1], out, sizeof(out), 5000, NULL) == 0) {
+         TEST_PASS("Expired records dropped on load");
+     } else {
+         TEST_FAIL("Expired records loaded");
+     }
+
+     /* Test 3: TTL = 300 - 100 (pred zápisom) - 60 (kým server nebežal) */
+     size_t len = dns_cache_lookup(cache, &key[0], query[0], out, sizeof(out), 5000, NULL);
+     size_t nx_len = dns_cache_lookup(cache, &key[2], query[2], out + len, sizeof(out) - len,
+                                      5000, NULL);
+     if (len > 0 && answer_ttl(out, query_len[0]) == 140 && nx_len > 0 &&
+         (out[len + 3] & 0x0F) == DNS_RCODE_NXDOMAIN) {
+         TEST_PASS("Loaded entries keep their remaining TTL");
+     } else {
+         TEST_FAIL("Loaded entries have wrong TTL");
+     }
+     dns_cache_destroy(cache);
+
+     /* Test 4: Chýbajúci snapshot nie je chyba, cudzí súbor sa odmietne */
+     cache = dns_cache_create(1024 * 1024, 0, 0);
+     unlink(path);
+     int missing_rc = dns_cache_load(cache, path, 0, 1000000, &loaded);
+     FILE *f = fopen(path, "wb");
+     if (f != NULL) {
+         fputs("not a cache snapshot, just some text", f);
+         fclose(f);
+     }
+     int invalid_rc = dns_cache_load(cache, path, 0, 1000000, &loaded);
+     if (missing_rc == 0 && invalid_rc == -1 && loaded == 0) {
+         TEST_PASS("Missing snapshot ignored, invalid snapshot rejected");
+     } else {
+         TEST_FAIL("Missing or invalid snapshot handled wrong");
+     }
+     unlink(path);
+     dns_cache_destroy(cache);
+ }
+
+ /**
+  * @brief Test DNSSEC bitov v kľúči (DO, CD) - aj po snapshote
+  */
+ void test_cache_dnssec() {
+     printf("\n[TEST] DO and CD bits in the cache key\n");
+
+     const char *path = "/tmp/test_cache_dnssec.bin";
+     uint8_t plain[DNS_UDP_MAX_SIZE], cd[DNS_UDP_MAX_SIZE], dnssec[DNS_UDP_MAX_SIZE];
+     uint8_t resp[DNS_UDP_MAX_SIZE], out[DNS_UDP_MAX_SIZE];
+     dns_cache_key_t plain_key, cd_key, do_key;
+
+     size_t plain_len = build_query(plain, 1, "sec.example.com");
+     dns_cache_key_from_packet(plain, plain_len, &plain_key);
+
+     /* CD=1 - klient si validáciu robí sám */
+     size_t cd_len = build_query(cd, 1, "sec.example.com");
+     cd[3] |= DNS_FLAG_CD;
+     dns_cache_key_from_packet(cd, cd_len, &cd_key);
+
+     /* DO=1 v OPT (payload 1232) */
+     static const uint8_t opt_do[DNS_OPT_RR_SIZE] = { 0, 0, 41, 0x04, 0xD0, 0, 0, 0x80, 0, 0, 0 };
+     size_t do_len = build_query(dnssec, 1, "sec.example.com");
+     memcpy(dnssec + do_len, opt_do, sizeof(opt_do));
+     dnssec[11] = 1;
+     do_len += sizeof(opt_do);
+     dns_cache_key_from_packet(dnssec, do_len, &do_key);
+
+     size_t resp_len = build_response(resp, plain, plain_len, DNS_RCODE_NOERROR, 300);
+
+     /* Test 1: Nevalidovaná odpoveď (CD=1) nejde validujúcemu klientovi */
+     dns_cache_t *cache = dns_cache_create(1024 * 1024, 0, 0);
+     dns_cache_store(cache, &cd_key, resp, resp_len, 0);
+     if (dns_cache_lookup(cache, &plain_key, plain, out, sizeof(out), 1000, NULL) == 0 &&
+         dns_cache_lookup(cache, &cd_key, cd, out, sizeof(out), 1000, NULL) > 0) {
+         TEST_PASS("CD=1 answer served only to CD=1 queries");
+     } else {
+         TEST_FAIL("CD=1 answer leaked to a CD=0 query");
+     }
+     dns_cache_destroy(cache);
+
+     /* Test 2: Odpoveď bez RRSIG (DO=0) nejde DO klientovi a naopak */
+     cache = dns_cache_create(1024 * 1024, 0, 0);
+     dns_cache_store(cache, &plain_key, resp, resp_len, 0);
+     bool plain_only = dns_cache_lookup(cache, &do_key, dnssec, out, sizeof(out), 1000, NULL) == 0;
+     dns_cache_destroy(cache);
+
+     cache = dns_cache_create(1024 * 1024, 0, 0);
+     dns_cache_store(cache, &do_key, resp, resp_len, 0);
+     bool do_only = dns_cache_lookup(cache, &plain_key, plain, out, sizeof(out), 1000, NULL) == 0 &&
+                    dns_cache_lookup(cache, &do_key, dnssec, out, sizeof(out), 1000, NULL) > 0;
+     if (plain_only && do_only && do_key.hash != plain_key.hash) {
+         TEST_PASS("DO=1 and DO=0 answers cached separately");
+     } else {
+         TEST_FAIL("DO bit ignored by the cache key");
+     }
+
+     /* Test 3: Snapshot si DNSSEC bity pamätá (odpoveď ich nenesie) */
+     size_t saved = 0, loaded = 0;
+     unlink(path);
+     dns_cache_save(cache, path, 1000, 1000000, &saved);
+     dns_cache_destroy(cache);
+
+     cache = dns_cache_create(1024 * 1024, 0, 0);
+     dns_cache_load(cache, path, 0, 1000000, &loaded);
+     if (saved == 1 && loaded == 1 &&
+         dns_cache_lookup(cache, &plain_key, plain, out, sizeof(out), 1000, NULL) == 0 &&
+         dns_cache_lookup(cache, &do_key, dnssec, out, sizeof(out), 1000, NULL) > 0) {
+         TEST_PASS("Snapshot keeps the DNSSEC bits of the key");
+     } else {
+         TEST_FAIL("Snapshot lost the DNSSEC bits of the key");
+     }
+     unlink(path);
+     dns_cache_destroy(cache);
+ }
+
+ /**
+  * @brief Main test runner
+  */
+ int main() {
+     printf("==============================================\n");
+     printf("Response Cache Unit Tests\n");
+     printf("==============================================\n");
+
+     test_cache_key();
+     test_cache_hit();
+     test_cache_uncacheable();
+     test_cache_eviction();
+     test_cache_negative();
+     test_cache_prefetch();
+     test_cache_stale();
+     test_cache_snapshot();
+     test_cache_dnssec();
+
+     printf("\n==============================================\n");
+     printf("TEST RESULTS:\n");
+     printf("  " COLOR_GREEN "Passed: %d" COLOR_RESET "\n", tests_passed);
+     if (tests_failed > 0) {
+         printf("  " COLOR_RED "Failed: %d" COLOR_RESET "\n", tests_failed);
+     } else {
+         printf("  Failed: 0\n");
+     }
+     printf("  Total:  %d\n", tests_passed + tests_failed);
+     printf("==============================================\n");
+
+     if (tests_failed == 0) {
+         printf(COLOR_GREEN " All tests passed!" COLOR_RESET "\n");
+         return 0;
+     } else {
+         printf(COLOR_RED " Some tests failed!" COLOR_RESET "\n");
+         return 1;
+     }
+ }
@@ -315,6 +315,180 @@
  /**
   * @brief Test build_dns_header
   */
+ void test_build_error_in_place() {
+     printf("\n[TEST] build_error_in_place()\n");
+     
+     /* Dotaz s EDNS OPT záznamom za otázkou - v odpovedi sa odreže */
+     uint8_t query_buffer[] = {
+         0x12, 0x34,        /* ID */
+         0x01, 0x00,        /* Flags: RD=1 */
+         0x00, 0x01,        /* QDCOUNT = 1 */
+         0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+         3, 'a', 'd', 's', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+         0x00, 0x01, 0x00, 0x01,
+         0x00, 0x00, 0x29, 0x04, 0xD0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+     };
+     size_t question_end = DNS_HEADER_SIZE + 17 + 4;
+     
+     dns_message_t query;
+     uint8_t *expected = NULL;
+     size_t expected_len = 0;
+     if (parse_dns_message(query_buffer, sizeof(query_buffer), &query) != 0 ||
+         build_error_response(&query, DNS_RCODE_NXDOMAIN, &expected, &expected_len) != 0) {
+         TEST_FAIL("Príprava referenčnej odpovede zlyhala");
+         return;
+     }
+     free_dns_message(&query);
+     
+     /* Test 1: Zhoda s build_error_response() */
+     uint8_t packet[sizeof(query_buffer)];
+     memcpy(packet, query_buffer, sizeof(query_buffer));
+     size_t resp_len = build_error_in_place(packet, question_end, DNS_RCODE_NXDOMAIN);
+     
+     if (resp_len == expected_len && memcmp(packet, expected, resp_len) == 0) {
+         TEST_PASS("In-place NXDOMAIN zhodné s build_error_response()");
+     } else {
+         TEST_FAIL("In-place odpoveď sa líši");
+     }
+     free(expected);
+     
+     /* Test 2: Neplatný RCODE */
+     memcpy(packet, query_buffer, sizeof(query_buffer));
+     if (build_error_in_place(packet, question_end, 15) == 0) {
+         TEST_PASS("Odmietnutie neplatného RCODE");
+     } else {
+         TEST_FAIL("Mal odmietnuť neplatný RCODE");
+     }
+ }
+ 
+ void test_build_error_from_view() {
+     printf("\n[TEST] build_error_from_view()\n");
+     
+     uint8_t query_buffer[] = {
+         0x43, 0x21, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+         0x00, 0x0F, 0x00, 0x01
+     };
+     uint8_t response[DNS_UDP_MAX_SIZE];
+     dns_view_t view;
+     
+     /* Test 1: Zhoda s build_error_response() */
+     dns_message_t query;
+     uint8_t *expected = NULL;
+     size_t expected_len = 0;
+     if (parse_dns_message(query_buffer, sizeof(query_buffer), &query) != 0 ||
+         build_error_response(&query, DNS_RCODE_NOTIMPL, &expected, &expected_len) != 0 ||
+         dns_view_parse(query_buffer, sizeof(query_buffer), &view, NULL, 0) != 0) {
+         TEST_FAIL("Príprava referenčnej odpovede zlyhala");
+         return;
+     }
+     free_dns_message(&query);
+     
+     size_t resp_len = build_error_from_view(&view, DNS_RCODE_NOTIMPL,
+                                             response, sizeof(response));
+     if (resp_len == expected_len && memcmp(response, expected, resp_len) == 0) {
+         TEST_PASS("Odpoveď z view zhodná s build_error_response()");
+     } else {
+         TEST_FAIL("Odpoveď z view sa líši");
+     }
+     free(expected);
+     
+     /* Test 2: Dotaz bez otázky -> FORMERR iba s hlavičkou */
+     query_buffer[5] = 0;
+     if (dns_view_parse(query_buffer, DNS_HEADER_SIZE, &view, NULL, 0) == 0 &&
+         build_error_from_view(&view, DNS_RCODE_FORMERR, response,
+                               sizeof(response)) == DNS_HEADER_SIZE &&
+         (response[3] & 0x0F) == DNS_RCODE_FORMERR && response[5] == 0) {
+         TEST_PASS("FORMERR pre dotaz bez otázky");
+     } else {
+         TEST_FAIL("FORMERR bez otázky zlyhal");
+     }
+ }
+ 
+ /**
+  * @brief Test EDNS(0) - pridanie/odstránenie OPT a prispôsobenie odpovede
+  */
+ void test_dns_fit_response() {
+     printf("\n[TEST] dns_append_opt() / dns_fit_response()\n");
+     
+     uint8_t query[64] = {
+         0x43, 0x21, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+         0x00, 0x01, 0x00, 0x01
+     };
+     size_t query_len = 29;
+     uint8_t original[64];
+     memcpy(original, query, sizeof(original));
+     
+     /* Test 1: OPT sa pridá za otázku a dá sa zase odstrániť */
+     dns_edns_t opt = { .present = true, .udp_size = DNS_EDNS_UDP_SIZE, .dnssec_ok = true };
+     dns_edns_t parsed;
+     size_t len = dns_append_opt(query, query_len, sizeof(query), &opt);
+     if (len == query_len + DNS_OPT_RR_SIZE && query[11] == 1 &&
+         dns_parse_edns(query, len, &parsed) == 0 && parsed.present &&
+         parsed.udp_size == DNS_EDNS_UDP_SIZE && parsed.dnssec_ok &&
+         parsed.opt_offset == query_len &&
+         dns_remove_opt(query, len, &parsed) == query_len &&
+         memcmp(query, original, query_len) == 0) {
+         TEST_PASS("OPT pridaný a odstránený");
+     } else {
+         TEST_FAIL("Pridanie/odstránenie OPT zlyhalo");
+     }
+     
+     /* Odpoveď upstream: 40x A (669 B) + OPT s payloadom 4096 */
+     uint8_t response[DNS_EDNS_MAX_SIZE];
+     memcpy(response, original, query_len);
+     response[2] = 0x81;
+     response[3] = 0x80;
+     response[7] = 40;
+     size_t resp_len = query_len;
+     for (int i = 0; i < 40; i++) {
+         const uint8_t rr[] = { 0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2C,
+                                0x00, 0x04, 10, 0, 0, (uint8_t)i };
+         memcpy(response + resp_len, rr, sizeof(rr));
+         resp_len += sizeof(rr);
+     }
+     opt.udp_size = 4096;
+     opt.dnssec_ok = false;
+     resp_len = dns_append_opt(response, resp_len, sizeof(response), &opt);
+     
+     uint8_t copy[DNS_EDNS_MAX_SIZE];
+     memcpy(copy, response, resp_len);
+     
+     /* Test 2: Klient bez EDNS (512 B) - skrátenie na otázku s TC */
+     dns_edns_t client;
+     memset(&client, 0, sizeof(client));
+     len = dns_fit_response(copy, resp_len, sizeof(copy), &client, dns_edns_payload(&client));
+     if (len == query_len && (copy[2] & 0x02) && copy[7] == 0 && copy[11] == 0) {
+         TEST_PASS("Skrátenie s TC pre klienta bez EDNS");
+     } else {
+         TEST_FAIL("Odpoveď mala byť skrátená");
+     }
+     
+     /* Test 3: Klient bez EDNS cez TCP - celá odpoveď bez OPT */
+     memcpy(copy, response, resp_len);
+     len = dns_fit_response(copy, resp_len, sizeof(copy), &client, sizeof(copy));
+     if (len == resp_len - DNS_OPT_RR_SIZE && !(copy[2] & 0x02) &&
+         copy[7] == 40 && copy[11] == 0) {
+         TEST_PASS("Celá odpoveď pre TCP klienta");
+     } else {
+         TEST_FAIL("TCP odpoveď nemala byť skrátená");
+     }
+     
+     /* Test 4: EDNS klient - celá odpoveď, OPT nahradený naším */
+     client.present = true;
+     client.udp_size = 4096;
+     memcpy(copy, response, resp_len);
+     len = dns_fit_response(copy, resp_len, sizeof(copy), &client, dns_edns_payload(&client));
+     if (len == resp_len && !(copy[2] & 0x02) && copy[7] == 40 &&
+         dns_parse_edns(copy, len, &parsed) == 0 &&
+         parsed.udp_size == DNS_EDNS_UDP_SIZE) {
+         TEST_PASS("Celá odpoveď pre EDNS klienta");
+     } else {
+         TEST_FAIL("EDNS odpoveď nesprávne prispôsobená");
+     }
+ }
+ 
  void test_build_dns_header() {
      printf("\n[TEST] build_dns_header()\n");
      
@@ -374,6 +548,9 @@
      test_encode_dns_name();
      test_build_error_response();
      test_roundtrip();
+     test_build_error_in_place();
+     test_build_error_from_view();
+     test_dns_fit_response();
      test_build_dns_header();
      
      printf("\n==============================================\n");
@@ -216,6 +216,210 @@
      }
  }
  
+ /**
+  * @brief Test dns_wire_name_length (meno bez kopírovania)
+  */
+ void test_dns_wire_name_length() {
+     printf("\n[TEST] dns_wire_name_length()\n");
+     
+     uint8_t buffer[] = {
+         3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+         4, 'm', 'a', 'i', 'l', 0xC0, 0x04
+     };
+     
+     /* Test 1: Nekomprimované meno */
+     if (dns_wire_name_length(buffer, sizeof(buffer), 0) == 17) {
+         TEST_PASS("Dĺžka nekomprimovaného mena");
+     } else {
+         TEST_FAIL("Nesprávna dĺžka mena");
+     }
+     
+     /* Test 2: Compression pointer -> volajúci použije parse_dns_name() */
+     if (dns_wire_name_length(buffer, sizeof(buffer), 17) == -1) {
+         TEST_PASS("Odmietnutie komprimovaného mena");
+     } else {
+         TEST_FAIL("Mal odmietnuť compression pointer");
+     }
+     
+     /* Test 3: Meno neukončené v rámci bufferu */
+     if (dns_wire_name_length(buffer, 10, 0) == -1) {
+         TEST_PASS("Odmietnutie neukončeného mena");
+     } else {
+         TEST_FAIL("Mal odmietnuť neukončené meno");
+     }
+ }
+ 
+ /**
+  * @brief Test dns_view_parse (zero-copy pohľad)
+  */
+ void test_dns_view_parse() {
+     printf("\n[TEST] dns_view_parse()\n");
+     
+     /* Dve otázky, druhá s komprimovaným menom */
+     uint8_t buffer[] = {
+         0xBE, 0xEF, 0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         4, 'M', 'a', 'i', 'l', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'o', 'r', 'g', 0,
+         0x00, 0x01, 0x00, 0x01,
+         3, 'w', 'w', 'w', 0xC0, 0x11,
+         0x00, 0x1C, 0x00, 0x01
+     };
+     
+     dns_view_t view;
+     char qname[DNS_MAX_NAME_LEN + 1];
+     
+     /* Test 1: Hlavička, prvá otázka a offsety */
+     if (dns_view_parse(buffer, sizeof(buffer), &view, qname, sizeof(qname)) == 0 &&
+         view.header.id == 0xBEEF && view.header.qdcount == 2 &&
+         strcmp(qname, "Mail.example.org") == 0 &&
+         view.qtype == DNS_TYPE_A && view.qclass == DNS_CLASS_IN &&
+         view.qname_offset == DNS_HEADER_SIZE && view.qname_len == 18 &&
+         !view.qname_compressed && view.question_end == 34 &&
+         view.questions_end == sizeof(buffer) && view.packet == buffer) {
+         TEST_PASS("View s offsetmi do bufferu");
+     } else {
+         TEST_FAIL("Nesprávne hodnoty vo view");
+     }
+     
+     /* Test 2: Bez dekódovania QNAME */
+     if (dns_view_parse(buffer, sizeof(buffer), &view, NULL, 0) == 0 &&
+         view.questions_end == sizeof(buffer)) {
+         TEST_PASS("View bez dekódovania QNAME");
+     } else {
+         TEST_FAIL("View bez QNAME zlyhal");
+     }
+     
+     /* Test 3: Rovnaké odmietnutie ako parse_dns_message() */
+     dns_message_t message;
+     int message_rc = parse_dns_message(buffer, sizeof(buffer) - 1, &message);
+     if (message_rc == 0) {
+         free_dns_message(&message);
+     }
+     if (dns_view_parse(buffer, sizeof(buffer) - 1, &view, qname, sizeof(qname)) == -1 &&
+         message_rc == -1) {
+         TEST_PASS("Odmietnutie skrátenej druhej otázky");
+     } else {
+         TEST_FAIL("Mal odmietnuť skrátenú správu");
+     }
+     
+     /* Test 4: Wrapper dns_parse_query() nad view */
+     dns_query_t query;
+     if (dns_parse_query(buffer, sizeof(buffer), &query) == 0 &&
+         strcmp(query.qname, "Mail.example.org") == 0 && query.qtype == DNS_TYPE_A) {
+         TEST_PASS("dns_parse_query() cez view");
+     } else {
+         TEST_FAIL("dns_parse_query() zlyhal");
+     }
+ }
+ 
+ /**
+  * @brief Test lenivého iterátora záznamov (dns_rr_iter_*)
+  */
+ void test_dns_rr_iter() {
+     printf("\n[TEST] dns_rr_iter_next()\n");
+     
+     /* Odpoveď: CNAME -> A (komprimované mená) + OPT v additional */
+     uint8_t buffer[] = {
+         0xBE, 0xEF, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01,
+         3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+         0x00, 0x01, 0x00, 0x01,
+         0xC0, 0x0C, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2C, 0x00, 0x06,
+         3, 'c', 'd', 'n', 0xC0, 0x10,
+         0xC0, 0x2D, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04,
+         1, 2, 3, 4,
+         0x00, 0x00, 0x29, 0x04, 0xD0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+     };
+     
+     dns_rr_iter_t iter;
+     dns_rr_t rr[5];
+     int count = 0;
+     int rc = -1;
+     
+     if (dns_rr_iter_init(&iter, buffer, sizeof(buffer)) == 0) {
+         while (count < 5 && (rc = dns_rr_iter_next(&iter, &rr[count])) == 1) {
+             count++;
+         }
+     }
+     
+     /* Test 1: Všetky sekcie v poradí, polia priamo z paketu */
+     if (rc == 0 && count == 4 &&
+         rr[0].section == DNS_SECTION_QUESTION && rr[0].type == DNS_TYPE_A &&
+         rr[1].section == DNS_SECTION_ANSWER && rr[1].type == DNS_TYPE_CNAME &&
+         rr[1].ttl == 300 && rr[1].rdata_offset == 45 && rr[1].rdlength == 6 &&
+         rr[2].section == DNS_SECTION_ANSWER && rr[2].ttl == 60 &&
+         rr[2].ttl_offset == 57 && memcmp(buffer + rr[2].rdata_offset, "\1\2\3\4", 4) == 0 &&
+         rr[3].section == DNS_SECTION_ADDITIONAL && rr[3].type == DNS_TYPE_OPT &&
+         rr[3].rr_class == 1232) {
+         TEST_PASS("Question, answer aj additional sekcia");
+     } else {
+         TEST_FAIL("Nesprávne dekódované záznamy");
+     }
+     
+     /* Test 2: Komprimované mená bez kópie */
+     if (count == 4 &&
+         dns_name_equals(buffer, sizeof(buffer), rr[1].name_offset, "WWW.example.com") &&
+         dns_name_equals(buffer, sizeof(buffer), rr[1].rdata_offset, "cdn.example.com") &&
+         dns_name_equals(buffer, sizeof(buffer), rr[2].name_offset, "cdn.example.com") &&
+         !dns_name_equals(buffer, sizeof(buffer), rr[2].name_offset, "cdn.example") &&
+         dns_name_equals(buffer, sizeof(buffer), rr[3].name_offset, "")) {
+         TEST_PASS("Porovnanie komprimovaných mien");
+     } else {
+         TEST_FAIL("Porovnanie mien zlyhalo");
+     }
+     
+     /* Test 3: RDATA za koncom správy */
+     if (dns_validate_message(buffer, sizeof(buffer)) == 0 &&
+         dns_validate_message(buffer, sizeof(buffer) - 1) == -1) {
+         TEST_PASS("Odmietnutie skráteného RR");
+     } else {
+         TEST_FAIL("Mal odmietnuť skrátený RR");
+     }
+     
+     /* Test 4: Pointer dopredu (slučka) */
+     buffer[34] = 0x2D;
+     if (dns_validate_message(buffer, sizeof(buffer)) == -1) {
+         TEST_PASS("Odmietnutie pointera dopredu");
+     } else {
+         TEST_FAIL("Mal odmietnuť pointer dopredu");
+     }
+ }
+ 
+ /**
+  * @brief Test dns_parse_edns a dns_edns_payload
+  */
+ void test_dns_parse_edns() {
+     printf("\n[TEST] dns_parse_edns()\n");
+     
+     /* Dotaz s dvoma OPT záznamami (payload 4096 a 300) */
+     uint8_t buffer[] = {
+         0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+         3, 'c', 'o', 'm', 0, 0x00, 0x01, 0x00, 0x01,
+         0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+         0x00, 0x00, 0x29, 0x01, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+     };
+     dns_edns_t edns;
+     
+     /* Test 1: Viac OPT = chyba (FORMERR) */
+     if (dns_parse_edns(buffer, sizeof(buffer), &edns) == -1) {
+         TEST_PASS("Odmietnutie dvoch OPT záznamov");
+     } else {
+         TEST_FAIL("Mal odmietnuť dva OPT záznamy");
+     }
+     
+     /* Test 2: Jeden OPT, payload obmedzený na DNS_EDNS_UDP_SIZE */
+     buffer[11] = 1;
+     size_t payload_4096 = 0;
+     if (dns_parse_edns(buffer, sizeof(buffer) - DNS_OPT_RR_SIZE, &edns) == 0) {
+         payload_4096 = dns_edns_payload(&edns);
+     }
+     edns.udp_size = 300;
+     if (edns.present && edns.dnssec_ok && payload_4096 == DNS_EDNS_UDP_SIZE &&
+         dns_edns_payload(&edns) == DNS_UDP_MAX_SIZE) {
+         TEST_PASS("Payload klienta v rozsahu 512-1232");
+     } else {
+         TEST_FAIL("Nesprávny EDNS payload");
+     }
+ }
+ 
  /**
   * @brief Test parsing DNS question section
   */
@@ -369,6 +573,10 @@
      test_parse_dns_header();
      test_parse_dns_name_simple();
      test_parse_dns_name_compression();
+     test_dns_wire_name_length();
+     test_dns_view_parse();
+     test_dns_rr_iter();
+     test_dns_parse_edns();
      test_parse_dns_question();
      test_parse_dns_message();
      test_free_dns_message();
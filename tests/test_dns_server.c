@@ -258,6 +258,100 @@ void test_blocked_domain_fast(const char *domain) {
     }
 }
 
+/**
+ * Prijme presne len bajtov z TCP spojenia
+ */
+int recv_exact(int sockfd, uint8_t *buffer, size_t len) {
+    size_t got = 0;
+    
+    while (got < len) {
+        ssize_t n = recv(sockfd, buffer + got, len - got, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        got += (size_t)n;
+    }
+    
+    return 0;
+}
+
+/**
+ * Test helper - dva pipelined dotazy na jednom TCP spojení (RFC 7766)
+ * 
+ * Blokovaný a povolený dotaz idú jedným send(), odpovede môžu prísť
+ * v ľubovoľnom poradí - párujú sa podľa transaction ID.
+ */
+void test_tcp_pipelining(const char *blocked, const char *allowed) {
+    test_num++;
+    printf("\n" COLOR_BLUE "[TEST %d]" COLOR_RESET " TCP pipelining: %s + %s\n",
+           test_num, blocked, allowed);
+    
+    uint8_t frames[1024];
+    size_t frames_len = 0;
+    const char *domains[2] = { blocked, allowed };
+    
+    for (int i = 0; i < 2; i++) {
+        size_t query_len;
+        if (create_test_query(domains[i], DNS_TYPE_A, frames + frames_len + 2,
+                              sizeof(frames) / 2 - 2, &query_len) != 0) {
+            printf("  " COLOR_RED " FAIL" COLOR_RESET ": Failed to create query\n");
+            tests_failed++;
+            return;
+        }
+        *(uint16_t *)(frames + frames_len) = htons((uint16_t)query_len);
+        *(uint16_t *)(frames + frames_len + 2) = htons((uint16_t)(i + 1));
+        frames_len += query_len + 2;
+    }
+    
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        tests_failed++;
+        return;
+    }
+    
+    struct timeval timeout = { TIMEOUT_SEC, 0 };
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(TEST_PORT);
+    inet_pton(AF_INET, TEST_SERVER, &server_addr.sin_addr);
+    
+    int rcodes[3] = { -1, -1, -1 };
+    
+    if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == 0 &&
+        send(sockfd, frames, frames_len, 0) == (ssize_t)frames_len) {
+        for (int i = 0; i < 2; i++) {
+            uint8_t response[4096];
+            uint16_t len;
+            
+            if (recv_exact(sockfd, (uint8_t *)&len, 2) != 0 ||
+                ntohs(len) > sizeof(response) ||
+                recv_exact(sockfd, response, ntohs(len)) != 0) {
+                break;
+            }
+            
+            uint16_t id = ntohs(*(uint16_t *)response);
+            if (id == 1 || id == 2) {
+                rcodes[id] = get_rcode(response, ntohs(len));
+            }
+        }
+    }
+    
+    close(sockfd);
+    
+    if (rcodes[1] == DNS_RCODE_NXDOMAIN && rcodes[2] == DNS_RCODE_NOERROR) {
+        printf("  " COLOR_GREEN " PASS" COLOR_RESET
+               ": Both responses on one connection\n");
+        tests_passed++;
+    } else {
+        printf("  " COLOR_RED " FAIL" COLOR_RESET
+               ": RCODE=%d / %d (expected NXDOMAIN / NOERROR)\n", rcodes[1], rcodes[2]);
+        tests_failed++;
+    }
+}
+
 /**
  * Main test suite
  */
@@ -384,6 +478,11 @@ int main(int argc, char *argv[]) {
                                  expected[i], "Rapid fire query");
     }
     
+    printf("\n" COLOR_BLUE "════ TCP TESTS ════" COLOR_RESET "\n");
+    
+    // Test 26: Pipelined TCP queries
+    test_tcp_pipelining("ads.google.com", "google.com");
+    
     // Summary
     printf("\n══════════════════════════════════════════════════════════════\n");
     printf("                       TEST SUMMARY\n");
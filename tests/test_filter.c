@@ -9,7 +9,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <time.h>
 #include "filter.h"
+#include "filter_reload.h"
 
 // Test counter
 static int tests_run = 0;
@@ -614,8 +617,69 @@ void test_filter_newline() {
     PASS();
 }
 
+void test_filter_label_prefix() {
+    TEST("Label prefix is not a match");
+    
+    filter_t *filter = filter_init();
+    filter_insert(filter, "ads.example.com");
+    
+    // Labels are compared in place, length must match exactly
+    assert(filter_lookup(filter, "ad.example.com") == false);
+    assert(filter_lookup(filter, "adsx.example.com") == false);
+    assert(filter_lookup(filter, "x.ads.exampl.com") == false);
+    assert(filter_lookup(filter, "x.ads.example.com") == true);
+    
+    filter_free(filter);
+    PASS();
+}
+
+void test_filter_wire_name() {
+    TEST("Wire-format name lookup");
+    
+    filter_t *filter = filter_init();
+    filter_insert(filter, "ads.example.com");
+    
+    const uint8_t blocked[] = { 3, 'W', 'w', 'W', 3, 'A', 'D', 'S', 7, 'e', 'x', 'a',
+                                'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0 };
+    const uint8_t allowed[] = { 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0 };
+    const uint8_t root_name[] = { 0 };
+    
+    assert(is_wire_name_blocked(filter->root, blocked, sizeof(blocked)) == true);
+    assert(is_wire_name_blocked(filter->root, allowed, sizeof(allowed)) == false);
+    assert(is_wire_name_blocked(filter->root, root_name, sizeof(root_name)) == false);
+    // Unterminated name
+    assert(is_wire_name_blocked(filter->root, blocked, sizeof(blocked) - 1) == false);
+    
+    // Same result after compaction
+    filter_compact(filter->root);
+    assert(is_wire_name_blocked(filter->root, blocked, sizeof(blocked)) == true);
+    assert(is_wire_name_blocked(filter->root, allowed, sizeof(allowed)) == false);
+    
+    filter_free(filter);
+    PASS();
+}
+
+void test_filter_label_too_long() {
+    TEST("Label longer than 63 chars rejected");
+    
+    filter_t *filter = filter_init();
+    
+    char domain[80];
+    memset(domain, 'a', 64);
+    domain[64] = '\0';
+    strcat(domain, ".com");
+    
+    // Invalid domain must not leave a partial path in the Trie
+    assert(filter_insert(filter, domain) == -1);
+    assert(filter->root->children_count == 0);
+    assert(filter_lookup(filter, domain) == false);
+    
+    filter_free(filter);
+    PASS();
+}
+
 // ============================================================================
-// TEST 41-47: Performance and Stress Tests
+// TEST 43-54: Performance and Stress Tests
 // ============================================================================
 
 void test_filter_many_domains() {
@@ -698,6 +762,316 @@ void test_filter_wide_trie() {
     PASS();
 }
 
+void test_filter_hashed_children() {
+    TEST("Hashed child index on wide node");
+    
+    filter_t *filter = filter_init();
+    char domain[64];
+    
+    // Enough siblings to build and grow the hash index several times
+    for (int i = 0; i < 5000; i++) {
+        snprintf(domain, sizeof(domain), "site%d.com", i);
+        assert(filter_insert(filter, domain) == 0);
+    }
+    
+    const filter_node_t *com = filter->root->children[0];
+    assert(com->children_count == 5000);
+    assert(com->child_index != NULL);
+    
+    for (int i = 0; i < 5000; i++) {
+        snprintf(domain, sizeof(domain), "www.site%d.com", i);
+        assert(filter_lookup(filter, domain) == true);
+    }
+    assert(filter_lookup(filter, "site5000.com") == false);
+    assert(filter_lookup(filter, "site.com") == false);
+    assert(filter_lookup(filter, "com") == false);
+    
+    filter_free(filter);
+    PASS();
+}
+
+void test_filter_compact_lookup() {
+    TEST("Compact Trie gives same results");
+    
+    filter_t *filter = filter_init();
+    char domain[64];
+    
+    // Wide node (hash index) + shared labels (interned once)
+    for (int i = 0; i < 200; i++) {
+        snprintf(domain, sizeof(domain), "ads.site%d.com", i);
+        filter_insert(filter, domain);
+    }
+    filter_insert(filter, "tracker.net");
+    filter_insert(filter, "a.b.c.example.org");
+    
+    size_t domains = filter_domain_count(filter->root);
+    size_t tree_bytes = filter_memory_usage(filter->root);
+    assert(filter_compact(filter->root) == 0);
+    assert(filter->root->compact != NULL);
+    assert(filter_domain_count(filter->root) == domains);
+    assert(filter_memory_usage(filter->root) < tree_bytes);
+    
+    for (int i = 0; i < 200; i++) {
+        snprintf(domain, sizeof(domain), "x.ADS.site%d.com", i);
+        assert(filter_lookup(filter, domain) == true);
+        snprintf(domain, sizeof(domain), "site%d.com", i);
+        assert(filter_lookup(filter, domain) == false);
+    }
+    assert(filter_lookup(filter, "www.tracker.net.") == true);
+    assert(filter_lookup(filter, "b.c.example.org") == false);
+    assert(filter_lookup(filter, "z.a.b.c.example.org") == true);
+    assert(filter_lookup(filter, "ads.site200.com") == false);
+    
+    filter_free(filter);
+    PASS();
+}
+
+void test_filter_compact_read_only() {
+    TEST("Compact Trie is read-only");
+    
+    filter_t *filter = filter_init();
+    filter_insert(filter, "example.com");
+    
+    assert(filter_compact(filter->root) == 0);
+    assert(filter_compact(filter->root) == -1);
+    assert(filter_insert(filter, "other.com") == -1);
+    assert(filter_lookup(filter, "other.com") == false);
+    assert(filter_lookup(filter, "example.com") == true);
+    
+    filter_free(filter);
+    PASS();
+}
+
+void test_filter_compiled_roundtrip() {
+    TEST("Compiled filter file round trip (mmap)");
+    
+    const char *path = "/tmp/test_filter_compiled.bin";
+    filter_t *filter = filter_init();
+    char domain[64];
+    
+    for (int i = 0; i < 100; i++) {
+        snprintf(domain, sizeof(domain), "ads%d.example.com", i);
+        filter_insert(filter, domain);
+    }
+    filter_insert(filter, "tracker.net");
+    
+    // Only a compacted Trie can be saved
+    assert(filter_save_compiled(filter->root, path) == -1);
+    assert(filter_compact(filter->root) == 0);
+    assert(filter_save_compiled(filter->root, path) == 0);
+    filter_free(filter);
+    
+    filter_node_t *mapped = filter_map_compiled(path);
+    assert(mapped != NULL);
+    assert(mapped->compact->mapped == true);
+    assert(filter_domain_count(mapped) == 101);
+    assert(is_domain_blocked(mapped, "www.ads42.example.com") == true);
+    assert(is_domain_blocked(mapped, "x.TRACKER.net") == true);
+    assert(is_domain_blocked(mapped, "ads100.example.com") == false);
+    assert(is_domain_blocked(mapped, "example.com") == false);
+    
+    filter_node_free(mapped);
+    unlink(path);
+    PASS();
+}
+
+void test_filter_compiled_invalid() {
+    TEST("Invalid compiled filter rejected");
+    
+    const char *path = "/tmp/test_filter_invalid.bin";
+    
+    // Text file instead of compiled Trie
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "example.com\nads.example.com\nmore.example.com\n");
+    fclose(file);
+    assert(filter_map_compiled(path) == NULL);
+    
+    // Valid header, truncated body
+    filter_t *filter = filter_init();
+    filter_insert(filter, "example.com");
+    filter_compact(filter->root);
+    assert(filter_save_compiled(filter->root, path) == 0);
+    filter_free(filter);
+    assert(truncate(path, 48) == 0);
+    assert(filter_map_compiled(path) == NULL);
+    
+    assert(filter_map_compiled("/nonexistent/filter.bin") == NULL);
+    
+    unlink(path);
+    PASS();
+}
+
+// Writes a modified copy of a compiled filter and checks that lookups
+// through the damaged nodes neither crash nor report a match
+static bool corrupt_lookup_safe(const char *path, const uint8_t *data, size_t size) {
+    FILE *file = fopen(path, "wb");
+    assert(file != NULL);
+    assert(fwrite(data, 1, size, file) == size);
+    fclose(file);
+    
+    filter_node_t *mapped = filter_map_compiled(path);
+    if (mapped == NULL) {
+        return false;
+    }
+    
+    bool safe = !is_domain_blocked(mapped, "www.ads42.example.com") &&
+                !is_domain_blocked(mapped, "zzz.example.com");
+    filter_node_free(mapped);
+    return safe;
+}
+
+void test_filter_compiled_corrupt() {
+    TEST("Corrupt compiled filter fields stay in bounds");
+    
+    const char *path = "/tmp/test_filter_corrupt.bin";
+    filter_t *filter = filter_init();
+    char domain[64];
+    
+    // example.com gets enough children for a hash index
+    for (int i = 0; i < 100; i++) {
+        snprintf(domain, sizeof(domain), "ads%d.example.com", i);
+        filter_insert(filter, domain);
+    }
+    filter_insert(filter, "tracker.net");
+    assert(filter_compact(filter->root) == 0);
+    assert(filter_save_compiled(filter->root, path) == 0);
+    
+    const filter_compact_t *compact = filter->root->compact;
+    size_t nodes_size = compact->node_count * sizeof(filter_cnode_t);
+    size_t index_size = compact->index_count * sizeof(uint32_t);
+    size_t pool_size = compact->pool_size;
+    uint32_t node_count = compact->node_count;
+    assert(compact->index_count > 0);
+    
+    FILE *file = fopen(path, "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    size_t size = (size_t)ftell(file);
+    rewind(file);
+    uint8_t *original = (uint8_t *)malloc(size);
+    uint8_t *data = (uint8_t *)malloc(size);
+    assert(original != NULL && data != NULL);
+    assert(fread(original, 1, size, file) == size);
+    fclose(file);
+    filter_free(filter);
+    
+    size_t header_size = size - nodes_size - index_size - pool_size;
+    filter_cnode_t *nodes = (filter_cnode_t *)(data + header_size);
+    uint32_t *index = (uint32_t *)(data + header_size + nodes_size);
+    
+    // Find the wide node
+    uint32_t wide = 0;
+    memcpy(data, original, size);
+    for (uint32_t i = 0; i < node_count; i++) {
+        if (nodes[i].child_count >= 8) {
+            wide = i;
+        }
+    }
+    assert(wide != 0);
+    
+    // Root children outside the node array
+    memcpy(data, original, size);
+    nodes[0].first_child = 0xFFFFFFF0u;
+    assert(corrupt_lookup_safe(path, data, size));
+    
+    memcpy(data, original, size);
+    nodes[0].child_count = 0xFFFFFFFFu;
+    assert(corrupt_lookup_safe(path, data, size));
+    
+    // Labels outside the string pool
+    memcpy(data, original, size);
+    for (uint32_t i = 1; i < node_count; i++) {
+        nodes[i].label_off = 0xFFFFFF00u;
+    }
+    assert(corrupt_lookup_safe(path, data, size));
+    
+    // Hash index outside the slot array
+    memcpy(data, original, size);
+    nodes[wide].index_off = 0xFFFFFFF0u;
+    assert(corrupt_lookup_safe(path, data, size));
+    
+    // Saturated index without an empty slot, slots outside the node array
+    memcpy(data, original, size);
+    for (size_t i = 0; i < index_size / sizeof(uint32_t); i++) {
+        index[i] = i % 2 == 0 ? 1 : 0xFFFFFFFFu;
+    }
+    assert(corrupt_lookup_safe(path, data, size));
+    
+    free(original);
+    free(data);
+    unlink(path);
+    PASS();
+}
+
+void test_filter_hot_reload() {
+    TEST("Hot reload waits for readers (RCU)");
+    
+    const char *path = "/tmp/test_filter_reload.txt";
+    struct timespec pause = { 0, 1000000L };
+    server_config_t config;
+    filter_reloader_t reloader;
+    filter_reload_stats_t stats;
+    
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "old.example.com\n");
+    fclose(file);
+    
+    memset(&config, 0, sizeof(config));
+    config.filter_file = (char *)path;
+    config.filter_root = filter_load(path, false, false);
+    assert(config.filter_root != NULL);
+    const filter_node_t *old_root = config.filter_root;
+    
+    assert(filter_reloader_init(&reloader, &config, 1, false) == 0);
+    assert(filter_reloader_start(&reloader) == 0);
+    filter_reader_online(&reloader, 0);
+    
+    file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "new.example.com\nnew.example.org\n");
+    fclose(file);
+    filter_reloader_request(&reloader);
+    
+    // New root is published, old one stays alive while the reader is online
+    while (filter_reader_root(&reloader) == old_root) {
+        nanosleep(&pause, NULL);
+    }
+    for (int i = 0; i < 20; i++) {
+        nanosleep(&pause, NULL);
+    }
+    filter_reloader_stats(&reloader, &stats);
+    assert(stats.reload_count == 0);
+    assert(is_domain_blocked(old_root, "old.example.com") == true);
+    
+    // Quiescent point lets the reloader free the old Trie
+    filter_reader_offline(&reloader, 0);
+    do {
+        nanosleep(&pause, NULL);
+        filter_reloader_stats(&reloader, &stats);
+    } while (stats.reload_count == 0);
+    assert(stats.last_domains == 2);
+    assert(stats.last_old_domains == 1);
+    assert(is_domain_blocked(filter_reader_root(&reloader), "www.new.example.org") == true);
+    assert(is_domain_blocked(filter_reader_root(&reloader), "old.example.com") == false);
+    
+    // Failed reload keeps the current filter
+    const filter_node_t *current = filter_reader_root(&reloader);
+    config.filter_file = "/nonexistent/filter.txt";
+    filter_reloader_request(&reloader);
+    do {
+        nanosleep(&pause, NULL);
+        filter_reloader_stats(&reloader, &stats);
+    } while (stats.reload_failures == 0);
+    assert(filter_reader_root(&reloader) == current);
+    
+    filter_reloader_destroy(&reloader);
+    filter_node_free(config.filter_root);
+    unlink(path);
+    PASS();
+}
+
 void test_filter_mixed_depths() {
     TEST("Mixed depth domains");
     
@@ -825,7 +1199,7 @@ int main(void) {
     test_filter_multiple_dots();
     test_filter_very_long_domain();
     
-    // Edge cases (10 tests)
+    // Edge cases (13 tests)
     printf("\nEdge Cases:\n");
     test_filter_hyphen_domain();
     test_filter_numeric_domain();
@@ -837,13 +1211,23 @@ int main(void) {
     test_filter_uppercase_lowercase_mix();
     test_filter_whitespace();
     test_filter_newline();
+    test_filter_label_prefix();
+    test_filter_label_too_long();
+    test_filter_wire_name();
     
-    // Performance (7 tests)
+    // Performance (14 tests)
     printf("\nPerformance & Stress Tests:\n");
     test_filter_many_domains();
     test_filter_lookup_performance();
     test_filter_deep_trie();
     test_filter_wide_trie();
+    test_filter_hashed_children();
+    test_filter_compact_lookup();
+    test_filter_compact_read_only();
+    test_filter_compiled_roundtrip();
+    test_filter_compiled_invalid();
+    test_filter_compiled_corrupt();
+    test_filter_hot_reload();
     test_filter_mixed_depths();
     test_filter_realistic_blocklist();
     test_filter_memory_efficiency();
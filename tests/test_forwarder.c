@@ -0,0 +1,1428 @@
+/**
+ * @file test_forwarder.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver
+ */
+
+ #include "dns.h"
+ #include "forwarder.h"
+ #include "utils.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+ #include <errno.h>
+ #include <poll.h>
+ #include <arpa/inet.h>
+ #include <sys/epoll.h>
+ #include <sys/socket.h>
+ #include <netinet/in.h>
+
+ #define COLOR_GREEN "\033[32m"
+ #define COLOR_RED "\033[31m"
+ #define COLOR_RESET "\033[0m"
+
+ int tests_passed = 0;
+ int tests_failed = 0;
+
+ #define TEST_PASS(msg) do { \
+     printf("  " COLOR_GREEN "Y" COLOR_RESET " %s\n", msg); \
+     tests_passed++; \
+ } while(0)
+
+ #define TEST_FAIL(msg) do { \
+     printf("  " COLOR_RED "N" COLOR_RESET " %s\n", msg); \
+     tests_failed++; \
+ } while(0)
+
+ #define TEST_CHECK(cond, msg) do { \
+     if (cond) { TEST_PASS(msg); } else { TEST_FAIL(msg); } \
+ } while(0)
+
+ /* Koľko odpovedí si zapamätá callback (a koľko bajtov z každej) */
+ #define REPLY_LOG_SIZE  300
+ #define REPLY_HEAD      96
+
+ /* Odpovede doručené cez on_reply */
+ static struct {
+     int count;
+     int failures;
+     uint16_t client_id[REPLY_LOG_SIZE];
+     bool failed[REPLY_LOG_SIZE];
+     size_t len[REPLY_LOG_SIZE];
+     uint8_t head[REPLY_LOG_SIZE][REPLY_HEAD];   /* Odpoveď, pri zlyhaní dotaz */
+ } replies;
+
+ /**
+  * @brief Callback forwardera - zapamätá si doručenú odpoveď
+  */
+ static void on_reply(void *ctx, const dns_client_t *client, const uint8_t *query,
+                      size_t query_len, uint8_t *response, size_t resp_len) {
+     (void)ctx;
+
+     int i = replies.count++;
+     if (i >= REPLY_LOG_SIZE) {
+         return;
+     }
+
+     const uint8_t *msg = response != NULL ? response : query;
+     size_t len = response != NULL ? resp_len : query_len;
+
+     replies.client_id[i] = client->id;
+     replies.failed[i] = response == NULL;
+     replies.len[i] = len;
+     memcpy(replies.head[i], msg, len < REPLY_HEAD ? len : REPLY_HEAD);
+     if (response == NULL) {
+         replies.failures++;
+     }
+ }
+
+ /* Falošný upstream na loopbacku - UDP socket a TCP listener na rovnakom porte */
+ typedef struct {
+     int udp;
+     int listener;
+     struct sockaddr_in addr;
+     struct sockaddr_in peer;    /* Odkiaľ prišiel posledný UDP dotaz */
+ } fake_upstream_t;
+
+ /**
+  * @brief Otvorí falošný upstream na voľnom porte
+  * @return 0 pri úspechu, -1 pri chybe
+  */
+ static int fake_open(fake_upstream_t *up) {
+     for (int attempt = 0; attempt < 16; attempt++) {
+         memset(up, 0, sizeof(*up));
+         up->addr.sin_family = AF_INET;
+         up->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+         up->udp = socket(AF_INET, SOCK_DGRAM, 0);
+         up->listener = socket(AF_INET, SOCK_STREAM, 0);
+         if (up->udp < 0 || up->listener < 0) {
+             return -1;
+         }
+
+         socklen_t len = sizeof(up->addr);
+         if (bind(up->udp, (struct sockaddr *)&up->addr, sizeof(up->addr)) == 0 &&
+             getsockname(up->udp, (struct sockaddr *)&up->addr, &len) == 0 &&
+             bind(up->listener, (struct sockaddr *)&up->addr, sizeof(up->addr)) == 0 &&
+             listen(up->listener, 8) == 0) {
+             return 0;
+         }
+
+         close(up->udp);
+         close(up->listener);
+     }
+     return -1;
+ }
+
+ static void fake_close(fake_upstream_t *up) {
+     close(up->udp);
+     close(up->listener);
+ }
+
+ /**
+  * @brief Počká, kým je fd čitateľný
+  */
+ static bool wait_readable(int fd, int timeout_ms) {
+     struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+     return poll(&pfd, 1, timeout_ms) == 1;
+ }
+
+ /**
+  * @brief Prijme UDP dotaz na falošnom upstream
+  * @return Dĺžka dotazu, -1 ak žiadny neprišiel
+  */
+ static ssize_t fake_recv(fake_upstream_t *up, uint8_t *buf, size_t cap, int timeout_ms) {
+     if (!wait_readable(up->udp, timeout_ms)) {
+         return -1;
+     }
+
+     socklen_t len = sizeof(up->peer);
+     return recvfrom(up->udp, buf, cap, 0, (struct sockaddr *)&up->peer, &len);
+ }
+
+ /**
+  * @brief Pošle UDP odpoveď na adresu posledného dotazu
+  */
+ static void fake_send(fake_upstream_t *up, const uint8_t *buf, size_t len) {
+     sendto(up->udp, buf, len, 0, (struct sockaddr *)&up->peer, sizeof(up->peer));
+ }
+
+ /**
+  * @brief Prijme TCP spojenie od forwardera
+  * @return Socket spojenia, -1 ak žiadne neprišlo
+  */
+ static int fake_accept(fake_upstream_t *up) {
+     if (!wait_readable(up->listener, 1000)) {
+         return -1;
+     }
+     return accept(up->listener, NULL, NULL);
+ }
+
+ /**
+  * @brief Prečíta presne len bajtov z TCP spojenia
+  */
+ static int read_full(int fd, uint8_t *buf, size_t len, int timeout_ms) {
+     size_t got = 0;
+     while (got < len) {
+         if (!wait_readable(fd, timeout_ms)) {
+             return -1;
+         }
+         ssize_t n = recv(fd, buf + got, len - got, 0);
+         if (n <= 0) {
+             return -1;
+         }
+         got += (size_t)n;
+     }
+     return 0;
+ }
+
+ /**
+  * @brief Prečíta jeden rámec (2-bajtová dĺžka + správa) z TCP spojenia
+  * @return Dĺžka správy, -1 ak rámec neprišiel
+  */
+ static ssize_t read_frame(int fd, uint8_t *buf, size_t cap, int timeout_ms) {
+     uint8_t prefix[2];
+     if (read_full(fd, prefix, 2, timeout_ms) != 0) {
+         return -1;
+     }
+
+     size_t len = ((size_t)prefix[0] << 8) | prefix[1];
+     if (len > cap || read_full(fd, buf, len, timeout_ms) != 0) {
+         return -1;
+     }
+     return (ssize_t)len;
+ }
+
+ /**
+  * @brief Pošle celý buffer cez TCP spojenie
+  */
+ static void write_all(int fd, const uint8_t *buf, size_t len) {
+     size_t sent = 0;
+     while (sent < len) {
+         ssize_t n = send(fd, buf + sent, len - sent, MSG_NOSIGNAL);
+         if (n <= 0) {
+             return;
+         }
+         sent += (size_t)n;
+     }
+ }
+
+ /**
+  * @brief Zabalí správu do TCP rámca
+  * @return Dĺžka rámca
+  */
+ static size_t make_frame(uint8_t *frame, const uint8_t *msg, size_t len) {
+     frame[0] = (uint8_t)(len >> 8);
+     frame[1] = (uint8_t)len;
+     memcpy(frame + 2, msg, len);
+     return len + 2;
+ }
+
+ /**
+  * @brief Zostaví dotaz (trieda IN, RD) na dané meno
+  * @return Dĺžka dotazu
+  */
+ static size_t build_query(uint8_t *buf, uint16_t id, const char *name, uint16_t qtype) {
+     memset(buf, 0, DNS_HEADER_SIZE);
+     buf[0] = (uint8_t)(id >> 8);
+     buf[1] = (uint8_t)id;
+     buf[2] = 0x01;
+     buf[5] = 1;
+
+     size_t pos = DNS_HEADER_SIZE;
+     const char *label = name;
+     while (*label != '\0') {
+         const char *dot = strchr(label, '.');
+         size_t len = dot != NULL ? (size_t)(dot - label) : strlen(label);
+         buf[pos++] = (uint8_t)len;
+         memcpy(buf + pos, label, len);
+         pos += len;
+         label += len + (dot != NULL ? 1 : 0);
+     }
+     buf[pos++] = 0;
+     buf[pos++] = (uint8_t)(qtype >> 8); buf[pos++] = (uint8_t)qtype;
+     buf[pos++] = 0; buf[pos++] = DNS_CLASS_IN;
+     return pos;
+ }
+
+ /**
+  * @brief Vráti offset konca question section (dotaz s jednou otázkou)
+  */
+ static size_t question_end(const uint8_t *msg) {
+     size_t pos = DNS_HEADER_SIZE;
+     while (msg[pos] != 0) {
+         pos += 1 + msg[pos];
+     }
+     return pos + 5;
+ }
+
+ /**
+  * @brief Zostaví odpoveď na upstream dotaz (bez OPT)
+  * @return Dĺžka odpovede
+  *
+  * S truncated je to prázdna odpoveď s TC bitom, inak jeden A záznam.
+  */
+ static size_t build_answer(uint8_t *buf, const uint8_t *query, bool truncated) {
+     size_t pos = question_end(query);
+
+     memcpy(buf, query, pos);
+     buf[2] = (uint8_t)(0x81 | (truncated ? 0x02 : 0));
+     buf[3] = 0x80;
+     buf[6] = 0; buf[7] = truncated ? 0 : 1;     /* ANCOUNT */
+     buf[8] = 0; buf[9] = 0;                     /* NSCOUNT */
+     buf[10] = 0; buf[11] = 0;                   /* ARCOUNT */
+     if (truncated) {
+         return pos;
+     }
+
+     buf[pos++] = 0xC0; buf[pos++] = DNS_HEADER_SIZE;
+     buf[pos++] = 0; buf[pos++] = DNS_TYPE_A;
+     buf[pos++] = 0; buf[pos++] = DNS_CLASS_IN;
+     buf[pos++] = 0; buf[pos++] = 0; buf[pos++] = 0x0E; buf[pos++] = 0x10;
+     buf[pos++] = 0; buf[pos++] = 4;
+     buf[pos++] = 1; buf[pos++] = 2; buf[pos++] = 3; buf[pos++] = 4;
+     return pos;
+ }
+
+ /**
+  * @brief Spustí forwarder s vlastným epoll (UDP pool registruje volajúci)
+  * @return epoll fd, -1 pri chybe
+  */
+ static int start_forwarder(forwarder_t *fw, fake_upstream_t *ups, unsigned int count,
+                            uint32_t rto_max_ms, unsigned int hedge_percent) {
+     struct sockaddr_in addrs[DNS_MAX_UPSTREAMS];
+     for (unsigned int i = 0; i < count; i++) {
+         addrs[i] = ups[i].addr;
+     }
+
+     int epfd = epoll_create1(0);
+     if (epfd < 0) {
+         return -1;
+     }
+     if (forwarder_init(fw, addrs, count, rto_max_ms, hedge_percent, epfd, on_reply, NULL) != 0) {
+         close(epfd);
+         return -1;
+     }
+
+     for (unsigned int u = 0; u < count; u++) {
+         for (unsigned int i = 0; i < fw->upstreams[u].sock_count; i++) {
+             struct epoll_event ev;
+             memset(&ev, 0, sizeof(ev));
+             ev.events = EPOLLIN;
+             ev.data.fd = fw->upstreams[u].socks[i];
+             epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+         }
+     }
+
+     memset(&replies, 0, sizeof(replies));
+     return epfd;
+ }
+
+ static void stop_forwarder(forwarder_t *fw, int epfd) {
+     forwarder_free(fw);
+     close(epfd);
+ }
+
+ /**
+  * @brief Obsluhuje udalosti a timeouty forwardera počas ms milisekúnd
+  */
+ static void pump(forwarder_t *fw, int epfd, int ms) {
+     uint64_t end = monotonic_ms() + (uint64_t)ms;
+     uint64_t now;
+
+     while ((now = monotonic_ms()) < end) {
+         struct epoll_event events[16];
+         int wait = end - now < 10 ? (int)(end - now) : 10;
+         int n = epoll_wait(epfd, events, 16, wait);
+
+         for (int i = 0; i < n; i++) {
+             forwarder_handle_event(fw, events[i].data.fd, events[i].events);
+         }
+         forwarder_process_timeouts(fw, monotonic_ms());
+     }
+ }
+
+ /**
+  * @brief Pošle klientov dotaz cez forwarder
+  * @return Návratová hodnota forwarder_submit()
+  */
+ static int submit_query(forwarder_t *fw, uint16_t id, const char *name, uint16_t qtype) {
+     uint8_t query[DNS_UDP_MAX_SIZE];
+     dns_client_t client;
+
+     memset(&client, 0, sizeof(client));
+     client.id = id;
+
+     size_t len = build_query(query, id, name, qtype);
+     return forwarder_submit(fw, query, len, &client);
+ }
+
+ /**
+  * @brief Pošle dotaz cez forwarder a odpovie naň cez UDP s TC bitom
+  * @return 0 ak dotaz prišiel na upstream
+  */
+ static int submit_truncated(forwarder_t *fw, int epfd, fake_upstream_t *up,
+                             uint16_t id, const char *name, uint16_t qtype) {
+     uint8_t buf[DNS_EDNS_UDP_SIZE];
+
+     if (submit_query(fw, id, name, qtype) < 0) {
+         return -1;
+     }
+
+     ssize_t got = fake_recv(up, buf, sizeof(buf), 1000);
+     if (got < 0) {
+         return -1;
+     }
+
+     uint8_t answer[DNS_EDNS_UDP_SIZE];
+     fake_send(up, answer, build_answer(answer, buf, true));
+     pump(fw, epfd, 50);
+     return 0;
+ }
+
+ /**
+  * @brief Nájde index doručenej odpovede pre ID klienta
+  */
+ static int find_reply(uint16_t client_id) {
+     for (int i = 0; i < replies.count && i < REPLY_LOG_SIZE; i++) {
+         if (replies.client_id[i] == client_id) {
+             return i;
+         }
+     }
+     return -1;
+ }
+
+ /**
+  * @brief Test TCP rámca rozdeleného do viacerých recv()
+  */
+ void test_tcp_split_frames() {
+     printf("\n[TEST] TCP fallback - frame split across reads\n");
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     submit_truncated(&fw, epfd, &up, 0x1111, "split.example.com", DNS_TYPE_A);
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     int conn = fake_accept(&up);
+     ssize_t len = conn >= 0 ? read_frame(conn, query, sizeof(query), 1000) : -1;
+     TEST_CHECK(len > 0 && fw.tcp_fallback_count == 1, "TC answer retried over TCP");
+
+     if (len > 0) {
+         uint8_t answer[DNS_EDNS_UDP_SIZE];
+         uint8_t frame[DNS_EDNS_UDP_SIZE + 2];
+         size_t frame_len = make_frame(frame, answer, build_answer(answer, query, false));
+
+         /* Dĺžka po jednom bajte, potom zvyšok správy na dvakrát */
+         write_all(conn, frame, 1);
+         pump(&fw, epfd, 20);
+         write_all(conn, frame + 1, 10);
+         pump(&fw, epfd, 20);
+         TEST_CHECK(replies.count == 0, "Incomplete frame not delivered");
+
+         write_all(conn, frame + 11, frame_len - 11);
+         pump(&fw, epfd, 50);
+     }
+
+     TEST_CHECK(replies.count == 1 && !replies.failed[0] &&
+                replies.head[0][0] == 0x11 && replies.head[0][1] == 0x11 &&
+                replies.head[0][7] == 1,
+                "Reassembled answer delivered with client ID");
+     TEST_CHECK(fw.in_flight == 0 && fw.upstreams[0].tcp[0].outstanding == 0 &&
+                fw.upstreams[0].tcp[0].queries == NULL,
+                "Pending released from connection");
+
+     if (conn >= 0) {
+         close(conn);
+     }
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Test pipeliningu - odpovede v opačnom poradí sa párujú podľa ID
+  */
+ void test_tcp_pipelined() {
+     printf("\n[TEST] TCP fallback - pipelined queries answered out of order\n");
+
+     static const char *names[3] = { "one.example.com", "two.example.com", "three.example.com" };
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     /* Tri dotazy na dve spojenia - aspoň na jednom sú dva naraz */
+     for (int i = 0; i < 3; i++) {
+         submit_truncated(&fw, epfd, &up, (uint16_t)(0x2000 + i), names[i], DNS_TYPE_A);
+     }
+
+     int conns[FORWARDER_TCP_POOL_SIZE];
+     uint8_t frames[FORWARDER_TCP_POOL_SIZE][3][DNS_EDNS_UDP_SIZE];
+     int frame_count[FORWARDER_TCP_POOL_SIZE] = { 0 };
+     int total = 0;
+
+     for (int c = 0; c < FORWARDER_TCP_POOL_SIZE; c++) {
+         conns[c] = fake_accept(&up);
+         while (conns[c] >= 0 && frame_count[c] < 3 &&
+                read_frame(conns[c], frames[c][frame_count[c]], DNS_EDNS_UDP_SIZE, 100) > 0) {
+             frame_count[c]++;
+             total++;
+         }
+     }
+     TEST_CHECK(total == 3 && fw.tcp_connect_count == FORWARDER_TCP_POOL_SIZE &&
+                (frame_count[0] == 2 || frame_count[1] == 2),
+                "Queries pipelined over the connection pool");
+
+     /* Odpovede na každom spojení odzadu, všetky rámce jedným send() */
+     for (int c = 0; c < FORWARDER_TCP_POOL_SIZE; c++) {
+         uint8_t out[3 * (DNS_EDNS_UDP_SIZE + 2)];
+         size_t out_len = 0;
+
+         for (int f = frame_count[c] - 1; f >= 0; f--) {
+             uint8_t answer[DNS_EDNS_UDP_SIZE];
+             size_t len = build_answer(answer, frames[c][f], false);
+             out_len += make_frame(out + out_len, answer, len);
+         }
+         if (out_len > 0) {
+             write_all(conns[c], out, out_len);
+         }
+     }
+     pump(&fw, epfd, 50);
+
+     bool matched = replies.count == 3;
+     for (int i = 0; matched && i < 3; i++) {
+         uint8_t expected[DNS_UDP_MAX_SIZE];
+         size_t len = build_query(expected, (uint16_t)(0x2000 + i), names[i], DNS_TYPE_A);
+         int r = find_reply((uint16_t)(0x2000 + i));
+
+         matched = r >= 0 && !replies.failed[r] &&
+                   memcmp(replies.head[r], expected, 2) == 0 &&
+                   memcmp(replies.head[r] + DNS_HEADER_SIZE, expected + DNS_HEADER_SIZE,
+                          len - DNS_HEADER_SIZE) == 0;
+     }
+     TEST_CHECK(matched, "Out-of-order answers matched to their clients by ID");
+     TEST_CHECK(fw.in_flight == 0 && fw.dropped_count == 0, "No answer dropped");
+
+     for (int c = 0; c < FORWARDER_TCP_POOL_SIZE; c++) {
+         if (conns[c] >= 0) {
+             close(conns[c]);
+         }
+     }
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Test zatvorenia spojenia upstreamom - presun dotazov, potom SERVFAIL
+  */
+ void test_tcp_upstream_close() {
+     printf("\n[TEST] TCP fallback - upstream closes the connection\n");
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     submit_truncated(&fw, epfd, &up, 0x3333, "close.example.com", DNS_TYPE_A);
+
+     /* Upstream prečíta dotaz a zavrie spojenie - pri každom pokuse */
+     int received = 0;
+     for (int attempt = 0; attempt < UPSTREAM_RETRY_COUNT; attempt++) {
+         uint8_t query[DNS_EDNS_UDP_SIZE];
+         int conn = fake_accept(&up);
+         if (conn < 0) {
+             break;
+         }
+         if (read_frame(conn, query, sizeof(query), 1000) > 0) {
+             received++;
+         }
+         close(conn);
+
+         if (attempt == 0) {
+             pump(&fw, epfd, 50);
+             TEST_CHECK(replies.count == 0 && fw.retry_count == 1 && fw.in_flight == 1,
+                        "Outstanding query re-queued on a new connection");
+             continue;
+         }
+         pump(&fw, epfd, 50);
+     }
+
+     TEST_CHECK(received == UPSTREAM_RETRY_COUNT &&
+                fw.tcp_connect_count == UPSTREAM_RETRY_COUNT &&
+                fw.retry_count == UPSTREAM_RETRY_COUNT - 1,
+                "Every attempt went over a fresh connection");
+     TEST_CHECK(replies.count == 1 && replies.failures == 1 &&
+                replies.client_id[0] == 0x3333 && fw.timeout_count == 1,
+                "SERVFAIL once attempts run out");
+     TEST_CHECK(fw.in_flight == 0 && fw.upstreams[0].tcp[0].outstanding == 0 &&
+                fw.upstreams[0].tcp[1].outstanding == 0,
+                "No query left on a connection");
+
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Test TCP odpovede väčšej ako DNS_EDNS_MAX_SIZE
+  */
+ void test_tcp_oversize() {
+     printf("\n[TEST] TCP fallback - answer larger than DNS_EDNS_MAX_SIZE\n");
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     submit_truncated(&fw, epfd, &up, 0x4444, "big.example.com", DNS_TYPE_TXT);
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     int conn = fake_accept(&up);
+     ssize_t len = conn >= 0 ? read_frame(conn, query, sizeof(query), 1000) : -1;
+     size_t qend = len > 0 ? question_end(query) : 0;
+
+     if (len > 0) {
+         /* Jeden TXT záznam z 18 reťazcov po 255 bajtov (~4.6 kB) */
+         static uint8_t answer[DNS_EDNS_MAX_SIZE * 2];
+         static uint8_t frame[DNS_EDNS_MAX_SIZE * 2 + 2];
+         size_t rdlen = 18 * 256;
+         size_t pos = qend;
+
+         memcpy(answer, query, qend);
+         answer[2] = 0x81; answer[3] = 0x80;
+         answer[6] = 0; answer[7] = 1;
+         answer[8] = 0; answer[9] = 0; answer[10] = 0; answer[11] = 0;
+         answer[pos++] = 0xC0; answer[pos++] = DNS_HEADER_SIZE;
+         answer[pos++] = 0; answer[pos++] = DNS_TYPE_TXT;
+         answer[pos++] = 0; answer[pos++] = DNS_CLASS_IN;
+         answer[pos++] = 0; answer[pos++] = 0; answer[pos++] = 0x0E; answer[pos++] = 0x10;
+         answer[pos++] = (uint8_t)(rdlen >> 8); answer[pos++] = (uint8_t)rdlen;
+         for (int s = 0; s < 18; s++) {
+             answer[pos++] = 255;
+             memset(answer + pos, 'a' + s, 255);
+             pos += 255;
+         }
+
+         write_all(conn, frame, make_frame(frame, answer, pos));
+         pump(&fw, epfd, 50);
+     }
+
+     TEST_CHECK(replies.count == 1 && !replies.failed[0] && replies.len[0] == qend,
+                "Oversize answer cut to header and question");
+     TEST_CHECK(replies.count == 1 && replies.head[0][0] == 0x44 &&
+                (replies.head[0][2] & 0x02) && replies.head[0][5] == 1 &&
+                replies.head[0][7] == 0 && replies.head[0][9] == 0 && replies.head[0][11] == 0,
+                "TC set and record counts cleared");
+
+     if (conn >= 0) {
+         close(conn);
+     }
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Pošle dotaz, odpovie naň cez UDP a doručí odpoveď (jedno meranie latencie)
+  */
+ static void answer_one(forwarder_t *fw, int epfd, fake_upstream_t *up, uint16_t id,
+                        const char *name) {
+     uint8_t buf[DNS_EDNS_UDP_SIZE];
+     uint8_t answer[DNS_EDNS_UDP_SIZE];
+
+     submit_query(fw, id, name, DNS_TYPE_A);
+     if (fake_recv(up, buf, sizeof(buf), 1000) > 0) {
+         fake_send(up, answer, build_answer(answer, buf, false));
+     }
+     pump(fw, epfd, 20);
+ }
+
+ /**
+  * @brief Test p95 z histogramu latencie a jeho prepolenia
+  *
+  * Histogram sa nastaví priamo, skutočná latencia loopbacku pridá jedno
+  * meranie v nízkom buckete - p95 ani polenie neovplyvní.
+  */
+ void test_hedge_delay() {
+     printf("\n[TEST] Hedging - p95 from the latency histogram\n");
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     /* Bucket 40 = 1024..1279 µs */
+     fw.latency_hist[40] = 30;
+     fw.latency_samples = 30;
+     answer_one(&fw, epfd, &up, 0x5001, "p95-a.example.com");
+     TEST_CHECK(fw.latency_samples == 31 && fw.hedge_delay_us == 0,
+                "p95 recomputed only every 32 samples");
+
+     answer_one(&fw, epfd, &up, 0x5002, "p95-b.example.com");
+     TEST_CHECK(fw.latency_samples == 32 && fw.hedge_delay_us == 1280,
+                "p95 is the upper limit of its bucket");
+
+     /* Bucket 48 = 4096..5119 µs, bucket 68 = 131072..163839 µs */
+     memset(fw.latency_hist, 0, sizeof(fw.latency_hist));
+     fw.latency_hist[48] = 990;
+     fw.latency_hist[68] = 33;
+     fw.latency_samples = FORWARDER_LATENCY_WINDOW - 1;
+     answer_one(&fw, epfd, &up, 0x5003, "p95-c.example.com");
+     TEST_CHECK(fw.latency_samples == 511 && fw.latency_hist[48] == 495 &&
+                fw.latency_hist[68] == 16 && fw.hedge_delay_us == 5120,
+                "Histogram halved after FORWARDER_LATENCY_WINDOW samples");
+
+     memset(fw.latency_hist, 0, sizeof(fw.latency_hist));
+     fw.latency_hist[48] = 960;
+     fw.latency_hist[68] = 63;
+     fw.latency_samples = FORWARDER_LATENCY_WINDOW - 1;
+     answer_one(&fw, epfd, &up, 0x5004, "p95-d.example.com");
+     TEST_CHECK(fw.latency_samples == 511 && fw.hedge_delay_us == 163840,
+                "p95 moves to the slow tail after halving");
+
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Test token bucketu hedgingu
+  */
+ void test_hedge_tokens() {
+     printf("\n[TEST] Hedging - token bucket\n");
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 30);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     submit_query(&fw, 0x6000, "tokens-0.example.com", DNS_TYPE_A);
+     TEST_CHECK(fw.hedge_tokens == 30, "hedge_percent hundredths of a copy per query");
+
+     for (int i = 1; i < 50; i++) {
+         char name[32];
+         snprintf(name, sizeof(name), "tokens-%d.example.com", i);
+         submit_query(&fw, (uint16_t)(0x6000 + i), name, DNS_TYPE_A);
+     }
+     TEST_CHECK(fw.hedge_tokens == FORWARDER_HEDGE_BURST * 100 && fw.hedge_count == 0,
+                "Budget capped at FORWARDER_HEDGE_BURST copies");
+
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Spustí forwarder s dvoma upstreamami a p95 1 ms
+  * @return epoll fd, -1 pri chybe
+  */
+ static int start_hedging(forwarder_t *fw, fake_upstream_t *ups, uint32_t samples) {
+     if (fake_open(&ups[0]) != 0) {
+         return -1;
+     }
+     if (fake_open(&ups[1]) != 0) {
+         fake_close(&ups[0]);
+         return -1;
+     }
+
+     int epfd = start_forwarder(fw, ups, 2, 1000, 100);
+     if (epfd < 0) {
+         fake_close(&ups[0]);
+         fake_close(&ups[1]);
+         return -1;
+     }
+
+     fw->latency_samples = samples;
+     fw->hedge_delay_us = 1000;
+     return epfd;
+ }
+
+ static void stop_hedging(forwarder_t *fw, int epfd, fake_upstream_t *ups) {
+     stop_forwarder(fw, epfd);
+     fake_close(&ups[0]);
+     fake_close(&ups[1]);
+ }
+
+ /**
+  * @brief Test hedged kópie - až od FORWARDER_HEDGE_MIN_SAMPLES meraní
+  */
+ void test_hedge_min_samples() {
+     printf("\n[TEST] Hedging - minimum samples\n");
+
+     uint8_t first[DNS_EDNS_UDP_SIZE];
+     uint8_t second[DNS_EDNS_UDP_SIZE];
+     fake_upstream_t ups[2];
+     forwarder_t fw;
+
+     int epfd = start_hedging(&fw, ups, FORWARDER_HEDGE_MIN_SAMPLES - 1);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+     submit_query(&fw, 0x7001, "few.example.com", DNS_TYPE_A);
+     pump(&fw, epfd, 50);
+
+     bool primary = fake_recv(&ups[0], first, sizeof(first), 100) > 0;
+     TEST_CHECK(primary && fake_recv(&ups[1], second, sizeof(second), 0) < 0 &&
+                fw.hedge_count == 0,
+                "No hedge below FORWARDER_HEDGE_MIN_SAMPLES");
+     stop_hedging(&fw, epfd, ups);
+
+     epfd = start_hedging(&fw, ups, FORWARDER_HEDGE_MIN_SAMPLES);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+     submit_query(&fw, 0x7002, "enough.example.com", DNS_TYPE_A);
+     pump(&fw, epfd, 50);
+
+     ssize_t len1 = fake_recv(&ups[0], first, sizeof(first), 100);
+     ssize_t len2 = fake_recv(&ups[1], second, sizeof(second), 100);
+     TEST_CHECK(len1 > 0 && len1 == len2 && memcmp(first, second, (size_t)len1) == 0 &&
+                fw.hedge_count == 1 && fw.hedge_tokens == 0,
+                "Hedged copy sent to the other upstream after p95");
+     stop_hedging(&fw, epfd, ups);
+ }
+
+ /**
+  * @brief Test hedged kópie - prvá odpoveď vyhráva, neskoršia sa zahodí
+  */
+ void test_hedge_loser() {
+     printf("\n[TEST] Hedging - losing copy dropped\n");
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     uint8_t answer[DNS_EDNS_UDP_SIZE];
+     fake_upstream_t ups[2];
+     forwarder_t fw;
+
+     int epfd = start_hedging(&fw, ups, FORWARDER_HEDGE_MIN_SAMPLES);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+     submit_query(&fw, 0x7003, "race.example.com", DNS_TYPE_A);
+     pump(&fw, epfd, 50);
+
+     bool sent = fake_recv(&ups[0], query, sizeof(query), 100) > 0 &&
+                 fake_recv(&ups[1], query, sizeof(query), 100) > 0;
+     size_t len = build_answer(answer, query, false);
+
+     /* Hedged kópia odpovie prvá */
+     fake_send(&ups[1], answer, len);
+     pump(&fw, epfd, 20);
+     TEST_CHECK(sent && replies.count == 1 && replies.client_id[0] == 0x7003 &&
+                fw.hedge_win_count == 1 && fw.in_flight == 0,
+                "First answer (hedged copy) delivered");
+
+     fake_send(&ups[0], answer, len);
+     pump(&fw, epfd, 20);
+     TEST_CHECK(replies.count == 1 && fw.dropped_count == 1,
+                "Late answer from the original upstream dropped");
+
+     stop_hedging(&fw, epfd, ups);
+ }
+
+ /**
+  * @brief Overí, že odpoveď (alebo dotaz pri SERVFAIL) patrí klientovi -
+  *        jeho ID a question section vrátane veľkosti písmen
+  */
+ static bool reply_matches(uint16_t client_id, const char *name) {
+     uint8_t expected[DNS_UDP_MAX_SIZE];
+     size_t len = build_query(expected, client_id, name, DNS_TYPE_A);
+     int r = find_reply(client_id);
+
+     return r >= 0 && replies.len[r] >= len &&
+            memcmp(replies.head[r], expected, 2) == 0 &&
+            memcmp(replies.head[r] + DNS_HEADER_SIZE, expected + DNS_HEADER_SIZE,
+                   len - DNS_HEADER_SIZE) == 0;
+ }
+
+ /**
+  * @brief Test coalescingu - rovnaké otázky idú na upstream raz
+  */
+ void test_coalesce_duplicates() {
+     printf("\n[TEST] Coalescing - duplicate questions\n");
+
+     static const char *names[5] = {
+         "dup.example.com", "DUP.example.com", "dUp.ExAmPlE.cOm", "Dup.Example.Com", "dup.EXAMPLE.com"
+     };
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     for (int i = 0; i < 5; i++) {
+         submit_query(&fw, (uint16_t)(0x8000 + i), names[i], DNS_TYPE_A);
+     }
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     uint8_t extra[DNS_EDNS_UDP_SIZE];
+     ssize_t len = fake_recv(&up, query, sizeof(query), 1000);
+     TEST_CHECK(len > 0 && fake_recv(&up, extra, sizeof(extra), 50) < 0 &&
+                fw.coalesced_count == 4 && fw.in_flight == 5,
+                "Five duplicate submits, one upstream query");
+
+     if (len > 0) {
+         uint8_t answer[DNS_EDNS_UDP_SIZE];
+         fake_send(&up, answer, build_answer(answer, query, false));
+         pump(&fw, epfd, 50);
+     }
+
+     bool matched = replies.count == 5 && replies.failures == 0;
+     for (int i = 0; matched && i < 5; i++) {
+         matched = reply_matches((uint16_t)(0x8000 + i), names[i]);
+     }
+     TEST_CHECK(matched, "Every waiter gets its own ID and question case");
+     TEST_CHECK(fw.in_flight == 0, "in_flight back to 0 after the answer");
+
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Test coalescingu - SERVFAIL dostanú všetci čakajúci
+  */
+ void test_coalesce_servfail() {
+     printf("\n[TEST] Coalescing - failure reaches every waiter\n");
+
+     static const char *names[3] = { "fail.example.com", "FAIL.example.com", "fAiL.example.com" };
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 50, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     for (int i = 0; i < 3; i++) {
+         submit_query(&fw, (uint16_t)(0x8100 + i), names[i], DNS_TYPE_A);
+     }
+
+     /* Termín dotazu uplynie s prvým RTO - bez čakania na UPSTREAM_TIMEOUT_SEC */
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     if (fake_recv(&up, query, sizeof(query), 1000) > 0) {
+         pending_query_t *pending = fw.by_id[((uint16_t)query[0] << 8) | query[1]];
+         if (pending != NULL) {
+             pending->deadline_ms = 0;
+         }
+     }
+     pump(&fw, epfd, 150);
+
+     bool matched = replies.count == 3 && replies.failures == 3;
+     for (int i = 0; matched && i < 3; i++) {
+         matched = reply_matches((uint16_t)(0x8100 + i), names[i]);
+     }
+     TEST_CHECK(matched && fw.timeout_count == 1, "SERVFAIL delivered to every waiter");
+     TEST_CHECK(fw.in_flight == 0, "in_flight back to 0 after the failure");
+
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Test coalescingu - nad FORWARDER_MAX_WAITERS ide samostatný dotaz
+  */
+ void test_coalesce_overflow() {
+     printf("\n[TEST] Coalescing - waiter limit\n");
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     int total = FORWARDER_MAX_WAITERS + 2;
+     for (int i = 0; i < total; i++) {
+         submit_query(&fw, (uint16_t)(0x9000 + i), "many.example.com", DNS_TYPE_A);
+     }
+
+     /* Dotazy môžu ísť cez rôzne sockety poolu - odpoveď na adresu každého */
+     uint8_t queries[3][DNS_EDNS_UDP_SIZE];
+     struct sockaddr_in peers[3];
+     int sent = 0;
+     while (sent < 3 && fake_recv(&up, queries[sent], DNS_EDNS_UDP_SIZE, 50) > 0) {
+         peers[sent++] = up.peer;
+     }
+     TEST_CHECK(sent == 2 && fw.coalesced_count == FORWARDER_MAX_WAITERS &&
+                fw.in_flight == (size_t)total,
+                "Overflow falls back to a separate upstream query");
+
+     for (int i = 0; i < sent; i++) {
+         uint8_t answer[DNS_EDNS_UDP_SIZE];
+         up.peer = peers[i];
+         fake_send(&up, answer, build_answer(answer, queries[i], false));
+     }
+     pump(&fw, epfd, 50);
+
+     TEST_CHECK(replies.count == total && replies.failures == 0 && fw.in_flight == 0,
+                "Both queries answered, in_flight back to 0");
+
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Test coalescingu - rôzne DO alebo CD bity sa nespájajú
+  */
+ void test_coalesce_dnssec() {
+     printf("\n[TEST] Coalescing - DO and CD bits\n");
+
+     fake_upstream_t up;
+     forwarder_t fw;
+     if (fake_open(&up) != 0) {
+         TEST_FAIL("Failed to open fake upstream");
+         return;
+     }
+     int epfd = start_forwarder(&fw, &up, 1, 1000, 0);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         fake_close(&up);
+         return;
+     }
+
+     uint8_t query[DNS_UDP_MAX_SIZE];
+     dns_client_t client;
+     memset(&client, 0, sizeof(client));
+
+     /* Bez DNSSEC bitov, s DO (OPT) a s CD */
+     submit_query(&fw, 0xA000, "sec.example.com", DNS_TYPE_A);
+
+     client.id = 0xA001;
+     size_t len = build_query(query, client.id, "sec.example.com", DNS_TYPE_A);
+     static const uint8_t opt_do[DNS_OPT_RR_SIZE] = { 0, 0, 41, 0x04, 0xD0, 0, 0, 0x80, 0, 0, 0 };
+     memcpy(query + len, opt_do, sizeof(opt_do));
+     query[11] = 1;
+     forwarder_submit(&fw, query, len + sizeof(opt_do), &client);
+
+     client.id = 0xA002;
+     len = build_query(query, client.id, "sec.example.com", DNS_TYPE_A);
+     query[3] |= DNS_FLAG_CD;
+     forwarder_submit(&fw, query, len, &client);
+
+     TEST_CHECK(fw.coalesced_count == 0 && fw.sent_count == 3,
+                "DO or CD mismatch gets its own upstream query");
+
+     /* Rovnaké bity sa stále spájajú */
+     client.id = 0xA003;
+     len = build_query(query, client.id, "SEC.example.com", DNS_TYPE_A);
+     query[3] |= DNS_FLAG_CD;
+     forwarder_submit(&fw, query, len, &client);
+     TEST_CHECK(fw.coalesced_count == 1 && fw.sent_count == 3,
+                "Matching CD query still coalesced");
+
+     stop_forwarder(&fw, epfd);
+     fake_close(&up);
+ }
+
+ /**
+  * @brief Spustí forwarder s dvoma falošnými upstream servermi pre test výberu
+  * @return epoll fd, -1 pri chybe
+  *
+  * RTO je obmedzené na 100 ms, aby timeouty netrvali dlho.
+  */
+ static int start_selection(forwarder_t *fw, fake_upstream_t *ups) {
+     if (fake_open(&ups[0]) != 0) {
+         return -1;
+     }
+     if (fake_open(&ups[1]) != 0) {
+         fake_close(&ups[0]);
+         return -1;
+     }
+
+     int epfd = start_forwarder(fw, ups, 2, 100, 0);
+     if (epfd < 0) {
+         fake_close(&ups[0]);
+         fake_close(&ups[1]);
+         return -1;
+     }
+     return epfd;
+ }
+
+ static void stop_selection(forwarder_t *fw, int epfd, fake_upstream_t *ups) {
+     stop_forwarder(fw, epfd);
+     fake_close(&ups[0]);
+     fake_close(&ups[1]);
+ }
+
+ /**
+  * @brief Nastaví upstream do ustáleného stavu (zmeraný, nedávno použitý)
+  */
+ static void set_upstream(upstream_t *up, uint32_t srtt_us, unsigned int fail_score) {
+     up->rtt.srtt_us = srtt_us;
+     up->rtt.rttvar_us = srtt_us / 2;
+     up->fail_score = fail_score;
+     up->down_until_ms = 0;
+     up->last_used_ms = monotonic_ms();
+ }
+
+ /**
+  * @brief Pošle dotaz cez forwarder a zistí, ktorý upstream ho dostal
+  * @return Index upstream servera, -1 ak dotaz neprišiel práve na jeden
+  *
+  * Prijatý dotaz ostane v query (peer upstream servera je zapamätaný).
+  */
+ static int routed_to(forwarder_t *fw, fake_upstream_t *ups, uint16_t id,
+                      const char *name, uint8_t *query) {
+     int chosen = submit_query(fw, id, name, DNS_TYPE_A);
+     if (chosen < 0 || chosen > 1) {
+         return -1;
+     }
+
+     uint8_t other[DNS_EDNS_UDP_SIZE];
+     if (fake_recv(&ups[chosen], query, DNS_EDNS_UDP_SIZE, 200) <= 0 ||
+         fake_recv(&ups[1 - chosen], other, sizeof(other), 0) > 0) {
+         return -1;
+     }
+     return chosen;
+ }
+
+ /**
+  * @brief Odpovie na posledný prijatý dotaz a doručí odpoveď
+  */
+ static void answer_routed(forwarder_t *fw, int epfd, fake_upstream_t *up,
+                           const uint8_t *query) {
+     uint8_t answer[DNS_EDNS_UDP_SIZE];
+     fake_send(up, answer, build_answer(answer, query, false));
+     pump(fw, epfd, 20);
+ }
+
+ /**
+  * @brief Obsluhuje forwarder, kým počet retransmisií nedosiahne retries
+  * @return true ak retransmisia nastala do 1 s
+  */
+ static bool pump_until_retry(forwarder_t *fw, int epfd, unsigned long retries) {
+     uint64_t end = monotonic_ms() + 1000;
+     while (fw->retry_count < retries && monotonic_ms() < end) {
+         pump(fw, epfd, 1);
+     }
+     return fw->retry_count >= retries;
+ }
+
+ /**
+  * @brief Test výberu najrýchlejšieho upstream servera podľa SRTT
+  */
+ void test_select_fastest() {
+     printf("\n[TEST] Upstream selection - lowest SRTT wins\n");
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     fake_upstream_t ups[2];
+     forwarder_t fw;
+
+     int epfd = start_selection(&fw, ups);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+
+     set_upstream(&fw.upstreams[0], 40000, 0);
+     set_upstream(&fw.upstreams[1], 5000, 0);
+     TEST_CHECK(routed_to(&fw, ups, 0xC001, "fast-a.example.com", query) == 1,
+                "Second upstream chosen while faster");
+
+     set_upstream(&fw.upstreams[0], 5000, 0);
+     set_upstream(&fw.upstreams[1], 40000, 0);
+     TEST_CHECK(routed_to(&fw, ups, 0xC002, "fast-b.example.com", query) == 0,
+                "First upstream chosen once it is faster");
+
+     /* Server bez merania má skóre 0 - dostane dotaz, aby sa zmeral */
+     set_upstream(&fw.upstreams[1], 0, 0);
+     TEST_CHECK(routed_to(&fw, ups, 0xC003, "fast-c.example.com", query) == 1,
+                "Unmeasured upstream preferred");
+
+     stop_selection(&fw, epfd, ups);
+ }
+
+ /**
+  * @brief Test penalizácie za vypršané RTO - skóre sa zdvojnásobí
+  */
+ void test_timeout_penalty() {
+     printf("\n[TEST] Upstream selection - timeout doubles the score\n");
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     fake_upstream_t ups[2];
+     forwarder_t fw;
+
+     int epfd = start_selection(&fw, ups);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+
+     /* 10 ms vs. 15 ms - po jednom timeoute 20 ms vs. 15 ms */
+     set_upstream(&fw.upstreams[0], 10000, 0);
+     set_upstream(&fw.upstreams[1], 15000, 0);
+     TEST_CHECK(routed_to(&fw, ups, 0xC101, "penalty.example.com", query) == 0,
+                "Faster upstream gets the first attempt");
+
+     bool retried = pump_until_retry(&fw, epfd, 1);
+     TEST_CHECK(retried && fw.upstreams[0].fail_score == 1 &&
+                fw.upstreams[0].timeout_count == 1 && fw.upstreams[0].down_until_ms == 0 &&
+                fake_recv(&ups[1], query, sizeof(query), 200) > 0,
+                "Retry goes to the other upstream, first one not marked down");
+
+     answer_routed(&fw, epfd, &ups[1], query);
+     TEST_CHECK(replies.count == 1 && !replies.failed[0] && fw.upstreams[1].fail_score == 0,
+                "Retried query answered");
+
+     stop_selection(&fw, epfd, ups);
+ }
+
+ /**
+  * @brief Test vyradenia po FORWARDER_FAIL_LIMIT timeoutoch, sondy a backoffu
+  */
+ void test_upstream_down() {
+     printf("\n[TEST] Upstream selection - marked down with backoff\n");
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     fake_upstream_t ups[2];
+     forwarder_t fw;
+
+     int epfd = start_selection(&fw, ups);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+
+     /* Dva timeouty za sebou - stále rýchlejší (50 ms << 2 < 500 ms) */
+     upstream_t *up = &fw.upstreams[0];
+     set_upstream(up, 50000, FORWARDER_FAIL_LIMIT - 1);
+     set_upstream(&fw.upstreams[1], 500000, 0);
+     routed_to(&fw, ups, 0xC201, "down-a.example.com", query);
+
+     uint64_t before = monotonic_ms();
+     bool retried = pump_until_retry(&fw, epfd, 1);
+     uint64_t after = monotonic_ms();
+     TEST_CHECK(retried && up->fail_score == FORWARDER_FAIL_LIMIT &&
+                up->down_until_ms >= before + FORWARDER_DOWN_MS &&
+                up->down_until_ms <= after + FORWARDER_DOWN_MS,
+                "Marked down for FORWARDER_DOWN_MS after FORWARDER_FAIL_LIMIT timeouts");
+
+     fake_recv(&ups[1], query, sizeof(query), 200);
+     answer_routed(&fw, epfd, &ups[1], query);
+
+     up->last_used_ms = monotonic_ms();
+     TEST_CHECK(routed_to(&fw, ups, 0xC202, "down-b.example.com", query) == 1,
+                "Down upstream skipped despite the lower score");
+     answer_routed(&fw, epfd, &ups[1], query);
+
+     /* Koniec vyradenia - jedna sonda, ďalšie dotazy čakajú na jej výsledok */
+     up->down_until_ms = monotonic_ms() - 1;
+     bool probed = routed_to(&fw, ups, 0xC203, "down-c.example.com", query) == 0;
+     TEST_CHECK(probed && up->down_until_ms > monotonic_ms(),
+                "One probe sent after the down window");
+     TEST_CHECK(routed_to(&fw, ups, 0xC204, "down-d.example.com", query) == 1,
+                "Next query avoids the upstream while the probe is out");
+     answer_routed(&fw, epfd, &ups[1], query);
+
+     /* Sonda bez odpovede - vyradenie sa zdvojnásobí */
+     before = monotonic_ms();
+     retried = pump_until_retry(&fw, epfd, 2);
+     after = monotonic_ms();
+     TEST_CHECK(retried && up->fail_score == FORWARDER_FAIL_LIMIT + 1 &&
+                up->down_until_ms >= before + 2 * FORWARDER_DOWN_MS &&
+                up->down_until_ms <= after + 2 * FORWARDER_DOWN_MS,
+                "Failed probe doubles the down window");
+     fake_recv(&ups[1], query, sizeof(query), 200);
+     answer_routed(&fw, epfd, &ups[1], query);
+
+     /* 2 s << 5 = 64 s - strop FORWARDER_DOWN_MAX_MS */
+     up->fail_score = FORWARDER_FAIL_LIMIT + 4;
+     up->down_until_ms = monotonic_ms() - 1;
+     routed_to(&fw, ups, 0xC205, "down-e.example.com", query);
+
+     before = monotonic_ms();
+     retried = pump_until_retry(&fw, epfd, 3);
+     after = monotonic_ms();
+     TEST_CHECK(retried && up->down_until_ms >= before + FORWARDER_DOWN_MAX_MS &&
+                up->down_until_ms <= after + FORWARDER_DOWN_MAX_MS,
+                "Down window capped at FORWARDER_DOWN_MAX_MS");
+     fake_recv(&ups[1], query, sizeof(query), 200);
+     answer_routed(&fw, epfd, &ups[1], query);
+
+     /* Zodpovedaná sonda vráti server do výberu */
+     up->down_until_ms = monotonic_ms() - 1;
+     probed = routed_to(&fw, ups, 0xC206, "down-f.example.com", query) == 0;
+     answer_routed(&fw, epfd, &ups[0], query);
+     TEST_CHECK(probed && up->fail_score == 0 && up->down_until_ms == 0,
+                "Answered probe brings the upstream back");
+
+     stop_selection(&fw, epfd, ups);
+ }
+
+ /**
+  * @brief Test sondy na upstream bez dotazu dlhšie ako FORWARDER_PROBE_MS
+  */
+ void test_idle_probe() {
+     printf("\n[TEST] Upstream selection - idle probe\n");
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     fake_upstream_t ups[2];
+     forwarder_t fw;
+
+     int epfd = start_selection(&fw, ups);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+
+     set_upstream(&fw.upstreams[0], 1000, 0);
+     set_upstream(&fw.upstreams[1], 50000, 0);
+     fw.upstreams[1].last_used_ms = monotonic_ms() - FORWARDER_PROBE_MS + 1000;
+     TEST_CHECK(routed_to(&fw, ups, 0xC301, "idle-a.example.com", query) == 0,
+                "No probe before FORWARDER_PROBE_MS");
+
+     fw.upstreams[1].last_used_ms = monotonic_ms() - FORWARDER_PROBE_MS;
+     TEST_CHECK(routed_to(&fw, ups, 0xC302, "idle-b.example.com", query) == 1,
+                "Slow upstream probed after FORWARDER_PROBE_MS idle");
+
+     TEST_CHECK(routed_to(&fw, ups, 0xC303, "idle-c.example.com", query) == 0,
+                "Fastest upstream chosen again after the probe");
+
+     stop_selection(&fw, epfd, ups);
+ }
+
+ /**
+  * @brief Test výberu, keď sú vyradené všetky upstream servery
+  */
+ void test_all_down() {
+     printf("\n[TEST] Upstream selection - every upstream down\n");
+
+     uint8_t query[DNS_EDNS_UDP_SIZE];
+     fake_upstream_t ups[2];
+     forwarder_t fw;
+
+     int epfd = start_selection(&fw, ups);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start forwarder");
+         return;
+     }
+
+     uint64_t now = monotonic_ms();
+     set_upstream(&fw.upstreams[0], 1000, FORWARDER_FAIL_LIMIT);
+     set_upstream(&fw.upstreams[1], 50000, FORWARDER_FAIL_LIMIT);
+     fw.upstreams[0].down_until_ms = now + 5000;
+     fw.upstreams[1].down_until_ms = now + 3000;
+     TEST_CHECK(routed_to(&fw, ups, 0xC401, "all-a.example.com", query) == 1,
+                "Upstream recovering first is used");
+
+     fw.upstreams[0].down_until_ms = now + 1000;
+     TEST_CHECK(routed_to(&fw, ups, 0xC402, "all-b.example.com", query) == 0,
+                "Earliest recovery wins regardless of SRTT");
+
+     stop_selection(&fw, epfd, ups);
+ }
+
+ int main() {
+     printf("==============================================\n");
+     printf("Forwarder Unit Tests\n");
+     printf("==============================================\n");
+
+     test_tcp_split_frames();
+     test_tcp_pipelined();
+     test_tcp_upstream_close();
+     test_tcp_oversize();
+     test_hedge_delay();
+     test_hedge_tokens();
+     test_hedge_min_samples();
+     test_hedge_loser();
+     test_coalesce_duplicates();
+     test_coalesce_servfail();
+     test_coalesce_overflow();
+     test_coalesce_dnssec();
+     test_select_fastest();
+     test_timeout_penalty();
+     test_upstream_down();
+     test_idle_probe();
+     test_all_down();
+
+     printf("\n==============================================\n");
+     printf("TEST RESULTS:\n");
+     printf("  " COLOR_GREEN "Passed: %d" COLOR_RESET "\n", tests_passed);
+     if (tests_failed > 0) {
+         printf("  " COLOR_RED "Failed: %d" COLOR_RESET "\n", tests_failed);
+     } else {
+         printf("  Failed: 0\n");
+     }
+     printf("  Total:  %d\n", tests_passed + tests_failed);
+     printf("==============================================\n");
+
+     if (tests_failed == 0) {
+         printf(COLOR_GREEN " All tests passed!" COLOR_RESET "\n");
+         return 0;
+     } else {
+         printf(COLOR_RED " Some tests failed!" COLOR_RESET "\n");
+         return 1;
+     }
+ }
@@ -17,6 +17,8 @@
  #include <arpa/inet.h>
  #include <sys/socket.h>
  #include <netinet/in.h>
+ #include <fcntl.h>
+ #include <errno.h>
  
  #define COLOR_GREEN "\033[32m"
  #define COLOR_RED "\033[31m"
@@ -255,6 +257,209 @@
      }
  }
  
+ /**
+  * @brief Test open_upstream_socket (pripojený socket s náhodným portom)
+  */
+ void test_open_upstream_socket() {
+     printf("\n[TEST] open_upstream_socket()\n");
+     
+     /* Lokálny "upstream" na efemérnom porte */
+     int upstream_fd = socket(AF_INET, SOCK_DGRAM, 0);
+     struct sockaddr_in upstream;
+     socklen_t addr_len = sizeof(upstream);
+     memset(&upstream, 0, sizeof(upstream));
+     upstream.sin_family = AF_INET;
+     upstream.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+     
+     if (upstream_fd < 0 ||
+         bind(upstream_fd, (struct sockaddr *)&upstream, sizeof(upstream)) != 0 ||
+         getsockname(upstream_fd, (struct sockaddr *)&upstream, &addr_len) != 0) {
+         TEST_SKIP("Cannot create local upstream socket");
+         return;
+     }
+     
+     int a = open_upstream_socket(&upstream, true);
+     int b = open_upstream_socket(&upstream, false);
+     
+     if (a < 0 || b < 0) {
+         TEST_FAIL("Failed to open upstream sockets");
+         close(upstream_fd);
+         return;
+     }
+     
+     /* Test 1: Socket je pripojený na upstream */
+     struct sockaddr_in peer, local_a, local_b;
+     addr_len = sizeof(peer);
+     if (getpeername(a, (struct sockaddr *)&peer, &addr_len) == 0 &&
+         peer.sin_addr.s_addr == upstream.sin_addr.s_addr &&
+         peer.sin_port == upstream.sin_port) {
+         TEST_PASS("Socket connected to upstream");
+     } else {
+         TEST_FAIL("Socket not connected to upstream");
+     }
+     
+     /* Test 2: Náhodné (rôzne, nie privilegované) zdrojové porty */
+     addr_len = sizeof(local_a);
+     getsockname(a, (struct sockaddr *)&local_a, &addr_len);
+     addr_len = sizeof(local_b);
+     getsockname(b, (struct sockaddr *)&local_b, &addr_len);
+     
+     if (ntohs(local_a.sin_port) >= UPSTREAM_PORT_MIN &&
+         ntohs(local_b.sin_port) >= UPSTREAM_PORT_MIN &&
+         local_a.sin_port != local_b.sin_port) {
+         TEST_PASS("Distinct random source ports");
+     } else {
+         TEST_FAIL("Source ports not randomized");
+     }
+     
+     /* Test 3: O_NONBLOCK podľa parametra */
+     if ((fcntl(a, F_GETFL, 0) & O_NONBLOCK) && !(fcntl(b, F_GETFL, 0) & O_NONBLOCK)) {
+         TEST_PASS("Non-blocking mode honored");
+     } else {
+         TEST_FAIL("Non-blocking mode wrong");
+     }
+     
+     /* Test 4: Datagram z cudzej adresy kernel zahodí */
+     int stranger = socket(AF_INET, SOCK_DGRAM, 0);
+     local_a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+     sendto(stranger, "x", 1, 0, (struct sockaddr *)&local_a, sizeof(local_a));
+     sendto(upstream_fd, "y", 1, 0, (struct sockaddr *)&local_a, sizeof(local_a));
+     usleep(10000);
+     
+     char buf[4];
+     ssize_t n = recv(a, buf, sizeof(buf), 0);
+     ssize_t extra = recv(a, buf + 1, sizeof(buf) - 1, 0);
+     if (n == 1 && buf[0] == 'y' && extra < 0 && errno == EAGAIN) {
+         TEST_PASS("Datagrams from other sources filtered");
+     } else {
+         TEST_FAIL("Datagram from foreign source delivered");
+     }
+     
+     /* Test 5: NULL upstream */
+     if (open_upstream_socket(NULL, false) == -1) {
+         TEST_PASS("NULL upstream handling");
+     } else {
+         TEST_FAIL("NULL upstream accepted");
+     }
+     
+     close(stranger);
+     close(a);
+     close(b);
+     close(upstream_fd);
+ }
+ 
+ /**
+  * @brief Test cache upstream adresy
+  */
+ void test_upstream_cache() {
+     printf("\n[TEST] upstream_cache_*()\n");
+     
+     struct sockaddr_in addr;
+     char loopback[] = "127.0.0.1";
+     char loopback2[] = "127.0.0.2";
+     char invalid[] = "this.domain.does.not.exist.invalid";
+     char *single[] = { loopback };
+     char *pair[] = { loopback, loopback2 };
+     char *broken[] = { loopback2, invalid };
+     
+     /* Test 1: Pred inicializáciou nie je čo vrátiť */
+     upstream_cache_clear();
+     if (upstream_cache_generation() == 0 && !upstream_cache_lookup("127.0.0.1", &addr) &&
+         upstream_cache_refresh() == -1) {
+         TEST_PASS("Empty cache");
+     } else {
+         TEST_FAIL("Empty cache returned data");
+     }
+     
+     /* Test 2: Init s IP adresou -> hotová sockaddr_in */
+     if (upstream_cache_init(single, 1) == 0 &&
+         upstream_cache_count() == 1 &&
+         upstream_cache_get(0, &addr) != 0 &&
+         addr.sin_addr.s_addr == htonl(INADDR_LOOPBACK) &&
+         addr.sin_port == htons(UPSTREAM_PORT)) {
+         TEST_PASS("Address resolved at init");
+     } else {
+         TEST_FAIL("Init did not store address");
+     }
+     
+     /* Test 3: Lookup iba pre nakonfigurovaný upstream */
+     if (upstream_cache_lookup("127.0.0.1", &addr) && !upstream_cache_lookup("8.8.8.8", &addr)) {
+         TEST_PASS("Lookup matches configured upstream only");
+     } else {
+         TEST_FAIL("Lookup mismatch");
+     }
+     
+     /* Test 4: Obnova IP adresy je no-op (generácia sa nemení) */
+     uint32_t generation = upstream_cache_generation();
+     if (upstream_cache_refresh() == 0 && upstream_cache_generation() == generation) {
+         TEST_PASS("Refresh of literal IP is a no-op");
+     } else {
+         TEST_FAIL("Refresh changed literal IP");
+     }
+     
+     /* Test 5: Nevyriešiteľný hostname pri štarte - cache ostáva celá */
+     if (upstream_cache_init(broken, 2) == -1 &&
+         upstream_cache_count() == 1 &&
+         upstream_cache_lookup("127.0.0.1", &addr) &&
+         !upstream_cache_lookup("127.0.0.2", &addr)) {
+         TEST_PASS("Failed init keeps last known address");
+     } else {
+         TEST_FAIL("Failed init corrupted cache");
+     }
+     
+     /* Test 6: Viac upstream serverov - adresy v poradí konfigurácie */
+     if (upstream_cache_init(pair, 2) == 0 &&
+         upstream_cache_count() == 2 &&
+         upstream_cache_get(1, &addr) != 0 &&
+         addr.sin_addr.s_addr == htonl(0x7F000002) &&
+         upstream_cache_get(2, &addr) == 0) {
+         TEST_PASS("Multiple upstreams kept in order");
+     } else {
+         TEST_FAIL("Multiple upstreams not stored");
+     }
+     
+     upstream_cache_clear();
+ }
+ 
+ /**
+  * @brief Test odhadu RTT a retransmission timeoutu
+  */
+ void test_upstream_rtt() {
+     printf("\n[TEST] upstream_rtt_*()\n");
+     
+     upstream_rtt_t rtt;
+     memset(&rtt, 0, sizeof(rtt));
+     
+     /* Test 1: Bez merania počiatočné RTO, rýchly upstream zdola ohraničený */
+     uint32_t initial = upstream_rtt_rto_ms(&rtt, 0, UPSTREAM_RTO_MAX_MS);
+     upstream_rtt_sample(&rtt, 3000);
+     if (initial == UPSTREAM_RTO_INITIAL_MS &&
+         upstream_rtt_rto_ms(&rtt, 0, UPSTREAM_RTO_MAX_MS) == UPSTREAM_RTO_MIN_MS) {
+         TEST_PASS("Initial and minimum RTO");
+     } else {
+         TEST_FAIL("Unexpected initial/minimum RTO");
+     }
+     
+     /* Test 2: SRTT + 4*RTTVAR, backoff zdvojnásobí až po strop */
+     memset(&rtt, 0, sizeof(rtt));
+     upstream_rtt_sample(&rtt, 100000);
+     if (upstream_rtt_rto_ms(&rtt, 0, 1000) == 300 &&
+         upstream_rtt_rto_ms(&rtt, 1, 1000) == 600 &&
+         upstream_rtt_rto_ms(&rtt, 2, 1000) == 1000) {
+         TEST_PASS("RTO with exponential backoff and cap");
+     } else {
+         TEST_FAIL("Wrong RTO backoff");
+     }
+     
+     /* Test 3: Ďalšie meranie - RTTVAR o 1/4, SRTT o 1/8 (RFC 6298) */
+     upstream_rtt_sample(&rtt, 200000);
+     if (rtt.srtt_us == 112500 && rtt.rttvar_us == 62500) {
+         TEST_PASS("SRTT/RTTVAR update");
+     } else {
+         TEST_FAIL("Wrong SRTT/RTTVAR update");
+     }
+ }
+ 
  /**
   * @brief Main test runner
   */
@@ -266,6 +471,9 @@
      
      test_resolve_upstream_address();
      test_create_upstream_socket();
+     test_open_upstream_socket();
+     test_upstream_cache();
+     test_upstream_rtt();
      test_forward_query();
      
      printf("\n==============================================\n");
@@ -0,0 +1,637 @@
+/**
+ * @file test_tcp_server.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver
+ */
+
+ #include "dns.h"
+ #include "tcp_server.h"
+ #include "utils.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+ #include <errno.h>
+ #include <poll.h>
+ #include <arpa/inet.h>
+ #include <sys/epoll.h>
+ #include <sys/socket.h>
+ #include <netinet/in.h>
+
+ #define COLOR_GREEN "\033[32m"
+ #define COLOR_RED "\033[31m"
+ #define COLOR_RESET "\033[0m"
+
+ int tests_passed = 0;
+ int tests_failed = 0;
+
+ #define TEST_PASS(msg) do { \
+     printf("  " COLOR_GREEN "Y" COLOR_RESET " %s\n", msg); \
+     tests_passed++; \
+ } while(0)
+
+ #define TEST_FAIL(msg) do { \
+     printf("  " COLOR_RED "N" COLOR_RESET " %s\n", msg); \
+     tests_failed++; \
+ } while(0)
+
+ #define TEST_CHECK(cond, msg) do { \
+     if (cond) { TEST_PASS(msg); } else { TEST_FAIL(msg); } \
+ } while(0)
+
+ /* Koľko dotazov si zapamätá callback */
+ #define QUERY_LOG_SIZE  64
+
+ /* Dotazy doručené cez on_query */
+ static struct {
+     bool defer;                         /* false = odpovie hneď (echo s QR) */
+     int count;
+     uint32_t conn_ref[QUERY_LOG_SIZE];
+     uint32_t generation[QUERY_LOG_SIZE];
+     uint16_t id[QUERY_LOG_SIZE];
+ } queries;
+
+ /**
+  * @brief Callback listenera - zapamätá si dotaz, v echo režime hneď odpovie
+  */
+ static int on_query(void *ctx, uint32_t conn_ref, uint32_t generation,
+                     const struct sockaddr_in *addr, uint8_t *query, size_t len) {
+     tcp_server_t *tcp = (tcp_server_t *)ctx;
+     (void)addr;
+
+     int i = queries.count++;
+     if (i < QUERY_LOG_SIZE) {
+         queries.conn_ref[i] = conn_ref;
+         queries.generation[i] = generation;
+         queries.id[i] = len >= 2 ? (uint16_t)((query[0] << 8) | query[1]) : 0;
+     }
+
+     if (queries.defer) {
+         return 0;
+     }
+
+     query[2] |= 0x80;
+     return tcp_server_send(tcp, conn_ref, generation, query, len) == 0 ? 0 : -1;
+ }
+
+ /**
+  * @brief Spustí listener na voľnom porte loopbacku s vlastným epoll
+  * @return epoll fd, -1 pri chybe
+  */
+ static int start_server(tcp_server_t *tcp, size_t max_conns, struct sockaddr_in *addr) {
+     memset(addr, 0, sizeof(*addr));
+     addr->sin_family = AF_INET;
+     addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+     int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+     int epfd = epoll_create1(0);
+     socklen_t len = sizeof(*addr);
+
+     if (lfd < 0 || epfd < 0 ||
+         bind(lfd, (struct sockaddr *)addr, sizeof(*addr)) != 0 ||
+         getsockname(lfd, (struct sockaddr *)addr, &len) != 0 ||
+         listen(lfd, 16) != 0 ||
+         tcp_server_init(tcp, lfd, epfd, max_conns, on_query, tcp) != 0) {
+         if (lfd >= 0) {
+             close(lfd);
+         }
+         if (epfd >= 0) {
+             close(epfd);
+         }
+         return -1;
+     }
+
+     memset(&queries, 0, sizeof(queries));
+     return epfd;
+ }
+
+ static void stop_server(tcp_server_t *tcp, int epfd) {
+     tcp_server_free(tcp);
+     close(epfd);
+ }
+
+ /**
+  * @brief Obsluhuje udalosti listenera počas ms milisekúnd
+  *
+  * Ako event loop workera: udalosti, flush odpovedí, timeouty.
+  */
+ static void pump(tcp_server_t *tcp, int epfd, int ms) {
+     uint64_t end = monotonic_ms() + (uint64_t)ms;
+     uint64_t now;
+
+     while ((now = monotonic_ms()) < end) {
+         struct epoll_event events[16];
+         int wait = end - now < 10 ? (int)(end - now) : 10;
+         int n = epoll_wait(epfd, events, 16, wait);
+
+         for (int i = 0; i < n; i++) {
+             tcp_server_handle_event(tcp, events[i].data.u64, events[i].events);
+         }
+         tcp_server_flush(tcp);
+         tcp_server_process_timeouts(tcp, monotonic_ms());
+     }
+ }
+
+ /**
+  * @brief Pripojí klienta k listeneru
+  * @return Socket klienta, -1 pri chybe
+  */
+ static int client_connect(const struct sockaddr_in *addr) {
+     int fd = socket(AF_INET, SOCK_STREAM, 0);
+     if (fd < 0) {
+         return -1;
+     }
+     if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+         close(fd);
+         return -1;
+     }
+     return fd;
+ }
+
+ /**
+  * @brief Počká, kým je fd čitateľný
+  */
+ static bool wait_readable(int fd, int timeout_ms) {
+     struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+     return poll(&pfd, 1, timeout_ms) == 1;
+ }
+
+ /**
+  * @brief Zistí, či server spojenie zavrel (recv() vráti EOF)
+  */
+ static bool peer_closed(int fd, int timeout_ms) {
+     uint8_t byte;
+     return wait_readable(fd, timeout_ms) && recv(fd, &byte, 1, MSG_DONTWAIT) == 0;
+ }
+
+ /**
+  * @brief Prečíta presne len bajtov z TCP spojenia
+  */
+ static int read_full(int fd, uint8_t *buf, size_t len, int timeout_ms) {
+     size_t got = 0;
+     while (got < len) {
+         if (!wait_readable(fd, timeout_ms)) {
+             return -1;
+         }
+         ssize_t n = recv(fd, buf + got, len - got, 0);
+         if (n <= 0) {
+             return -1;
+         }
+         got += (size_t)n;
+     }
+     return 0;
+ }
+
+ /**
+  * @brief Prečíta jeden rámec (2-bajtová dĺžka + správa) z TCP spojenia
+  * @return Dĺžka správy, -1 ak rámec neprišiel
+  */
+ static ssize_t read_frame(int fd, uint8_t *buf, size_t cap, int timeout_ms) {
+     uint8_t prefix[2];
+     if (read_full(fd, prefix, 2, timeout_ms) != 0) {
+         return -1;
+     }
+
+     size_t len = ((size_t)prefix[0] << 8) | prefix[1];
+     if (len > cap || read_full(fd, buf, len, timeout_ms) != 0) {
+         return -1;
+     }
+     return (ssize_t)len;
+ }
+
+ /**
+  * @brief Pošle celý buffer cez TCP spojenie
+  */
+ static void write_all(int fd, const uint8_t *buf, size_t len) {
+     size_t sent = 0;
+     while (sent < len) {
+         ssize_t n = send(fd, buf + sent, len - sent, MSG_NOSIGNAL);
+         if (n <= 0) {
+             return;
+         }
+         sent += (size_t)n;
+     }
+ }
+
+ /**
+  * @brief Zostaví TCP rámec s dotazom (trieda IN, typ A) na dané meno
+  * @return Dĺžka rámca
+  */
+ static size_t build_frame(uint8_t *frame, uint16_t id, const char *name) {
+     uint8_t *buf = frame + 2;
+
+     memset(buf, 0, DNS_HEADER_SIZE);
+     buf[0] = (uint8_t)(id >> 8);
+     buf[1] = (uint8_t)id;
+     buf[2] = 0x01;
+     buf[5] = 1;
+
+     size_t pos = DNS_HEADER_SIZE;
+     const char *label = name;
+     while (*label != '\0') {
+         const char *dot = strchr(label, '.');
+         size_t len = dot != NULL ? (size_t)(dot - label) : strlen(label);
+         buf[pos++] = (uint8_t)len;
+         memcpy(buf + pos, label, len);
+         pos += len;
+         label += len + (dot != NULL ? 1 : 0);
+     }
+     buf[pos++] = 0;
+     buf[pos++] = 0; buf[pos++] = DNS_TYPE_A;
+     buf[pos++] = 0; buf[pos++] = DNS_CLASS_IN;
+
+     frame[0] = (uint8_t)(pos >> 8);
+     frame[1] = (uint8_t)pos;
+     return pos + 2;
+ }
+
+ /**
+  * @brief Odpovie na odložený dotaz (echo s QR bitom)
+  * @return Návratová hodnota tcp_server_send()
+  */
+ static int answer_deferred(tcp_server_t *tcp, int index) {
+     uint8_t frame[DNS_HEADER_SIZE + 64];
+     size_t len = build_frame(frame, queries.id[index], "deferred.example.com") - 2;
+
+     frame[4] |= 0x80;
+     return tcp_server_send(tcp, queries.conn_ref[index], queries.generation[index],
+                            frame + 2, len);
+ }
+
+ /**
+  * @brief Test rámca rozdeleného do viacerých recv() a viacerých rámcov v jednom
+  */
+ void test_split_frames() {
+     printf("\n[TEST] TCP listener - frames split and coalesced across reads\n");
+
+     tcp_server_t tcp;
+     struct sockaddr_in addr;
+     int epfd = start_server(&tcp, 4, &addr);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start TCP listener");
+         return;
+     }
+
+     int fd = client_connect(&addr);
+     uint8_t frame[128];
+     size_t frame_len = build_frame(frame, 0x1111, "split.example.com");
+
+     /* Dĺžka po jednom bajte, potom zvyšok správy na dvakrát */
+     write_all(fd, frame, 1);
+     pump(&tcp, epfd, 20);
+     write_all(fd, frame + 1, 10);
+     pump(&tcp, epfd, 20);
+     TEST_CHECK(tcp.accepted_count == 1 && queries.count == 0,
+                "Incomplete frame not dispatched");
+
+     write_all(fd, frame + 11, frame_len - 11);
+     pump(&tcp, epfd, 20);
+
+     uint8_t reply[128];
+     ssize_t len = read_frame(fd, reply, sizeof(reply), 1000);
+     TEST_CHECK(queries.count == 1 && len == (ssize_t)(frame_len - 2) &&
+                reply[0] == 0x11 && reply[1] == 0x11 && (reply[2] & 0x80) != 0,
+                "Reassembled query answered in one frame");
+
+     /* Dva celé rámce a začiatok tretieho v jednom send() */
+     uint8_t batch[384];
+     size_t batch_len = build_frame(batch, 0x2001, "one.example.com");
+     batch_len += build_frame(batch + batch_len, 0x2002, "two.example.com");
+     size_t third = build_frame(batch + batch_len, 0x2003, "three.example.com");
+     write_all(fd, batch, batch_len + 5);
+     pump(&tcp, epfd, 20);
+     TEST_CHECK(queries.count == 3 && queries.id[1] == 0x2001 && queries.id[2] == 0x2002,
+                "Two complete frames from one read dispatched");
+
+     write_all(fd, batch + batch_len + 5, third - 5);
+     pump(&tcp, epfd, 20);
+
+     bool ordered = true;
+     for (uint16_t id = 0x2001; id <= 0x2003; id++) {
+         len = read_frame(fd, reply, sizeof(reply), 1000);
+         ordered = ordered && len > 0 && ((reply[0] << 8) | reply[1]) == id;
+     }
+     TEST_CHECK(queries.count == 4 && ordered, "Trailing partial frame completed later");
+
+     close(fd);
+     stop_server(&tcp, epfd);
+ }
+
+ /**
+  * @brief Test pipeliningu - odpovede odchádzajú v poradí, v akom sú hotové
+  */
+ void test_pipelined_out_of_order() {
+     printf("\n[TEST] TCP listener - pipelined queries answered out of order\n");
+
+     tcp_server_t tcp;
+     struct sockaddr_in addr;
+     int epfd = start_server(&tcp, 4, &addr);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start TCP listener");
+         return;
+     }
+     queries.defer = true;
+
+     int fd = client_connect(&addr);
+     uint8_t batch[384];
+     size_t batch_len = 0;
+     batch_len += build_frame(batch + batch_len, 0x3001, "one.example.com");
+     batch_len += build_frame(batch + batch_len, 0x3002, "two.example.com");
+     batch_len += build_frame(batch + batch_len, 0x3003, "three.example.com");
+     write_all(fd, batch, batch_len);
+     pump(&tcp, epfd, 20);
+
+     TEST_CHECK(queries.count == 3 && tcp.conns[0].outstanding == 3,
+                "All pipelined queries dispatched before any answer");
+
+     /* Odpovede v poradí 3, 1, 2 */
+     static const int order[3] = { 2, 0, 1 };
+     bool ordered = true;
+     uint8_t reply[128];
+
+     for (int i = 0; i < 3; i++) {
+         answer_deferred(&tcp, order[i]);
+         pump(&tcp, epfd, 10);
+
+         ssize_t len = read_frame(fd, reply, sizeof(reply), 1000);
+         ordered = ordered && len > 0 &&
+                   ((reply[0] << 8) | reply[1]) == queries.id[order[i]];
+     }
+     TEST_CHECK(ordered, "Replies sent in completion order");
+     TEST_CHECK(tcp.conns[0].outstanding == 0 && tcp.open_count == 1,
+                "Outstanding count back to zero, connection kept");
+
+     close(fd);
+     stop_server(&tcp, epfd);
+ }
+
+ /**
+  * @brief Test timeoutu nečinnosti - spojenie s rozpracovaným dotazom počká
+  */
+ void test_idle_timeout() {
+     printf("\n[TEST] TCP listener - idle timeout\n");
+
+     tcp_server_t tcp;
+     struct sockaddr_in addr;
+     int epfd = start_server(&tcp, 4, &addr);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start TCP listener");
+         return;
+     }
+     queries.defer = true;
+
+     int idle = client_connect(&addr);
+     int busy = client_connect(&addr);
+     uint8_t frame[128];
+     write_all(busy, frame, build_frame(frame, 0x4001, "busy.example.com"));
+     pump(&tcp, epfd, 20);
+
+     /* Čas sa posúva iba pre koleso časovačov */
+     uint64_t now = monotonic_ms() + TCP_IDLE_TIMEOUT_MS + 500;
+     tcp_server_process_timeouts(&tcp, now);
+
+     TEST_CHECK(tcp.idle_closed_count == 1 && tcp.open_count == 1 && peer_closed(idle, 1000),
+                "Idle connection closed");
+     TEST_CHECK(!peer_closed(busy, 50), "Connection with outstanding query kept");
+
+     /* Zahodený dotaz už spojenie nedrží */
+     TEST_CHECK(tcp_server_drop(&tcp, queries.conn_ref[0], queries.generation[0]) == 0,
+                "Dropped query released");
+     tcp_server_flush(&tcp);
+     tcp_server_process_timeouts(&tcp, now + TCP_IDLE_TIMEOUT_MS + 500);
+     TEST_CHECK(tcp.idle_closed_count == 2 && tcp.open_count == 0 && peer_closed(busy, 1000),
+                "Connection closed after the dropped query");
+
+     close(idle);
+     close(busy);
+     stop_server(&tcp, epfd);
+ }
+
+ /**
+  * @brief Test zahodeného dotazu od klienta, ktorý už skončil (EOF)
+  */
+ void test_drop_after_eof() {
+     printf("\n[TEST] TCP listener - dropped query after client EOF\n");
+
+     tcp_server_t tcp;
+     struct sockaddr_in addr;
+     int epfd = start_server(&tcp, 4, &addr);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start TCP listener");
+         return;
+     }
+     queries.defer = true;
+
+     int fd = client_connect(&addr);
+     uint8_t frame[128];
+     write_all(fd, frame, build_frame(frame, 0x5001, "drop.example.com"));
+     shutdown(fd, SHUT_WR);
+     pump(&tcp, epfd, 20);
+
+     TEST_CHECK(queries.count == 1 && tcp.open_count == 1 && tcp.conns[0].read_closed,
+                "Half-closed connection waits for the outstanding answer");
+
+     tcp_server_drop(&tcp, queries.conn_ref[0], queries.generation[0]);
+     pump(&tcp, epfd, 20);
+     TEST_CHECK(tcp.open_count == 0 && peer_closed(fd, 1000),
+                "Connection closed once nothing is outstanding");
+
+     close(fd);
+     stop_server(&tcp, epfd);
+ }
+
+ /**
+  * @brief Test limitu spojení - spojenie nad limitom sa prijme a hneď zavrie
+  */
+ void test_connection_cap() {
+     printf("\n[TEST] TCP listener - connection cap\n");
+
+     tcp_server_t tcp;
+     struct sockaddr_in addr;
+     int epfd = start_server(&tcp, 2, &addr);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start TCP listener");
+         return;
+     }
+
+     int fds[3];
+     for (int i = 0; i < 3; i++) {
+         fds[i] = client_connect(&addr);
+     }
+     pump(&tcp, epfd, 50);
+
+     TEST_CHECK(tcp.accepted_count == 2 && tcp.rejected_count == 1 && tcp.open_count == 2,
+                "Connection over the cap rejected");
+     TEST_CHECK(peer_closed(fds[2], 1000), "Rejected connection closed, not left in backlog");
+
+     /* Uvoľnený slot prijme ďalšie spojenie */
+     close(fds[0]);
+     pump(&tcp, epfd, 20);
+     int extra = client_connect(&addr);
+     pump(&tcp, epfd, 20);
+
+     uint8_t frame[128];
+     uint8_t reply[128];
+     write_all(extra, frame, build_frame(frame, 0x6001, "cap.example.com"));
+     pump(&tcp, epfd, 20);
+     TEST_CHECK(tcp.accepted_count == 3 && tcp.open_count == 2 &&
+                read_frame(extra, reply, sizeof(reply), 1000) > 0,
+                "Freed slot serves a new connection");
+
+     close(fds[1]);
+     close(fds[2]);
+     close(extra);
+     stop_server(&tcp, epfd);
+ }
+
+ /**
+  * @brief Test backpressure - nad TCP_TX_HIGH_WATER sa z klienta nečíta
+  */
+ void test_tx_backpressure() {
+     printf("\n[TEST] TCP listener - tx high-water backpressure\n");
+
+     tcp_server_t tcp;
+     struct sockaddr_in addr;
+     int epfd = start_server(&tcp, 4, &addr);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start TCP listener");
+         return;
+     }
+     queries.defer = true;
+
+     int fd = client_connect(&addr);
+     int small = 4096;
+     setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+     uint8_t frame[128];
+     write_all(fd, frame, build_frame(frame, 0x7001, "bulk.example.com"));
+     pump(&tcp, epfd, 20);
+
+     tcp_conn_t *conn = &tcp.conns[0];
+     setsockopt(conn->fd, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+
+     /* Klient neodoberá - odpovede sa hromadia v tx */
+     static uint8_t bulk[16000];
+     memset(bulk, 0, sizeof(bulk));
+     size_t queued = 0;
+     for (int i = 0; i < 10; i++) {
+         tcp_server_send(&tcp, queries.conn_ref[0], queries.generation[0], bulk, sizeof(bulk));
+         queued += sizeof(bulk) + 2;
+     }
+     pump(&tcp, epfd, 20);
+
+     TEST_CHECK(conn->tx_len - conn->tx_sent >= TCP_TX_HIGH_WATER &&
+                (conn->events & EPOLLIN) == 0 && (conn->events & EPOLLOUT) != 0,
+                "Reading paused above the high-water mark");
+
+     write_all(fd, frame, build_frame(frame, 0x7002, "paused.example.com"));
+     pump(&tcp, epfd, 20);
+     TEST_CHECK(queries.count == 1, "Query not read while paused");
+
+     /* Klient odoberie všetko - čítanie sa obnoví */
+     static uint8_t sink[65536];
+     size_t drained = 0;
+     uint64_t deadline = monotonic_ms() + 5000;
+     while (drained < queued && monotonic_ms() < deadline) {
+         ssize_t n = wait_readable(fd, 5) ? recv(fd, sink, sizeof(sink), MSG_DONTWAIT) : 0;
+         if (n > 0) {
+             drained += (size_t)n;
+         }
+         pump(&tcp, epfd, 1);
+     }
+     pump(&tcp, epfd, 20);
+
+     TEST_CHECK(drained == queued && tcp.open_count == 1, "All queued replies delivered");
+     TEST_CHECK(queries.count == 2 && queries.id[1] == 0x7002 && (conn->events & EPOLLIN) != 0,
+                "Reading resumed after the client drained");
+
+     close(fd);
+     stop_server(&tcp, epfd);
+ }
+
+ /**
+  * @brief Test generácie - odpoveď pre zatvorené spojenie nepatrí novému v slote
+  */
+ void test_stale_generation() {
+     printf("\n[TEST] TCP listener - generation check on reused slot\n");
+
+     tcp_server_t tcp;
+     struct sockaddr_in addr;
+     int epfd = start_server(&tcp, 1, &addr);
+     if (epfd < 0) {
+         TEST_FAIL("Failed to start TCP listener");
+         return;
+     }
+     queries.defer = true;
+
+     int first = client_connect(&addr);
+     uint8_t frame[128];
+     write_all(first, frame, build_frame(frame, 0x8001, "first.example.com"));
+     pump(&tcp, epfd, 20);
+     close(first);
+     pump(&tcp, epfd, 20);
+
+     /* Klient sa odpojil úplne - odpoveď zlyhá pri odoslaní a slot sa uvoľní */
+     answer_deferred(&tcp, 0);
+     pump(&tcp, epfd, 20);
+     TEST_CHECK(tcp.open_count == 0, "Slot freed after the client went away");
+
+     int second = client_connect(&addr);
+     write_all(second, frame, build_frame(frame, 0x8002, "second.example.com"));
+     pump(&tcp, epfd, 20);
+
+     TEST_CHECK(queries.count == 2 && queries.conn_ref[1] == queries.conn_ref[0] &&
+                queries.generation[1] != queries.generation[0],
+                "Slot reused with a new generation");
+     TEST_CHECK(answer_deferred(&tcp, 0) != 0 &&
+                tcp_server_drop(&tcp, queries.conn_ref[0], queries.generation[0]) != 0 &&
+                tcp.conns[0].outstanding == 1,
+                "Stale send and drop rejected");
+
+     answer_deferred(&tcp, 1);
+     pump(&tcp, epfd, 20);
+
+     uint8_t reply[128];
+     ssize_t len = read_frame(second, reply, sizeof(reply), 1000);
+     TEST_CHECK(len > 0 && reply[0] == 0x80 && reply[1] == 0x02 &&
+                !wait_readable(second, 50),
+                "New client gets only its own answer");
+
+     close(second);
+     stop_server(&tcp, epfd);
+ }
+
+ int main() {
+     printf("==============================================\n");
+     printf("TCP Listener Unit Tests\n");
+     printf("==============================================\n");
+
+     test_split_frames();
+     test_pipelined_out_of_order();
+     test_idle_timeout();
+     test_drop_after_eof();
+     test_connection_cap();
+     test_tx_backpressure();
+     test_stale_generation();
+
+     printf("\n==============================================\n");
+     printf("TEST RESULTS:\n");
+     printf("  " COLOR_GREEN "Passed: %d" COLOR_RESET "\n", tests_passed);
+     if (tests_failed > 0) {
+         printf("  " COLOR_RED "Failed: %d" COLOR_RESET "\n", tests_failed);
+     } else {
+         printf("  Failed: 0\n");
+     }
+     printf("  Total:  %d\n", tests_passed + tests_failed);
+     printf("==============================================\n");
+
+     if (tests_failed == 0) {
+         printf(COLOR_GREEN " All tests passed!" COLOR_RESET "\n");
+         return 0;
+     } else {
+         printf(COLOR_RED " Some tests failed!" COLOR_RESET "\n");
+         return 1;
+     }
+ }
@@ -0,0 +1,288 @@
+/**
+ * @file test_timer_wheel.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver
+ */
+
+ #include "timer_wheel.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+
+ #define COLOR_GREEN "\033[32m"
+ #define COLOR_RED "\033[31m"
+ #define COLOR_RESET "\033[0m"
+
+ int tests_passed = 0;
+ int tests_failed = 0;
+
+ #define TEST_PASS(msg) do { \
+     printf("  " COLOR_GREEN "Y" COLOR_RESET " %s\n", msg); \
+     tests_passed++; \
+ } while(0)
+
+ #define TEST_FAIL(msg) do { \
+     printf("  " COLOR_RED "N" COLOR_RESET " %s\n", msg); \
+     tests_failed++; \
+ } while(0)
+
+ /**
+  * @brief Testovací záznam s vloženým časovačom
+  */
+ typedef struct {
+     int value;
+     timer_node_t timer;
+     int fired;
+ } test_entry_t;
+
+ /**
+  * @brief Callback - započíta expiráciu
+  */
+ static void count_fired(timer_node_t *node, void *ctx) {
+     test_entry_t *entry = TIMER_ENTRY(node, test_entry_t, timer);
+     entry->fired++;
+
+     if (ctx != NULL) {
+         (*(int *)ctx)++;
+     }
+ }
+
+ /**
+  * @brief Callback - znovu naplánuje ten istý časovač
+  */
+ static void rearm_fired(timer_node_t *node, void *ctx) {
+     timer_wheel_t *wheel = (timer_wheel_t *)ctx;
+     test_entry_t *entry = TIMER_ENTRY(node, test_entry_t, timer);
+
+     entry->fired++;
+     if (entry->fired < 3) {
+         timer_wheel_add(wheel, node, (wheel->current_tick + 5) * wheel->tick_ms);
+     }
+ }
+
+ /**
+  * @brief Test základnej expirácie
+  */
+ void test_basic_expiry() {
+     printf("\n[TEST] timer_wheel_add() / timer_wheel_advance()\n");
+
+     timer_wheel_t wheel;
+     if (timer_wheel_init(&wheel, 64, 10, 1000) != 0) {
+         TEST_FAIL("Initialization failed");
+         return;
+     }
+
+     test_entry_t a, b;
+     memset(&a, 0, sizeof(a));
+     memset(&b, 0, sizeof(b));
+
+     timer_wheel_add(&wheel, &a.timer, 1050);
+     timer_wheel_add(&wheel, &b.timer, 1200);
+
+     /* Test 1: Pred expiráciou sa nič nestane */
+     int count = 0;
+     timer_wheel_advance(&wheel, 1040, count_fired, &count);
+     if (count == 0 && a.fired == 0) {
+         TEST_PASS("No expiry before deadline");
+     } else {
+         TEST_FAIL("Timer fired too early");
+     }
+
+     /* Test 2: Expiruje iba prvý */
+     timer_wheel_advance(&wheel, 1060, count_fired, &count);
+     if (a.fired == 1 && b.fired == 0 && !a.timer.armed) {
+         TEST_PASS("First timer expired");
+     } else {
+         TEST_FAIL("Unexpected expiry state");
+     }
+
+     /* Test 3: Druhý expiruje neskôr */
+     timer_wheel_advance(&wheel, 1300, count_fired, &count);
+     if (b.fired == 1 && count == 2 && wheel.armed_count == 0) {
+         TEST_PASS("Second timer expired");
+     } else {
+         TEST_FAIL("Second timer did not expire");
+     }
+
+     timer_wheel_free(&wheel);
+ }
+
+ /**
+  * @brief Test zrušenia časovača
+  */
+ void test_cancel() {
+     printf("\n[TEST] timer_wheel_cancel()\n");
+
+     timer_wheel_t wheel;
+     timer_wheel_init(&wheel, 64, 10, 0);
+
+     test_entry_t a;
+     memset(&a, 0, sizeof(a));
+
+     timer_wheel_add(&wheel, &a.timer, 100);
+     timer_wheel_cancel(&wheel, &a.timer);
+     timer_wheel_advance(&wheel, 500, count_fired, NULL);
+
+     if (a.fired == 0 && wheel.armed_count == 0) {
+         TEST_PASS("Cancelled timer does not fire");
+     } else {
+         TEST_FAIL("Cancelled timer fired");
+     }
+
+     /* Dvojité zrušenie je no-op */
+     timer_wheel_cancel(&wheel, &a.timer);
+     if (wheel.armed_count == 0) {
+         TEST_PASS("Double cancel is a no-op");
+     } else {
+         TEST_FAIL("Double cancel corrupted state");
+     }
+
+     timer_wheel_free(&wheel);
+ }
+
+ /**
+  * @brief Test časovača dlhšieho ako jedna otáčka kolesa
+  */
+ void test_multiple_rounds() {
+     printf("\n[TEST] Timers beyond one wheel rotation\n");
+
+     timer_wheel_t wheel;
+     timer_wheel_init(&wheel, 8, 10, 0);     /* Otáčka = 80 ms */
+
+     test_entry_t a;
+     memset(&a, 0, sizeof(a));
+     timer_wheel_add(&wheel, &a.timer, 250);
+
+     /* Postupný posun cez viac otáčok */
+     for (uint64_t now = 10; now < 250; now += 10) {
+         timer_wheel_advance(&wheel, now, count_fired, NULL);
+     }
+
+     if (a.fired == 0) {
+         TEST_PASS("Timer survives earlier rotations");
+     } else {
+         TEST_FAIL("Timer fired in wrong rotation");
+     }
+
+     timer_wheel_advance(&wheel, 250, count_fired, NULL);
+     if (a.fired == 1) {
+         TEST_PASS("Timer fires in correct rotation");
+     } else {
+         TEST_FAIL("Timer did not fire");
+     }
+
+     /* Veľký skok dopredu (dlhý epoll_wait) */
+     test_entry_t b;
+     memset(&b, 0, sizeof(b));
+     timer_wheel_add(&wheel, &b.timer, 400);
+     timer_wheel_advance(&wheel, 10000, count_fired, NULL);
+     if (b.fired == 1) {
+         TEST_PASS("Large time jump expires timer");
+     } else {
+         TEST_FAIL("Large time jump lost timer");
+     }
+
+     timer_wheel_free(&wheel);
+ }
+
+ /**
+  * @brief Test preplánovania z callbacku a timeoutu pre epoll
+  */
+ void test_rearm_and_timeout() {
+     printf("\n[TEST] Re-arm from callback / timer_wheel_timeout_ms()\n");
+
+     timer_wheel_t wheel;
+     timer_wheel_init(&wheel, 16, 10, 0);
+
+     if (timer_wheel_timeout_ms(&wheel, 0, 1000) == 1000) {
+         TEST_PASS("Empty wheel returns max timeout");
+     } else {
+         TEST_FAIL("Empty wheel timeout wrong");
+     }
+
+     test_entry_t a;
+     memset(&a, 0, sizeof(a));
+     timer_wheel_add(&wheel, &a.timer, 30);
+
+     int timeout = timer_wheel_timeout_ms(&wheel, 3, 1000);
+     if (timeout > 0 && timeout <= 10) {
+         TEST_PASS("Armed wheel returns tick timeout");
+     } else {
+         TEST_FAIL("Armed wheel timeout wrong");
+     }
+
+     for (uint64_t now = 0; now <= 200; now += 10) {
+         timer_wheel_advance(&wheel, now, rearm_fired, &wheel);
+     }
+
+     if (a.fired == 3 && wheel.armed_count == 0) {
+         TEST_PASS("Timer re-armed from callback");
+     } else {
+         TEST_FAIL("Re-arm from callback failed");
+     }
+
+     timer_wheel_free(&wheel);
+ }
+
+ /**
+  * @brief Test neplatných argumentov
+  */
+ void test_invalid_args() {
+     printf("\n[TEST] Invalid arguments\n");
+
+     timer_wheel_t wheel;
+
+     if (timer_wheel_init(NULL, 16, 10, 0) == -1 &&
+         timer_wheel_init(&wheel, 0, 10, 0) == -1 &&
+         timer_wheel_init(&wheel, 16, 0, 0) == -1) {
+         TEST_PASS("Invalid init parameters rejected");
+     } else {
+         TEST_FAIL("Invalid init parameters accepted");
+     }
+
+     /* NULL argumenty nesmú spadnúť */
+     timer_wheel_add(NULL, NULL, 0);
+     timer_wheel_cancel(NULL, NULL);
+     timer_wheel_free(NULL);
+     if (timer_wheel_advance(NULL, 100, count_fired, NULL) == 0) {
+         TEST_PASS("NULL wheel handling");
+     } else {
+         TEST_FAIL("NULL wheel handling");
+     }
+ }
+
+ /**
+  * @brief Main test runner
+  */
+ int main() {
+     printf("==============================================\n");
+     printf("Timer Wheel Unit Tests\n");
+     printf("==============================================\n");
+
+     test_basic_expiry();
+     test_cancel();
+     test_multiple_rounds();
+     test_rearm_and_timeout();
+     test_invalid_args();
+
+     printf("\n==============================================\n");
+     printf("TEST RESULTS:\n");
+     printf("  " COLOR_GREEN "Passed: %d" COLOR_RESET "\n", tests_passed);
+     if (tests_failed > 0) {
+         printf("  " COLOR_RED "Failed: %d" COLOR_RESET "\n", tests_failed);
+     } else {
+         printf("  Failed: 0\n");
+     }
+     printf("  Total:  %d\n", tests_passed + tests_failed);
+     printf("==============================================\n");
+
+     if (tests_failed == 0) {
+         printf(COLOR_GREEN " All tests passed!" COLOR_RESET "\n");
+         return 0;
+     } else {
+         printf(COLOR_RED " Some tests failed!" COLOR_RESET "\n");
+         return 1;
+     }
+ }
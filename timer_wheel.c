@@ -0,0 +1,198 @@
+/**
+ * @file timer_wheel.c
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Hashed timer wheel
+ */
+
+#include "timer_wheel.h"
+
+#include <stdlib.h>
+
+/**
+ * @brief Vloží uzol na koniec zoznamu slotu
+ */
+static void slot_append(timer_node_t *head, timer_node_t *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+/**
+ * @brief Vyberie uzol zo zoznamu
+ */
+static void node_unlink(timer_node_t *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+/**
+ * @brief Inicializuje timer wheel
+ *
+ * Edge cases:
+ * - NULL wheel
+ * - Nulový počet slotov alebo granularita
+ */
+int timer_wheel_init(timer_wheel_t *wheel, size_t slot_count, uint64_t tick_ms,
+                     uint64_t now_ms) {
+    if (wheel == NULL || slot_count == 0 || tick_ms == 0) {
+        return -1;
+    }
+
+    wheel->slots = (timer_node_t *)malloc(slot_count * sizeof(timer_node_t));
+    if (wheel->slots == NULL) {
+        return -1;
+    }
+
+    /* Prázdny slot = sentinel ukazujúci sám na seba */
+    for (size_t i = 0; i < slot_count; i++) {
+        wheel->slots[i].prev = &wheel->slots[i];
+        wheel->slots[i].next = &wheel->slots[i];
+        wheel->slots[i].expires_tick = 0;
+        wheel->slots[i].armed = false;
+    }
+
+    wheel->slot_count = slot_count;
+    wheel->tick_ms = tick_ms;
+    wheel->current_tick = now_ms / tick_ms;
+    wheel->armed_count = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Uvoľní sloty kolesa
+ */
+void timer_wheel_free(timer_wheel_t *wheel) {
+    if (wheel == NULL) {
+        return;
+    }
+
+    free(wheel->slots);
+    wheel->slots = NULL;
+    wheel->slot_count = 0;
+    wheel->armed_count = 0;
+}
+
+/**
+ * @brief Naplánuje (alebo preplánuje) časovač
+ *
+ * Expirácia sa zaokrúhľuje nahor na celý tick, takže časovač nikdy
+ * nevyprší skôr ako je požadované.
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_node_t *node, uint64_t expires_ms) {
+    if (wheel == NULL || node == NULL || wheel->slots == NULL) {
+        return;
+    }
+
+    if (node->armed) {
+        timer_wheel_cancel(wheel, node);
+    }
+
+    uint64_t tick = (expires_ms + wheel->tick_ms - 1) / wheel->tick_ms;
+    if (tick <= wheel->current_tick) {
+        tick = wheel->current_tick + 1;
+    }
+
+    node->expires_tick = tick;
+    node->armed = true;
+    slot_append(&wheel->slots[tick % wheel->slot_count], node);
+    wheel->armed_count++;
+}
+
+/**
+ * @brief Zruší časovač
+ */
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_node_t *node) {
+    if (wheel == NULL || node == NULL || !node->armed) {
+        return;
+    }
+
+    node_unlink(node);
+    node->armed = false;
+    wheel->armed_count--;
+}
+
+/**
+ * @brief Posunie koleso na aktuálny čas
+ *
+ * Spracujú sa iba sloty medzi posledným a aktuálnym tickom (najviac
+ * jedna otáčka). Uzly s expiráciou v ďalšej otáčke zostávajú v slote.
+ * Slot sa pred spracovaním odpojí, takže callback môže bezpečne
+ * plánovať nové časovače.
+ */
+size_t timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms,
+                           timer_callback_t callback, void *ctx) {
+    if (wheel == NULL || wheel->slots == NULL) {
+        return 0;
+    }
+
+    uint64_t target = now_ms / wheel->tick_ms;
+    if (target <= wheel->current_tick) {
+        return 0;
+    }
+
+    /* Viac ako jedna otáčka - stačí spracovať každý slot raz */
+    if (target - wheel->current_tick > wheel->slot_count) {
+        wheel->current_tick = target - wheel->slot_count;
+    }
+
+    size_t expired = 0;
+
+    while (wheel->current_tick < target) {
+        wheel->current_tick++;
+        timer_node_t *head = &wheel->slots[wheel->current_tick % wheel->slot_count];
+
+        if (head->next == head) {
+            continue;
+        }
+
+        /* Odpojenie celého slotu do dočasného zoznamu */
+        timer_node_t pending;
+        pending.next = head->next;
+        pending.prev = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        head->next = head;
+        head->prev = head;
+
+        while (pending.next != &pending) {
+            timer_node_t *node = pending.next;
+            node_unlink(node);
+
+            if (node->expires_tick <= wheel->current_tick) {
+                node->armed = false;
+                wheel->armed_count--;
+                expired++;
+                if (callback != NULL) {
+                    callback(node, ctx);
+                }
+            } else {
+                /* Patrí do ďalšej otáčky */
+                slot_append(head, node);
+            }
+        }
+    }
+
+    return expired;
+}
+
+/**
+ * @brief Vráti počet ms do ďalšieho ticku
+ */
+int timer_wheel_timeout_ms(const timer_wheel_t *wheel, uint64_t now_ms, int max_ms) {
+    if (wheel == NULL || wheel->armed_count == 0) {
+        return max_ms;
+    }
+
+    uint64_t next_tick_ms = (wheel->current_tick + 1) * wheel->tick_ms;
+    if (next_tick_ms <= now_ms) {
+        return 0;
+    }
+
+    uint64_t wait = next_tick_ms - now_ms;
+    return wait < (uint64_t)max_ms ? (int)wait : max_ms;
+}
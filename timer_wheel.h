@@ -0,0 +1,114 @@
+/**
+ * @file timer_wheel.h
+ * @author Marcel Feiler (xfeile00)
+ * @date 10.11.2025
+ * @brief Filtering DNS Resolver - Hashed timer wheel
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Predvolené parametre kolesa: 512 slotov po 10 ms = 5,12 s na otáčku */
+#define TIMER_WHEEL_SLOTS       512
+#define TIMER_WHEEL_TICK_MS     10
+
+/**
+ * @brief Získa pointer na štruktúru obsahujúcu timer_node_t
+ *
+ * Časovače sú intrusívne - uzol je vložený priamo v štruktúre,
+ * ktorej timeout sleduje (napr. pending upstream dotaz).
+ */
+#define TIMER_ENTRY(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+/**
+ * @brief Uzol časovača (vkladá sa do vlastníckej štruktúry)
+ */
+typedef struct timer_node {
+    struct timer_node *prev;    /* Predchádzajúci uzol v slote */
+    struct timer_node *next;    /* Nasledujúci uzol v slote */
+    uint64_t expires_tick;      /* Absolútny tick expirácie */
+    bool armed;                 /* true = uzol je v kolese */
+} timer_node_t;
+
+/**
+ * @brief Hashed timer wheel
+ *
+ * Každý slot je obojsmerne zreťazený kruhový zoznam so sentinelom.
+ * Pridanie aj zrušenie časovača je O(1), posun kolesa je O(slotov
+ * od posledného posunu + expirovaných uzlov).
+ */
+typedef struct {
+    timer_node_t *slots;        /* Sentinely slotov [slot_count] */
+    size_t slot_count;          /* Počet slotov */
+    uint64_t tick_ms;           /* Granularita v milisekundách */
+    uint64_t current_tick;      /* Posledný spracovaný tick */
+    size_t armed_count;         /* Počet aktívnych časovačov */
+} timer_wheel_t;
+
+/**
+ * @brief Callback volaný pri expirácii časovača
+ * @param node Expirovaný uzol (už vybratý z kolesa)
+ * @param ctx Používateľský kontext z timer_wheel_advance()
+ */
+typedef void (*timer_callback_t)(timer_node_t *node, void *ctx);
+
+/**
+ * @brief Inicializuje timer wheel
+ * @param wheel Koleso na inicializáciu
+ * @param slot_count Počet slotov (> 0)
+ * @param tick_ms Granularita v ms (> 0)
+ * @param now_ms Aktuálny monotónny čas v ms
+ * @return 0 pri úspechu, -1 pri chybe
+ */
+int timer_wheel_init(timer_wheel_t *wheel, size_t slot_count, uint64_t tick_ms,
+                     uint64_t now_ms);
+
+/**
+ * @brief Uvoľní sloty kolesa (uzly patria volajúcemu)
+ * @param wheel Koleso
+ */
+void timer_wheel_free(timer_wheel_t *wheel);
+
+/**
+ * @brief Naplánuje (alebo preplánuje) časovač
+ * @param wheel Koleso
+ * @param node Uzol časovača
+ * @param expires_ms Absolútny monotónny čas expirácie v ms
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_node_t *node, uint64_t expires_ms);
+
+/**
+ * @brief Zruší časovač (no-op ak nie je naplánovaný)
+ * @param wheel Koleso
+ * @param node Uzol časovača
+ */
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_node_t *node);
+
+/**
+ * @brief Posunie koleso na aktuálny čas a zavolá callback pre expirované uzly
+ * @param wheel Koleso
+ * @param now_ms Aktuálny monotónny čas v ms
+ * @param callback Callback pre expirované uzly
+ * @param ctx Kontext pre callback
+ * @return Počet expirovaných časovačov
+ *
+ * Callback smie naplánovať nové časovače (aj ten istý uzol).
+ */
+size_t timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms,
+                           timer_callback_t callback, void *ctx);
+
+/**
+ * @brief Vráti počet ms do ďalšieho ticku (pre epoll_wait timeout)
+ * @param wheel Koleso
+ * @param now_ms Aktuálny monotónny čas v ms
+ * @param max_ms Horná hranica výsledku
+ * @return Timeout v ms; max_ms ak koleso neobsahuje žiadne časovače
+ */
+int timer_wheel_timeout_ms(const timer_wheel_t *wheel, uint64_t now_ms, int max_ms);
+
+#endif /* TIMER_WHEEL_H */
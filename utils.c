@@ -9,6 +9,7 @@
  #include <stdio.h>
  #include <stdlib.h>
  #include <stdarg.h>
+ #include <time.h>
  
  /**
   * @brief Vypíše chybovú správu na stderr
@@ -59,23 +60,61 @@
      fprintf(stderr, "\n");
  }
  
+ /**
+  * @brief Vráti monotónny čas v milisekundách
+  * 
+  * Používa sa pre timeouty a merania RTT - na rozdiel od gettimeofday()
+  * ho neovplyvní zmena systémového času.
+  */
+ uint64_t monotonic_ms(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+ }
+ 
+ /**
+  * @brief Vráti monotónny čas v mikrosekundách (merania RTT upstream)
+  */
+ uint64_t monotonic_us(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+ }
+ 
  /**
   * @brief Vypíše usage informácie
   */
  void print_usage(const char *program_name) {
-     printf("Usage: %s -s server [-p port] -f filter_file [-v]\n", program_name);
+     printf("Usage: %s -s server [-s server ...] [-p port] [-t threads] [-b batch] [-r sec] [-T ms] [-H pct] [-c MB] [-n MB] [-S sec] [-C file] {-f filter_file | -F compiled_filter} [-w] [-v]\n", program_name);
+     printf("       %s --compile-filter filter_file compiled_filter\n", program_name);
      printf("\n");
      printf("Filtrujúci DNS resolver\n");
      printf("\n");
      printf("Povinné parametre:\n");
-     printf("  -s server        IP adresa alebo hostname upstream DNS servera\n");
+     printf("  -s server        IP adresa alebo hostname upstream DNS servera (opakovateľný,\n");
+     printf("                   najviac 8 - dotaz ide na najrýchlejší dostupný)\n");
      printf("  -f filter_file   Súbor so zoznamom nežiadúcich domén\n");
+     printf("  -F compiled      Prekompilovaný filter (--compile-filter), načíta sa cez mmap();\n");
+     printf("                   vymieňať iba cez rename() (mv), prepísanie na mieste (cp)\n");
+     printf("                   zhodí bežiaci server (SIGBUS)\n");
      printf("\n");
      printf("Voliteľné parametre:\n");
      printf("  -p port          Port pre prijímanie dotazov (default: 53)\n");
+     printf("  -t threads       Počet worker vlákien so SO_REUSEPORT (default: 1)\n");
+     printf("  -b batch         Datagramov na recvmmsg/sendmmsg, 1 = vypnuté (default: 32)\n");
+     printf("  -r sec           Interval obnovy adresy upstream hostname, 0 = vypnuté (default: 300)\n");
+     printf("  -T ms            Strop timeoutu retransmisie upstream dotazu (default: 1000)\n");
+     printf("  -H pct           Kópia dotazu po p95 latencii, najviac pct %% dotazov (default: 0 = vypnuté)\n");
+     printf("  -c MB            Pamäťová kvóta cache odpovedí, 0 = vypnutá (default: 16)\n");
+     printf("  -n MB            Kvóta cache NXDOMAIN/NODATA odpovedí, 0 = necachujú sa (default: 4)\n");
+     printf("  -S sec           Po TTL sa záznam drží sec sekúnd a ide klientovi, ak upstream\n");
+     printf("                   neodpovie do 400 ms (RFC 8767, default: 0 = vypnuté)\n");
+     printf("  -C file          Snapshot cache - načíta sa pri štarte, zapisuje sa každých\n");
+     printf("                   300 s a pri ukončení (SIGINT/SIGTERM)\n");
+     printf("  -w               Pri zmene filter súboru ho znova načítať (inotify), inak iba SIGHUP\n");
      printf("  -v               Verbose mode - vypisuje informácie o preklade\n");
      printf("\n");
      printf("Príklad:\n");
-     printf("  sudo %s -s 8.8.8.8 -p 5353 -f blocked_domains.txt -v\n", program_name);
+     printf("  sudo %s -s 8.8.8.8 -s 1.1.1.1 -p 5353 -t 4 -f blocked_domains.txt -v\n", program_name);
      printf("\n");
  }
\ No newline at end of file
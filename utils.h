@@ -40,4 +40,16 @@
   */
  void verbose_log_raw(const char *format, ...);
  
+ /**
+  * @brief Vráti monotónny čas v milisekundách (CLOCK_MONOTONIC)
+  * @return Čas v ms od nešpecifikovaného bodu v minulosti
+  */
+ uint64_t monotonic_ms(void);
+ 
+ /**
+  * @brief Vráti monotónny čas v mikrosekundách (CLOCK_MONOTONIC)
+  * @return Čas v µs od nešpecifikovaného bodu v minulosti
+  */
+ uint64_t monotonic_us(void);
+ 
  #endif /* UTILS_H */
\ No newline at end of file